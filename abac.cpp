@@ -2,180 +2,220 @@
 #include "abac.h"
 #include "math.h"
 
-#define EVX_ENTROPY_PRECISION					(16)
-#define EVX_ENTROPY_PRECISION_MAX				((uint32(0x1) << EVX_ENTROPY_PRECISION) - 1)
-#define EVX_ENTROPY_PRECISION_MASK				((uint32(0x1) << EVX_ENTROPY_PRECISION) - 1)
-#define EVX_ENTROPY_HALF_RANGE					((EVX_ENTROPY_PRECISION_MAX >> 1))
-#define EVX_ENTROPY_QTR_RANGE					(EVX_ENTROPY_HALF_RANGE >> 1)
-#define EVX_ENTROPY_3QTR_RANGE					(3 * EVX_ENTROPY_QTR_RANGE)
-#define EVX_ENTROPY_MSB_MASK					(uint64(0x1) << (EVX_ENTROPY_PRECISION - 1))
-#define EVX_ENTROPY_SMSB_MASK					(EVX_ENTROPY_MSB_MASK >> 1)
-
-#if (EVX_ENTROPY_PRECISION > 32)
-  #error "EVX_ENTROPY_PRECISION must be <= 32"
+#define EVX_ENTROPY_PROBABILITY_BITS			(15)
+#define EVX_ENTROPY_PROBABILITY_MAX				(uint32(0x1) << EVX_ENTROPY_PROBABILITY_BITS)
+#define EVX_ENTROPY_PROBABILITY_HALF			(EVX_ENTROPY_PROBABILITY_MAX >> 1)
+#define EVX_ENTROPY_RANGE_TOP					(uint32(0x1) << 24)
+#define EVX_ENTROPY_ADAPT_COUNT_LIMIT			(86)
+
+#if (EVX_ENTROPY_PROBABILITY_BITS > 16)
+  #error "EVX_ENTROPY_PROBABILITY_BITS must be <= 16"
 #endif
 
 namespace evx {
 
 // ABAC Ranging
 //
-// + Our range for 0 is [0, mid]            (inclusive)
-// + Our range for 1 is [mid+1, high]       (inclusive)
+// + Our range for 0 is [low, low + bound)          
+// + Our range for 1 is [low + bound, low + range)  
 //
-// Thus, when encoding a zero, low should remain the same, high becomes mid.
-// When encoding a one, low should be set to mid + 1, high remains the same. 
+// where bound is the probability of a zero scaled to the current range. Whenever the 
+// range falls below EVX_ENTROPY_RANGE_TOP, the top byte of low is shifted out and the
+// range is scaled up by 256. The decoder tracks (value - low) in place of low, and 
+// reads a byte for each byte that was shifted out by the encoder.
+
+// The adaptation rate of a context begins high and slows as the context observes more
+// bits, which approximates the occurrence counts of a frequency model. Each entry is 
+// the shift applied to the probability error for a given update count.
+static const uint8 EVX_ENTROPY_ADAPT_SHIFT_LUT[EVX_ENTROPY_ADAPT_COUNT_LIMIT + 1] = {
+    1, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4,
+    4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 5, 5, 5, 5, 5, 5,
+    5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 5, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+    6, 6, 6, 6, 6, 6, 6
+};
+
+entropy_context::entropy_context()
+{
+    clear();
+}
 
-entropy_coder::entropy_coder() 
+void entropy_context::clear()
 {
-    history[0] = 1;
-    history[1] = 1;
+    probability = EVX_ENTROPY_PROBABILITY_HALF;
+    count = 0;
+}
 
-    e3_count = 0;
-    adaptive = 1;
-    model = EVX_ENTROPY_HALF_RANGE;
-    value = 0;
+void entropy_context::update(uint8 bit)
+{
+    uint8 shift = EVX_ENTROPY_ADAPT_SHIFT_LUT[count];
 
-    low = 0;
-    high = EVX_ENTROPY_PRECISION_MAX;
-    mid = EVX_ENTROPY_HALF_RANGE;
+    if (bit)
+    {
+        probability -= probability >> shift;
+    }
+    else
+    {
+        probability += (EVX_ENTROPY_PROBABILITY_MAX - probability) >> shift;
+    }
+
+    count += (count < EVX_ENTROPY_ADAPT_COUNT_LIMIT);
+}
+
+entropy_coder::entropy_coder() 
+{
+    adaptive = true;
+    initial_model = EVX_ENTROPY_PROBABILITY_HALF;
+
+    clear();
 }
 
 entropy_coder::entropy_coder(uint32 input_model) 
 {
-    history[0] = 0;
-    history[1] = 0;
+    // Static models are specified as the probability of a zero in 16 bit precision,
+    // and are clamped so that neither symbol has a zero probability.
+    uint32 probability = input_model >> (16 - EVX_ENTROPY_PROBABILITY_BITS);
 
-    model = input_model;
-    e3_count = 0;
-    adaptive = 0;
-    value = 0;
+    adaptive = false;
+    initial_model = (uint16) evx_min2(evx_max2(probability, 1), EVX_ENTROPY_PROBABILITY_MAX - 1);
 
-    low	= 0;
-    high = EVX_ENTROPY_PRECISION_MAX;
-    mid = model;
+    clear();
 }
 
 void entropy_coder::clear() 
 {
-    low	= 0;
+    model.clear();
+    model.probability = initial_model;
+
+    low = 0;
+    range = EVX_MAX_UINT32;
     value = 0;
-    e3_count = 0;
-  
-    if (adaptive) 
-    {
-        history[0] = 1;
-        history[1] = 1;
-        high = EVX_ENTROPY_PRECISION_MAX;
-        mid = EVX_ENTROPY_HALF_RANGE;
-    } 
-    else 
-    {
-        high = EVX_ENTROPY_PRECISION_MAX;
-        mid = model;
-    }
+
+    cache = 0;
+    cache_size = 1;
+    leading_byte = true;
 }
 
-void entropy_coder::resolve_model() 
+evx_status entropy_coder::shift_low(bit_stream *dest)
 {
-    uint64 mid_range = 0; 
-    uint64 range = high - low;
-    
-    if (adaptive) 
-    {
-        mid_range = range * history[0] / (history[0] + history[1]);
-    } 
-    else 
+    if (EVX_PARAM_CHECK) 
     {
-        mid_range = range * model / EVX_ENTROPY_PRECISION_MAX;
+        if (!dest) 
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
     }
 
-    mid = low + mid_range;
-}
-
-evx_status entropy_coder::encode_symbol(uint8 value) 
-{
-    // We only encode the first 2 GB instances of each symbol.
-    if (history[value] >= (2 * EVX_GB)) 
+    // The top byte of low is held back while it is 0xff, since a later carry could
+    // still ripple through it. Once the byte is settled (or a carry has occurred), the
+    // held back bytes are written with the carry applied.
+    if (low < 0xFF000000 || low > EVX_MAX_UINT32)
     {
-        return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
-    }
+        uint8 carry = (uint8) (low >> 32);
+        uint8 byte = cache;
 
-    // Adapt our model with knowledge of our recently processed value.
-    resolve_model();
+        do
+        {
+            if (!leading_byte && EVX_SUCCESS != dest->write_byte(byte + carry))
+            {
+                return evx_post_error(EVX_ERROR_CAPACITY_LIMIT);
+            }
 
-    // Encode our bit.
-    value = value & 0x1;
+            leading_byte = false;
+            byte = 0xFF;
+        } 
+        while (--cache_size);
 
-    if (value) 
-    {
-        low = mid + 1;		
-    } 
-    else 
-    {
-        high = mid;			  
+        cache = (uint8) (low >> 24);
     }
 
-    history[value]++;	
+    cache_size++;
+    low = (low & 0x00FFFFFF) << 8;
 
     return EVX_SUCCESS;
 }
 
-evx_status entropy_coder::decode_symbol(uint32 value, bit_stream *dest) 
+evx_status entropy_coder::fetch_byte(bit_stream *source)
 {
     if (EVX_PARAM_CHECK) 
     {
-        if (!dest) 
+        if (!source) 
         {
             return evx_post_error(EVX_ERROR_INVALIDARG);
         }
     }
 
-    // Adapt our model with knowledge of our recently processed value.
-    resolve_model();
+    // Reads beyond the end of the source are padded with zeroes.
+    uint8 byte = 0;
 
-    // Decode our bit.
-    if (value >= low && value <= mid) 
+    if (EVX_SUCCESS != source->read_byte(&byte))
     {
-        high = mid;
-        history[0]++;
-        dest->write_bit(0);
-    } 
-    else if (value > mid && value <= high) 
-    {
-        low = mid + 1;
-        history[1]++;
-        dest->write_bit(1);
+        byte = 0;
     }
 
+    value = (value << 8) | byte;
+
     return EVX_SUCCESS;
 }
 
-evx_status entropy_coder::flush_inverse_bits(uint8 value, bit_stream *dest) 
+evx_status entropy_coder::encode_symbol(uint8 bit, uint16 probability, bit_stream *dest) 
 {
-    if (EVX_PARAM_CHECK) 
+    uint32 bound = (range >> EVX_ENTROPY_PROBABILITY_BITS) * probability;
+
+    if (bit & 0x1) 
     {
-        if (!dest) 
+        low += bound;
+        range -= bound;
+    } 
+    else 
+    {
+        range = bound;
+    }
+
+    while (range < EVX_ENTROPY_RANGE_TOP)
+    {
+        range <<= 8;
+
+        if (EVX_SUCCESS != shift_low(dest))
         {
-            return evx_post_error(EVX_ERROR_INVALIDARG);
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
         }
     }
 
-    value = !value;
+    return EVX_SUCCESS;
+}
 
-    for (uint32 i = 0; i < e3_count; ++i) 
+evx_status entropy_coder::decode_symbol(bit_stream *source, uint16 probability, uint8 *bit) 
+{
+    uint32 bound = (range >> EVX_ENTROPY_PROBABILITY_BITS) * probability;
+
+    if (value < bound) 
     {
-        if (EVX_SUCCESS != dest->write_bit(value)) 
+        range = bound;
+        *bit = 0;
+    } 
+    else 
+    {
+        value -= bound;
+        range -= bound;
+        *bit = 1;
+    }
+
+    while (range < EVX_ENTROPY_RANGE_TOP)
+    {
+        range <<= 8;
+
+        if (EVX_SUCCESS != fetch_byte(source))
         {
             return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
         }
     }
 
-    e3_count = 0;
-
     return EVX_SUCCESS;
 }
 
-evx_status entropy_coder::resolve_encode_scaling(bit_stream *dest) 
+evx_status entropy_coder::flush_encoder(bit_stream *dest) 
 {
     if (EVX_PARAM_CHECK) 
     {
@@ -185,236 +225,222 @@ evx_status entropy_coder::resolve_encode_scaling(bit_stream *dest)
         }
     }
 
-    while (true) 
-    {
-        if ((high & EVX_ENTROPY_MSB_MASK) == (low & EVX_ENTROPY_MSB_MASK)) 
-        {
-            // E1/E2 scaling violation.
-            uint8 msb = (high & EVX_ENTROPY_MSB_MASK) >> (EVX_ENTROPY_PRECISION - 1);
-            low -= EVX_ENTROPY_HALF_RANGE * msb + msb;	
-            high -= EVX_ENTROPY_HALF_RANGE * msb + msb;	
-
-            if (EVX_SUCCESS != dest->write_bit(msb)) 
-            {
-                return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
-            }
+    // Any value in [low, low + range) identifies the coded sequence, and the decoder 
+    // pads the stream with zeroes. Rounding low up to the next multiple of 2^24 stays 
+    // within the range (which is at least 2^24), and leaves a single significant byte 
+    // to be written after those that are held back.
+    low = (low + EVX_ENTROPY_RANGE_TOP - 1) & ~uint64(EVX_ENTROPY_RANGE_TOP - 1);
 
-            if (EVX_SUCCESS != flush_inverse_bits(msb, dest)) 
-            {
-                return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
-            }
-        } 
-        else if (high <= EVX_ENTROPY_3QTR_RANGE && low > EVX_ENTROPY_QTR_RANGE) 
-        {
-            // E3 scaling violation.
-            high -= EVX_ENTROPY_QTR_RANGE + 1;
-            low	-= EVX_ENTROPY_QTR_RANGE + 1;
-            e3_count += 1;
-        } 
-        else 
-        {
-            break;
-        }
-
-        high = ((high << 0x1) & EVX_ENTROPY_PRECISION_MAX) | 0x1;
-        low = ((low  << 0x1) & EVX_ENTROPY_PRECISION_MAX) | 0x0;
+    if (EVX_SUCCESS != shift_low(dest) ||
+        EVX_SUCCESS != shift_low(dest)) 
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
+    clear();
+
     return EVX_SUCCESS;
 }
 
-evx_status entropy_coder::resolve_decode_scaling(uint32 *value, bit_stream *source, bit_stream *dest) 
+evx_status entropy_coder::encode(bit_stream *source, bit_stream *dest, bool auto_finish) 
 {
     if (EVX_PARAM_CHECK) 
     {
-        if (!value || !source || !dest) 
+        if (!source || !dest) 
         {
             return evx_post_error(EVX_ERROR_INVALIDARG);
         }
     }
 
-    uint8 bit = 0;
+    uint8 value = 0;
 
-    while (true) 
+    while (!source->is_empty()) 
     {
-        if (high <= EVX_ENTROPY_HALF_RANGE) 
-        {
-            // If our high value is less than half we do nothing 
-            // (but prevent the loop from exiting).
-        } 
-        else if (low > EVX_ENTROPY_HALF_RANGE) 
-        {
-            high -= (EVX_ENTROPY_HALF_RANGE + 1);
-            low	-= (EVX_ENTROPY_HALF_RANGE + 1);
-            *value -= (EVX_ENTROPY_HALF_RANGE + 1);
-        }	
-        else if (high <= EVX_ENTROPY_3QTR_RANGE && low > EVX_ENTROPY_QTR_RANGE) 
-        {
-            // E3 scaling violation.
-            high -= EVX_ENTROPY_QTR_RANGE + 1;
-            low	-= EVX_ENTROPY_QTR_RANGE + 1;
-            *value -= EVX_ENTROPY_QTR_RANGE + 1;
-        } 
-        else
+        if (EVX_SUCCESS != source->read_bit(&value) ||
+            EVX_SUCCESS != encode_symbol(value, model.probability, dest)) 
         {
-            break;
-        }   
+            return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+        }
 
-        if (!source->is_empty()) 
+        if (adaptive)
         {
-            if (EVX_SUCCESS != source->read_bit(&bit)) 
-            {
-                return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
-            }
+            model.update(value);
         }
+    }
 
-        high = ((high << 0x1) & EVX_ENTROPY_PRECISION_MAX) | 0x1;
-        low = ((low  << 0x1) & EVX_ENTROPY_PRECISION_MAX) | 0x0;
-        *value = ((*value << 0x1) & EVX_ENTROPY_PRECISION_MAX) | bit;
+    if (auto_finish) 
+    {
+        // We close out the tab here in order to remain consistent with the decode
+        // behavior. If stream support is required, this will require an update.
+        if (EVX_SUCCESS != flush_encoder(dest)) 
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
     }
 
     return EVX_SUCCESS;
 }
 
-evx_status entropy_coder::flush_encoder(bit_stream *dest) 
+evx_status entropy_coder::decode(uint32 symbol_count, bit_stream *source, bit_stream *dest, bool auto_start) 
 {
     if (EVX_PARAM_CHECK) 
     {
-        if (!dest) 
+        if (0 == symbol_count || !source || !dest ) 
         {
             return evx_post_error(EVX_ERROR_INVALIDARG);
         }
     }
 
-    e3_count++;
+    if (auto_start && EVX_SUCCESS != start_decode(source)) 
+    {
+        return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+    }
 
-    if (low < EVX_ENTROPY_QTR_RANGE) 
+    // Begin decoding the sequence.
+    for (uint32 i = 0; i < symbol_count; ++i) 
     {
-        if (EVX_SUCCESS != dest->write_bit(0) || 
-            EVX_SUCCESS != flush_inverse_bits(0, dest)) 
+        uint8 bit = 0;
+
+        if (EVX_SUCCESS != decode_symbol(source, model.probability, &bit) ||
+            EVX_SUCCESS != dest->write_bit(bit)) 
         {
             return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
         }
-    } 
-    else 
-    {
-        if (EVX_SUCCESS != dest->write_bit(1) ||
-            EVX_SUCCESS != flush_inverse_bits(1, dest)) 
+
+        if (adaptive)
         {
-            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            model.update(bit);
         }
     }
 
-    clear();
-
     return EVX_SUCCESS;
 }
 
-evx_status entropy_coder::encode(bit_stream *source, bit_stream *dest, bool auto_finish) 
+evx_status entropy_coder::start_decode(bit_stream *source) 
 {
     if (EVX_PARAM_CHECK) 
     {
-        if (!source || !dest) 
+        if (!source) 
         {
             return evx_post_error(EVX_ERROR_INVALIDARG);
         }
     }
 
-    uint8 value = 0;
+    clear();
 
-    while (!source->is_empty()) 
+    // We read in our initial bytes with padded tailing zeroes.
+    for (uint32 i = 0; i < 4; ++i) 
     {
-        if (EVX_SUCCESS != source->read_bit(&value) ||
-            EVX_SUCCESS != encode_symbol(value) ||
-            EVX_SUCCESS != resolve_encode_scaling(dest)) 
+        if (EVX_SUCCESS != fetch_byte(source)) 
         {
             return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
         }
     }
 
-    if (auto_finish) 
+    return EVX_SUCCESS;
+}
+
+evx_status entropy_coder::encode_bit(uint8 bit, entropy_context *context, bit_stream *dest)
+{
+    if (EVX_PARAM_CHECK) 
     {
-        // We close out the tab here in order to remain consistent with the decode
-        // behavior. If stream support is required, this will require an update.
-        if (EVX_SUCCESS != flush_encoder(dest)) 
+        if (!context || !dest) 
         {
-            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            return evx_post_error(EVX_ERROR_INVALIDARG);
         }
+    }
+
+    bit = bit & 0x1;
 
-        clear();
+    if (EVX_SUCCESS != encode_symbol(bit, context->probability, dest))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
+    context->update(bit);
+
     return EVX_SUCCESS;
 }
 
-evx_status entropy_coder::decode(uint32 symbol_count, bit_stream *source, bit_stream *dest, bool auto_start) 
+evx_status entropy_coder::decode_bit(bit_stream *source, entropy_context *context, uint8 *bit)
 {
     if (EVX_PARAM_CHECK) 
     {
-        if (0 == symbol_count || !source || !dest ) 
+        if (!source || !context || !bit) 
         {
             return evx_post_error(EVX_ERROR_INVALIDARG);
         }
     }
 
-    if (auto_start) 
+    if (EVX_SUCCESS != decode_symbol(source, context->probability, bit))
     {
-        uint8 bit = 0;
-        value = 0;
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
 
-        clear();
+    context->update(*bit);
 
-        // We read in our initial bits with padded tailing zeroes.
-        for (uint32 i = 0; i < EVX_ENTROPY_PRECISION; ++i) 
-        {
-            if (!source->is_empty()) 
-            {
-                if (EVX_SUCCESS != source->read_bit(&bit)) 
-                {
-                    return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
-                }
-            }
+    return EVX_SUCCESS;
+}
 
-            value <<= 0x1;
-            value |= bit;
+evx_status entropy_coder::encode_bits(uint32 bits, uint8 count, bit_stream *dest)
+{
+    if (EVX_PARAM_CHECK) 
+    {
+        if (count > 32 || !dest) 
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
         }
     }
 
-    // Begin decoding the sequence.
-    for (uint32 i = 0; i < symbol_count; ++i) 
+    for (uint8 i = 0; i < count; ++i, bits >>= 1) 
     {
-        if (EVX_SUCCESS != decode_symbol(value, dest) ||
-            EVX_SUCCESS != resolve_decode_scaling(&value, source, dest)) 
+        uint8 bit = bits & 0x1;
+
+        if (EVX_SUCCESS != encode_symbol(bit, model.probability, dest)) 
         {
-            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+        }
+
+        if (adaptive)
+        {
+            model.update(bit);
         }
     }
 
     return EVX_SUCCESS;
 }
 
-evx_status entropy_coder::start_decode(bit_stream *source) 
+evx_status entropy_coder::decode_bits(uint8 count, bit_stream *source, uint32 *bits)
 {
-    uint8 bit = 0;
-    value = 0;
+    if (EVX_PARAM_CHECK) 
+    {
+        if (count > 32 || !source || !bits) 
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
 
-    clear();
+    uint32 result = 0;
 
-    // We read in our initial bits with padded tailing zeroes.
-    for (uint32 i = 0; i < EVX_ENTROPY_PRECISION; ++i) 
+    for (uint8 i = 0; i < count; ++i) 
     {
-        if (!source->is_empty()) 
+        uint8 bit = 0;
+
+        if (EVX_SUCCESS != decode_symbol(source, model.probability, &bit)) 
         {
-            if (EVX_SUCCESS != source->read_bit(&bit)) 
-            {
-                return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
-            }
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
         }
 
-        value <<= 0x1;
-        value |= bit;
+        if (adaptive)
+        {
+            model.update(bit);
+        }
+
+        result |= (uint32(bit) << i);
     }
 
+    *bits = result;
+
     return EVX_SUCCESS;
 }
 
@@ -425,8 +451,6 @@ evx_status entropy_coder::finish_encode(bit_stream *dest)
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    clear();
-
     return EVX_SUCCESS;
 }
 
@@ -56,30 +56,56 @@
 
 namespace evx {
 
+// The coder is a 32 bit binary range coder. The range is renormalized a byte at a time,
+// and a carry out of the low end of the range is propagated into the bytes that were 
+// already produced (see shift_low), so the coder reads and writes whole bytes only.
+// Probabilities are adapted with a shift rather than with occurrence counts, so neither
+// the encoder nor the decoder performs a division.
+
+// An entropy context is an adaptive binary probability model that is owned by the
+// caller rather than the coder. Callers may maintain a bank of contexts (e.g. one per 
+// syntax element and bit position) and select one for each bit that is coded.
+
+class entropy_context
+{
+    friend class entropy_coder;
+
+    uint16 probability;     // probability of a zero, see EVX_ENTROPY_PROBABILITY_BITS.
+    uint8 count;            // number of updates, used to select the adaptation rate.
+
+private:
+
+    void update(uint8 bit);
+
+public:
+
+    entropy_context();
+    void clear();
+};
+
 class entropy_coder 
 {
     bool adaptive;
-    uint32 e3_count;
-    uint32 history[2];
+    uint16 initial_model;
+    entropy_context model;
+
+    uint64 low;
+    uint32 range;
     uint32 value;
 
-    uint32 model;
-    uint32 low;
-    uint32 high;
-    uint32 mid;
+    uint8 cache;            // most recent output byte, held back until it cannot carry.
+    uint32 cache_size;      // number of held back bytes (the cache, and any 0xff bytes).
+    bool leading_byte;      // the first held back byte is always zero and is not written.
 
 private:
 
-    void resolve_model();
+    evx_status shift_low(bit_stream *dest);
+    evx_status fetch_byte(bit_stream *source);
 
     evx_status flush_encoder(bit_stream *dest);
-    evx_status flush_inverse_bits(uint8 value, bit_stream *dest);
-
-    evx_status encode_symbol(uint8 value);
-    evx_status decode_symbol(uint32 value, bit_stream *dest);
 
-    evx_status resolve_encode_scaling(bit_stream *dest);
-    evx_status resolve_decode_scaling(uint32 *value, bit_stream *source, bit_stream *dest);
+    evx_status encode_symbol(uint8 bit, uint16 probability, bit_stream *dest);
+    evx_status decode_symbol(bit_stream *source, uint16 probability, uint8 *bit);
 
 public:
 
@@ -93,6 +119,17 @@ public:
     evx_status start_decode(bit_stream *source);
     evx_status finish_encode(bit_stream *dest);
 
+    // Incrementally codes a single bit against an external context. These may be freely
+    // interleaved with incremental encode and decode calls.
+    evx_status encode_bit(uint8 bit, entropy_context *context, bit_stream *dest);
+    evx_status decode_bit(bit_stream *source, entropy_context *context, uint8 *bit);
+
+    // Incrementally codes up to 32 bits (lsb first) against the internal model. This is
+    // equivalent to an incremental encode or decode of a stream that holds the same 
+    // bits, but does not require the caller to stage them in a bit_stream.
+    evx_status encode_bits(uint32 bits, uint8 count, bit_stream *dest);
+    evx_status decode_bits(uint8 count, bit_stream *source, uint32 *bits);
+
 private:
 
     EVX_DISABLE_COPY_AND_ASSIGN(entropy_coder);
@@ -0,0 +1,419 @@
+
+#include "analysis.h"
+
+#if defined (EVX_SIMD_X86_SUPPORTED)
+#include "emmintrin.h"
+#include "immintrin.h"
+#endif
+
+namespace evx {
+
+// Vectorized block metrics
+//
+// All kernels operate on the unsigned absolute difference |a - b|, computed as
+// max(a, b) - min(a, b). This is exact for the full int16 range (the result
+// always fits in 16 unsigned bits), so the vector kernels are bit-exact with
+// the scalar versions for any input. SSE2 lacks unsigned 16 bit compares and
+// sign-agnostic horizontal adds, so differences are biased by -32768 to allow
+// the signed max and multiply-add instructions to be used, and the bias is
+// removed from the final result.
+
+#if defined (EVX_SIMD_X86_SUPPORTED)
+
+#define EVX_METRIC_BIAS                 (0x8000)
+#define EVX_METRIC_LUMA_BIAS            (EVX_MACROBLOCK_LUMINANCE_SIZE * EVX_METRIC_BIAS)
+
+static EVX_TARGET_SSE2 inline __m128i abs_diff_sse2(__m128i a, __m128i b)
+{
+    return _mm_sub_epi16(_mm_max_epi16(a, b), _mm_min_epi16(a, b));
+}
+
+static EVX_TARGET_SSE2 inline __m128i biased_abs_diff_sse2(__m128i a, __m128i b)
+{
+    return _mm_xor_si128(abs_diff_sse2(a, b), _mm_set1_epi16((int16) EVX_METRIC_BIAS));
+}
+
+static EVX_TARGET_SSE2 inline uint32 horizontal_add_sse2(__m128i value)
+{
+    value = _mm_add_epi32(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2)));
+    value = _mm_add_epi32(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return (uint32) _mm_cvtsi128_si32(value);
+}
+
+static EVX_TARGET_SSE2 inline int32 horizontal_max_sse2(__m128i value)
+{
+    value = _mm_max_epi16(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(1, 0, 3, 2)));
+    value = _mm_max_epi16(value, _mm_shuffle_epi32(value, _MM_SHUFFLE(2, 3, 0, 1)));
+    value = _mm_max_epi16(value, _mm_shufflelo_epi16(value, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return (int16) _mm_cvtsi128_si32(value);
+}
+
+// Accumulates the squares of unsigned 16 bit values into 32 bit lanes.
+static EVX_TARGET_SSE2 inline __m128i accumulate_squares_sse2(__m128i sum, __m128i value)
+{
+    __m128i lo = _mm_mullo_epi16(value, value);
+    __m128i hi = _mm_mulhi_epu16(value, value);
+
+    sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(lo, hi));
+    sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(lo, hi));
+
+    return sum;
+}
+
+// Returns the (biased) maximum absolute difference of the chroma channels.
+static EVX_TARGET_SSE2 inline __m128i chroma_biased_max_sse2(const macroblock &left, const macroblock &right, __m128i max)
+{
+    uint32 left_stride = left.stride >> 1;
+    uint32 right_stride = right.stride >> 1;
+
+    for (uint32 j = 0; j < (EVX_MACROBLOCK_SIZE >> 1); ++j)
+    {
+        __m128i lu = _mm_loadu_si128((const __m128i *) (left.data_u + j * left_stride));
+        __m128i ru = _mm_loadu_si128((const __m128i *) (right.data_u + j * right_stride));
+        __m128i lv = _mm_loadu_si128((const __m128i *) (left.data_v + j * left_stride));
+        __m128i rv = _mm_loadu_si128((const __m128i *) (right.data_v + j * right_stride));
+
+        max = _mm_max_epi16(max, biased_abs_diff_sse2(lu, ru));
+        max = _mm_max_epi16(max, biased_abs_diff_sse2(lv, rv));
+    }
+
+    return max;
+}
+
+static EVX_TARGET_SSE2 int32 compute_block_sad_sse2(const macroblock &left, const macroblock &right)
+{
+    __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+
+    for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)
+    {
+        const int16 *left_row = left.data_y + j * left.stride;
+        const int16 *right_row = right.data_y + j * right.stride;
+
+        __m128i d0 = biased_abs_diff_sse2(_mm_loadu_si128((const __m128i *) left_row), _mm_loadu_si128((const __m128i *) right_row));
+        __m128i d1 = biased_abs_diff_sse2(_mm_loadu_si128((const __m128i *) (left_row + 8)), _mm_loadu_si128((const __m128i *) (right_row + 8)));
+
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(d0, ones));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(d1, ones));
+    }
+
+    return (int32) (horizontal_add_sse2(sum) + EVX_METRIC_LUMA_BIAS);
+}
+
+static EVX_TARGET_SSE2 int32 compute_block_ssd_sse2(const macroblock &left, const macroblock &right)
+{
+    __m128i sum = _mm_setzero_si128();
+
+    for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)
+    {
+        const int16 *left_row = left.data_y + j * left.stride;
+        const int16 *right_row = right.data_y + j * right.stride;
+
+        __m128i d0 = abs_diff_sse2(_mm_loadu_si128((const __m128i *) left_row), _mm_loadu_si128((const __m128i *) right_row));
+        __m128i d1 = abs_diff_sse2(_mm_loadu_si128((const __m128i *) (left_row + 8)), _mm_loadu_si128((const __m128i *) (right_row + 8)));
+
+        sum = accumulate_squares_sse2(sum, d0);
+        sum = accumulate_squares_sse2(sum, d1);
+    }
+
+    return (int32) horizontal_add_sse2(sum);
+}
+
+static EVX_TARGET_SSE2 int32 compute_block_mad_sse2(const macroblock &left, const macroblock &right)
+{
+    __m128i max = _mm_set1_epi16((int16) EVX_METRIC_BIAS);
+
+    for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)
+    {
+        const int16 *left_row = left.data_y + j * left.stride;
+        const int16 *right_row = right.data_y + j * right.stride;
+
+        __m128i d0 = biased_abs_diff_sse2(_mm_loadu_si128((const __m128i *) left_row), _mm_loadu_si128((const __m128i *) right_row));
+        __m128i d1 = biased_abs_diff_sse2(_mm_loadu_si128((const __m128i *) (left_row + 8)), _mm_loadu_si128((const __m128i *) (right_row + 8)));
+
+        max = _mm_max_epi16(max, _mm_max_epi16(d0, d1));
+    }
+
+    max = chroma_biased_max_sse2(left, right, max);
+
+    return horizontal_max_sse2(max) + EVX_METRIC_BIAS;
+}
+
+static EVX_TARGET_SSE2 int32 compute_block_sad_mad_sse2(const macroblock &left, const macroblock &right, int32 *mad)
+{
+    __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+    __m128i max = _mm_set1_epi16((int16) EVX_METRIC_BIAS);
+
+    for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)
+    {
+        const int16 *left_row = left.data_y + j * left.stride;
+        const int16 *right_row = right.data_y + j * right.stride;
+
+        __m128i d0 = biased_abs_diff_sse2(_mm_loadu_si128((const __m128i *) left_row), _mm_loadu_si128((const __m128i *) right_row));
+        __m128i d1 = biased_abs_diff_sse2(_mm_loadu_si128((const __m128i *) (left_row + 8)), _mm_loadu_si128((const __m128i *) (right_row + 8)));
+
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(d0, ones));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(d1, ones));
+        max = _mm_max_epi16(max, _mm_max_epi16(d0, d1));
+    }
+
+    max = chroma_biased_max_sse2(left, right, max);
+    *mad = horizontal_max_sse2(max) + EVX_METRIC_BIAS;
+
+    return (int32) (horizontal_add_sse2(sum) + EVX_METRIC_LUMA_BIAS);
+}
+
+static EVX_TARGET_SSE2 int32 compute_block_sad_mad_bounded_sse2(const macroblock &left, const macroblock &right, int32 sad_limit, int32 mad_limit, int32 *mad)
+{
+    __m128i ones = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128();
+    __m128i max = _mm_set1_epi16((int16) EVX_METRIC_BIAS);
+
+    for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)
+    {
+        const int16 *left_row = left.data_y + j * left.stride;
+        const int16 *right_row = right.data_y + j * right.stride;
+
+        __m128i d0 = biased_abs_diff_sse2(_mm_loadu_si128((const __m128i *) left_row), _mm_loadu_si128((const __m128i *) right_row));
+        __m128i d1 = biased_abs_diff_sse2(_mm_loadu_si128((const __m128i *) (left_row + 8)), _mm_loadu_si128((const __m128i *) (right_row + 8)));
+
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(d0, ones));
+        sum = _mm_add_epi32(sum, _mm_madd_epi16(d1, ones));
+        max = _mm_max_epi16(max, _mm_max_epi16(d0, d1));
+
+        if (0 == ((j + 1) % EVX_PARTIAL_SAD_ROWS))
+        {
+            int32 sad = (int32) (horizontal_add_sse2(sum) + (j + 1) * EVX_MACROBLOCK_SIZE * EVX_METRIC_BIAS);
+            int32 partial_mad = horizontal_max_sse2(max) + EVX_METRIC_BIAS;
+
+            if (sad >= sad_limit && partial_mad >= mad_limit)
+            {
+                *mad = partial_mad;
+                return sad;
+            }
+        }
+    }
+
+    max = chroma_biased_max_sse2(left, right, max);
+    *mad = horizontal_max_sse2(max) + EVX_METRIC_BIAS;
+
+    return (int32) (horizontal_add_sse2(sum) + EVX_METRIC_LUMA_BIAS);
+}
+
+static EVX_TARGET_AVX2 inline __m256i biased_abs_diff_avx2(__m256i a, __m256i b)
+{
+    __m256i diff = _mm256_sub_epi16(_mm256_max_epi16(a, b), _mm256_min_epi16(a, b));
+    return _mm256_xor_si256(diff, _mm256_set1_epi16((int16) EVX_METRIC_BIAS));
+}
+
+static EVX_TARGET_AVX2 inline __m256i load_luma_row_avx2(const macroblock &block, uint32 row)
+{
+    return _mm256_loadu_si256((const __m256i *) (block.data_y + row * block.stride));
+}
+
+// Loads a row of the u channel into the low lane and the same row of the v
+// channel into the high lane.
+static EVX_TARGET_AVX2 inline __m256i load_chroma_row_avx2(const macroblock &block, uint32 row)
+{
+    uint32 stride = block.stride >> 1;
+    __m128i u = _mm_loadu_si128((const __m128i *) (block.data_u + row * stride));
+    __m128i v = _mm_loadu_si128((const __m128i *) (block.data_v + row * stride));
+
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(u), v, 1);
+}
+
+static EVX_TARGET_AVX2 inline uint32 horizontal_add_avx2(__m256i value)
+{
+    return horizontal_add_sse2(_mm_add_epi32(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1)));
+}
+
+static EVX_TARGET_AVX2 inline int32 horizontal_max_avx2(__m256i value)
+{
+    return horizontal_max_sse2(_mm_max_epi16(_mm256_castsi256_si128(value), _mm256_extracti128_si256(value, 1)));
+}
+
+static EVX_TARGET_AVX2 inline __m256i chroma_biased_max_avx2(const macroblock &left, const macroblock &right, __m256i max)
+{
+    for (uint32 j = 0; j < (EVX_MACROBLOCK_SIZE >> 1); ++j)
+    {
+        max = _mm256_max_epi16(max, biased_abs_diff_avx2(load_chroma_row_avx2(left, j), load_chroma_row_avx2(right, j)));
+    }
+
+    return max;
+}
+
+static EVX_TARGET_AVX2 int32 compute_block_sad_avx2(const macroblock &left, const macroblock &right)
+{
+    __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+
+    for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)
+    {
+        __m256i d = biased_abs_diff_avx2(load_luma_row_avx2(left, j), load_luma_row_avx2(right, j));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(d, ones));
+    }
+
+    return (int32) (horizontal_add_avx2(sum) + EVX_METRIC_LUMA_BIAS);
+}
+
+static EVX_TARGET_AVX2 int32 compute_block_ssd_avx2(const macroblock &left, const macroblock &right)
+{
+    __m256i sum = _mm256_setzero_si256();
+
+    for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)
+    {
+        __m256i a = load_luma_row_avx2(left, j);
+        __m256i b = load_luma_row_avx2(right, j);
+        __m256i d = _mm256_sub_epi16(_mm256_max_epi16(a, b), _mm256_min_epi16(a, b));
+        __m256i lo = _mm256_mullo_epi16(d, d);
+        __m256i hi = _mm256_mulhi_epu16(d, d);
+
+        sum = _mm256_add_epi32(sum, _mm256_unpacklo_epi16(lo, hi));
+        sum = _mm256_add_epi32(sum, _mm256_unpackhi_epi16(lo, hi));
+    }
+
+    return (int32) horizontal_add_avx2(sum);
+}
+
+static EVX_TARGET_AVX2 int32 compute_block_mad_avx2(const macroblock &left, const macroblock &right)
+{
+    __m256i max = _mm256_set1_epi16((int16) EVX_METRIC_BIAS);
+
+    for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)
+    {
+        max = _mm256_max_epi16(max, biased_abs_diff_avx2(load_luma_row_avx2(left, j), load_luma_row_avx2(right, j)));
+    }
+
+    max = chroma_biased_max_avx2(left, right, max);
+
+    return horizontal_max_avx2(max) + EVX_METRIC_BIAS;
+}
+
+static EVX_TARGET_AVX2 int32 compute_block_sad_mad_avx2(const macroblock &left, const macroblock &right, int32 *mad)
+{
+    __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    __m256i max = _mm256_set1_epi16((int16) EVX_METRIC_BIAS);
+
+    for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)
+    {
+        __m256i d = biased_abs_diff_avx2(load_luma_row_avx2(left, j), load_luma_row_avx2(right, j));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(d, ones));
+        max = _mm256_max_epi16(max, d);
+    }
+
+    max = chroma_biased_max_avx2(left, right, max);
+    *mad = horizontal_max_avx2(max) + EVX_METRIC_BIAS;
+
+    return (int32) (horizontal_add_avx2(sum) + EVX_METRIC_LUMA_BIAS);
+}
+
+static EVX_TARGET_AVX2 int32 compute_block_sad_mad_bounded_avx2(const macroblock &left, const macroblock &right, int32 sad_limit, int32 mad_limit, int32 *mad)
+{
+    __m256i ones = _mm256_set1_epi16(1);
+    __m256i sum = _mm256_setzero_si256();
+    __m256i max = _mm256_set1_epi16((int16) EVX_METRIC_BIAS);
+
+    for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)
+    {
+        __m256i d = biased_abs_diff_avx2(load_luma_row_avx2(left, j), load_luma_row_avx2(right, j));
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(d, ones));
+        max = _mm256_max_epi16(max, d);
+
+        if (0 == ((j + 1) % EVX_PARTIAL_SAD_ROWS))
+        {
+            int32 sad = (int32) (horizontal_add_avx2(sum) + (j + 1) * EVX_MACROBLOCK_SIZE * EVX_METRIC_BIAS);
+            int32 partial_mad = horizontal_max_avx2(max) + EVX_METRIC_BIAS;
+
+            if (sad >= sad_limit && partial_mad >= mad_limit)
+            {
+                *mad = partial_mad;
+                return sad;
+            }
+        }
+    }
+
+    max = chroma_biased_max_avx2(left, right, max);
+    *mad = horizontal_max_avx2(max) + EVX_METRIC_BIAS;
+
+    return (int32) (horizontal_add_avx2(sum) + EVX_METRIC_LUMA_BIAS);
+}
+
+#endif // EVX_SIMD_X86_SUPPORTED
+
+static const evx_block_metric_kernels scalar_metric_kernels = 
+{
+    compute_block_sad_scalar,
+    compute_block_ssd_scalar,
+    compute_block_mad_scalar,
+    compute_block_sad_mad_scalar,
+    compute_block_sad_mad_bounded_scalar,
+    EVX_SIMD_SCALAR,
+};
+
+#if defined (EVX_SIMD_X86_SUPPORTED)
+
+static const evx_block_metric_kernels sse2_metric_kernels = 
+{
+    compute_block_sad_sse2,
+    compute_block_ssd_sse2,
+    compute_block_mad_sse2,
+    compute_block_sad_mad_sse2,
+    compute_block_sad_mad_bounded_sse2,
+    EVX_SIMD_SSE2,
+};
+
+static const evx_block_metric_kernels avx2_metric_kernels = 
+{
+    compute_block_sad_avx2,
+    compute_block_ssd_avx2,
+    compute_block_mad_avx2,
+    compute_block_sad_mad_avx2,
+    compute_block_sad_mad_bounded_avx2,
+    EVX_SIMD_AVX2,
+};
+
+#endif
+
+static const evx_block_metric_kernels *active_metric_kernels = NULL;
+
+static const evx_block_metric_kernels *query_metric_kernels_by_level(EVX_SIMD_LEVEL level)
+{
+    switch (level)
+    {
+#if defined (EVX_SIMD_X86_SUPPORTED)
+        case EVX_SIMD_AVX2: return &avx2_metric_kernels;
+        case EVX_SIMD_SSE41:
+        case EVX_SIMD_SSE2: return &sse2_metric_kernels;
+#endif
+        default: break;
+    };
+
+    return &scalar_metric_kernels;
+}
+
+const evx_block_metric_kernels &query_block_metric_kernels()
+{
+    // The default kernels are selected once, on first use, by a thread safe local static.
+    // active_metric_kernels only holds an override from select_block_metric_kernels.
+    static const evx_block_metric_kernels *default_kernels = query_metric_kernels_by_level(query_simd_level());
+
+    return active_metric_kernels ? *active_metric_kernels : *default_kernels;
+}
+
+evx_status select_block_metric_kernels(EVX_SIMD_LEVEL level)
+{
+    if (level > query_simd_level())
+    {
+        return evx_post_error(EVX_ERROR_NOTIMPL);
+    }
+
+    active_metric_kernels = query_metric_kernels_by_level(level);
+
+    return EVX_SUCCESS;
+}
+
+} // namespace evx
\ No newline at end of file
@@ -34,12 +34,19 @@
 #define __EVX_BLOCK_ANALYSIS_H__
 
 #include "base.h"
+#include "cpu.h"
 #include "macroblock.h"
 
 namespace evx {
 
+// Block metrics
+//
+//   The *_scalar functions below are the reference implementations. The
+//   un-suffixed versions dispatch to the kernels selected for the host
+//   processor (see EVX_ENABLE_SIMD), which are bit-exact with the reference.
+
 // Computes a sum of absolute differences between two blocks.
-inline int32 compute_block_sad(const macroblock &left, const macroblock &right)
+inline int32 compute_block_sad_scalar(const macroblock &left, const macroblock &right)
 {
     int32 sad = 0;
     int32 temp = 0;
@@ -67,24 +74,8 @@ inline int32 compute_block_sad(const macroblock &delta)
     return sad;
 }
 
-// Computes the mean squared error of two blocks.
-inline int32 compute_block_mse(const macroblock &left, const macroblock &right)
-{
-    int32 mse = 0;
-    int32 temp = 0;
-
-    for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)                                                
-    for (uint32 i = 0; i < EVX_MACROBLOCK_SIZE; ++i)                                                
-    {          
-        temp = (left.data_y[j *left.stride + i] - right.data_y[j * right.stride + i]);
-        mse += (temp * temp);                    
-    }  
-
-    return mse >> (EVX_MACROBLOCK_SHIFT + EVX_MACROBLOCK_SHIFT);
-}
-
 // Computes a sum of squared differences between two blocks.
-inline int32 compute_block_ssd(const macroblock &left, const macroblock &right)
+inline int32 compute_block_ssd_scalar(const macroblock &left, const macroblock &right)
 {
     int32 ssd = 0;
     int32 temp = 0;
@@ -100,7 +91,7 @@ inline int32 compute_block_ssd(const macroblock &left, const macroblock &right)
 }
 
 // Computes the maximum absolute difference between two blocks.
-inline int32 compute_block_mad(const macroblock &left, const macroblock &right)
+inline int32 compute_block_mad_scalar(const macroblock &left, const macroblock &right)
 {
     int32 mad = 0;
 
@@ -124,6 +115,134 @@ inline int32 compute_block_mad(const macroblock &left, const macroblock &right)
     return mad;
 }
 
+// Computes the luma sad and the full block mad in a single pass. The results
+// match separate calls to compute_block_sad and compute_block_mad.
+inline int32 compute_block_sad_mad_scalar(const macroblock &left, const macroblock &right, int32 *mad)
+{
+    int32 sad = 0;
+    int32 max = 0;
+
+    for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)                                                
+    for (uint32 i = 0; i < EVX_MACROBLOCK_SIZE; ++i)                                                
+    {          
+        int32 temp = abs(left.data_y[j * left.stride + i] - right.data_y[j * right.stride + i]);
+        sad += temp;
+        max = evx_max2(temp, max);                     
+    }  
+
+    for (uint32 j = 0; j < (EVX_MACROBLOCK_SIZE >> 1); ++j)                                                
+    for (uint32 i = 0; i < (EVX_MACROBLOCK_SIZE >> 1); ++i)                                                
+    {          
+        int32 temp_u = abs(left.data_u[j * (left.stride >> 1) + i] - right.data_u[j * (right.stride >> 1) + i]);
+        int32 temp_v = abs(left.data_v[j * (left.stride >> 1) + i] - right.data_v[j * (right.stride >> 1) + i]);
+        max = evx_max2(temp_u, max);    
+        max = evx_max2(temp_v, max); 
+    }  
+
+    *mad = max;
+
+    return sad;
+}
+
+// Partial distortion elimination
+//
+//   compute_block_sad_mad_bounded returns the same results as compute_block_sad_mad
+//   unless the candidate is known to lose, i.e. its running luma sad has reached 
+//   sad_limit and its running mad has reached mad_limit. In that case it stops
+//   early and returns lower bounds that are still >= their respective limits, so
+//   callers may apply their usual comparisons to the (partial) results. 
+//
+//   The scalar kernel checks its limits after every row. The vector kernels 
+//   require a horizontal reduction per check, so they only check every 
+//   EVX_PARTIAL_SAD_ROWS rows.
+
+#define EVX_PARTIAL_SAD_ROWS        (8)
+
+inline int32 compute_block_sad_mad_bounded_scalar(const macroblock &left, const macroblock &right, int32 sad_limit, int32 mad_limit, int32 *mad)
+{
+    int32 sad = 0;
+    int32 max = 0;
+
+    for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)                                                
+    {
+        for (uint32 i = 0; i < EVX_MACROBLOCK_SIZE; ++i)                                                
+        {          
+            int32 temp = abs(left.data_y[j * left.stride + i] - right.data_y[j * right.stride + i]);
+            sad += temp;
+            max = evx_max2(temp, max);                     
+        }
+
+        if (sad >= sad_limit && max >= mad_limit)
+        {
+            *mad = max;
+            return sad;
+        }
+    }  
+
+    for (uint32 j = 0; j < (EVX_MACROBLOCK_SIZE >> 1); ++j)                                                
+    for (uint32 i = 0; i < (EVX_MACROBLOCK_SIZE >> 1); ++i)                                                
+    {          
+        int32 temp_u = abs(left.data_u[j * (left.stride >> 1) + i] - right.data_u[j * (right.stride >> 1) + i]);
+        int32 temp_v = abs(left.data_v[j * (left.stride >> 1) + i] - right.data_v[j * (right.stride >> 1) + i]);
+        max = evx_max2(temp_u, max);    
+        max = evx_max2(temp_v, max); 
+    }  
+
+    *mad = max;
+
+    return sad;
+}
+
+typedef struct evx_block_metric_kernels
+{
+    int32 (*sad)(const macroblock &left, const macroblock &right);
+    int32 (*ssd)(const macroblock &left, const macroblock &right);
+    int32 (*mad)(const macroblock &left, const macroblock &right);
+    int32 (*sad_mad)(const macroblock &left, const macroblock &right, int32 *mad);
+    int32 (*sad_mad_bounded)(const macroblock &left, const macroblock &right, int32 sad_limit, int32 mad_limit, int32 *mad);
+    EVX_SIMD_LEVEL level;
+
+} evx_block_metric_kernels;
+
+// Returns the active kernels. By default these are the fastest kernels that 
+// are supported by the host processor.
+const evx_block_metric_kernels &query_block_metric_kernels();
+
+// Overrides the active kernels, e.g. to compare against the scalar reference. 
+// Fails if the requested level is not supported by the host processor.
+evx_status select_block_metric_kernels(EVX_SIMD_LEVEL level);
+
+inline int32 compute_block_sad(const macroblock &left, const macroblock &right)
+{
+    return query_block_metric_kernels().sad(left, right);
+}
+
+inline int32 compute_block_ssd(const macroblock &left, const macroblock &right)
+{
+    return query_block_metric_kernels().ssd(left, right);
+}
+
+inline int32 compute_block_mad(const macroblock &left, const macroblock &right)
+{
+    return query_block_metric_kernels().mad(left, right);
+}
+
+inline int32 compute_block_sad_mad(const macroblock &left, const macroblock &right, int32 *mad)
+{
+    return query_block_metric_kernels().sad_mad(left, right, mad);
+}
+
+inline int32 compute_block_sad_mad_bounded(const macroblock &left, const macroblock &right, int32 sad_limit, int32 mad_limit, int32 *mad)
+{
+    return query_block_metric_kernels().sad_mad_bounded(left, right, sad_limit, mad_limit, mad);
+}
+
+// Computes the mean squared error of two blocks.
+inline int32 compute_block_mse(const macroblock &left, const macroblock &right)
+{
+    return compute_block_ssd(left, right) >> (EVX_MACROBLOCK_SHIFT + EVX_MACROBLOCK_SHIFT);
+}
+
 // Computes the mean of the block.
 inline int32 compute_block_mean(const macroblock &src)
 {
@@ -60,6 +60,13 @@
     #elif TARGET_OS_MAC
         #define EVX_PLATFORM_MACOSX                       // building a Mac OSX application
     #endif
+#elif defined (__linux__)
+    #include "unistd.h"
+    #include "stdint.h"
+    #include "sys/types.h"
+    #include "ctype.h"
+
+    #define EVX_PLATFORM_LINUX                            // building a Linux application
 #else
     #error "Unsupported target platform detected."
 #endif
@@ -88,6 +95,14 @@
        #endif
     #endif
     #define __EVX_FUNCTION__ __func__
+#elif defined (EVX_PLATFORM_LINUX)
+    #ifdef DEBUG
+        #define EVX_DEBUG DEBUG
+        #if !defined(debug_break)
+            #define debug_break() __builtin_trap()
+        #endif
+    #endif
+    #define __EVX_FUNCTION__ __func__
 #endif
 
 /**********************************************************************************
@@ -129,6 +144,16 @@ namespace evx {
     typedef u_int32_t uint32;	    
     typedef u_int16_t uint16;	    
     typedef u_int8_t uint8;	 
+#elif defined (EVX_PLATFORM_LINUX)
+    typedef int64_t int64;
+    typedef int32_t int32;
+    typedef int16_t int16;
+    typedef int8_t  int8;
+
+    typedef uint64_t uint64;
+    typedef uint32_t uint32;
+    typedef uint16_t uint16;
+    typedef uint8_t  uint8;
 #endif
 
 typedef float float32;         
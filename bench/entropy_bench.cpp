@@ -0,0 +1,715 @@
+
+#include "../evx1.h"
+#include "../config.h"
+#include "../math.h"
+#include "../macroblock.h"
+#include "../scan.h"
+#include "../stream.h"
+#include "../symbol.h"
+
+// evx_entropy_bench
+//
+//   Measures the entropy layer in isolation. The quantized coefficient blocks of a
+//   synthetic or file based RGB sequence are captured from the encoder (see
+//   query_coefficients), or played back from a recorded corpus, and are then coded
+//   by each of the following backends:
+//
+//     symbol   the symbol_coder in each EVX_ENTROPY_MODE, coding every block as
+//              serialize_block_8x8 does (a run length followed by the coefficients).
+//     stream   entropy_rle_stream_encode_8x8 / decode_8x8, the golomb precoder with
+//              the adaptive binary coder.
+//     coder    entropy_coder::encode / decode alone, over the golomb precoded bits
+//              of the corpus.
+//
+//   For each backend the bench reports encode and decode throughput in MB/s of
+//   coefficient data, the coded size in bits per block and per coefficient, and
+//   whether the decoded blocks match the corpus. Throughput is taken from the
+//   fastest of the repeated runs.
+//
+//   The conformance mode hashes the coded output of each backend and compares it
+//   against a golden file, so that an entropy optimization can be shown to be bit
+//   exact before it ships. Captured coefficients change whenever the encoder does,
+//   so golden files should be recorded against a fixed corpus (see -w and -r).
+//
+//   Build by compiling this file together with the codec sources, e.g.:
+//
+//     c++ -O2 -o evx_entropy_bench bench/entropy_bench.cpp *.cpp
+//
+//   Usage:
+//
+//     evx_entropy_bench [-s WxH] [-q quality] [-n frames] [-i file.rgb] [-k repeats]
+//                       [-w corpus] [-r corpus] [-u golden] [-g golden]
+//
+//   -w records the captured corpus to a file, and -r plays a recorded corpus back in
+//   place of the encoder. -u writes the coded hashes of every backend to a golden
+//   file, and -g verifies them against one (the bench fails on any mismatch).
+
+using namespace evx;
+
+#define EVX_ENTROPY_BENCH_BACKENDS      (EVX_ENTROPY_MODE_COUNT + 2)
+#define EVX_ENTROPY_BENCH_MAGIC         (0x43585645)        // 'EVXC'
+
+typedef struct evx_entropy_corpus
+{
+    int16 *blocks;              // 64 coefficients per block, in raster order.
+    uint32 block_count;
+    uint32 checksum;
+
+} evx_entropy_corpus;
+
+typedef struct evx_entropy_result
+{
+    char name[32];
+    uint64 encode_time;         // fastest encode of the corpus, in nanoseconds.
+    uint64 decode_time;         // fastest decode of the corpus, in nanoseconds.
+    uint32 coded_bits;
+    uint32 checksum;            // hash of the coded output.
+    bool round_trip;            // true if the decoded blocks match the corpus.
+
+} evx_entropy_result;
+
+static uint32 update_checksum(uint32 hash, const uint8 *data, uint32 bit_count)
+{
+    // FNV-1a over the coded bits. Unused bits of the final byte are not
+    // guaranteed to be zero, so we mask them out.
+    uint32 byte_count = align(bit_count, 8) >> 3;
+
+    for (uint32 i = 0; i < byte_count; ++i)
+    {
+        uint8 value = data[i];
+
+        if (i == (bit_count >> 3))
+        {
+            value &= (0x1 << (bit_count & 0x7)) - 1;
+        }
+
+        hash ^= value;
+        hash *= 16777619;
+    }
+
+    return hash;
+}
+
+static void generate_synthetic_frame(uint32 index, uint32 width, uint32 height, uint8 *output)
+{
+    // A panning textured background with a moving object, see evx_bench.
+    int32 box_size = evx_max2(width, height) >> 3;
+    int32 box_x = (index * 11) % evx_max2(1, (int32) width - box_size);
+    int32 box_y = (index * 5) % evx_max2(1, (int32) height - box_size);
+
+    for (uint32 j = 0; j < height; ++j)
+    for (uint32 i = 0; i < width; ++i)
+    {
+        uint8 *pixel = output + (j * width + i) * 3;
+        uint32 u = i + index * 3;
+        uint32 v = j + index;
+
+        if ((int32) i >= box_x && (int32) i < box_x + box_size &&
+            (int32) j >= box_y && (int32) j < box_y + box_size)
+        {
+            pixel[0] = 200;
+            pixel[1] = 40 + ((i - box_x) << 1) % 160;
+            pixel[2] = 40;
+            continue;
+        }
+
+        uint32 hash = (u >> 2) * 73856093 ^ (v >> 2) * 19349663;
+        hash ^= hash >> 13;
+        hash *= 0x5bd1e995;
+        hash ^= hash >> 15;
+
+        uint8 checker = (((u >> 5) ^ (v >> 5)) & 0x1) * 48;
+
+        pixel[0] = (uint8) ((u & 0xFF) / 2 + checker + (hash & 0x1F));
+        pixel[1] = (uint8) ((v & 0xFF) / 2 + checker + ((hash >> 5) & 0x1F));
+        pixel[2] = (uint8) (((u + v) & 0xFF) / 2 + ((hash >> 10) & 0x1F));
+    }
+}
+
+static evx_status capture_corpus(uint32 width, uint32 height, uint8 quality, uint32 frame_count, const char *input_path, evx_entropy_corpus *corpus)
+{
+    uint32 frame_size = width * height * 3;
+    uint32 frame_capacity = (align(width, EVX_MACROBLOCK_SIZE) >> EVX_MACROBLOCK_SHIFT) *
+                            (align(height, EVX_MACROBLOCK_SIZE) >> EVX_MACROBLOCK_SHIFT) * 6;
+    FILE *input_file = NULL;
+
+    if (input_path)
+    {
+        input_file = fopen(input_path, "rb");
+
+        if (!input_file)
+        {
+            printf("Unable to open %s.\n", input_path);
+            return evx_post_error(EVX_ERROR_IO_FAILURE);
+        }
+    }
+
+    evx1_encoder *encoder = NULL;
+
+    if (evx_failed(create_encoder(&encoder)))
+    {
+        if (input_file) fclose(input_file);
+        return evx_post_error(EVX_ERROR_OUTOFMEMORY);
+    }
+
+    uint8 *source_frame = new uint8[frame_size];
+    bit_stream stream((frame_size << 3) * 2);
+
+    corpus->blocks = new int16[frame_capacity * frame_count * 64];
+    corpus->block_count = 0;
+
+    // The corpus is coded as 8x8 blocks, so we pin the encoder to a transform mode
+    // that never selects 16x16 luma blocks (see query_coefficients).
+    encoder->set_quality(quality);
+    encoder->set_transform_mode(EVX_TRANSFORM_MODE_REFERENCE);
+
+    evx_status status = EVX_SUCCESS;
+
+    for (uint32 i = 0; i < frame_count; ++i)
+    {
+        if (input_file)
+        {
+            if (frame_size != fread(source_frame, 1, frame_size, input_file))
+            {
+                // Loop the sequence if we run out of frames.
+                fseek(input_file, 0, SEEK_SET);
+
+                if (frame_size != fread(source_frame, 1, frame_size, input_file))
+                {
+                    printf("Unable to read frame %i from %s.\n", i, input_path);
+                    status = EVX_ERROR_IO_FAILURE;
+                    break;
+                }
+            }
+        }
+        else
+        {
+            generate_synthetic_frame(i, width, height, source_frame);
+        }
+
+        uint32 block_count = 0;
+        stream.empty();
+
+        if (evx_failed(encoder->encode(source_frame, width, height, &stream)) ||
+            evx_failed(encoder->query_coefficients(corpus->blocks + corpus->block_count * 64, frame_capacity, &block_count)))
+        {
+            status = evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            break;
+        }
+
+        corpus->block_count += block_count;
+    }
+
+    delete [] source_frame;
+    destroy_encoder(encoder);
+
+    if (input_file)
+    {
+        fclose(input_file);
+    }
+
+    return status;
+}
+
+static evx_status write_corpus(const char *path, const evx_entropy_corpus &corpus)
+{
+    FILE *file = fopen(path, "wb");
+    uint32 header[2] = { EVX_ENTROPY_BENCH_MAGIC, corpus.block_count };
+
+    if (!file)
+    {
+        printf("Unable to create %s.\n", path);
+        return evx_post_error(EVX_ERROR_IO_FAILURE);
+    }
+
+    bool result = (2 == fwrite(header, sizeof(uint32), 2, file)) &&
+                  (corpus.block_count * 64 == fwrite(corpus.blocks, sizeof(int16), corpus.block_count * 64, file));
+
+    fclose(file);
+
+    return result ? EVX_SUCCESS : evx_post_error(EVX_ERROR_IO_FAILURE);
+}
+
+static evx_status read_corpus(const char *path, evx_entropy_corpus *corpus)
+{
+    FILE *file = fopen(path, "rb");
+    uint32 header[2] = { 0 };
+
+    if (!file)
+    {
+        printf("Unable to open %s.\n", path);
+        return evx_post_error(EVX_ERROR_IO_FAILURE);
+    }
+
+    if (2 != fread(header, sizeof(uint32), 2, file) || EVX_ENTROPY_BENCH_MAGIC != header[0])
+    {
+        printf("%s is not a coefficient corpus.\n", path);
+        fclose(file);
+        return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+    }
+
+    corpus->block_count = header[1];
+    corpus->blocks = new int16[evx_max2(corpus->block_count, 1) * 64];
+
+    bool result = (corpus->block_count * 64 == fread(corpus->blocks, sizeof(int16), corpus->block_count * 64, file));
+
+    fclose(file);
+
+    return result ? EVX_SUCCESS : evx_post_error(EVX_ERROR_IO_FAILURE);
+}
+
+static uint32 query_run_length(const int16 *block)
+{
+    // The run length covers the coefficients up to the last nonzero one in zigzag order.
+    int32 run_length = 63;
+
+    for (; run_length >= 0; --run_length)
+    {
+        if (block[EVX_MACROBLOCK_8x8_ZIGZAG[run_length]])
+        {
+            break;
+        }
+    }
+
+    return run_length + 1;
+}
+
+static evx_status encode_symbol_corpus(const evx_entropy_corpus &corpus, symbol_coder *coder, bit_stream *output)
+{
+    int16 cache[64];
+
+    if (evx_failed(coder->start_encode(output)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    for (uint32 i = 0; i < corpus.block_count; ++i)
+    {
+        uint32 run_length = query_run_length(corpus.blocks + i * 64);
+
+        memcpy(cache, corpus.blocks + i * 64, sizeof(cache));
+
+        if (evx_failed(coder->encode_value(EVX_SYNTAX_RUN_LENGTH, (uint16) run_length)) ||
+            evx_failed(coder->encode_coefficients(cache, run_length, EVX_MACROBLOCK_8x8_ZIGZAG)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    return coder->finish_encode();
+}
+
+static evx_status decode_symbol_corpus(bit_stream *input, uint32 block_count, symbol_coder *coder, int16 *output)
+{
+    if (evx_failed(coder->start_decode(input)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    for (uint32 i = 0; i < block_count; ++i)
+    {
+        uint16 run_length = 0;
+        int16 *block = output + i * 64;
+
+        memset(block, 0, sizeof(int16) * 64);
+
+        if (evx_failed(coder->decode_value(EVX_SYNTAX_RUN_LENGTH, &run_length)) || run_length > 64 ||
+            evx_failed(coder->decode_coefficients(run_length, block, EVX_MACROBLOCK_8x8_ZIGZAG)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
+static evx_status encode_stream_corpus(const evx_entropy_corpus &corpus, entropy_coder *coder, bit_stream *feed_stream, bit_stream *output)
+{
+    for (uint32 i = 0; i < corpus.block_count; ++i)
+    {
+        feed_stream->empty();
+
+        if (evx_failed(entropy_rle_stream_encode_8x8(corpus.blocks + i * 64, feed_stream, coder, output)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    return coder->finish_encode(output);
+}
+
+static evx_status decode_stream_corpus(bit_stream *input, uint32 block_count, entropy_coder *coder, bit_stream *feed_stream, int16 *output)
+{
+    if (evx_failed(coder->start_decode(input)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    for (uint32 i = 0; i < block_count; ++i)
+    {
+        feed_stream->empty();
+
+        if (evx_failed(entropy_rle_stream_decode_8x8(input, coder, feed_stream, output + i * 64)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
+static evx_status precode_corpus(const evx_entropy_corpus &corpus, bit_stream *output)
+{
+    // Golomb precodes each block as entropy_rle_stream_encode_8x8 does.
+    for (uint32 i = 0; i < corpus.block_count; ++i)
+    {
+        int16 *block = corpus.blocks + i * 64;
+        uint32 run_length = query_run_length(block);
+
+        if (evx_failed(stream_encode_value((uint16) run_length, output)) ||
+            (run_length && evx_failed(stream_encode_block(block, EVX_MACROBLOCK_8x8_ZIGZAG, run_length, output))))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
+static evx_status run_backend(uint32 backend, const evx_entropy_corpus &corpus, uint32 repeat_count, evx_entropy_result *result)
+{
+    uint32 coefficient_count = corpus.block_count * 64;
+    uint32 capacity = coefficient_count * 48 + 4096;
+
+    bit_stream output(capacity);
+    bit_stream input;
+    bit_stream precoded(capacity);
+    bit_stream feed_stream(64 * 64);
+    bit_stream decoded_bits(capacity);
+
+    int16 *decoded = new int16[evx_max2(coefficient_count, 1)];
+    symbol_coder coder;
+    entropy_coder binary_coder;
+
+    evx_status status = EVX_SUCCESS;
+
+    result->encode_time = EVX_MAX_UINT64;
+    result->decode_time = EVX_MAX_UINT64;
+    result->round_trip = true;
+
+    if (backend < EVX_ENTROPY_MODE_COUNT)
+    {
+        const char *mode_names[] = { "abac", "range", "context", "huffman" };
+        sprintf(result->name, "symbol.%s", mode_names[backend]);
+        status = coder.initialize((EVX_ENTROPY_MODE) backend);
+    }
+    else if (EVX_ENTROPY_MODE_COUNT == backend)
+    {
+        sprintf(result->name, "stream.rle");
+    }
+    else
+    {
+        sprintf(result->name, "coder.golomb");
+        status = precode_corpus(corpus, &precoded);
+    }
+
+    for (uint32 k = 0; k < repeat_count && evx_succeeded(status); ++k)
+    {
+        output.empty();
+        decoded_bits.empty();
+
+        uint64 start_time = query_timestamp();
+
+        if (backend < EVX_ENTROPY_MODE_COUNT)
+        {
+            status = encode_symbol_corpus(corpus, &coder, &output);
+        }
+        else if (EVX_ENTROPY_MODE_COUNT == backend)
+        {
+            binary_coder.clear();
+            status = encode_stream_corpus(corpus, &binary_coder, &feed_stream, &output);
+        }
+        else
+        {
+            // The precoded bits are consumed by the coder, so each run codes a fresh copy.
+            bit_stream source(precoded.query_data(), evx_max2(precoded.query_byte_occupancy(), 1));
+            start_time = query_timestamp();
+            binary_coder.clear();
+            status = binary_coder.encode(&source, &output);
+        }
+
+        uint64 encode_time = query_timestamp();
+
+        if (evx_failed(status) || evx_failed(input.assign(output.query_data(), evx_max2(output.query_byte_occupancy(), 1))))
+        {
+            status = evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            break;
+        }
+
+        uint64 decode_start = query_timestamp();
+
+        if (backend < EVX_ENTROPY_MODE_COUNT)
+        {
+            status = decode_symbol_corpus(&input, corpus.block_count, &coder, decoded);
+        }
+        else if (EVX_ENTROPY_MODE_COUNT == backend)
+        {
+            status = decode_stream_corpus(&input, corpus.block_count, &binary_coder, &feed_stream, decoded);
+        }
+        else
+        {
+            binary_coder.clear();
+            status = binary_coder.decode(evx_max2(precoded.query_byte_occupancy(), 1) << 3, &input, &decoded_bits);
+        }
+
+        uint64 decode_time = query_timestamp();
+
+        result->encode_time = evx_min2(result->encode_time, encode_time - start_time);
+        result->decode_time = evx_min2(result->decode_time, decode_time - decode_start);
+    }
+
+    if (evx_succeeded(status))
+    {
+        result->coded_bits = output.query_occupancy();
+        result->checksum = update_checksum(2166136261, output.query_data(), output.query_occupancy());
+
+        if (backend <= EVX_ENTROPY_MODE_COUNT)
+        {
+            result->round_trip = (0 == memcmp(decoded, corpus.blocks, sizeof(int16) * coefficient_count));
+        }
+        else
+        {
+            result->round_trip = (0 == memcmp(decoded_bits.query_data(), precoded.query_data(), precoded.query_occupancy() >> 3));
+        }
+    }
+    else
+    {
+        result->round_trip = false;
+    }
+
+    delete [] decoded;
+
+    return status;
+}
+
+static evx_status write_golden(const char *path, const evx_entropy_corpus &corpus, evx_entropy_result *results, uint32 count)
+{
+    FILE *file = fopen(path, "w");
+
+    if (!file)
+    {
+        printf("Unable to create %s.\n", path);
+        return evx_post_error(EVX_ERROR_IO_FAILURE);
+    }
+
+    fprintf(file, "corpus %08x %u\n", corpus.checksum, corpus.block_count);
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        fprintf(file, "%s %08x %u\n", results[i].name, results[i].checksum, results[i].coded_bits);
+    }
+
+    fclose(file);
+
+    return EVX_SUCCESS;
+}
+
+static uint32 verify_golden(const char *path, const evx_entropy_corpus &corpus, evx_entropy_result *results, uint32 count)
+{
+    // Returns the number of mismatches against the golden file.
+    FILE *file = fopen(path, "r");
+    char name[32];
+    uint32 checksum = 0;
+    uint32 value = 0;
+    uint32 mismatch_count = 0;
+
+    if (!file)
+    {
+        printf("Unable to open %s.\n", path);
+        return count + 1;
+    }
+
+    if (3 != fscanf(file, "%31s %x %u", name, &checksum, &value) || strcmp(name, "corpus") ||
+        checksum != corpus.checksum || value != corpus.block_count)
+    {
+        printf("  golden: %s was recorded against a different corpus.\n", path);
+        fclose(file);
+        return count + 1;
+    }
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        bool found = false;
+
+        rewind(file);
+
+        while (3 == fscanf(file, "%31s %x %u", name, &checksum, &value))
+        {
+            if (0 == strcmp(name, results[i].name))
+            {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found)
+        {
+            printf("  golden: %s is missing from %s.\n", results[i].name, path);
+            mismatch_count++;
+        }
+        else if (checksum != results[i].checksum || value != results[i].coded_bits)
+        {
+            printf("  golden: %s mismatch (expected %08x / %u bits, coded %08x / %u bits).\n",
+                   results[i].name, checksum, value, results[i].checksum, results[i].coded_bits);
+            mismatch_count++;
+        }
+    }
+
+    fclose(file);
+
+    return mismatch_count;
+}
+
+static void print_usage()
+{
+    printf("usage: evx_entropy_bench [-s WxH] [-q quality] [-n frames] [-i file.rgb] [-k repeats] [-w corpus] [-r corpus] [-u golden] [-g golden]\n");
+}
+
+int main(int argc, char **argv)
+{
+    uint32 width = 640;
+    uint32 height = 480;
+    uint32 quality = EVX_DEFAULT_QUALITY_LEVEL;
+    uint32 frame_count = 30;
+    uint32 repeat_count = 5;
+    const char *input_path = NULL;
+    const char *record_path = NULL;
+    const char *corpus_path = NULL;
+    const char *update_path = NULL;
+    const char *golden_path = NULL;
+
+    for (int32 i = 1; i < argc; ++i)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if (0 == strcmp(argv[i], "-s") && has_value)
+        {
+            if (2 != sscanf(argv[++i], "%ux%u", &width, &height))
+            {
+                print_usage();
+                return 1;
+            }
+        }
+        else if (0 == strcmp(argv[i], "-q") && has_value)
+        {
+            int32 value = atoi(argv[++i]);
+            quality = clip_range(value, 1, 31);
+        }
+        else if (0 == strcmp(argv[i], "-n") && has_value)
+        {
+            int32 value = atoi(argv[++i]);
+            frame_count = evx_max2(1, value);
+        }
+        else if (0 == strcmp(argv[i], "-k") && has_value)
+        {
+            int32 value = atoi(argv[++i]);
+            repeat_count = evx_max2(1, value);
+        }
+        else if (0 == strcmp(argv[i], "-i") && has_value)
+        {
+            input_path = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], "-w") && has_value)
+        {
+            record_path = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], "-r") && has_value)
+        {
+            corpus_path = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], "-u") && has_value)
+        {
+            update_path = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], "-g") && has_value)
+        {
+            golden_path = argv[++i];
+        }
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (0 == width || 0 == height || (width & 0x1) || (height & 0x1))
+    {
+        printf("Invalid resolution %ix%i (dimensions must be even).\n", width, height);
+        return 1;
+    }
+
+    evx_entropy_corpus corpus;
+    evx_status status = EVX_SUCCESS;
+
+    if (corpus_path)
+    {
+        status = read_corpus(corpus_path, &corpus);
+    }
+    else
+    {
+        status = capture_corpus(width, height, (uint8) quality, frame_count, input_path, &corpus);
+    }
+
+    if (evx_failed(status) || (record_path && evx_failed(write_corpus(record_path, corpus))))
+    {
+        return 1;
+    }
+
+    corpus.checksum = update_checksum(2166136261, reinterpret_cast<uint8 *>(corpus.blocks), corpus.block_count * 64 * 16);
+
+    printf("corpus: %u blocks (%.2f MB)  checksum: %08x\n", corpus.block_count,
+           corpus.block_count * 128 / 1.0e6, corpus.checksum);
+    printf("  %-16s %12s %12s %12s %10s %10s  %s\n", "backend", "encode MB/s", "decode MB/s",
+           "bits/block", "bits/coef", "checksum", "round trip");
+
+    evx_entropy_result results[EVX_ENTROPY_BENCH_BACKENDS];
+    float64 corpus_bytes = corpus.block_count * 128.0;
+    bool round_trip = true;
+
+    for (uint32 i = 0; i < EVX_ENTROPY_BENCH_BACKENDS; ++i)
+    {
+        evx_entropy_result *result = &results[i];
+
+        if (evx_failed(run_backend(i, corpus, repeat_count, result)))
+        {
+            printf("  %-16s failed\n", result->name);
+            return 1;
+        }
+
+        round_trip = round_trip && result->round_trip;
+
+        printf("  %-16s %12.2f %12.2f %12.2f %10.3f %10.8x  %s\n", result->name,
+               corpus_bytes * 1.0e3 / evx_max2(result->encode_time, 1),
+               corpus_bytes * 1.0e3 / evx_max2(result->decode_time, 1),
+               result->coded_bits / (float64) evx_max2(corpus.block_count, 1),
+               result->coded_bits / (float64) evx_max2(corpus.block_count * 64, 1),
+               result->checksum, result->round_trip ? "ok" : "FAILED");
+    }
+
+    if (update_path && evx_failed(write_golden(update_path, corpus, results, EVX_ENTROPY_BENCH_BACKENDS)))
+    {
+        return 1;
+    }
+
+    uint32 mismatch_count = 0;
+
+    if (golden_path)
+    {
+        mismatch_count = verify_golden(golden_path, corpus, results, EVX_ENTROPY_BENCH_BACKENDS);
+        printf("  golden: %s\n", mismatch_count ? "FAILED" : "all backends match");
+    }
+
+    delete [] corpus.blocks;
+
+    return (round_trip && 0 == mismatch_count) ? 0 : 1;
+}
@@ -0,0 +1,787 @@
+
+#include "../evx1.h"
+#include "../analysis.h"
+#include "../config.h"
+#include "../math.h"
+#include "../quantize.h"
+#include "../transform.h"
+
+#include "math.h"
+
+// evx_bench
+//
+//   Runs the EVX-1 encoder and decoder over a synthetic or file based RGB sequence
+//   and reports throughput, per-frame latency percentiles, and bytes per frame for
+//   each requested resolution and quality level. The stream checksum is a hash of 
+//   the encoded bytes and should only change when the bitstream changes.
+//
+//   Build by compiling this file together with the codec sources, e.g.:
+//
+//     c++ -O2 -o evx_bench bench/evx_bench.cpp *.cpp
+//
+//   Usage:
+//
+//     evx_bench [-s WxH[,WxH...]] [-q quality[,quality...]] [-n frames] [-i file.rgb]
+//               [-x scalar|sse2|sse41|avx2] [-l slices] [-t threads] [-e abac|range|context|huffman]
+//               [-f reference|butterfly] [-k iterations]
+//
+//   Input files must contain raw interleaved R8G8B8 frames at the first requested
+//   resolution. Files shorter than the requested frame count are looped. The -x
+//   option caps the simd level of the block metric, transform and quantization 
+//   kernels. The -l option sets the slice count of the stream and -t the thread 
+//   count of the encoder and decoder; the checksum depends on the slice count but
+//   never on the thread count. The -e option selects the entropy backend of the 
+//   stream and -f its transforms. The -k option skips the benchmark, and instead
+//   checks the vector transform kernels against the scalar kernels over the given
+//   number of random blocks (see run_transform_sweep).
+
+using namespace evx;
+
+#define EVX_BENCH_MAX_CONFIGS       (16)
+
+typedef struct evx_bench_config
+{
+    uint32 width_list[EVX_BENCH_MAX_CONFIGS];
+    uint32 height_list[EVX_BENCH_MAX_CONFIGS];
+    uint32 size_count;
+
+    uint8 quality_list[EVX_BENCH_MAX_CONFIGS];
+    uint32 quality_count;
+
+    uint32 frame_count;
+    uint32 slice_count;
+    uint32 thread_count;
+    EVX_ENTROPY_MODE entropy_mode;
+    EVX_TRANSFORM_MODE transform_mode;
+    const char *input_path;
+
+} evx_bench_config;
+
+typedef struct evx_bench_result
+{
+    uint64 *encode_times;       // per-frame encode latency in nanoseconds
+    uint64 *decode_times;       // per-frame decode latency in nanoseconds
+    uint64 total_bytes;
+    uint32 min_bytes;
+    uint32 max_bytes;
+    uint32 checksum;
+    float64 psnr_sum;
+    uint64 motion_vector_bits;
+    uint64 motion_vector_count;
+    uint64 zero_block_count;
+
+    evx_timing_stats encoder_timing;
+    evx_timing_stats decoder_timing;
+
+} evx_bench_result;
+
+static int compare_times(const void *left, const void *right)
+{
+    uint64 a = *reinterpret_cast<const uint64 *>(left);
+    uint64 b = *reinterpret_cast<const uint64 *>(right);
+    return (a < b ? -1 : (a > b ? 1 : 0));
+}
+
+static float64 query_percentile_ms(uint64 *sorted_times, uint32 count, uint32 percentile)
+{
+    uint32 index = (count * percentile + 99) / 100;
+    index = clip_range(index, 1, count) - 1;
+    return sorted_times[index] / 1.0e6;
+}
+
+static uint32 update_checksum(uint32 hash, const uint8 *data, uint32 bit_count)
+{
+    // FNV-1a over the encoded bits. Unused bits of the final byte are not 
+    // guaranteed to be zero, so we mask them out.
+    uint32 byte_count = align(bit_count, 8) >> 3;
+
+    for (uint32 i = 0; i < byte_count; ++i)
+    {
+        uint8 value = data[i];
+
+        if (i == (bit_count >> 3))
+        {
+            value &= (0x1 << (bit_count & 0x7)) - 1;
+        }
+
+        hash ^= value;
+        hash *= 16777619;
+    }
+
+    return hash;
+}
+
+static void generate_synthetic_frame(uint32 index, uint32 width, uint32 height, uint8 *output)
+{
+    // The synthetic sequence approximates game content: a slowly panning textured
+    // background, a fast moving foreground object, and a static overlay region.
+    int32 pan_x = index * 3;
+    int32 pan_y = index;
+    int32 box_size = evx_max2(width, height) >> 3;
+    int32 box_x = (index * 11) % evx_max2(1, (int32) width - box_size);
+    int32 box_y = (index * 5) % evx_max2(1, (int32) height - box_size);
+    uint32 overlay_width = width >> 3;
+    uint32 overlay_height = height >> 3;
+
+    for (uint32 j = 0; j < height; ++j)
+    for (uint32 i = 0; i < width; ++i)
+    {
+        uint8 *pixel = output + (j * width + i) * 3;
+        uint32 u = i + pan_x;
+        uint32 v = j + pan_y;
+
+        if (i < overlay_width && j < overlay_height)
+        {
+            pixel[0] = pixel[1] = pixel[2] = ((i >> 2) ^ (j >> 2)) & 0x1 ? 230 : 20;
+            continue;
+        }
+
+        if ((int32) i >= box_x && (int32) i < box_x + box_size && 
+            (int32) j >= box_y && (int32) j < box_y + box_size)
+        {
+            pixel[0] = 200;
+            pixel[1] = 40 + ((i - box_x) << 1) % 160;
+            pixel[2] = 40;
+            continue;
+        }
+
+        uint32 hash = (u >> 2) * 73856093 ^ (v >> 2) * 19349663;
+        hash ^= hash >> 13;
+        hash *= 0x5bd1e995;
+        hash ^= hash >> 15;
+
+        uint8 checker = (((u >> 5) ^ (v >> 5)) & 0x1) * 48;
+
+        pixel[0] = (uint8) ((u & 0xFF) / 2 + checker + (hash & 0x1F));
+        pixel[1] = (uint8) ((v & 0xFF) / 2 + checker + ((hash >> 5) & 0x1F));
+        pixel[2] = (uint8) (((u + v) & 0xFF) / 2 + ((hash >> 10) & 0x1F));
+    }
+}
+
+static bool read_file_frame(FILE *file, uint32 frame_size, uint8 *output)
+{
+    if (frame_size == fread(output, 1, frame_size, file))
+    {
+        return true;
+    }
+
+    // Loop the sequence if we run out of frames.
+    fseek(file, 0, SEEK_SET);
+
+    return (frame_size == fread(output, 1, frame_size, file));
+}
+
+static float64 compute_psnr(const uint8 *left, const uint8 *right, uint32 size)
+{
+    uint64 sse = 0;
+
+    for (uint32 i = 0; i < size; ++i)
+    {
+        int32 delta = left[i] - right[i];
+        sse += delta * delta;
+    }
+
+    if (0 == sse)
+    {
+        return 99.0;
+    }
+
+    return 10.0 * log10((255.0 * 255.0 * size) / (float64) sse);
+}
+
+static evx_status run_benchmark(uint32 width, uint32 height, uint8 quality, const evx_bench_config &config, evx_bench_result *result)
+{
+    uint32 frame_size = width * height * 3;
+    FILE *input_file = NULL;
+
+    if (config.input_path)
+    {
+        input_file = fopen(config.input_path, "rb");
+
+        if (!input_file)
+        {
+            printf("Unable to open %s.\n", config.input_path);
+            return evx_post_error(EVX_ERROR_IO_FAILURE);
+        }
+    }
+
+    evx1_encoder *encoder = NULL;
+    evx1_decoder *decoder = NULL;
+
+    if (evx_failed(create_encoder(&encoder)) || evx_failed(create_decoder(&decoder)))
+    {
+        if (input_file) fclose(input_file);
+        return evx_post_error(EVX_ERROR_OUTOFMEMORY);
+    }
+
+    uint8 *source_frame = new uint8[frame_size];
+    uint8 *decoded_frame = new uint8[frame_size];
+
+    // The stream must be large enough to hold an uncompressed frame plus the header.
+    bit_stream stream((frame_size << 3) * 2);
+
+    encoder->set_quality(quality);
+    encoder->set_slice_count(config.slice_count);
+    encoder->set_thread_count(config.thread_count);
+    encoder->set_entropy_mode(config.entropy_mode);
+    encoder->set_transform_mode(config.transform_mode);
+    decoder->set_thread_count(config.thread_count);
+
+    evx_status status = EVX_SUCCESS;
+
+    for (uint32 i = 0; i < config.frame_count; ++i)
+    {
+        if (input_file)
+        {
+            if (!read_file_frame(input_file, frame_size, source_frame))
+            {
+                printf("Unable to read frame %i from %s.\n", i, config.input_path);
+                status = EVX_ERROR_IO_FAILURE;
+                break;
+            }
+        }
+        else
+        {
+            generate_synthetic_frame(i, width, height, source_frame);
+        }
+
+        stream.empty();
+
+        uint64 start_time = query_timestamp();
+
+        if (evx_failed(encoder->encode(source_frame, width, height, &stream)))
+        {
+            status = evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            break;
+        }
+
+        uint64 encode_time = query_timestamp();
+        uint32 frame_bytes = stream.query_byte_occupancy();
+
+        evx_stream_stats stream_stats;
+
+        if (evx_succeeded(encoder->query_stream_stats(&stream_stats)))
+        {
+            result->motion_vector_bits += stream_stats.motion_vector_bits;
+            result->motion_vector_count += stream_stats.motion_vector_count;
+            result->zero_block_count += stream_stats.zero_block_count;
+        }
+
+        result->checksum = update_checksum(result->checksum, stream.query_data(), stream.query_occupancy());
+
+        if (evx_failed(decoder->decode(&stream, decoded_frame)))
+        {
+            status = evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            break;
+        }
+
+        uint64 decode_time = query_timestamp();
+
+        result->encode_times[i] = encode_time - start_time;
+        result->decode_times[i] = decode_time - encode_time;
+        result->total_bytes += frame_bytes;
+        result->min_bytes = evx_min2(result->min_bytes, frame_bytes);
+        result->max_bytes = evx_max2(result->max_bytes, frame_bytes);
+        result->psnr_sum += compute_psnr(source_frame, decoded_frame, frame_size);
+    }
+
+    // Stage timings are unavailable if the codec was built without EVX_ENABLE_STAGE_TIMING.
+    encoder->query_timing(&result->encoder_timing);
+    decoder->query_timing(&result->decoder_timing);
+
+    delete [] source_frame;
+    delete [] decoded_frame;
+
+    destroy_encoder(encoder);
+    destroy_decoder(decoder);
+
+    if (input_file)
+    {
+        fclose(input_file);
+    }
+
+    return status;
+}
+
+static void print_stage_timing(const char *label, const evx_timing_stats &stats)
+{
+    if (0 == stats.frame_count)
+    {
+        return;
+    }
+
+    printf("  %s stages (avg ms/frame):", label);
+
+    for (uint32 i = 0; i < EVX_TIMING_STAGE_COUNT; ++i)
+    {
+        if (stats.total_time[i])
+        {
+            printf(" %s %.2f", query_timing_stage_name((EVX_TIMING_STAGE) i), stats.total_time[i] / (1.0e6 * stats.frame_count));
+        }
+    }
+
+    printf("\n");
+}
+
+static void print_result(uint32 width, uint32 height, uint8 quality, uint32 frame_count, evx_bench_result *result)
+{
+    uint64 encode_total = 0;
+    uint64 decode_total = 0;
+
+    for (uint32 i = 0; i < frame_count; ++i)
+    {
+        encode_total += result->encode_times[i];
+        decode_total += result->decode_times[i];
+    }
+
+    qsort(result->encode_times, frame_count, sizeof(uint64), compare_times);
+    qsort(result->decode_times, frame_count, sizeof(uint64), compare_times);
+
+    printf("%ix%i q%i, %i frames\n", width, height, quality, frame_count);
+    printf("  encode: %8.2f fps  p50 %7.2f ms  p90 %7.2f ms  p99 %7.2f ms  max %7.2f ms\n",
+           frame_count * 1.0e9 / evx_max2(encode_total, 1),
+           query_percentile_ms(result->encode_times, frame_count, 50),
+           query_percentile_ms(result->encode_times, frame_count, 90),
+           query_percentile_ms(result->encode_times, frame_count, 99),
+           query_percentile_ms(result->encode_times, frame_count, 100));
+    printf("  decode: %8.2f fps  p50 %7.2f ms  p90 %7.2f ms  p99 %7.2f ms  max %7.2f ms\n",
+           frame_count * 1.0e9 / evx_max2(decode_total, 1),
+           query_percentile_ms(result->decode_times, frame_count, 50),
+           query_percentile_ms(result->decode_times, frame_count, 90),
+           query_percentile_ms(result->decode_times, frame_count, 99),
+           query_percentile_ms(result->decode_times, frame_count, 100));
+    printf("  bytes/frame: avg %llu  min %i  max %i\n", 
+           (unsigned long long) (result->total_bytes / frame_count), result->min_bytes, result->max_bytes);
+    printf("  psnr: %.2f dB  checksum: %08x\n", result->psnr_sum / frame_count, result->checksum);
+    printf("  motion vectors/frame: %llu  bits/frame %llu  bits/vector %.2f\n",
+           (unsigned long long) (result->motion_vector_count / frame_count),
+           (unsigned long long) (result->motion_vector_bits / frame_count),
+           result->motion_vector_bits / (float64) evx_max2(result->motion_vector_count, 1));
+    printf("  zero blocks/frame: %llu\n", (unsigned long long) (result->zero_block_count / frame_count));
+
+    print_stage_timing("encode", result->encoder_timing);
+    print_stage_timing("decode", result->decoder_timing);
+}
+
+static uint32 parse_list(const char *text, uint32 *first, uint32 *second, uint32 capacity)
+{
+    // Parses comma separated values of the form "a" or "axb".
+    uint32 count = 0;
+
+    while (*text && count < capacity)
+    {
+        char *end = NULL;
+        first[count] = strtoul(text, &end, 10);
+
+        if (second && end && ('x' == *end || 'X' == *end))
+        {
+            second[count] = strtoul(end + 1, &end, 10);
+        }
+
+        count++;
+        text = end;
+
+        if (',' != *text)
+        {
+            break;
+        }
+
+        text++;
+    }
+
+    return count;
+}
+
+// Transform kernel sweep
+//
+//   Runs every transform kernel of every supported simd level over random blocks and 
+//   compares the results against the scalar kernels, which the vector kernels must match
+//   bit for bit. Inputs are kept within the ranges that the codec produces: pixels and
+//   residuals for the forward transforms, and coarsely quantized coefficients of random
+//   residuals for the inverse transforms.
+
+#define EVX_SWEEP_PITCH             (24)
+#define EVX_SWEEP_BLOCK_SIZE        (16 * EVX_SWEEP_PITCH)
+#define EVX_SWEEP_FILL              (0x5A5A)
+
+typedef void (*evx_forward_kernel)(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch);
+typedef void (*evx_sub_kernel)(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch);
+
+typedef struct evx_sweep_kernels
+{
+    evx_forward_kernel transform;
+    evx_forward_kernel inverse_transform;
+    evx_sub_kernel sub_transform;
+    evx_sub_kernel inverse_transform_add;
+
+} evx_sweep_kernels;
+
+static uint32 next_random(uint32 *state)
+{
+    // xorshift32
+    uint32 value = *state;
+    value ^= value << 13;
+    value ^= value >> 17;
+    value ^= value << 5;
+    *state = value;
+
+    return value;
+}
+
+static int32 random_range(uint32 *state, int32 low, int32 high)
+{
+    return low + (int32) (next_random(state) % (uint32) (high - low + 1));
+}
+
+static evx_sweep_kernels query_sweep_kernels(const evx_transform_kernels &kernels, uint32 size)
+{
+    evx_sweep_kernels output;
+
+    output.transform = (8 == size) ? kernels.transform_8x8 : kernels.transform_16x16;
+    output.inverse_transform = (8 == size) ? kernels.inverse_transform_8x8 : kernels.inverse_transform_16x16;
+    output.sub_transform = (8 == size) ? kernels.sub_transform_8x8 : kernels.sub_transform_16x16;
+    output.inverse_transform_add = (8 == size) ? kernels.inverse_transform_add_8x8 : kernels.inverse_transform_add_16x16;
+
+    return output;
+}
+
+static uint32 compare_sweep_blocks(int16 *expected, int16 *actual)
+{
+    uint32 mismatch_count = 0;
+
+    for (uint32 i = 0; i < EVX_SWEEP_BLOCK_SIZE; ++i)
+    {
+        mismatch_count += (expected[i] != actual[i]);
+        expected[i] = actual[i] = EVX_SWEEP_FILL;
+    }
+
+    return mismatch_count;
+}
+
+static uint32 sweep_transform_kernels(const evx_sweep_kernels &scalar, const evx_sweep_kernels &vector, uint32 size, uint32 iterations, uint32 *mismatches)
+{
+    int16 source[EVX_SWEEP_BLOCK_SIZE];
+    int16 prediction[EVX_SWEEP_BLOCK_SIZE];
+    int16 coefficients[EVX_SWEEP_BLOCK_SIZE];
+    int16 expected[EVX_SWEEP_BLOCK_SIZE];
+    int16 actual[EVX_SWEEP_BLOCK_SIZE];
+    uint32 state = 0x9E3779B9 ^ size;
+
+    for (uint32 i = 0; i < EVX_SWEEP_BLOCK_SIZE; ++i)
+    {
+        expected[i] = actual[i] = EVX_SWEEP_FILL;
+    }
+
+    for (uint32 n = 0; n < iterations; ++n)
+    {
+        // Residuals of flat blocks are small, so every other block uses a narrow range.
+        int32 range = (n & 0x1) ? 255 : random_range(&state, 1, 16);
+        uint32 step = random_range(&state, 1, 32);
+        uint32 density = random_range(&state, 0, 100);
+
+        for (uint32 i = 0; i < EVX_SWEEP_BLOCK_SIZE; ++i)
+        {
+            source[i] = random_range(&state, 0, 255);
+            prediction[i] = clip_range(source[i] + random_range(&state, -range, range), 0, 255);
+        }
+
+        scalar.transform(source, EVX_SWEEP_PITCH, expected, EVX_SWEEP_PITCH);
+        vector.transform(source, EVX_SWEEP_PITCH, actual, EVX_SWEEP_PITCH);
+        mismatches[0] += compare_sweep_blocks(expected, actual);
+
+        scalar.sub_transform(source, EVX_SWEEP_PITCH, prediction, EVX_SWEEP_PITCH, expected, EVX_SWEEP_PITCH);
+        vector.sub_transform(source, EVX_SWEEP_PITCH, prediction, EVX_SWEEP_PITCH, actual, EVX_SWEEP_PITCH);
+        mismatches[1] += compare_sweep_blocks(expected, actual);
+
+        // Coefficients are the quantized transform of the residual, with a random share
+        // of them discarded.
+        scalar.sub_transform(source, EVX_SWEEP_PITCH, prediction, EVX_SWEEP_PITCH, coefficients, EVX_SWEEP_PITCH);
+
+        for (uint32 i = 0; i < EVX_SWEEP_BLOCK_SIZE; ++i)
+        {
+            coefficients[i] = ((uint32) random_range(&state, 0, 99) < density) ? (coefficients[i] / (int32) step) * (int32) step : 0;
+        }
+
+        scalar.inverse_transform(coefficients, EVX_SWEEP_PITCH, expected, EVX_SWEEP_PITCH);
+        vector.inverse_transform(coefficients, EVX_SWEEP_PITCH, actual, EVX_SWEEP_PITCH);
+        mismatches[2] += compare_sweep_blocks(expected, actual);
+
+        scalar.inverse_transform_add(coefficients, EVX_SWEEP_PITCH, prediction, EVX_SWEEP_PITCH, expected, EVX_SWEEP_PITCH);
+        vector.inverse_transform_add(coefficients, EVX_SWEEP_PITCH, prediction, EVX_SWEEP_PITCH, actual, EVX_SWEEP_PITCH);
+        mismatches[3] += compare_sweep_blocks(expected, actual);
+    }
+
+    return mismatches[0] + mismatches[1] + mismatches[2] + mismatches[3];
+}
+
+static float64 time_transform_kernels(const evx_sweep_kernels &kernels, uint32 iterations)
+{
+    // Returns the average nanoseconds of a forward and an inverse transform.
+    int16 source[EVX_SWEEP_BLOCK_SIZE];
+    int16 prediction[EVX_SWEEP_BLOCK_SIZE];
+    int16 output[EVX_SWEEP_BLOCK_SIZE];
+    uint32 state = 0x2545F491;
+
+    for (uint32 i = 0; i < EVX_SWEEP_BLOCK_SIZE; ++i)
+    {
+        source[i] = random_range(&state, 0, 255);
+        prediction[i] = clip_range(source[i] + random_range(&state, -8, 8), 0, 255);
+    }
+
+    // The fastest of several runs is the least disturbed by other processes.
+    uint64 best_time = EVX_MAX_UINT64;
+
+    for (uint32 k = 0; k < 5; ++k)
+    {
+        uint64 start_time = query_timestamp();
+
+        for (uint32 n = 0; n < iterations; ++n)
+        {
+            kernels.sub_transform(source, EVX_SWEEP_PITCH, prediction, EVX_SWEEP_PITCH, output, EVX_SWEEP_PITCH);
+            kernels.inverse_transform_add(output, EVX_SWEEP_PITCH, prediction, EVX_SWEEP_PITCH, output, EVX_SWEEP_PITCH);
+        }
+
+        best_time = evx_min2(best_time, query_timestamp() - start_time);
+    }
+
+    return best_time / (float64) iterations;
+}
+
+static int32 run_transform_sweep(uint32 iterations)
+{
+    static const char *kernel_names[] = { "transform", "sub_transform", "inverse_transform", "inverse_transform_add" };
+    uint32 failure_count = 0;
+
+    for (uint32 mode = 0; mode < EVX_TRANSFORM_MODE_COUNT; ++mode)
+    for (uint32 size = 8; size <= 16; size += 8)
+    {
+        select_transform_kernels(EVX_SIMD_SCALAR);
+        evx_sweep_kernels scalar = query_sweep_kernels(query_transform_kernels((EVX_TRANSFORM_MODE) mode), size);
+        float64 scalar_time = time_transform_kernels(scalar, iterations);
+
+        for (uint32 level = EVX_SIMD_SCALAR + 1; level <= query_simd_level(); ++level)
+        {
+            select_transform_kernels((EVX_SIMD_LEVEL) level);
+
+            const evx_transform_kernels &kernels = query_transform_kernels((EVX_TRANSFORM_MODE) mode);
+            evx_sweep_kernels vector = query_sweep_kernels(kernels, size);
+            uint32 mismatches[4] = {0};
+
+            if (kernels.level != level)
+            {
+                // This level shares the kernels of a lower level.
+                continue;
+            }
+
+            uint32 mismatch_count = sweep_transform_kernels(scalar, vector, size, iterations, mismatches);
+
+            printf("  %-9s %2ix%-2i %-5s  %s  %7.1f ns -> %7.1f ns\n", mode ? "butterfly" : "reference", size, size, 
+                   query_simd_level_name((EVX_SIMD_LEVEL) level), mismatch_count ? "FAILED" : "ok    ", 
+                   scalar_time, time_transform_kernels(vector, iterations));
+
+            for (uint32 k = 0; k < 4; ++k)
+            {
+                if (mismatches[k])
+                {
+                    printf("    %s: %i mismatched coefficients\n", kernel_names[k], mismatches[k]);
+                }
+            }
+
+            failure_count += !!mismatch_count;
+        }
+    }
+
+    select_transform_kernels(query_simd_level());
+
+    return failure_count ? 1 : 0;
+}
+
+static void print_usage()
+{
+    printf("usage: evx_bench [-s WxH[,WxH...]] [-q quality[,quality...]] [-n frames] [-i file.rgb] [-x scalar|sse2|sse41|avx2] [-l slices] [-t threads] [-e abac|range|context|huffman] [-f reference|butterfly] [-k iterations]\n");
+}
+
+int main(int argc, char **argv)
+{
+    evx_bench_config config;
+    uint32 quality_values[EVX_BENCH_MAX_CONFIGS];
+
+    config.width_list[0] = 640;
+    config.height_list[0] = 480;
+    config.size_count = 1;
+    config.quality_list[0] = EVX_DEFAULT_QUALITY_LEVEL;
+    config.quality_count = 1;
+    config.frame_count = 60;
+    config.slice_count = EVX_DEFAULT_SLICE_COUNT;
+    config.thread_count = EVX_DEFAULT_THREAD_COUNT;
+    config.entropy_mode = (EVX_ENTROPY_MODE) EVX_DEFAULT_ENTROPY_MODE;
+    config.transform_mode = (EVX_TRANSFORM_MODE) EVX_DEFAULT_TRANSFORM_MODE;
+    config.input_path = NULL;
+
+    for (int32 i = 1; i < argc; ++i)
+    {
+        bool has_value = (i + 1 < argc);
+
+        if (0 == strcmp(argv[i], "-s") && has_value)
+        {
+            config.size_count = parse_list(argv[++i], config.width_list, config.height_list, EVX_BENCH_MAX_CONFIGS);
+        }
+        else if (0 == strcmp(argv[i], "-q") && has_value)
+        {
+            config.quality_count = parse_list(argv[++i], quality_values, NULL, EVX_BENCH_MAX_CONFIGS);
+
+            for (uint32 k = 0; k < config.quality_count; ++k)
+            {
+                config.quality_list[k] = clip_range(quality_values[k], 1, 31);
+            }
+        }
+        else if (0 == strcmp(argv[i], "-n") && has_value)
+        {
+            int32 frame_count = atoi(argv[++i]);
+            config.frame_count = evx_max2(1, frame_count);
+        }
+        else if (0 == strcmp(argv[i], "-l") && has_value)
+        {
+            int32 slice_count = atoi(argv[++i]);
+            config.slice_count = evx_max2(1, slice_count);
+        }
+        else if (0 == strcmp(argv[i], "-t") && has_value)
+        {
+            int32 thread_count = atoi(argv[++i]);
+            config.thread_count = evx_max2(1, thread_count);
+        }
+        else if (0 == strcmp(argv[i], "-e") && has_value)
+        {
+            const char *name = argv[++i];
+
+            if (0 == strcmp(name, "abac"))
+            {
+                config.entropy_mode = EVX_ENTROPY_MODE_ABAC;
+            }
+            else if (0 == strcmp(name, "range"))
+            {
+                config.entropy_mode = EVX_ENTROPY_MODE_RANGE;
+            }
+            else if (0 == strcmp(name, "context"))
+            {
+                config.entropy_mode = EVX_ENTROPY_MODE_CONTEXT;
+            }
+            else if (0 == strcmp(name, "huffman"))
+            {
+                config.entropy_mode = EVX_ENTROPY_MODE_HUFFMAN;
+            }
+            else
+            {
+                printf("Unsupported entropy mode %s.\n", name);
+                return 1;
+            }
+        }
+        else if (0 == strcmp(argv[i], "-f") && has_value)
+        {
+            const char *name = argv[++i];
+
+            if (0 == strcmp(name, "reference"))
+            {
+                config.transform_mode = EVX_TRANSFORM_MODE_REFERENCE;
+            }
+            else if (0 == strcmp(name, "butterfly"))
+            {
+                config.transform_mode = EVX_TRANSFORM_MODE_BUTTERFLY;
+            }
+            else
+            {
+                printf("Unsupported transform mode %s.\n", name);
+                return 1;
+            }
+        }
+        else if (0 == strcmp(argv[i], "-i") && has_value)
+        {
+            config.input_path = argv[++i];
+        }
+        else if (0 == strcmp(argv[i], "-k") && has_value)
+        {
+            int32 iterations = atoi(argv[++i]);
+
+            printf("simd: %s\n", query_simd_level_name(query_simd_level()));
+
+            return run_transform_sweep(evx_max2(1, iterations));
+        }
+        else if (0 == strcmp(argv[i], "-x") && has_value)
+        {
+            // Restrict the vector kernels, useful for comparing against the scalar reference.
+            const char *name = argv[++i];
+            EVX_SIMD_LEVEL level = EVX_SIMD_SCALAR;
+
+            while (level < EVX_SIMD_AVX2 && strcmp(name, query_simd_level_name(level)))
+            {
+                level = (EVX_SIMD_LEVEL) (level + 1);
+            }
+
+            if (strcmp(name, query_simd_level_name(level)) || 
+                evx_failed(select_block_metric_kernels(level)) ||
+                evx_failed(select_transform_kernels(level)) ||
+                evx_failed(select_quantize_kernels(level)))
+            {
+                printf("Unsupported simd level %s.\n", name);
+                return 1;
+            }
+        }
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    printf("simd: %s metrics, %s transforms, %s quantizers\n", query_simd_level_name(query_block_metric_kernels().level), 
+           query_simd_level_name(query_transform_kernels(config.transform_mode).level),
+           query_simd_level_name(query_quantize_kernels().level));
+
+    if (config.input_path)
+    {
+        // File based sequences have a single fixed resolution.
+        config.size_count = 1;
+    }
+
+    for (uint32 s = 0; s < config.size_count; ++s)
+    for (uint32 q = 0; q < config.quality_count; ++q)
+    {
+        uint32 width = config.width_list[s];
+        uint32 height = config.height_list[s];
+
+        if (0 == width || 0 == height || (width & 0x1) || (height & 0x1))
+        {
+            printf("Invalid resolution %ix%i (dimensions must be even).\n", width, height);
+            return 1;
+        }
+
+        evx_bench_result result;
+        result.encode_times = new uint64[config.frame_count];
+        result.decode_times = new uint64[config.frame_count];
+        result.total_bytes = 0;
+        result.min_bytes = EVX_MAX_UINT32;
+        result.max_bytes = 0;
+        result.checksum = 2166136261;
+        result.psnr_sum = 0.0;
+        result.motion_vector_bits = 0;
+        result.motion_vector_count = 0;
+        result.zero_block_count = 0;
+
+        clear_timing_stats(&result.encoder_timing);
+        clear_timing_stats(&result.decoder_timing);
+
+        if (evx_failed(run_benchmark(width, height, config.quality_list[q], config, &result)))
+        {
+            delete [] result.encode_times;
+            delete [] result.decode_times;
+            return 1;
+        }
+
+        print_result(width, height, config.quality_list[q], config.frame_count, &result);
+
+        delete [] result.encode_times;
+        delete [] result.decode_times;
+    }
+
+    return 0;
+}
@@ -3,8 +3,33 @@
 #include "math.h"
 #include "memory.h"
 
+// Word accesses may touch up to 7 bytes beyond the final byte of the stream, 
+// so every store is allocated with this many bytes of slack.
+#define EVX_BIT_STREAM_PADDING                  (8)
+
 namespace evx {
 
+static inline uint64 load_word(const uint8 *source)
+{
+    uint64 value = 0;
+    memcpy(&value, source, sizeof(value));
+
+#if defined (__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    value = __builtin_bswap64(value);
+#endif
+
+    return value;
+}
+
+static inline void store_word(uint8 *dest, uint64 value)
+{
+#if defined (__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    value = __builtin_bswap64(value);
+#endif
+
+    memcpy(dest, &value, sizeof(value));
+}
+
 bit_stream::bit_stream() 
 {
     read_index = 0;
@@ -72,7 +97,7 @@ uint32 bit_stream::resize_capacity(uint32 size_in_bits)
     clear();
 
     uint32 byte_size = align(size_in_bits, 8) >> 3;
-    data_store = new uint8[byte_size];
+    data_store = new uint8[byte_size + EVX_BIT_STREAM_PADDING];
 
     if (!data_store) 
     {
@@ -107,7 +132,7 @@ evx_status bit_stream::assign(void *bytes, uint32 size)
     clear();
 
     // Copy the data into our own buffer and adjust our indices.
-    data_store = new uint8[size];
+    data_store = new uint8[size + EVX_BIT_STREAM_PADDING];
 
     if (!data_store) 
     {
@@ -115,6 +140,7 @@ evx_status bit_stream::assign(void *bytes, uint32 size)
     }
 
     memcpy(data_store, bytes, size);
+    memset(data_store + size, 0, EVX_BIT_STREAM_PADDING);
 
     read_index  = 0;
     write_index = size << 3;
@@ -150,53 +176,12 @@ bool bit_stream::is_full() const
 
 evx_status bit_stream::write_byte(uint8 value) 
 {
-    if (write_index + 8 > query_capacity()) 
-    {
-        return EVX_ERROR_CAPACITY_LIMIT;
-    }
-
-    // Determine the current byte to write.
-    uint32 dest_byte = write_index >> 3;
-    uint8 dest_bit = write_index % 8;
-
-    if (0 == dest_bit) 
-    {
-        // This is a byte aligned write, so we perform it at byte level.
-        uint8 *data = &(data_store[dest_byte]);
-        *data = value;
-        write_index += 8;
-    } 
-    else 
-    {
-        // Slower byte unaligned write.
-        for (uint8 i = 0; i < 8; ++i) 
-        {
-            write_bit((value >> i) & 0x1);
-        }
-    }
-
-    return EVX_SUCCESS;
+    return put_bits(value, 8);
 }
 
 evx_status bit_stream::write_bit(uint8 value) 
 {
-    if (write_index + 1 > query_capacity()) 
-    {
-        return EVX_ERROR_CAPACITY_LIMIT;
-    }
-
-    // Determine the current byte to write.
-    uint32 dest_byte = write_index >> 3;
-    uint8 dest_bit = write_index % 8;
-
-    // Pull the correct byte from our data store, update it, and then store it.
-    // Note that we do not guarantee that unused buffer memory was zero filled,
-    // thus we safely clear the write bit.
-    uint8 *data = &(data_store[dest_byte]);
-    *data = ((*data) & ~(0x1 << dest_bit)) | (value & 0x1) << dest_bit;
-    write_index++;
-
-    return EVX_SUCCESS;
+    return put_bits(value & 0x1, 1);
 }
 
 evx_status bit_stream::write_bits(void *data, uint32 bit_count) 
@@ -229,17 +214,28 @@ evx_status bit_stream::write_bits(void *data, uint32 bit_count)
         }
     }
 
-    if (bits_copied < bit_count) 
+    write_index += bits_copied;
+
+    while (bits_copied < bit_count) 
     {
-        // Perform unaligned copies of our data.
-        bits_copied += unaligned_bit_copy(source, 
-                                          bits_copied, 
-                                          bit_count - bits_copied,
-                                          data_store, 
-                                          write_index + bits_copied);
-    }
+        // Gather the remaining source bits a word at a time. Our source offset is 
+        // always byte aligned here, and we never read beyond the source bytes.
+        uint8 count = evx_min2(32, bit_count - bits_copied);
+        uint8 *source_bytes = source + (bits_copied >> 3);
+        uint32 value = 0;
 
-    write_index += bits_copied;
+        for (uint8 i = 0; i < ((count + 7) >> 3); ++i)
+        {
+            value |= uint32(source_bytes[i]) << (i << 3);
+        }
+
+        if (evx_failed(put_bits(value, count)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        bits_copied += count;
+    }
 
     return EVX_SUCCESS;
 }
@@ -290,6 +286,47 @@ evx_status bit_stream::read_bytes(void *data, uint32 count)
     return read_bits(data, count << 3);
 }
 
+evx_status bit_stream::transfer_bytes(bit_stream *dest, uint32 count)
+{
+    if (EVX_PARAM_CHECK) 
+    {
+        if (!dest || 0 == count) 
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    if (read_index + (count << 3) > write_index) 
+    {
+        return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+    }
+
+    if (0 == (read_index % 8))
+    {
+        // Byte aligned sources may be written directly from our data store.
+        evx_status result = dest->write_bytes(data_store + (read_index >> 3), count);
+
+        if (EVX_SUCCESS == result)
+        {
+            read_index += (count << 3);
+        }
+
+        return result;
+    }
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        uint8 value = 0;
+
+        if (EVX_SUCCESS != read_byte(&value) || EVX_SUCCESS != dest->write_byte(value))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
 evx_status bit_stream::peek_byte(void *data)
 {
     if (EVX_PARAM_CHECK) 
@@ -316,13 +353,7 @@ evx_status bit_stream::peek_byte(void *data)
     } 
     else
     {
-        // Slower byte unaligned read.
-        for (uint8 i = 0; i < 8; ++i) 
-        {
-            uint8 temp = 0;
-            peek_bit(&temp);
-            *dest = (*dest & ~(0x1 << i)) | (temp << i);
-        }
+        *dest = (uint8) load_bits(read_index, 8);
     }
 
     return EVX_SUCCESS;
@@ -343,15 +374,11 @@ evx_status bit_stream::peek_bit(void *data)
         return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
     }
 
-    // Determine the current byte to read from.
-    uint32 source_byte = read_index >> 3;
-    uint8 source_bit = read_index % 8;
     uint8 *dest = reinterpret_cast<uint8 *>(data);
 
-    // Pull the correct byte from our data store. Note that we 
-    // preserve the high bits of *dest.
+    // Note that we preserve the high bits of *dest.
     *dest &= 0xFE;
-    *dest |= ((data_store[source_byte]) >> source_bit) & 0x1;
+    *dest |= (uint8) load_bits(read_index, 1);
 
     return EVX_SUCCESS;
 }
@@ -391,16 +418,104 @@ evx_status bit_stream::peek_bits(void *data, uint32 count)
         }
     }
 
-    if (bits_copied < count) 
+    while (bits_copied < count) 
+    {
+        // Scatter the remaining bits a word at a time. Our destination offset is always
+        // byte aligned here, and we preserve any dest bits beyond the requested count.
+        uint8 word_count = evx_min2(32, count - bits_copied);
+        uint32 value = load_bits(read_index + bits_copied, word_count);
+        uint8 *dest_bytes = dest + (bits_copied >> 3);
+
+        for (uint8 i = 0; i < word_count; i += 8)
+        {
+            uint8 byte_mask = (uint8) ((0x1 << evx_min2(8, word_count - i)) - 1);
+            dest_bytes[i >> 3] = (dest_bytes[i >> 3] & ~byte_mask) | ((value >> i) & byte_mask);
+        }
+
+        bits_copied += word_count;
+    }
+
+    return EVX_SUCCESS;
+}
+
+uint32 bit_stream::load_bits(uint32 bit_offset, uint8 count) const
+{
+    // The caller guarantees that bit_offset lies within the store. Bits beyond the 
+    // write index are masked off so that the result never depends upon stale data.
+    uint32 available = write_index - bit_offset;
+
+    if (!available)
     {
-        // Perform unaligned copies of our data.
-        bits_copied += unaligned_bit_copy(data_store, 
-                                          read_index + bits_copied, 
-                                          count - bits_copied,
-                                          dest, 
-                                          bits_copied);
+        return 0;
     }
 
+    uint64 word = load_word(data_store + (bit_offset >> 3)) >> (bit_offset & 0x7);
+    uint8 valid_count = evx_min2(count, available);
+
+    return (uint32) (word & ((uint64(0x1) << valid_count) - 1));
+}
+
+evx_status bit_stream::put_bits(uint32 value, uint8 count)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (count > 32)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    if (write_index + count > query_capacity()) 
+    {
+        return EVX_ERROR_CAPACITY_LIMIT;
+    }
+
+    // Merge the value with the partial byte at our write index and store the whole
+    // word. Bytes beyond the write index hold no data, so they may be overwritten.
+    uint32 dest_byte = write_index >> 3;
+    uint8 dest_bit = write_index & 0x7;
+    uint64 word = data_store[dest_byte] & ((0x1 << dest_bit) - 1);
+
+    word |= (uint64(value) & ((uint64(0x1) << count) - 1)) << dest_bit;
+    store_word(data_store + dest_byte, word);
+    write_index += count;
+
+    return EVX_SUCCESS;
+}
+
+evx_status bit_stream::get_bits(uint8 count, uint32 *value)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!value || count > 32)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    if (read_index + count > write_index) 
+    {
+        return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+    }
+
+    *value = load_bits(read_index, count);
+    read_index += count;
+
+    return EVX_SUCCESS;
+}
+
+evx_status bit_stream::show_bits(uint8 count, uint32 *value)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!value || count > 32)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    *value = load_bits(read_index, count);
+
     return EVX_SUCCESS;
 }
 
@@ -81,12 +81,25 @@ public:
     evx_status read_bytes(void *data, uint32 count);
     evx_status read_bits(void *data, uint32 count);
 
+    // transfer_bytes reads count bytes from this stream and appends them to dest.
+    evx_status transfer_bytes(bit_stream *dest, uint32 count);
+
     evx_status peek_byte(void *data);
     evx_status peek_bit(void *data);
     evx_status peek_bytes(void *data, uint32 count);
     evx_status peek_bits(void *data, uint32 count);
 
+    // Word oriented access. These move up to 32 bits at a time through a 64-bit
+    // window of the store, and are the basis for the byte and bit methods above.
+    // Bits are packed lsb first. show_bits does not advance the read index, and 
+    // reads beyond the end of the stream are zero filled.
+    evx_status put_bits(uint32 value, uint8 count);
+    evx_status get_bits(uint8 count, uint32 *value);
+    evx_status show_bits(uint8 count, uint32 *value);
+
 private:
+
+    uint32 load_bits(uint32 bit_offset, uint8 count) const;
   
     EVX_DISABLE_COPY_AND_ASSIGN(bit_stream);
 };
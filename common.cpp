@@ -2,21 +2,28 @@
 #include "common.h"
 #include "config.h"
 #include "memory.h"
+#include "quantize.h"
+#include "transform.h"
 #include "version.h"
 
 namespace evx {
 
-evx_status initialize_header(uint32 width, uint32 height, evx_header *header)
+evx_status initialize_header(uint32 width, uint32 height, EVX_ENTROPY_MODE entropy_mode, EVX_TRANSFORM_MODE transform_mode, evx_header *header)
 {
-    // Configure our header with default values.
+    // Configure our header with default values. The header is written to the
+    // stream verbatim, so we clear it first to avoid leaking padding bytes.
+    aligned_zero_memory(header, sizeof(evx_header));
+
     header->magic[0] = 'E';
     header->magic[1] = 'V';
     header->magic[2] = 'X';
     header->magic[3] = '1';
     header->ref_count = EVX_REFERENCE_FRAME_COUNT;
-    header->version = EVX_VERSION_WORD(EVX_VERSION_MAJOR, EVX_VERSION_MINOR);
+    header->version = EVX_VERSION_WORD(EVX_FORMAT_VERSION_MAJOR, EVX_FORMAT_VERSION_MINOR);
     header->frame_width = width;
     header->frame_height = height;
+    header->entropy_mode = entropy_mode;
+    header->transform_mode = transform_mode;
     header->size = sizeof(evx_header);
 
     return EVX_SUCCESS; 
@@ -24,7 +31,7 @@ evx_status initialize_header(uint32 width, uint32 height, evx_header *header)
 
 evx_status verify_header(const evx_header &header)
 {
-    uint16 version = EVX_VERSION_WORD(EVX_VERSION_MAJOR, EVX_VERSION_MINOR);
+    uint16 version = EVX_VERSION_WORD(EVX_FORMAT_VERSION_MAJOR, EVX_FORMAT_VERSION_MINOR);
 
     if (header.magic[0] != 'E' || header.magic[1] != 'V' ||
         header.magic[2] != 'X' || header.magic[3] != '1')
@@ -34,7 +41,9 @@ evx_status verify_header(const evx_header &header)
 
     if (header.version != version || 
         header.ref_count != EVX_REFERENCE_FRAME_COUNT || 
-        header.size != sizeof(header))
+        header.size != sizeof(header) ||
+        header.entropy_mode >= EVX_ENTROPY_MODE_COUNT ||
+        header.transform_mode >= EVX_TRANSFORM_MODE_COUNT)
     {
         return EVX_ERROR_INVALID_RESOURCE;
     }
@@ -44,7 +53,7 @@ evx_status verify_header(const evx_header &header)
 
 evx_status clear_header(evx_header *header)
 {
-    return initialize_header(0, 0, header);
+    return initialize_header(0, 0, (EVX_ENTROPY_MODE) EVX_DEFAULT_ENTROPY_MODE, (EVX_TRANSFORM_MODE) EVX_DEFAULT_TRANSFORM_MODE, header);
 }
 
 evx_status clear_frame(evx_frame *frame)
@@ -60,91 +69,187 @@ evx_status clear_frame(evx_frame *frame)
     frame->type = EVX_FRAME_INTRA;
     frame->index = 0;
     frame->quality = clip_range(EVX_DEFAULT_QUALITY_LEVEL, 1, 100);
+    frame->slice_count = evx_max2(EVX_DEFAULT_SLICE_COUNT, 1);
 
     return EVX_SUCCESS;
 }
 
 evx_status clear_block_desc(evx_block_desc *block_desc)
 {
-    aligned_zero_memory(block_desc, sizeof(block_desc));
+    aligned_zero_memory(block_desc, sizeof(evx_block_desc));
     block_desc->block_type = EVX_BLOCK_INTRA_DEFAULT;
 
     return EVX_SUCCESS;
 }
 
-evx_context::evx_context() : block_table(NULL)
+evx_context::evx_context() : block_table(NULL), slices(NULL), slice_count(0), rows(NULL), entropy_mode(EVX_ENTROPY_MODE_ABAC), transform_mode(EVX_TRANSFORM_MODE_REFERENCE)
 {
+    clear_timing_stats(&timing);
+    memset(&stats, 0, sizeof(stats));
 }
 
-evx_status initialize_context(uint32 width, uint32 height, evx_context *context)
+evx_status initialize_context(uint32 width, uint32 height, EVX_ENTROPY_MODE entropy_mode, EVX_TRANSFORM_MODE transform_mode, evx_context *context)
 {
     if (EVX_PARAM_CHECK)
     {
-        if (!context)
+        if (!context || entropy_mode >= EVX_ENTROPY_MODE_COUNT || transform_mode >= EVX_TRANSFORM_MODE_COUNT)
         {
             return evx_post_error(EVX_ERROR_INVALIDARG);
         }
     }
 
+    clear_timing_stats(&context->timing);
+    memset(&context->stats, 0, sizeof(context->stats));
+
     context->width_in_blocks = (width >> EVX_MACROBLOCK_SHIFT);
     context->height_in_blocks = (height >> EVX_MACROBLOCK_SHIFT);
+    context->entropy_mode = entropy_mode;
+    context->transform_mode = transform_mode;
     uint32 block_count = (context->width_in_blocks) * (context->height_in_blocks);
 
+    // Built here rather than by the first block that is quantized.
+    initialize_quantization_tables();
+
     if (EVX_SUCCESS != context->cache_bank.input_cache.initialize(EVX_IMAGE_FORMAT_R16S, width, height))
     {
         clear_context(context);
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    if (EVX_SUCCESS != context->cache_bank.transform_cache.initialize(EVX_IMAGE_FORMAT_R16S, EVX_MACROBLOCK_SIZE, EVX_MACROBLOCK_SIZE))
+
+    if (EVX_SUCCESS != context->cache_bank.output_cache.initialize(EVX_IMAGE_FORMAT_R16S, width, height))
     {
         clear_context(context);
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    if (EVX_SUCCESS != context->cache_bank.motion_cache.initialize(EVX_IMAGE_FORMAT_R16S, EVX_MACROBLOCK_SIZE, EVX_MACROBLOCK_SIZE))
+    for (uint32 i = 0; i < EVX_REFERENCE_FRAME_COUNT; ++i)
     {
-        clear_context(context);
-        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        if (EVX_SUCCESS != context->cache_bank.prediction_cache[i].initialize(EVX_IMAGE_FORMAT_R16S, width, height))
+        {
+            clear_context(context);
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
     }
 
-    if (EVX_SUCCESS != context->cache_bank.output_cache.initialize(EVX_IMAGE_FORMAT_R16S, width, height))
+#if EVX_SUBPEL_PLANE_MODE
+    // Sub-pixel planes are allocated on first use, see build_subpel_planes.
+    for (uint32 i = 0; i < EVX_REFERENCE_FRAME_COUNT; ++i)
+    {
+        context->cache_bank.subpel_valid[i] = false;
+    }
+#endif
+
+#if EVX_MOTION_PYRAMID_SEARCH
+    // Pyramid levels are allocated on first use, see build_motion_pyramid.
+    for (uint32 i = 0; i < EVX_REFERENCE_FRAME_COUNT; ++i)
+    {
+        context->cache_bank.pyramid_valid[i] = false;
+    }
+#endif
+
+    context->block_table = new evx_block_desc[block_count];
+
+    if (!context->block_table)
     {
         clear_context(context);
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    if (EVX_SUCCESS != context->cache_bank.staging_cache.initialize(EVX_IMAGE_FORMAT_R16S, EVX_MACROBLOCK_SIZE, EVX_MACROBLOCK_SIZE))
+    aligned_zero_memory(context->block_table, sizeof(evx_block_desc) * block_count);
+
+    context->rows = new evx_row[context->height_in_blocks];
+
+    if (!context->rows || evx_failed(context->row_progress.initialize(context->height_in_blocks)))
     {
         clear_context(context);
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    for (uint32 i = 0; i < EVX_REFERENCE_FRAME_COUNT; ++i)
+    for (uint32 i = 0; i < context->height_in_blocks; ++i)
     {
-        if (EVX_SUCCESS != context->cache_bank.prediction_cache[i].initialize(EVX_IMAGE_FORMAT_R16S, width, height))
+        evx_row *row = &context->rows[i];
+
+        if (EVX_SUCCESS != row->transform_cache.initialize(EVX_IMAGE_FORMAT_R16S, EVX_MACROBLOCK_SIZE, EVX_MACROBLOCK_SIZE) ||
+            EVX_SUCCESS != row->motion_cache.initialize(EVX_IMAGE_FORMAT_R16S, EVX_MACROBLOCK_SIZE, EVX_MACROBLOCK_SIZE))
         {
             clear_context(context);
             return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
         }
-    }
-    
-    // Create block caches.
-    create_macroblock(context->cache_bank.transform_cache, 0, 0, &context->cache_bank.transform_block);
-    create_macroblock(context->cache_bank.motion_cache, 0, 0, &context->cache_bank.motion_block);
-    create_macroblock(context->cache_bank.staging_cache, 0, 0, &context->cache_bank.staging_block);
 
-    context->block_table = new evx_block_desc[block_count];
+        create_macroblock(row->transform_cache, 0, 0, &row->transform_block);
+        create_macroblock(row->motion_cache, 0, 0, &row->motion_block);
+    }
 
-    if (!context->block_table)
+    if (evx_failed(initialize_slices(EVX_DEFAULT_SLICE_COUNT, context)))
     {
         clear_context(context);
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    aligned_zero_memory(context->block_table, sizeof(evx_block_desc) * block_count);
+    return EVX_SUCCESS;
+}
 
-    context->feed_stream.resize_capacity(32 * EVX_MB);
+evx_status initialize_slices(uint32 slice_count, evx_context *context)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!context || 0 == slice_count || slice_count > EVX_MAX_SLICE_COUNT || 
+            slice_count > context->height_in_blocks)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    if (slice_count == context->slice_count)
+    {
+        return EVX_SUCCESS;
+    }
+
+    delete [] context->slices;
+
+    context->slice_count = 0;
+    context->slices = new evx_slice[slice_count];
+
+    if (!context->slices)
+    {
+        return evx_post_error(EVX_ERROR_OUTOFMEMORY);
+    }
+
+    // Each slice receives a share of the entropy capacity proportional to its height.
+    uint32 capacity_per_row = (32 * EVX_MB) / context->height_in_blocks;
+
+    for (uint32 i = 0; i < slice_count; ++i)
+    {
+        evx_slice *slice = &context->slices[i];
+
+        slice->first_row = (i * context->height_in_blocks) / slice_count;
+        slice->row_count = ((i + 1) * context->height_in_blocks) / slice_count - slice->first_row;
+
+        if (EVX_SUCCESS != slice->transform_cache.initialize(EVX_IMAGE_FORMAT_R16S, EVX_MACROBLOCK_SIZE, EVX_MACROBLOCK_SIZE) ||
+            EVX_SUCCESS != slice->motion_cache.initialize(EVX_IMAGE_FORMAT_R16S, EVX_MACROBLOCK_SIZE, EVX_MACROBLOCK_SIZE) ||
+            EVX_SUCCESS != slice->staging_cache.initialize(EVX_IMAGE_FORMAT_R16S, EVX_MACROBLOCK_SIZE, EVX_MACROBLOCK_SIZE))
+        {
+            delete [] context->slices;
+            context->slices = NULL;
+
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        // Create block caches.
+        create_macroblock(slice->transform_cache, 0, 0, &slice->transform_block);
+        create_macroblock(slice->motion_cache, 0, 0, &slice->motion_block);
+        create_macroblock(slice->staging_cache, 0, 0, &slice->staging_block);
+
+        slice->slice_stream.resize_capacity(capacity_per_row * slice->row_count);
+        slice->coder.initialize(context->entropy_mode);
+
+        slice->ordered_rows = false;
+        clear_timing_stats(&slice->timing);
+        memset(&slice->stats, 0, sizeof(slice->stats));
+    }
+
+    context->slice_count = slice_count;
 
     return EVX_SUCCESS;
 }
@@ -161,20 +266,50 @@ evx_status clear_context(evx_context *context)
 
     context->cache_bank.input_cache.deinitialize();
     context->cache_bank.output_cache.deinitialize();
-    context->cache_bank.transform_cache.deinitialize();
-    context->cache_bank.motion_cache.deinitialize();
-    context->cache_bank.staging_cache.deinitialize();
 
     for (uint32 i = 0; i < EVX_REFERENCE_FRAME_COUNT; ++i)
     {
         context->cache_bank.prediction_cache[i].deinitialize();
+
+#if EVX_SUBPEL_PLANE_MODE
+        for (uint32 k = 0; k < EVX_SUBPEL_PLANE_COUNT; ++k)
+        {
+            context->cache_bank.subpel_cache[i][k].deinitialize();
+        }
+
+        context->cache_bank.subpel_valid[i] = false;
+#endif
+
+#if EVX_MOTION_PYRAMID_SEARCH
+        for (uint32 k = 0; k < EVX_MOTION_PYRAMID_LEVELS; ++k)
+        {
+            destroy_image(&context->cache_bank.prediction_pyramid[i][k]);
+        }
+
+        context->cache_bank.pyramid_valid[i] = false;
+#endif
     }
 
+#if EVX_MOTION_PYRAMID_SEARCH
+    for (uint32 k = 0; k < EVX_MOTION_PYRAMID_LEVELS; ++k)
+    {
+        destroy_image(&context->cache_bank.input_pyramid[k]);
+    }
+#endif
+
     delete [] context->block_table;
+    delete [] context->slices;
+    delete [] context->rows;
 
     context->block_table = NULL;
-    context->feed_stream.clear();
-    context->arith_coder.clear();
+    context->slices = NULL;
+    context->slice_count = 0;
+    context->rows = NULL;
+
+    context->row_progress.deinitialize();
+
+    clear_timing_stats(&context->timing);
+    memset(&context->stats, 0, sizeof(context->stats));
 
     return EVX_SUCCESS;
 }
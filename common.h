@@ -34,11 +34,14 @@
 #define __EVX_COMMON_H__
 
 #include "base.h"
+#include "config.h"
 #include "types.h"
 #include "imageset.h"
 #include "bitstream.h"
-#include "abac.h"
+#include "symbol.h"
 #include "macroblock.h"
+#include "thread.h"
+#include "timing.h"
 
 // The structures defined here are designed to be lightweight and managed
 // by the larger codec objects. For this reason, these structures cannot
@@ -55,13 +58,15 @@ typedef struct evx_header
     uint8 magic[4];        // must be 'EVX1'
     uint16 size;           // size of the header.
     uint8 ref_count;       // should match EVX_REFERENCE_FRAME_COUNT.
-    uint16 version;                        
+    uint16 version;        // see EVX_FORMAT_VERSION_MAJOR and EVX_FORMAT_VERSION_MINOR.
     uint16 frame_width;
     uint16 frame_height;
+    uint8 entropy_mode;    // see EVX_ENTROPY_MODE.
+    uint8 transform_mode;  // see EVX_TRANSFORM_MODE.
 
 } evx_header;
 
-evx_status initialize_header(uint32 width, uint32 height, evx_header *header);
+evx_status initialize_header(uint32 width, uint32 height, EVX_ENTROPY_MODE entropy_mode, EVX_TRANSFORM_MODE transform_mode, evx_header *header);
 evx_status verify_header(const evx_header &header);
 evx_status clear_header(evx_header *header);
 
@@ -70,6 +75,7 @@ typedef struct evx_frame
     EVX_FRAME_TYPE type;    // current frame type
     uint32 index;           // always equals count - 1
     uint16 quality;         // global frame quality
+    uint16 slice_count;     // number of independently coded slices
 
 } evx_frame;
 
@@ -88,6 +94,8 @@ typedef struct evx_block_desc
     bool sp_amount;             // 0 = half pixel, 1 = quarter pixel
     uint8 sp_index;             // 3 bits - specifies the direction of the prediction
     uint8 q_index;              // per block quantization index level.
+    uint8 coded_pattern;        // 7 bits - one per 8x8 transform block that holds coefficients,
+                                // and one for luma coded as a 16x16 block (see macroblock.h).
 
     // peek and debug only:
     int16 variance;             // pre-q block variance.
@@ -98,6 +106,16 @@ evx_status clear_block_desc(evx_block_desc *desc);
 
 #pragma pack(pop)
 
+#if EVX_SUBPEL_PLANE_MODE == 1
+    #define EVX_SUBPEL_PLANE_COUNT          (4)
+#elif EVX_SUBPEL_PLANE_MODE == 2
+    #define EVX_SUBPEL_PLANE_COUNT          (12)
+#endif
+
+#if EVX_MOTION_PYRAMID_SEARCH
+    #define EVX_MOTION_PYRAMID_LEVELS       (2)
+#endif
+
 // The cache bank is directly managed by the context. It's primary purpose
 // is to restrict the pipeline's context access to the images caches.
 
@@ -105,34 +123,93 @@ typedef struct evx_cache_bank
 {
     image_set input_cache;            // yuv420p view of the source image.
     image_set output_cache;           // transformed and quantized view.
+    image_set prediction_cache[EVX_REFERENCE_FRAME_COUNT]; 
+
+#if EVX_SUBPEL_PLANE_MODE
+    // pre-interpolated views of each prediction frame, see build_subpel_planes.
+    image_set subpel_cache[EVX_REFERENCE_FRAME_COUNT][EVX_SUBPEL_PLANE_COUNT];
+    bool subpel_valid[EVX_REFERENCE_FRAME_COUNT];
+#endif
+
+#if EVX_MOTION_PYRAMID_SEARCH
+    // downsampled luma of the source and prediction frames, see build_motion_pyramid.
+    image input_pyramid[EVX_MOTION_PYRAMID_LEVELS];
+    image prediction_pyramid[EVX_REFERENCE_FRAME_COUNT][EVX_MOTION_PYRAMID_LEVELS];
+    bool pyramid_valid[EVX_REFERENCE_FRAME_COUNT];
+#endif
+
+} evx_cache_bank;
+
+// A slice is a band of macroblock rows that is coded without reference to any other
+// slice of the current frame. Each slice owns the scratch caches and entropy state 
+// used to code it, so that all slices of a frame may be processed concurrently.
+
+typedef struct evx_slice
+{
+    uint32 first_row;                 // first macroblock row of the slice.
+    uint32 row_count;                 // number of macroblock rows in the slice.
+
     image_set transform_cache;        // scratch buffer used for transform ops.
     image_set motion_cache;           // cache for motion interpolated blocks.
-    image_set prediction_cache[EVX_REFERENCE_FRAME_COUNT]; 
     image_set staging_cache;          // used during serialization for ordering.
 
     macroblock transform_block;       // static cache for transform operations.
     macroblock motion_block;          // static cache for motion interpolation.
     macroblock staging_block;         // static cache for staging.
 
-} evx_cache_bank;
+    symbol_coder coder;               // entropy state of the slice, see symbol.h.
+    bit_stream slice_stream;          // coded contents of the slice.
 
-typedef struct evx_context
+    bool ordered_rows;                // rows must be reconstructed in order, see decode_slice.
+    evx_timing_stats timing;          // per-stage timing of the slice, merged into the context.
+    evx_stream_stats stats;           // bit usage of the slice, merged into the context.
+
+} evx_slice;
+
+// The decoder reconstructs the rows of a frame concurrently (see decode_slice), so 
+// each macroblock row owns the scratch caches used to decode its blocks.
+
+typedef struct evx_row
 {
-    entropy_coder arith_coder;  
-    bit_stream feed_stream;           // useful for feeding the entropy coder.
+    image_set transform_cache;        // scratch buffer used for transform ops.
+    image_set motion_cache;           // cache for motion interpolated blocks.
+
+    macroblock transform_block;       // static cache for transform operations.
+    macroblock motion_block;          // static cache for motion interpolation.
 
+} evx_row;
+
+typedef struct evx_context
+{
     evx_block_desc *block_table;
     evx_cache_bank cache_bank;        // bank of caches used by the pipeline.    
 
+    evx_slice *slices;                // see initialize_slices.
+    uint32 slice_count;
+    thread_pool worker_pool;          // persistent workers used to process slices.
+
+    evx_row *rows;                    // one per macroblock row.
+    progress_table row_progress;      // number of reconstructed blocks in each row.
+
     uint32 width_in_blocks;           // width of our full context space, in blocks
     uint32 height_in_blocks;          // height of our full context space, in blocks
+    EVX_ENTROPY_MODE entropy_mode;    // entropy backend used by all slices.
+    EVX_TRANSFORM_MODE transform_mode;  // transforms used by all blocks.
+
+    evx_timing_stats timing;          // per-stage timing, see EVX_ENABLE_STAGE_TIMING.
+    evx_stream_stats stats;           // bit usage of the most recent frame (encoder only).
 
     evx_context();
 } evx_context;
 
 // initialize_context will allocate the necessary space for all internal 
 // context buffers. This should only be done once for each coding session.
-evx_status initialize_context(uint32 width, uint32 height, evx_context *context);
+// All slices of the context are coded with the specified entropy backend and transforms.
+evx_status initialize_context(uint32 width, uint32 height, EVX_ENTROPY_MODE entropy_mode, EVX_TRANSFORM_MODE transform_mode, evx_context *context);
+
+// initialize_slices partitions the context into slice_count slices of (nearly) equal
+// height. This is a no-op if the context is already partitioned this way.
+evx_status initialize_slices(uint32 slice_count, evx_context *context);
 
 // query_context* return the requested dimension of the context in pixels.
 uint32 query_context_width(const evx_context &context);
@@ -41,6 +41,15 @@
 #define EVX_PERIODIC_INTRA_RATE                                     (3600)     // 0 implies only i-frames
 #define EVX_ENABLE_CHROMA_SUPPORT                                   (1)        // 0 - grayscale, 1 - color
 
+// Threading parameters. Each frame is divided into slices (bands of macroblock rows)
+// that are coded independently, and may therefore be processed concurrently by the
+// worker pool. Both values may be changed at runtime via set_slice_count and 
+// set_thread_count. Additional slices cost some efficiency at slice boundaries.
+
+#define EVX_DEFAULT_SLICE_COUNT                                     (1)
+#define EVX_MAX_SLICE_COUNT                                         (64)
+#define EVX_DEFAULT_THREAD_COUNT                                    (1)
+
 // Quantization parameters. Disabling quantization will enable a high
 // quality semi-lossless mode.
 
@@ -48,8 +57,47 @@
 #define EVX_ENABLE_LINEAR_QUANTIZATION                              (0)        // 0 - MPEG, 1 - H.263
 #define EVX_ROUNDED_QUANTIZATION                                    (1)      
 #define EVX_ADAPTIVE_QUANTIZATION                                   (1)
+#define EVX_ZERO_BLOCK_DETECTION                                    (1)        // skip delta blocks known to quantize to zero
+
+// Sub-pixel plane parameters. The encoder may pre-interpolate each reference frame
+// once, when it is committed, rather than interpolating every sub-pixel candidate
+// during motion search. Each plane costs as much memory as a prediction frame (3 
+// bytes per pixel, or 2.6 MB at 720p), and the planes of a frame are rebuilt on a 
+// single thread after it is deblocked. The output is identical in every mode.
+//   0 - disabled, sub-pixel blocks are always interpolated on the fly
+//   1 - half pel planes only (4 planes per reference frame, 42 MB at 720p)
+//   2 - half and quarter pel planes (12 planes per reference frame, 127 MB at 720p)
+#define EVX_SUBPEL_PLANE_MODE                                       (1)
+
+// Hierarchical motion parameters. The encoder may maintain 1/2 and 1/4 downsampled
+// luma pyramids of the source and of each reference frame, which it uses to find 
+// motion that lies beyond the reach of the full resolution search (see motion.cpp).
+#define EVX_MOTION_PYRAMID_SEARCH                                   (1)
+
+// Entropy parameters. The entropy backend is selected per stream and recorded in the
+// stream header, see EVX_ENTROPY_MODE. The default may be overridden via set_entropy_mode.
+//   0 - golomb precoder with the adaptive binary coder (abac)
+//   1 - multi-symbol range coder
+//   2 - context modeled binary coder (smallest streams)
+//   3 - static huffman tables (fastest decode)
+#define EVX_DEFAULT_ENTROPY_MODE                                    (2)
+
+// Transform parameters. The transforms are selected per stream and recorded in the stream
+// header, see EVX_TRANSFORM_MODE. The default may be overridden via set_transform_mode.
+//   0 - reference matrix transforms
+//   1 - fixed point butterfly transforms (fastest)
+#define EVX_DEFAULT_TRANSFORM_MODE                                  (1)
 
 // Deblocking parameters
 #define EVX_ENABLE_DEBLOCKING                                       (1)
 
+// Vectorization parameters. When enabled, block metrics, transforms and other hot
+// kernels select an sse2, sse4.1 or avx2 implementation at runtime. All vector 
+// kernels are bit-exact with their scalar counterparts.
+#define EVX_ENABLE_SIMD                                             (1)
+
+// Instrumentation parameters. Stage timing records per-stage latencies that
+// may be retrieved via query_timing. Set to 0 to compile out all timers.
+#define EVX_ENABLE_STAGE_TIMING                                     (1)
+
 #endif // __EVX_CONFIG_H__
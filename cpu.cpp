@@ -0,0 +1,88 @@
+
+#include "cpu.h"
+
+#if defined (EVX_SIMD_X86_SUPPORTED) && defined (_MSC_VER)
+#include "intrin.h"
+#endif
+
+namespace evx {
+
+static EVX_SIMD_LEVEL detect_simd_level()
+{
+#if defined (EVX_SIMD_X86_SUPPORTED) && defined (_MSC_VER)
+    int32 info[4] = {0};
+    bool avx2 = false;
+
+    __cpuid(info, 0);
+
+    if (info[0] >= 7)
+    {
+        __cpuid(info, 1);
+
+        // avx2 additionally requires os support for saving the ymm registers.
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+
+        if (osxsave && avx && (_xgetbv(0) & 0x6) == 0x6)
+        {
+            __cpuidex(info, 7, 0);
+            avx2 = (info[1] & (1 << 5)) != 0;
+        }
+    }
+
+    if (avx2)
+    {
+        return EVX_SIMD_AVX2;
+    }
+
+    __cpuid(info, 1);
+
+    if (info[2] & (1 << 19))
+    {
+        return EVX_SIMD_SSE41;
+    }
+
+    return (info[3] & (1 << 26)) ? EVX_SIMD_SSE2 : EVX_SIMD_SCALAR;
+#elif defined (EVX_SIMD_X86_SUPPORTED)
+    __builtin_cpu_init();
+
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return EVX_SIMD_AVX2;
+    }
+
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        return EVX_SIMD_SSE41;
+    }
+
+    return __builtin_cpu_supports("sse2") ? EVX_SIMD_SSE2 : EVX_SIMD_SCALAR;
+#else
+    return EVX_SIMD_SCALAR;
+#endif
+}
+
+EVX_SIMD_LEVEL query_simd_level()
+{
+    // Detected once, on first use. Contexts may be created on any thread, and the 
+    // initialization of a local static is thread safe.
+    static const EVX_SIMD_LEVEL simd_level = detect_simd_level();
+
+    return simd_level;
+}
+
+const char *query_simd_level_name(EVX_SIMD_LEVEL level)
+{
+    switch (level)
+    {
+        case EVX_SIMD_SCALAR: return "scalar";
+        case EVX_SIMD_SSE2: return "sse2";
+        case EVX_SIMD_SSE41: return "sse41";
+        case EVX_SIMD_AVX2: return "avx2";
+        default: break;
+    };
+
+    return "unknown";
+}
+
+} // namespace evx
\ No newline at end of file
@@ -0,0 +1,79 @@
+
+/*
+// Copyright (c) 2009-2014 Joe Bertolami. All Right Reserved.
+//
+// cpu.h
+//
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Additional Information:
+//
+//   For more information, visit http://www.bertolami.com.
+*/
+
+#ifndef __EVX_CPU_H__
+#define __EVX_CPU_H__
+
+#include "base.h"
+#include "config.h"
+
+// Processor feature detection for the vectorized kernels. The simd level is
+// detected once, and kernels that are not supported by the host processor
+// (or by the compiler) always fall back to the scalar reference versions.
+
+#if defined (__x86_64__) || defined (__i386__) || defined (_M_X64) || defined (_M_IX86)
+    #define EVX_ARCH_X86                                  // building for an x86 or x64 processor
+#endif
+
+#if EVX_ENABLE_SIMD && defined (EVX_ARCH_X86) && (defined (__GNUC__) || defined (_MSC_VER))
+    #define EVX_SIMD_X86_SUPPORTED                        // compiler can emit sse2, sse4.1 and avx2 kernels
+#endif
+
+#if defined (__GNUC__)
+    #define EVX_TARGET_SSE2 __attribute__((target("sse2")))
+    #define EVX_TARGET_SSE41 __attribute__((target("sse4.1")))
+    #define EVX_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+    #define EVX_TARGET_SSE2
+    #define EVX_TARGET_SSE41
+    #define EVX_TARGET_AVX2
+#endif
+
+namespace evx {
+
+enum EVX_SIMD_LEVEL
+{
+    EVX_SIMD_SCALAR = 0,
+    EVX_SIMD_SSE2,
+    EVX_SIMD_SSE41,
+    EVX_SIMD_AVX2,
+};
+
+// Returns the highest simd level supported by both the host processor and
+// the current build.
+EVX_SIMD_LEVEL query_simd_level();
+
+const char *query_simd_level_name(EVX_SIMD_LEVEL level);
+
+} // namespace evx
+
+#endif // __EVX_CPU_H__
\ No newline at end of file
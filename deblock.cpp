@@ -88,8 +88,6 @@ void deblock_filter_values(
     int16 delta_p0q0 = abs(p0 - q0);
     int16 delta_p1p0 = abs(p1 - p0);
     int16 delta_q1q0 = abs(q1 - q0);
-    int16 delta_p2p0 = abs(p2 - p0);
-    int16 delta_q2q0 = abs(q2 - q0);
 
     if (delta_p0q0 >= alpha_table[average_qp] || 
         delta_p1p0 >= beta_table[average_qp] || 
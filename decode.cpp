@@ -9,18 +9,20 @@
 
 namespace evx {
 
-evx_status unserialize_slice(bit_stream *input, evx_context *context);
+evx_status unserialize_slice(evx_context *context, evx_slice *slice);
+evx_status unserialize_slices(bit_stream *input, evx_context *context);
 evx_status deblock_image_filter(evx_block_desc *block_table, image_set *target_image);
 
-evx_status decode_block(const evx_frame &frame, const evx_block_desc &block_desc, const macroblock &source_block, 
-                        evx_cache_bank *cache_bank, int32 i, int32 j, macroblock *dest_block)
+evx_status decode_block(const evx_frame &frame, EVX_TRANSFORM_MODE transform_mode, const evx_block_desc &block_desc, const macroblock &source_block, 
+                        evx_cache_bank *cache_bank, macroblock *transform_block, macroblock *motion_block, 
+                        int32 i, int32 j, macroblock *dest_block)
 {
     switch (block_desc.block_type)
     {
         case EVX_BLOCK_INTRA_DEFAULT:
         {
-            inverse_quantize_macroblock(block_desc.q_index, block_desc.block_type, source_block, &cache_bank->transform_block);
-            inverse_transform_macroblock(cache_bank->transform_block, dest_block);
+            inverse_quantize_macroblock(block_desc.q_index, block_desc.block_type, block_desc.coded_pattern, source_block, transform_block);
+            inverse_transform_macroblock(transform_mode, *transform_block, block_desc.coded_pattern, dest_block);
 
         } break;
 
@@ -32,12 +34,10 @@ evx_status decode_block(const evx_frame &frame, const evx_block_desc &block_desc
 
             if (block_desc.sp_pred)
             {
-                int16 sp_i, sp_j;
-                compute_motion_direction_from_frac_index(block_desc.sp_index, &sp_i, &sp_j);
-                create_subpixel_macroblock(&cache_bank->prediction_cache[intra_pred_index], block_desc.sp_amount, beta_block, 
-                                           i + block_desc.motion_x + sp_i, j + block_desc.motion_y + sp_j, &cache_bank->motion_block);
+                macroblock sp_block;
+                create_subpixel_prediction(cache_bank, intra_pred_index, block_desc, i, j, motion_block, &sp_block);
 
-                copy_macroblock(cache_bank->motion_block, dest_block);
+                copy_macroblock(sp_block, dest_block);
             }
             else 
             {
@@ -52,21 +52,19 @@ evx_status decode_block(const evx_frame &frame, const evx_block_desc &block_desc
             macroblock beta_block;
             uint32 intra_pred_index = query_prediction_index_by_offset(frame, 0); 
             create_macroblock(cache_bank->prediction_cache[intra_pred_index], i + block_desc.motion_x, j + block_desc.motion_y, &beta_block);
-            inverse_quantize_macroblock(block_desc.q_index, block_desc.block_type, source_block, &cache_bank->transform_block);
+            inverse_quantize_macroblock(block_desc.q_index, block_desc.block_type, block_desc.coded_pattern, source_block, transform_block);
 
             if (block_desc.sp_pred)
             {
-                int16 sp_i, sp_j;
-                compute_motion_direction_from_frac_index(block_desc.sp_index, &sp_i, &sp_j);
-                create_subpixel_macroblock(&cache_bank->prediction_cache[intra_pred_index], block_desc.sp_amount, beta_block, 
-                                           i + block_desc.motion_x + sp_i, j + block_desc.motion_y + sp_j, &cache_bank->motion_block);
+                macroblock sp_block;
+                create_subpixel_prediction(cache_bank, intra_pred_index, block_desc, i, j, motion_block, &sp_block);
 
-                inverse_transform_add_macroblock(cache_bank->transform_block, cache_bank->motion_block, dest_block);
+                inverse_transform_add_macroblock(transform_mode, *transform_block, sp_block, block_desc.coded_pattern, dest_block);
             }
             else 
             {
                 // no sub-pixel motion estimation
-                inverse_transform_add_macroblock(cache_bank->transform_block, beta_block, dest_block);
+                inverse_transform_add_macroblock(transform_mode, *transform_block, beta_block, block_desc.coded_pattern, dest_block);
             }
 
         } break;
@@ -79,12 +77,10 @@ evx_status decode_block(const evx_frame &frame, const evx_block_desc &block_desc
 
             if (block_desc.sp_pred)
             {
-                int16 sp_i, sp_j;
-                compute_motion_direction_from_frac_index(block_desc.sp_index, &sp_i, &sp_j);
-                create_subpixel_macroblock(&cache_bank->prediction_cache[inter_pred_index], block_desc.sp_amount, beta_block, 
-                                           i + block_desc.motion_x + sp_i, j + block_desc.motion_y + sp_j, &cache_bank->motion_block);
+                macroblock sp_block;
+                create_subpixel_prediction(cache_bank, inter_pred_index, block_desc, i, j, motion_block, &sp_block);
 
-                copy_macroblock(cache_bank->motion_block, dest_block);
+                copy_macroblock(sp_block, dest_block);
             }
             else 
             {
@@ -108,21 +104,19 @@ evx_status decode_block(const evx_frame &frame, const evx_block_desc &block_desc
             macroblock beta_block;
             uint32 inter_pred_index = query_prediction_index_by_offset(frame, block_desc.prediction_target); 
             create_macroblock(cache_bank->prediction_cache[inter_pred_index], i + block_desc.motion_x, j + block_desc.motion_y, &beta_block);
-            inverse_quantize_macroblock(block_desc.q_index, block_desc.block_type, source_block, &cache_bank->transform_block);
+            inverse_quantize_macroblock(block_desc.q_index, block_desc.block_type, block_desc.coded_pattern, source_block, transform_block);
 
             if (block_desc.sp_pred)
             {
-                int16 sp_i, sp_j;
-                compute_motion_direction_from_frac_index(block_desc.sp_index, &sp_i, &sp_j);
-                create_subpixel_macroblock(&cache_bank->prediction_cache[inter_pred_index], block_desc.sp_amount, beta_block, 
-                                           i + block_desc.motion_x + sp_i, j + block_desc.motion_y + sp_j, &cache_bank->motion_block);
+                macroblock sp_block;
+                create_subpixel_prediction(cache_bank, inter_pred_index, block_desc, i, j, motion_block, &sp_block);
 
-                inverse_transform_add_macroblock(cache_bank->transform_block, cache_bank->motion_block, dest_block);
+                inverse_transform_add_macroblock(transform_mode, *transform_block, sp_block, block_desc.coded_pattern, dest_block);
             }
             else 
             {
                 // no sub-pixel motion estimation
-                inverse_transform_add_macroblock(cache_bank->transform_block, beta_block, dest_block);
+                inverse_transform_add_macroblock(transform_mode, *transform_block, beta_block, block_desc.coded_pattern, dest_block);
             }
 
         } break;
@@ -132,8 +126,8 @@ evx_status decode_block(const evx_frame &frame, const evx_block_desc &block_desc
             macroblock beta_block;
             uint32 inter_pred_index = query_prediction_index_by_offset(frame, block_desc.prediction_target); 
             create_macroblock(cache_bank->prediction_cache[inter_pred_index], i, j, &beta_block);
-            inverse_quantize_macroblock(block_desc.q_index, block_desc.block_type, source_block, &cache_bank->transform_block);
-            inverse_transform_add_macroblock(cache_bank->transform_block, beta_block, dest_block);
+            inverse_quantize_macroblock(block_desc.q_index, block_desc.block_type, block_desc.coded_pattern, source_block, transform_block);
+            inverse_transform_add_macroblock(transform_mode, *transform_block, beta_block, block_desc.coded_pattern, dest_block);
 
         } break;
 
@@ -143,57 +137,222 @@ evx_status decode_block(const evx_frame &frame, const evx_block_desc &block_desc
     return EVX_SUCCESS;
 }
 
-evx_status decode_slice(const evx_frame &frame, evx_context *context)
+// Intra motion blocks are the only blocks that reference the frame being decoded. 
+// query_intra_reference returns the range of block rows, and the rightmost block 
+// column, that such a block reads (including its sub-pixel neighbor).
+static bool query_intra_reference(const evx_block_desc &block_desc, int32 i, int32 j, 
+                                  int32 *top_row, int32 *bottom_row, int32 *right_column)
 {
-    uint32 block_index = 0;
-    uint32 width = query_context_width(*context);
-    uint32 height = query_context_height(*context);
+    if (!EVX_IS_INTRA_BLOCK_TYPE(block_desc.block_type) || !EVX_IS_MOTION_BLOCK_TYPE(block_desc.block_type))
+    {
+        return false;
+    }
+
+    int16 sp_i = 0, sp_j = 0;
+    int32 base_x = i + block_desc.motion_x;
+    int32 base_y = j + block_desc.motion_y;
+
+    if (block_desc.sp_pred)
+    {
+        compute_motion_direction_from_frac_index(block_desc.sp_index, &sp_i, &sp_j);
+    }
+
+    *top_row = (base_y + evx_min2(sp_j, 0)) >> EVX_MACROBLOCK_SHIFT;
+    *bottom_row = (base_y + evx_max2(sp_j, 0) + EVX_MACROBLOCK_SIZE - 1) >> EVX_MACROBLOCK_SHIFT;
+    *right_column = (base_x + evx_max2(sp_i, 0) + EVX_MACROBLOCK_SIZE - 1) >> EVX_MACROBLOCK_SHIFT;
+
+    return true;
+}
+
+// Rows may only be reconstructed out of order if no block references pixels that 
+// the serial order would not yet have reconstructed, below its own row. Streams 
+// that do (or that reference other slices) are decoded one row at a time, with the
+// first row of the slice waiting on the last row of the previous slice.
+static bool query_ordered_rows(const evx_context &context, const evx_slice &slice)
+{
+    uint32 block_index = slice.first_row * context.width_in_blocks;
+
+    for (uint32 y = slice.first_row; y < slice.first_row + slice.row_count; ++y)
+    for (uint32 x = 0; x < context.width_in_blocks; ++x)
+    {
+        int32 top_row, bottom_row, right_column;
+        const evx_block_desc &block_desc = context.block_table[block_index++];
+
+        if (query_intra_reference(block_desc, x << EVX_MACROBLOCK_SHIFT, y << EVX_MACROBLOCK_SHIFT, 
+                                  &top_row, &bottom_row, &right_column))
+        {
+            if (top_row < (int32) slice.first_row || bottom_row > (int32) y)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+// decode_slice reconstructs a single row of a slice. Rows are decoded as a wavefront: 
+// each block waits until the blocks it references in the rows above have been 
+// reconstructed, which for the default intra search is a lag of about two blocks.
+// The result is bit-exact with decoding the rows in order.
+evx_status decode_slice(const evx_frame &frame, evx_context *context, const evx_slice &slice, uint32 row_index)
+{
+    int32 width = query_context_width(*context);
+    uint32 block_index = row_index * context->width_in_blocks;
+    uint32 block_column = 0;
+    int32 j = row_index << EVX_MACROBLOCK_SHIFT;
     uint32 dest_index = query_prediction_index_by_offset(frame, 0);
+    evx_row *row = &context->rows[row_index];
 
     macroblock source_block, dest_block;
 
-    for (int32 j = 0; j < height; j += EVX_MACROBLOCK_SIZE)
-    for (int32 i = 0; i < width;  i += EVX_MACROBLOCK_SIZE)
+    if (slice.ordered_rows && row_index > 0)
+    {
+        context->row_progress.wait(row_index - 1, context->width_in_blocks);
+    }
+
+    for (int32 i = 0; i < width; i += EVX_MACROBLOCK_SIZE, ++block_column)
     {
         evx_block_desc *block_desc = &context->block_table[block_index++];
+        int32 top_row, bottom_row, right_column;
+
+        if (!slice.ordered_rows && query_intra_reference(*block_desc, i, j, &top_row, &bottom_row, &right_column))
+        {
+            uint32 required = evx_max2(evx_min2(right_column + 1, (int32) context->width_in_blocks), 0);
+
+            for (int32 k = top_row; k <= bottom_row && k < (int32) row_index; ++k)
+            {
+                context->row_progress.wait(k, required);
+            }
+        }
         
         create_macroblock(context->cache_bank.input_cache, i, j, &source_block);
         create_macroblock(context->cache_bank.prediction_cache[dest_index], i, j, &dest_block);
 
-        if (evx_failed(decode_block(frame, *block_desc, source_block, &context->cache_bank, i, j, &dest_block)))
+        if (evx_failed(decode_block(frame, context->transform_mode, *block_desc, source_block, &context->cache_bank, &row->transform_block, 
+                                    &row->motion_block, i, j, &dest_block)))
         {
+            // Release any rows waiting on us before we fail.
+            context->row_progress.publish(row_index, context->width_in_blocks);
             return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
         }
+
+        context->row_progress.publish(row_index, block_column + 1);
     }
 
     return EVX_SUCCESS;
 }
 
+typedef struct evx_decode_task
+{
+    const evx_frame *frame;
+    evx_context *context;
+
+} evx_decode_task;
+
+static evx_status unserialize_slice_task(void *user_data, uint32 task_index)
+{
+    evx_decode_task *task = (evx_decode_task *) user_data;
+    evx_slice *slice = &task->context->slices[task_index];
+
+    EVX_TIMING_BEGIN_FRAME(&slice->timing);
+    EVX_TIMING_BEGIN(unserialize_start);
+
+    if (evx_failed(unserialize_slice(task->context, slice)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    slice->ordered_rows = query_ordered_rows(*task->context, *slice);
+
+    EVX_TIMING_END(&slice->timing, EVX_TIMING_UNSERIALIZE, unserialize_start);
+
+    return EVX_SUCCESS;
+}
+
+static evx_status decode_row_task(void *user_data, uint32 task_index)
+{
+    evx_decode_task *task = (evx_decode_task *) user_data;
+    evx_context *context = task->context;
+    uint32 slice_index = 0;
+
+    while (task_index >= context->slices[slice_index].first_row + context->slices[slice_index].row_count)
+    {
+        slice_index++;
+    }
+
+    return decode_slice(*task->frame, context, context->slices[slice_index], task_index);
+}
+
 evx_status engine_decode_frame(bit_stream *input, const evx_frame &frame, evx_context *context, image *output)
 {
     uint32 dest_index = query_prediction_index_by_offset(frame, 0);
 
-    if (evx_failed(unserialize_slice(input, context)))
+    EVX_TIMING_BEGIN_FRAME(&context->timing);
+    EVX_TIMING_BEGIN(frame_start);
+
+    if (evx_failed(initialize_slices(frame.slice_count, context)))
+    {
+        return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+    }
+
+    // Split the frame into its slices, which are then unserialized concurrently.
+    if (evx_failed(unserialize_slices(input, context)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    if (evx_failed(decode_slice(frame, context)))
+    evx_decode_task task = { &frame, context };
+
+    if (evx_failed(context->worker_pool.execute(context->slice_count, unserialize_slice_task, &task)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    for (uint32 i = 0; i < context->slice_count; ++i)
+    {
+        EVX_TIMING_MERGE_FRAME(context->slices[i].timing, &context->timing);
+    }
+
+    // Blocks of a slice that is decoded in order may also read the rows of the following
+    // slice, before the serial order would have reconstructed them, so it waits as well.
+    for (uint32 i = context->slice_count; i > 1; --i)
+    {
+        context->slices[i - 1].ordered_rows |= context->slices[i - 2].ordered_rows;
+    }
+
+    EVX_TIMING_BEGIN(decode_start);
+
+    // Rows are handed out in order, so a row only ever waits on rows that are already 
+    // being decoded by another thread.
+    context->row_progress.reset();
+
+    if (evx_failed(context->worker_pool.execute(context->height_in_blocks, decode_row_task, &task)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
+    EVX_TIMING_END(&context->timing, EVX_TIMING_DECODE_SLICE, decode_start);
+    EVX_TIMING_BEGIN(deblock_start);
+
     // Run our in-loop deblocking filter on the final post prediction image.
     if (evx_failed(deblock_image_filter(context->block_table, &context->cache_bank.prediction_cache[dest_index])))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
+    EVX_TIMING_END(&context->timing, EVX_TIMING_DEBLOCK, deblock_start);
+    EVX_TIMING_BEGIN(convert_start);
+
     if (evx_failed(convert_image(context->cache_bank.prediction_cache[dest_index], output)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
+    EVX_TIMING_END(&context->timing, EVX_TIMING_CONVERT, convert_start);
+    EVX_TIMING_END(&context->timing, EVX_TIMING_FRAME, frame_start);
+    EVX_TIMING_END_FRAME(&context->timing);
+
     return EVX_SUCCESS;
 }
 
@@ -6,20 +6,24 @@
 #include "evx1enc.h"
 #include "motion.h"
 #include "quantize.h"
+#include "scan.h"
 
 namespace evx {
 
 evx_status deblock_image_filter(evx_block_desc *block_table, image_set *target_image);
-evx_status serialize_slice(const evx_frame &frame, evx_context *context, bit_stream *output);
-evx_status decode_block(const evx_frame &frame, const evx_block_desc &block_desc, const macroblock &source_block, 
-                        evx_cache_bank *cache_bank, int32 i, int32 j, macroblock *dest_block);
-
-evx_status classify_block(const evx_frame &frame, const macroblock &source_block, evx_cache_bank *cache_bank, int32 i, int32 j, evx_block_desc *output)
+evx_status serialize_slice(const evx_frame &frame, evx_context *context, evx_slice *slice);
+evx_status serialize_slices(evx_context *context, bit_stream *output);
+evx_status decode_block(const evx_frame &frame, EVX_TRANSFORM_MODE transform_mode, const evx_block_desc &block_desc, const macroblock &source_block, 
+                        evx_cache_bank *cache_bank, macroblock *transform_block, macroblock *motion_block, 
+                        int32 i, int32 j, macroblock *dest_block);
+
+evx_status classify_block(const evx_frame &frame, const macroblock &source_block, evx_cache_bank *cache_bank, evx_slice *slice, 
+                          int32 i, int32 j, const evx_motion_predictors &predictors, evx_block_desc *output)
 {
     evx_block_desc best_desc;
 
     // calculate_intra_prediction will return the source block desc if there is no better intra alternative.
-    int32 best_sad = calculate_intra_prediction(frame, source_block, i, j, cache_bank, &best_desc);
+    int32 best_sad = calculate_intra_prediction(frame, source_block, i, j, cache_bank, slice, &best_desc);
 
     if (EVX_FRAME_INTER == frame.type)
     {
@@ -31,7 +35,7 @@ evx_status classify_block(const evx_frame &frame, const macroblock &source_block
             evx_block_desc inter_desc;
 
             // calculate_inter_prediction will always return a best candidate.
-            int32 inter_sad = calculate_inter_prediction(frame, source_block, i, j, cache_bank, offset, &inter_desc);
+            int32 inter_sad = calculate_inter_prediction(frame, source_block, i, j, cache_bank, slice, offset, predictors, &inter_desc);
             
             if (EVX_IS_COPY_BLOCK_TYPE(inter_desc.block_type) ^ EVX_IS_COPY_BLOCK_TYPE(best_desc.block_type))
             {
@@ -66,112 +70,201 @@ evx_status classify_block(const evx_frame &frame, const macroblock &source_block
     return EVX_SUCCESS;
 }
 
-evx_status encode_block(const evx_frame &frame, const macroblock &source_block, evx_cache_bank *cache_bank, 
-                        int32 i, int32 j, evx_block_desc *block_desc, macroblock *dest_block)
+static uint32 estimate_block_bits(const int16 *block, uint32 stride, const uint8 *scan, uint32 coefficient_count, uint8 width_shift)
 {
-    // Classification only performs a fast block comparison and interpolation, so we recalculate
-    // the full block values when necessary.
+    // Approximates the cost of a block as serialize_block_8x8 codes it, with the lengths 
+    // of the exp-golomb codes of its run length and of each coefficient within the run.
+    uint32 width_mask = (0x1 << width_shift) - 1;
+    uint32 run_length = 0;
+    uint32 bits = 0;
 
-    switch (block_desc->block_type)
+    for (uint32 i = 0; i < coefficient_count; ++i)
     {
-        case EVX_BLOCK_INTRA_DEFAULT:
+        int16 value = block[(scan[i] >> width_shift) * stride + (scan[i] & width_mask)];
+
+        if (value)
         {
-            transform_macroblock(source_block, &cache_bank->transform_block);
-            block_desc->q_index = query_block_quantization_parameter(frame.quality, cache_bank->transform_block, block_desc->block_type);
-            block_desc->variance = compute_block_variance2(cache_bank->transform_block);
-            quantize_macroblock(block_desc->q_index, block_desc->block_type, cache_bank->transform_block, dest_block);
+            // Each zero that precedes this coefficient costs a single bit.
+            bits += (i - run_length) + 2 * log2((uint32) (2 * abs(value))) + 1;
+            run_length = i + 1;
+        }
+    }
 
-        } break;
+    return bits + 2 * log2((uint32) (run_length + 1)) + 1;
+}
+
+static void select_luma_transform(EVX_TRANSFORM_MODE transform_mode, const macroblock &source_block, const macroblock *prediction_block, 
+                                  evx_block_desc *block_desc, macroblock *dest_block)
+{
+    // Adaptive transform modes may code the luma as a single 16x16 block, which 
+    // compacts the energy of smooth content into fewer coefficients. Both candidates 
+    // share a quantizer step, and thus a similar distortion, so we select the one 
+    // with the smaller estimated rate.
+    int16 transform_data[16*16];
+    int16 quantized_data[16*16];
+
+    if (prediction_block)
+    {
+        sub_transform_luma_16x16(transform_mode, source_block, *prediction_block, transform_data, 16);
+    }
+    else
+    {
+        transform_luma_16x16(transform_mode, source_block, transform_data, 16);
+    }
+
+    quantize_luma_16x16(block_desc->q_index, block_desc->block_type, transform_data, 16, quantized_data, 16);
+
+    uint32 split_bits = 0;
+    uint32 single_bits = estimate_block_bits(quantized_data, 16, EVX_MACROBLOCK_16x16_TRANSFORM_ZIGZAG, 256, 4);
+
+    for (uint32 k = 0; k < 4; ++k)
+    {
+        if (block_desc->coded_pattern & (0x1 << k))
+        {
+            split_bits += estimate_block_bits(dest_block->data_y + EVX_LUMA_BLOCK_OFFSET(k, dest_block->stride), dest_block->stride, 
+                                              EVX_MACROBLOCK_8x8_ZIGZAG, 64, 3);
+        }
+    }
+
+    if (single_bits >= split_bits)
+    {
+        return;
+    }
+
+    for (uint32 j = 0; j < 16; ++j)
+    {
+        aligned_byte_copy(quantized_data + j * 16, sizeof(int16) * 16, dest_block->data_y + j * dest_block->stride);
+    }
+
+    block_desc->coded_pattern &= ~EVX_CODED_PATTERN_LUMA;
+
+    for (uint32 i = 0; i < 256; ++i)
+    {
+        if (quantized_data[i])
+        {
+            block_desc->coded_pattern |= EVX_CODED_PATTERN_LUMA | EVX_CODED_PATTERN_LUMA_16x16;
+            break;
+        }
+    }
+}
+
+evx_status encode_block(const evx_frame &frame, EVX_TRANSFORM_MODE transform_mode, const macroblock &source_block, evx_cache_bank *cache_bank, 
+                        evx_slice *slice, int32 i, int32 j, evx_block_desc *block_desc, macroblock *dest_block)
+{
+    // Classification only performs a fast block comparison and interpolation, so we recalculate
+    // the full block values when necessary. Intra default blocks are transformed directly, and
+    // all other coded blocks as the difference against their prediction.
+    macroblock beta_block;
+    macroblock sp_block;
+    const macroblock *prediction_block = NULL;
+
+    switch (block_desc->block_type)
+    {
+        case EVX_BLOCK_INTRA_DEFAULT: break;
 
         case EVX_BLOCK_INTRA_MOTION_DELTA:
         {
-            macroblock beta_block;
             uint32 intra_pred_index = query_prediction_index_by_offset(frame, 0);
             create_macroblock(cache_bank->prediction_cache[intra_pred_index], i + block_desc->motion_x, j + block_desc->motion_y, &beta_block);
+            prediction_block = &beta_block;
 
             if (block_desc->sp_pred)
             {
-                int16 sp_i, sp_j;
-                compute_motion_direction_from_frac_index(block_desc->sp_index, &sp_i, &sp_j);
-                create_subpixel_macroblock(&cache_bank->prediction_cache[intra_pred_index], block_desc->sp_amount, beta_block, 
-                                           i + block_desc->motion_x + sp_i, j + block_desc->motion_y + sp_j, &cache_bank->motion_block);
-
-                sub_transform_macroblock(source_block, cache_bank->motion_block, &cache_bank->transform_block);
-            }
-            else 
-            {
-                // no sub-pixel motion estimation
-                sub_transform_macroblock(source_block, beta_block, &cache_bank->transform_block);
+                create_subpixel_prediction(cache_bank, intra_pred_index, *block_desc, i, j, &slice->motion_block, &sp_block);
+                prediction_block = &sp_block;
             }
 
-            block_desc->q_index = query_block_quantization_parameter(frame.quality, cache_bank->transform_block, block_desc->block_type);
-            block_desc->variance = compute_block_variance2(cache_bank->transform_block);
-            quantize_macroblock(block_desc->q_index, block_desc->block_type, cache_bank->transform_block, dest_block);
-
         } break;
 
         case EVX_BLOCK_INTER_DELTA:
         {
-            macroblock beta_block;
             uint32 inter_pred_index = query_prediction_index_by_offset(frame, block_desc->prediction_target);
             create_macroblock(cache_bank->prediction_cache[inter_pred_index], i, j, &beta_block);
-
-            sub_transform_macroblock(source_block, beta_block, &cache_bank->transform_block);
-
-            block_desc->q_index = query_block_quantization_parameter(frame.quality, cache_bank->transform_block, block_desc->block_type);
-            block_desc->variance = compute_block_variance2(cache_bank->transform_block);
-            quantize_macroblock(block_desc->q_index, block_desc->block_type, cache_bank->transform_block, dest_block);
+            prediction_block = &beta_block;
 
         } break;
 
         case EVX_BLOCK_INTER_MOTION_DELTA:
         {
-            macroblock beta_block;
             uint32 inter_pred_index = query_prediction_index_by_offset(frame, block_desc->prediction_target);
             create_macroblock(cache_bank->prediction_cache[inter_pred_index], i + block_desc->motion_x, j + block_desc->motion_y, &beta_block);
+            prediction_block = &beta_block;
 
             if (block_desc->sp_pred)
             {
-                int16 sp_i, sp_j;
-                compute_motion_direction_from_frac_index(block_desc->sp_index, &sp_i, &sp_j);
-                create_subpixel_macroblock(&cache_bank->prediction_cache[inter_pred_index], block_desc->sp_amount, beta_block, 
-                                           i + block_desc->motion_x + sp_i, j + block_desc->motion_y + sp_j, &cache_bank->motion_block);
-
-                sub_transform_macroblock(source_block, cache_bank->motion_block, &cache_bank->transform_block);
-            }
-            else 
-            {
-                // no sub-pixel motion estimation
-                sub_transform_macroblock(source_block, beta_block, &cache_bank->transform_block);
+                create_subpixel_prediction(cache_bank, inter_pred_index, *block_desc, i, j, &slice->motion_block, &sp_block);
+                prediction_block = &sp_block;
             }
 
-            block_desc->q_index = query_block_quantization_parameter(frame.quality, cache_bank->transform_block, block_desc->block_type);
-            block_desc->variance = compute_block_variance2(cache_bank->transform_block);
-            quantize_macroblock(block_desc->q_index, block_desc->block_type, cache_bank->transform_block, dest_block);
-
         } break;
 
         // The following are primarily handled by the reverse (decode) pipeline.
         case EVX_BLOCK_INTRA_MOTION_COPY:    
         case EVX_BLOCK_INTER_MOTION_COPY:
-        case EVX_BLOCK_INTER_COPY: break;
+        case EVX_BLOCK_INTER_COPY:
+        {
+            // Transform blocks without coefficients are neither serialized nor reconstructed.
+            block_desc->coded_pattern = 0;
+            return EVX_SUCCESS;
+        }
         
         default: return evx_post_error(EVX_ERROR_INVALID_RESOURCE);;
     }; 
 
+    // Delta blocks that are known to quantize to zero skip the transform and quantization. 
+    uint8 zero_qp = 0;
+
+    if (prediction_block && predict_zero_macroblock(frame.quality, block_desc->block_type, source_block, *prediction_block, &zero_qp))
+    {
+        clear_macroblock(dest_block);
+
+        block_desc->q_index = zero_qp;
+        block_desc->variance = 0;
+        block_desc->coded_pattern = 0;
+        slice->stats.zero_block_count++;
+
+        return EVX_SUCCESS;
+    }
+
+    if (prediction_block)
+    {
+        sub_transform_macroblock(transform_mode, source_block, *prediction_block, &slice->transform_block);
+    }
+    else
+    {
+        transform_macroblock(transform_mode, source_block, &slice->transform_block);
+    }
+
+    block_desc->q_index = query_block_quantization_parameter(frame.quality, slice->transform_block, block_desc->block_type);
+    block_desc->variance = compute_block_variance2(slice->transform_block);
+    quantize_macroblock(block_desc->q_index, block_desc->block_type, slice->transform_block, dest_block);
+
+    block_desc->coded_pattern = query_coded_pattern(*dest_block);
+
+    // Luma without any coefficients cannot benefit from a larger transform.
+    if (EVX_IS_ADAPTIVE_TRANSFORM_MODE(transform_mode) && (block_desc->coded_pattern & EVX_CODED_PATTERN_LUMA))
+    {
+        select_luma_transform(transform_mode, source_block, prediction_block, block_desc, dest_block);
+    }
+
+#if !EVX_ENABLE_CHROMA_SUPPORT
+    block_desc->coded_pattern &= EVX_CODED_PATTERN_LUMA | EVX_CODED_PATTERN_LUMA_16x16;
+#endif
+
     return EVX_SUCCESS;
 }
 
-evx_status encode_slice(const evx_frame &frame, evx_context *context)
+evx_status encode_slice(const evx_frame &frame, evx_context *context, evx_slice *slice)
 {
-    uint32 block_index = 0;
-    uint32 width = query_context_width(*context);
-    uint32 height = query_context_height(*context);
+    int32 width = query_context_width(*context);
+    uint32 block_index = slice->first_row * context->width_in_blocks;
+    int32 first_y = (int32) slice->first_row << EVX_MACROBLOCK_SHIFT;
+    int32 last_y = (int32) (slice->first_row + slice->row_count) << EVX_MACROBLOCK_SHIFT;
     uint32 dest_index = query_prediction_index_by_offset(frame, 0);
 
     macroblock source_block, dest_block, dest_prediction_block;
 
-    for (int32 j = 0; j < height; j += EVX_MACROBLOCK_SIZE)
+    for (int32 j = first_y; j < last_y; j += EVX_MACROBLOCK_SIZE)
     for (int32 i = 0; i < width;  i += EVX_MACROBLOCK_SIZE)
     {
         evx_block_desc *block_desc = &context->block_table[block_index++];
@@ -181,24 +274,72 @@ evx_status encode_slice(const evx_frame &frame, evx_context *context)
         create_macroblock(context->cache_bank.prediction_cache[dest_index], i, j, &dest_prediction_block);
          
         // Classify the block and pass it to the encoding pipeline.
-        if (evx_failed(classify_block(frame, source_block, &context->cache_bank, i, j, block_desc)))
+        EVX_TIMING_BEGIN(classify_start);
+
+        evx_motion_predictors predictors;
+        gather_motion_predictors(context->block_table, context->width_in_blocks, *slice,
+                                 i >> EVX_MACROBLOCK_SHIFT, j >> EVX_MACROBLOCK_SHIFT, &predictors);
+
+        if (evx_failed(classify_block(frame, source_block, &context->cache_bank, slice, i, j, predictors, block_desc)))
         {
             return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
         }
 
-        if (evx_failed(encode_block(frame, source_block, &context->cache_bank, i, j, block_desc, &dest_block)))
+        EVX_TIMING_END(&slice->timing, EVX_TIMING_CLASSIFY_BLOCK, classify_start);
+        EVX_TIMING_BEGIN(encode_start);
+
+        if (evx_failed(encode_block(frame, context->transform_mode, source_block, &context->cache_bank, slice, i, j, block_desc, &dest_block)))
         {
             return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
         }
 
+        EVX_TIMING_END(&slice->timing, EVX_TIMING_ENCODE_BLOCK, encode_start);
+        EVX_TIMING_BEGIN(decode_start);
+
         // The decoder frontend is used as our reverse pipeline. it would be more efficient to 
         // update our prediction within encode_block, but we sacrifice for clarity.
-        if (evx_failed(decode_block(frame, *block_desc, dest_block, &context->cache_bank, i, j, &dest_prediction_block)))
+        if (evx_failed(decode_block(frame, context->transform_mode, *block_desc, dest_block, &context->cache_bank, &slice->transform_block, 
+                                  &slice->motion_block, i, j, &dest_prediction_block)))
         {
             return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
         }
+
+        EVX_TIMING_END(&slice->timing, EVX_TIMING_DECODE_BLOCK, decode_start);
+    }
+
+    return EVX_SUCCESS;
+}
+
+typedef struct evx_encode_task
+{
+    const evx_frame *frame;
+    evx_context *context;
+
+} evx_encode_task;
+
+static evx_status encode_slice_task(void *user_data, uint32 task_index)
+{
+    evx_encode_task *task = (evx_encode_task *) user_data;
+    evx_slice *slice = &task->context->slices[task_index];
+
+    EVX_TIMING_BEGIN_FRAME(&slice->timing);
+    memset(&slice->stats, 0, sizeof(slice->stats));
+
+    if (evx_failed(encode_slice(*task->frame, task->context, slice)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    EVX_TIMING_BEGIN(serialize_start);
+
+    // Each slice is entropy coded into its own stream, see serialize_slices.
+    if (evx_failed(serialize_slice(*task->frame, task->context, slice)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
+    EVX_TIMING_END(&slice->timing, EVX_TIMING_SERIALIZE, serialize_start);
+
     return EVX_SUCCESS;
 }
 
@@ -206,28 +347,101 @@ evx_status engine_encode_frame(const image &input, const evx_frame &frame_desc,
 {
     uint32 dest_index = query_prediction_index_by_offset(frame_desc, 0);
 
+    EVX_TIMING_BEGIN_FRAME(&context->timing);
+    EVX_TIMING_BEGIN(frame_start);
+    EVX_TIMING_BEGIN(convert_start);
+
     if (evx_failed(convert_image(input, &context->cache_bank.input_cache)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
+
+    EVX_TIMING_END(&context->timing, EVX_TIMING_CONVERT, convert_start);
+
+    if (evx_failed(initialize_slices(frame_desc.slice_count, context)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    EVX_TIMING_BEGIN(input_pyramid_start);
+
+    if (EVX_FRAME_INTER == frame_desc.type && evx_failed(build_input_pyramid(&context->cache_bank)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    EVX_TIMING_END(&context->timing, EVX_TIMING_MOTION_PYRAMID, input_pyramid_start);
+    EVX_TIMING_BEGIN(encode_start);
+
+    // Our destination prediction frame is about to be overwritten.
+    invalidate_subpel_planes(dest_index, &context->cache_bank);
+    invalidate_prediction_pyramid(dest_index, &context->cache_bank);
     
-    if (evx_failed(encode_slice(frame_desc, context)))
+    // Slices only read from the shared caches outside of their own rows, so they
+    // may be encoded and serialized concurrently.
+    evx_encode_task task = { &frame_desc, context };
+
+    if (evx_failed(context->worker_pool.execute(context->slice_count, encode_slice_task, &task)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    // Serialize our context to the output bitstream.
-    if (evx_failed(serialize_slice(frame_desc, context, output)))
+    EVX_TIMING_END(&context->timing, EVX_TIMING_ENCODE_SLICE, encode_start);
+
+    memset(&context->stats, 0, sizeof(context->stats));
+
+    for (uint32 i = 0; i < context->slice_count; ++i)
+    {
+        EVX_TIMING_MERGE_FRAME(context->slices[i].timing, &context->timing);
+
+        context->stats.motion_vector_bits += context->slices[i].stats.motion_vector_bits;
+        context->stats.motion_vector_count += context->slices[i].stats.motion_vector_count;
+        context->stats.zero_block_count += context->slices[i].stats.zero_block_count;
+    }
+
+    EVX_TIMING_BEGIN(serialize_start);
+
+    uint32 start_bits = output->query_occupancy();
+
+    // Gather the slice streams into the output bitstream.
+    if (evx_failed(serialize_slices(context, output)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
+    context->stats.frame_bits = output->query_occupancy() - start_bits;
+
+    EVX_TIMING_END(&context->timing, EVX_TIMING_SERIALIZE, serialize_start);
+    EVX_TIMING_BEGIN(deblock_start);
+
     // Run our in-loop deblocking filter on the final post prediction image.
     if (evx_failed(deblock_image_filter(context->block_table, &context->cache_bank.prediction_cache[dest_index])))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
+    EVX_TIMING_END(&context->timing, EVX_TIMING_DEBLOCK, deblock_start);
+    EVX_TIMING_BEGIN(subpel_start);
+
+    // The prediction frame is now final, so we may pre-interpolate it for use
+    // as a reference by subsequent frames.
+    if (evx_failed(build_subpel_planes(dest_index, &context->cache_bank)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    EVX_TIMING_END(&context->timing, EVX_TIMING_SUBPEL_PLANES, subpel_start);
+    EVX_TIMING_BEGIN(pyramid_start);
+
+    if (evx_failed(build_prediction_pyramid(dest_index, &context->cache_bank)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    EVX_TIMING_END(&context->timing, EVX_TIMING_MOTION_PYRAMID, pyramid_start);
+    EVX_TIMING_END(&context->timing, EVX_TIMING_FRAME, frame_start);
+    EVX_TIMING_END_FRAME(&context->timing);
+
     return EVX_SUCCESS;
 }
 
@@ -48,7 +48,9 @@
 #define __EVX1_H__
 
 #include "base.h"
+#include "types.h"
 #include "bitstream.h"
+#include "timing.h"
 
 namespace evx {
 
@@ -82,6 +84,23 @@ public:
 
     // Sets a quality level between 0-31, with 0 being the highest quality.
     virtual evx_status set_quality(uint8 quality) = 0;
+
+    // Sets the number of slices that each frame is divided into. Slices are coded
+    // independently, which allows them to be encoded and decoded in parallel, at a
+    // small cost in efficiency. The count is clamped to the number of block rows.
+    virtual evx_status set_slice_count(uint32 count) = 0;
+
+    // Sets the number of threads used to encode the slices of each frame. A count 
+    // of one performs all work on the calling thread.
+    virtual evx_status set_thread_count(uint32 count) = 0;
+
+    // Selects the entropy backend used to code the stream (see EVX_ENTROPY_MODE). The
+    // mode is recorded in the stream header, so it must be set before the first frame.
+    virtual evx_status set_entropy_mode(EVX_ENTROPY_MODE mode) = 0;
+
+    // Selects the transforms used to code the stream (see EVX_TRANSFORM_MODE). Like the
+    // entropy mode, this is recorded in the stream header and must be set before the first frame.
+    virtual evx_status set_transform_mode(EVX_TRANSFORM_MODE mode) = 0;
      
     // The input image must contain R8G8B8 formatted data. Upon return, output will
     // contain the encoded frame. Note that this engine does not provide a container 
@@ -91,6 +110,21 @@ public:
     // Debug routine that enables visibility into the internal encoder state. This is
     // a very expensive operation that should only be used in testing.
     virtual evx_status peek(EVX_PEEK_STATE peek_state, void *output) = 0;
+
+    // Retrieves per-stage timings for the most recent frame along with running totals
+    // since the last clear. Returns EVX_ERROR_NOTIMPL if stage timing is compiled out.
+    virtual evx_status query_timing(evx_timing_stats *output) = 0;
+
+    // Retrieves the bit usage of the most recent frame (see evx_stream_stats). Rate 
+    // control may use this to balance motion vector and residual bits.
+    virtual evx_status query_stream_stats(evx_stream_stats *output) = 0;
+
+    // Copies the quantized coefficient blocks of the most recent frame, as they were passed
+    // to the entropy coder. Each block holds 64 coefficients in raster order, and its dc
+    // is stored as a delta against its predictor. Luma that was coded as a single 16x16
+    // block is copied as its four coefficient quadrants. At most capacity blocks are copied,
+    // and block_count receives the number of blocks. Intended for entropy coding benchmarks.
+    virtual evx_status query_coefficients(int16 *output, uint32 capacity, uint32 *block_count) = 0;
 };
 
 class evx1_decoder
@@ -110,6 +144,14 @@ public:
     // buffer. The caller is responsible for ensuring sufficient size at the output,
     // using frame dimensions provided by a container format.
     virtual evx_status decode(bit_stream *input, void *output) = 0;
+
+    // Sets the number of threads used to decode the slices of each frame. A count 
+    // of one performs all work on the calling thread.
+    virtual evx_status set_thread_count(uint32 count) = 0;
+
+    // Retrieves per-stage timings for the most recent frame along with running totals
+    // since the last clear. Returns EVX_ERROR_NOTIMPL if stage timing is compiled out.
+    virtual evx_status query_timing(evx_timing_stats *output) = 0;
 };
 
 // EV objects must be created using the create* interface. Similarly, 
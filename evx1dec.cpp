@@ -13,6 +13,11 @@ evx1_decoder_impl::evx1_decoder_impl()
 
     clear_frame(&frame);
     clear_header(&header);
+
+    if (evx_failed(context.worker_pool.initialize(EVX_DEFAULT_THREAD_COUNT)))
+    {
+        evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
 }
 
 evx1_decoder_impl::~evx1_decoder_impl()
@@ -58,7 +63,8 @@ evx_status evx1_decoder_impl::initialize(bit_stream *input)
     uint32 aligned_width = align(header.frame_width, EVX_MACROBLOCK_SIZE);
     uint32 aligned_height = align(header.frame_height, EVX_MACROBLOCK_SIZE);
 
-    if (EVX_SUCCESS != initialize_context(aligned_width, aligned_height, &context))
+    if (EVX_SUCCESS != initialize_context(aligned_width, aligned_height, (EVX_ENTROPY_MODE) header.entropy_mode, 
+                                          (EVX_TRANSFORM_MODE) header.transform_mode, &context))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
@@ -122,6 +128,25 @@ evx_status evx1_decoder_impl::decode(bit_stream *input, void *output)
     return EVX_SUCCESS;
 }
 
+evx_status evx1_decoder_impl::set_thread_count(uint32 count)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (0 == count)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    // The pool persists across clear() so that workers are not needlessly recreated.
+    if (evx_failed(context.worker_pool.initialize(count)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    return EVX_SUCCESS;
+}
+
 evx_status evx1_decoder_impl::decode_frame(bit_stream *input, void *output)
 {
     image output_image;
@@ -134,4 +159,25 @@ evx_status evx1_decoder_impl::decode_frame(bit_stream *input, void *output)
     return engine_decode_frame(input, frame, &context, &output_image);
 }
 
+evx_status evx1_decoder_impl::query_timing(evx_timing_stats *output)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!output)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+#if EVX_ENABLE_STAGE_TIMING
+    *output = context.timing;
+
+    return EVX_SUCCESS;
+#else
+    clear_timing_stats(output);
+
+    return EVX_ERROR_NOTIMPL;
+#endif
+}
+
 } // namespace evx
\ No newline at end of file
@@ -59,6 +59,8 @@ public:
 
     evx_status clear();
     evx_status decode(bit_stream *input, void *output);
+    evx_status set_thread_count(uint32 count);
+    evx_status query_timing(evx_timing_stats *output);
 };
 
 } // namespace evx
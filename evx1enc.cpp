@@ -7,13 +7,21 @@
 namespace evx {
 
 evx_status engine_encode_frame(const image &input, const evx_frame &frame_desc, evx_context *context, bit_stream *output);
+evx_status capture_macroblocks(evx_context *context, evx_slice *slice, int16 *output, uint32 capacity, uint32 *block_count);
 
 evx1_encoder_impl::evx1_encoder_impl()
 {
     initialized = false;
+    entropy_mode = (EVX_ENTROPY_MODE) EVX_DEFAULT_ENTROPY_MODE;
+    transform_mode = (EVX_TRANSFORM_MODE) EVX_DEFAULT_TRANSFORM_MODE;
 
     clear_frame(&frame);
     clear_header(&header);
+
+    if (evx_failed(context.worker_pool.initialize(EVX_DEFAULT_THREAD_COUNT)))
+    {
+        evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
 }
 
 evx1_encoder_impl::~evx1_encoder_impl()
@@ -63,6 +71,83 @@ evx_status evx1_encoder_impl::set_quality(uint8 quality)
     return EVX_SUCCESS;
 }
 
+evx_status evx1_encoder_impl::set_slice_count(uint32 count)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (0 == count)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    // The count is clamped against the frame height once the context is initialized.
+    frame.slice_count = evx_min2(count, EVX_MAX_SLICE_COUNT);
+
+    return EVX_SUCCESS;
+}
+
+evx_status evx1_encoder_impl::set_thread_count(uint32 count)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (0 == count)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    // The pool persists across clear() so that workers are not needlessly recreated.
+    if (evx_failed(context.worker_pool.initialize(count)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status evx1_encoder_impl::set_entropy_mode(EVX_ENTROPY_MODE mode)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (mode >= EVX_ENTROPY_MODE_COUNT)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    // The entropy mode is recorded in the stream header, so it cannot change mid-stream.
+    if (initialized)
+    {
+        return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+    }
+
+    entropy_mode = mode;
+
+    return EVX_SUCCESS;
+}
+
+evx_status evx1_encoder_impl::set_transform_mode(EVX_TRANSFORM_MODE mode)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (mode >= EVX_TRANSFORM_MODE_COUNT)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    // The transform mode is recorded in the stream header, so it cannot change mid-stream.
+    if (initialized)
+    {
+        return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+    }
+
+    transform_mode = mode;
+
+    return EVX_SUCCESS;
+}
+
 evx_status evx1_encoder_impl::initialize(uint32 width, uint32 height)
 {
     if (initialized)
@@ -73,13 +158,13 @@ evx_status evx1_encoder_impl::initialize(uint32 width, uint32 height)
 
     // Initialize will place the encoder in a default state that is 
     // ready for encoding operations.
-    initialize_header(width, height, &header);
+    initialize_header(width, height, entropy_mode, transform_mode, &header);
 
     // Initialize image resources.
     uint32 aligned_width = align(width, EVX_MACROBLOCK_SIZE);
     uint32 aligned_height = align(height, EVX_MACROBLOCK_SIZE);
 
-    if (EVX_SUCCESS != initialize_context(aligned_width, aligned_height, &context))
+    if (EVX_SUCCESS != initialize_context(aligned_width, aligned_height, entropy_mode, transform_mode, &context))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
@@ -124,6 +209,9 @@ evx_status evx1_encoder_impl::encode(void *input, uint32 width, uint32 height, b
         return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
     }
 
+    // Each slice must contain at least one row of blocks.
+    frame.slice_count = evx_min2(frame.slice_count, context.height_in_blocks);
+
     // Serialize our frame state.
     if (evx_failed(output->write_bytes(&frame, sizeof(evx_frame))))
     {
@@ -304,4 +392,68 @@ evx_status evx1_encoder_impl::peek(EVX_PEEK_STATE peek_state, void *output)
     return EVX_SUCCESS;
 }
 
+evx_status evx1_encoder_impl::query_timing(evx_timing_stats *output)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!output)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+#if EVX_ENABLE_STAGE_TIMING
+    *output = context.timing;
+
+    return EVX_SUCCESS;
+#else
+    clear_timing_stats(output);
+
+    return EVX_ERROR_NOTIMPL;
+#endif
+}
+
+evx_status evx1_encoder_impl::query_stream_stats(evx_stream_stats *output)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!output)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    *output = context.stats;
+
+    return EVX_SUCCESS;
+}
+
+evx_status evx1_encoder_impl::query_coefficients(int16 *output, uint32 capacity, uint32 *block_count)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!output || !block_count)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    *block_count = 0;
+
+    if (!initialized)
+    {
+        return EVX_SUCCESS;
+    }
+
+    for (uint32 i = 0; i < context.slice_count; ++i)
+    {
+        if (evx_failed(capture_macroblocks(&context, &context.slices[i], output, capacity, block_count)))
+        {
+            return EVX_ERROR_CAPACITY_LIMIT;
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
 } // namespace evx
\ No newline at end of file
@@ -41,6 +41,8 @@ namespace evx {
 class evx1_encoder_impl : public evx1_encoder
 {
     bool initialized;
+    EVX_ENTROPY_MODE entropy_mode;
+    EVX_TRANSFORM_MODE transform_mode;
 
     evx_frame frame;        // current frame state
     evx_header header;      // global video state
@@ -59,8 +61,15 @@ public:
     evx_status clear();
     evx_status insert_intra();
     evx_status set_quality(uint8 quality);
+    evx_status set_slice_count(uint32 count);
+    evx_status set_thread_count(uint32 count);
+    evx_status set_entropy_mode(EVX_ENTROPY_MODE mode);
+    evx_status set_transform_mode(EVX_TRANSFORM_MODE mode);
     evx_status encode(void *input, uint32 width, uint32 height, bit_stream *output);
     evx_status peek(EVX_PEEK_STATE peek_state, void *output);
+    evx_status query_timing(evx_timing_stats *output);
+    evx_status query_stream_stats(evx_stream_stats *output);
+    evx_status query_coefficients(int16 *output, uint32 capacity, uint32 *block_count);
 };
 
 } // namespace evx
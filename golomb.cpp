@@ -37,18 +37,12 @@ uint32 encode_unsigned_golomb_value(uint16 input, uint8 * count)
         return encode_unsigned_golomb_value((uint8) input, count);
     }
  
-    uint32 result = 0;
+    // Codes are packed lsb first: a prefix of (bit_count - 1) zeroes is followed by
+    // value in reverse bit order, so that the leading one bit terminates the prefix.
     uint32 value = input + 1;
     uint8 bit_count = evx_required_bits(value);
+    uint32 result = reverse_bits(value, bit_count) << (bit_count - 1);
 
-    while (value) 
-    {
-        result <<= 1;
-        result |= value & 0x1;
-        value  >>= 1;
-    }
-
-    result <<= bit_count - 1;
     bit_count <<= 1;
     bit_count -= 1;
 
@@ -67,18 +61,10 @@ uint32 encode_signed_golomb_value(int16 input, uint8 *count)
         return encode_signed_golomb_value((int8) input, count);
     }
 
-    uint32 result = 0;
     uint32 value = (!input ? 1 : (abs((int32) input) << 1) | ((input >> 15) & 0x1));
     uint8 bit_count = evx_required_bits(value);
+    uint32 result = reverse_bits(value, bit_count) << (bit_count - 1);
 
-    while (value) 
-    {
-        result <<= 1;
-        result |= value & 0x1;
-        value >>= 1;
-    }
-
-    result <<= bit_count - 1;
     bit_count <<= 1;
     bit_count -= 1;
 
@@ -92,26 +78,11 @@ uint32 encode_signed_golomb_value(int16 input, uint8 *count)
 
 uint16 decode_unsigned_golomb_value(uint32 input, uint8 *count) 
 {
-    uint16 result = 0; 
-    uint8 zero_count = 0;
-    uint8 bit_count = 0;
-
-    while (!(input & 0x1)) 
-    {
-        zero_count++;
-        input >>= 1;
-    }
-
-    bit_count = zero_count + 1;
-
-    for (uint8 i = 0; i < bit_count; i++) 
-    {
-        result <<= 1;
-        result |= input & 0x1;
-        input  >>= 1;
-    }
-
-    result -= 1;
+    // Codes are packed lsb first, so the zero prefix occupies the low bits of input 
+    // and the value that follows it is stored in reverse bit order.
+    uint8 zero_count = evx_min2(count_trailing_zeros(input), 31);
+    uint8 bit_count = zero_count + 1;
+    uint16 result = reverse_bits(input >> zero_count, bit_count) - 1;
 
     if (count) 
     {
@@ -123,25 +94,11 @@ uint16 decode_unsigned_golomb_value(uint32 input, uint8 *count)
 
 int16 decode_signed_golomb_value(uint32 input, uint8 *count) 
 {
-    int16 result = 0;
-    uint8 zero_count = 0;
-    uint8 bit_count = 0;
+    uint8 zero_count = evx_min2(count_trailing_zeros(input), 31);
+    uint8 bit_count = zero_count + 1;
+    int16 result = (int16) reverse_bits(input >> zero_count, bit_count);
     int16 sign = 0;
 
-    while (!(input & 0x1)) 
-    {
-        zero_count++;
-        input >>= 1;
-    }
-
-    bit_count = zero_count + 1;
-    for (uint8 i = 0; i < bit_count; i++) 
-    {
-        result <<= 1;
-        result |= input & 0x1;
-        input >>= 1;
-    }
-
     // Remove the lowest bit as our sign bit.
     sign = 1 - 2 * (result & 0x1);
     result = sign * ((result >> 1) & 0x7FFF);
@@ -155,7 +112,7 @@ int16 decode_signed_golomb_value(uint32 input, uint8 *count)
 
     if (count) 
     {
-        *count = bit_count + zero_count;
+        *count = bit_count;
     }
 
     return result;
@@ -0,0 +1,157 @@
+
+#include "huffman.h"
+#include "math.h"
+
+#define EVX_HUFFMAN_LOOKUP_MASK                 ((0x1 << EVX_HUFFMAN_LOOKUP_BITS) - 1)
+
+namespace evx {
+
+huffman_table::huffman_table()
+{
+    symbol_count = 0;
+
+    memset(lookup, 0, sizeof(lookup));
+    memset(length_count, 0, sizeof(length_count));
+}
+
+evx_status huffman_table::initialize(const uint8 *code_lengths, uint32 count)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!code_lengths || count < 2 || count > EVX_HUFFMAN_MAX_SYMBOLS)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    symbol_count = count;
+
+    memset(lookup, 0, sizeof(lookup));
+    memset(length_count, 0, sizeof(length_count));
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        if (0 == code_lengths[i] || code_lengths[i] > EVX_HUFFMAN_MAX_CODE_LENGTH)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+
+        lengths[i] = code_lengths[i];
+        length_count[lengths[i]]++;
+    }
+
+    // Canonical codes are assigned in order of length, and then of symbol. The lengths
+    // form a valid prefix code only if no length runs out of codes.
+    uint32 code = 0;
+    uint32 index = 0;
+
+    first_code[0] = 0;
+    first_index[0] = 0;
+
+    for (uint32 i = 1; i <= EVX_HUFFMAN_MAX_CODE_LENGTH; ++i)
+    {
+        code <<= 1;
+
+        if (code + length_count[i] > (uint32(0x1) << i))
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+
+        first_code[i] = (uint16) code;
+        first_index[i] = (uint16) index;
+
+        code += length_count[i];
+        index += length_count[i];
+    }
+
+    uint16 next_code[EVX_HUFFMAN_MAX_CODE_LENGTH + 1];
+    uint16 next_index[EVX_HUFFMAN_MAX_CODE_LENGTH + 1];
+
+    memcpy(next_code, first_code, sizeof(next_code));
+    memcpy(next_index, first_index, sizeof(next_index));
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        uint8 length = lengths[i];
+
+        codes[i] = (uint16) reverse_bits(next_code[length]++, length);
+        sorted_symbols[next_index[length]++] = (uint16) i;
+
+        // Short codes fill every lookup entry that begins with them.
+        if (length <= EVX_HUFFMAN_LOOKUP_BITS)
+        {
+            for (uint32 j = codes[i]; j <= EVX_HUFFMAN_LOOKUP_MASK; j += (0x1 << length))
+            {
+                lookup[j] = (uint16) ((i << 4) | length);
+            }
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
+uint32 huffman_table::query_symbol_count() const
+{
+    return symbol_count;
+}
+
+evx_status huffman_table::encode_symbol(uint32 symbol, bit_stream *dest) const
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (symbol >= symbol_count || !dest)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    return dest->put_bits(codes[symbol], lengths[symbol]);
+}
+
+evx_status huffman_table::decode_symbol(bit_stream *source, uint32 *symbol) const
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!source || !symbol)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    uint32 bits = 0;
+    uint32 unused = 0;
+
+    if (evx_failed(source->show_bits(EVX_HUFFMAN_MAX_CODE_LENGTH, &bits)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    uint16 entry = lookup[bits & EVX_HUFFMAN_LOOKUP_MASK];
+
+    if (entry)
+    {
+        *symbol = entry >> 4;
+
+        return source->get_bits(entry & 0xF, &unused);
+    }
+
+    // Long codes are found by comparing the (msb first) code against the range of
+    // canonical codes of each remaining length.
+    uint32 code = reverse_bits(bits, EVX_HUFFMAN_MAX_CODE_LENGTH);
+
+    for (uint8 i = EVX_HUFFMAN_LOOKUP_BITS + 1; i <= EVX_HUFFMAN_MAX_CODE_LENGTH; ++i)
+    {
+        uint32 offset = (code >> (EVX_HUFFMAN_MAX_CODE_LENGTH - i)) - first_code[i];
+
+        if (offset < length_count[i])
+        {
+            *symbol = sorted_symbols[first_index[i] + offset];
+
+            return source->get_bits(i, &unused);
+        }
+    }
+
+    return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+}
+
+} // namespace evx
\ No newline at end of file
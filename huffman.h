@@ -0,0 +1,79 @@
+
+/*
+// Copyright (c) 2009-2014 Joe Bertolami. All Right Reserved.
+//
+// huffman.h
+//
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Additional Information:
+//
+*/
+
+#ifndef __EVX_HUFFMAN_H__
+#define __EVX_HUFFMAN_H__
+
+#include "bitstream.h"
+
+// A huffman table holds a static canonical prefix code that is described entirely by 
+// the code length of each symbol (see hufftables.h). Codes are stored bit reversed so 
+// that they may be written lsb first, and decoded with a single table lookup for any
+// code of up to EVX_HUFFMAN_LOOKUP_BITS bits. Longer codes fall back to a canonical 
+// search over the remaining code lengths.
+
+#define EVX_HUFFMAN_MAX_SYMBOLS                     (257)
+#define EVX_HUFFMAN_MAX_CODE_LENGTH                 (16)
+#define EVX_HUFFMAN_LOOKUP_BITS                     (8)
+
+namespace evx {
+
+class huffman_table
+{
+    uint32 symbol_count;
+
+    uint16 codes[EVX_HUFFMAN_MAX_SYMBOLS];
+    uint8 lengths[EVX_HUFFMAN_MAX_SYMBOLS];
+
+    uint16 lookup[0x1 << EVX_HUFFMAN_LOOKUP_BITS];          // symbol << 4 | length, or 0 for long codes.
+    uint16 first_code[EVX_HUFFMAN_MAX_CODE_LENGTH + 1];     // canonical (msb first) code of each length.
+    uint16 first_index[EVX_HUFFMAN_MAX_CODE_LENGTH + 1];    // index of the first symbol of each length.
+    uint16 length_count[EVX_HUFFMAN_MAX_CODE_LENGTH + 1];
+    uint16 sorted_symbols[EVX_HUFFMAN_MAX_SYMBOLS];         // symbols in canonical order.
+
+public:
+
+    huffman_table();
+
+    // Builds the table from the code length of each symbol. Every symbol must have a 
+    // length in [1:EVX_HUFFMAN_MAX_CODE_LENGTH], and the lengths must form a valid 
+    // prefix code.
+    evx_status initialize(const uint8 *code_lengths, uint32 count);
+
+    uint32 query_symbol_count() const;
+
+    evx_status encode_symbol(uint32 symbol, bit_stream *dest) const;
+    evx_status decode_symbol(bit_stream *source, uint32 *symbol) const;
+};
+
+} // namespace evx
+
+#endif // __EVX_HUFFMAN_H__
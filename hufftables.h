@@ -0,0 +1,87 @@
+
+/*
+// Copyright (c) 2009-2014 Joe Bertolami. All Right Reserved.
+//
+// hufftables.h
+//
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Additional Information: 
+//
+//   For more information, visit http://www.bertolami.com.
+*/
+
+#ifndef __EVX_HUFFMAN_TABLES_H__
+#define __EVX_HUFFMAN_TABLES_H__
+
+#include "base.h"
+
+// Static code lengths used by the huffman entropy mode. The tables were trained offline
+// from the symbol statistics of the benchmark sequences at several quality levels, and
+// every symbol is assigned a code. Entries beyond the symbol count of an element are unused.
+
+namespace evx {
+
+const uint8 EVX_HUFFMAN_ELEMENT_LENGTHS[][17] = {
+    {  2,  6,  1,  3,  7,  7,  5,  4,  0,  0,  0,  0,  0,  0,  0,  0,  0 },    // block type
+    {  1,  2,  3,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  6,  6 },    // skip run
+    {  3,  1,  2,  3,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },    // prediction target
+    {  1,  2,  3,  4,  5,  6, 10, 10, 10, 10, 10, 10,  9,  9,  9,  9,  9 },    // motion run
+    {  3,  5,  2,  3,  3,  3,  3,  4,  6,  9,  9,  9,  9,  9,  9,  9,  9 },    // motion x
+    {  4,  2,  3,  5,  4,  2,  3,  4,  6,  9,  9,  9,  9,  9,  9,  9,  9 },    // motion y
+    {  1,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },    // subpel enabled
+    {  1,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },    // subpel amount
+    {  4,  2,  4,  3,  3,  4,  2,  4,  0,  0,  0,  0,  0,  0,  0,  0,  0 },    // subpel index
+    {  1,  2,  3,  4,  5,  6, 10, 10, 10, 10, 10, 10,  9,  9,  9,  9,  9 },    // block quality
+    {  1,  4,  5,  6,  5,  5,  6,  6,  4,  6,  5,  6,  6,  6,  6,  3,  0 },    // luma pattern
+    {  1,  3,  3,  2,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },    // chroma pattern
+    {  6,  3,  4,  3,  3,  2,  2,  5, 10, 10,  9,  9,  9,  9,  9,  9,  9 },    // run length
+    {  1,  2,  3,  4,  5,  6,  7,  8,  9, 12, 12, 12, 12, 12, 12, 12, 12 },    // dc coefficient
+    {  5,  5,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4 },    // ac low coefficient (unused)
+    {  5,  5,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4,  4 },    // ac high coefficient (unused)
+    {  1,  1,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0 },    // transform size
+};
+
+// Indexed by (zero run << 4) | (magnitude class - 1), followed by the zero run symbol.
+const uint8 EVX_HUFFMAN_PAIR_LENGTHS[] = {
+     2,  3,  5,  7, 10, 13, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     3,  5,  7, 10, 13, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     4,  6,  9, 13, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     4,  7, 10, 13, 15, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     4,  7, 11, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     5,  8, 11, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     5,  9, 12, 15, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     6,  9, 12, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     6, 10, 12, 15, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     6, 10, 12, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     7, 11, 14, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     7, 11, 13, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     7, 11, 14, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     7, 10, 12, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     8, 12, 15, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     8, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 16,
+     5
+};
+
+} // namespace evx
+
+#endif // __EVX_HUFFMAN_TABLES_H__
@@ -59,6 +59,18 @@
 #define EVX_MACROBLOCK_SS_CHROMINANCE_SIZE          (EVX_MACROBLOCK_CHROMINANCE_SIZE >> 2)
 #define EVX_MACROBLOCK_FULL_BLOCK_SIZE              (EVX_MACROBLOCK_LUMINANCE_SIZE + EVX_MACROBLOCK_CHROMINANCE_SIZE << 1)
 
+// Coded block patterns hold one bit per 8x8 transform block of a macroblock, which is
+// set if the block contains any non-zero quantized coefficient. The four luma blocks 
+// are ordered left to right, top to bottom, and are followed by the u and v blocks.
+// Adaptive transform modes may instead code the luma as a single 16x16 transform, in
+// which case EVX_CODED_PATTERN_LUMA_16x16 is set along with all four luma bits.
+#define EVX_CODED_PATTERN_LUMA                      (0x0F)
+#define EVX_CODED_PATTERN_U                         (0x10)
+#define EVX_CODED_PATTERN_V                         (0x20)
+#define EVX_CODED_PATTERN_ALL                       (0x3F)
+#define EVX_CODED_PATTERN_LUMA_16x16                (0x40)
+#define EVX_LUMA_BLOCK_OFFSET(index, stride)        ((((index) >> 1) << 3) * (stride) + (((index) & 0x1) << 3))
+
 namespace evx {
 
 // A macroblock holds one complete block worth of image data in YUV format.
@@ -105,7 +117,7 @@ inline void print_macroblock(const macroblock &block)
 {       
     evx_msg("Printing block:");
     evx_msg("data_y = ");
-    evx_msg("");
+    evx_msg("%s", "");
 
     for (uint32 i = 0; i < EVX_MACROBLOCK_SIZE; ++i) 
     {
@@ -121,7 +133,7 @@ inline void print_macroblock(const macroblock &block)
     }
 
     evx_msg("data_u = ");
-    evx_msg("");
+    evx_msg("%s", "");
 
     for (uint32 i = 0; i < EVX_MACROBLOCK_SIZE >> 1; ++i) 
     {
@@ -137,7 +149,7 @@ inline void print_macroblock(const macroblock &block)
     }
 
     evx_msg("data_v = ");
-    evx_msg("");
+    evx_msg("%s", "");
 
     for (uint32 i = 0; i < EVX_MACROBLOCK_SIZE >> 1; ++i) 
     {
@@ -168,6 +180,57 @@ inline void copy_macroblock(const macroblock &src, macroblock *dest)
     }                                                                              
 }          
 
+inline void zero_block_8x8(int16 *dest, uint32 dest_stride)
+{
+    for (uint32 i = 0; i < 8; ++i)
+    {
+        aligned_zero_memory(dest + i * dest_stride, sizeof(int16) * 8);
+    }
+}
+
+inline void copy_block_8x8(const int16 *src, uint32 src_stride, int16 *dest, uint32 dest_stride)
+{
+    // Intra motion sources may lie within the same image as dest, so we copy element
+    // by element in the same order as our transform kernels.
+    for (uint32 j = 0; j < 8; ++j)
+    for (uint32 i = 0; i < 8; ++i)
+    {
+        dest[j * dest_stride + i] = src[j * src_stride + i];
+    }
+}
+
+inline bool is_zero_block_8x8(const int16 *src, uint32 src_stride)
+{
+    int16 accum = 0;
+
+    for (uint32 j = 0; j < 8; ++j)
+    for (uint32 i = 0; i < 8; ++i)
+    {
+        accum |= src[j * src_stride + i];
+    }
+
+    return (0 == accum);
+}
+
+// Returns the coded block pattern of a block of quantized coefficients.
+inline uint8 query_coded_pattern(const macroblock &block)
+{
+    uint8 pattern = 0;
+
+    for (uint32 k = 0; k < 4; ++k)
+    {
+        if (!is_zero_block_8x8(block.data_y + EVX_LUMA_BLOCK_OFFSET(k, block.stride), block.stride))
+        {
+            pattern |= (0x1 << k);
+        }
+    }
+
+    if (!is_zero_block_8x8(block.data_u, block.stride >> 1)) pattern |= EVX_CODED_PATTERN_U;
+    if (!is_zero_block_8x8(block.data_v, block.stride >> 1)) pattern |= EVX_CODED_PATTERN_V;
+
+    return pattern;
+}
+
 inline void add_macroblock(const macroblock &left, const macroblock &right, macroblock *dest)
 {                                                                                   
     for (uint32 j = 0; j < EVX_MACROBLOCK_SIZE; ++j)                                                
@@ -260,38 +323,126 @@ inline void create_subpixel_macroblock(image_set *prediction, bool amount, const
 
 // Forward block transformations.
 //
-//   Performs a DCT-II transform on the source block.
+//   Performs a DCT-II transform on the source block, using the transforms of the 
+//   requested transform mode (see query_transform_kernels). The luma is transformed
+//   as four 8x8 blocks, and the *_luma_16x16 variants transform it as a single block
+//   for the adaptive transform modes.
 
-inline void transform_macroblock(const macroblock &src, macroblock *dest)
+inline void transform_macroblock(EVX_TRANSFORM_MODE mode, const macroblock &src, macroblock *dest)
 {                                                                                   
-    transform_16x16(src.data_y, src.stride, dest->data_y, dest->stride);
-    transform_8x8(src.data_u, src.stride >> 1, dest->data_u, dest->stride >> 1);
-    transform_8x8(src.data_v, src.stride >> 1, dest->data_v, dest->stride >> 1);
+    const evx_transform_kernels &kernels = query_transform_kernels(mode);
+
+    for (uint32 k = 0; k < 4; ++k)
+    {
+        kernels.transform_8x8(src.data_y + EVX_LUMA_BLOCK_OFFSET(k, src.stride), src.stride, dest->data_y + EVX_LUMA_BLOCK_OFFSET(k, dest->stride), dest->stride);
+    }
+
+    kernels.transform_8x8(src.data_u, src.stride >> 1, dest->data_u, dest->stride >> 1);
+    kernels.transform_8x8(src.data_v, src.stride >> 1, dest->data_v, dest->stride >> 1);
 }
 
-inline void sub_transform_macroblock(const macroblock &src, const macroblock &sub, macroblock *dest)                     
+inline void sub_transform_macroblock(EVX_TRANSFORM_MODE mode, const macroblock &src, const macroblock &sub, macroblock *dest)                     
 {       
-    sub_transform_16x16(src.data_y, src.stride, sub.data_y, sub.stride, dest->data_y, dest->stride);
-    sub_transform_8x8(src.data_u, src.stride >> 1, sub.data_u, sub.stride >> 1, dest->data_u, dest->stride >> 1);
-    sub_transform_8x8(src.data_v, src.stride >> 1, sub.data_v, sub.stride >> 1, dest->data_v, dest->stride >> 1);
+    const evx_transform_kernels &kernels = query_transform_kernels(mode);
+
+    for (uint32 k = 0; k < 4; ++k)
+    {
+        kernels.sub_transform_8x8(src.data_y + EVX_LUMA_BLOCK_OFFSET(k, src.stride), src.stride, sub.data_y + EVX_LUMA_BLOCK_OFFSET(k, sub.stride), sub.stride,
+                                  dest->data_y + EVX_LUMA_BLOCK_OFFSET(k, dest->stride), dest->stride);
+    }
+
+    kernels.sub_transform_8x8(src.data_u, src.stride >> 1, sub.data_u, sub.stride >> 1, dest->data_u, dest->stride >> 1);
+    kernels.sub_transform_8x8(src.data_v, src.stride >> 1, sub.data_v, sub.stride >> 1, dest->data_v, dest->stride >> 1);
+}
+
+inline void transform_luma_16x16(EVX_TRANSFORM_MODE mode, const macroblock &src, int16 *dest, uint32 dest_stride)
+{
+    query_transform_kernels(mode).transform_16x16(src.data_y, src.stride, dest, dest_stride);
+}
+
+inline void sub_transform_luma_16x16(EVX_TRANSFORM_MODE mode, const macroblock &src, const macroblock &sub, int16 *dest, uint32 dest_stride)
+{
+    query_transform_kernels(mode).sub_transform_16x16(src.data_y, src.stride, sub.data_y, sub.stride, dest, dest_stride);
 }
 
 // Inverse block transformations.
 //
-//   Performs an Inverse DCT-II transform on the source block.
+//   Performs an Inverse DCT-II transform on the source block. Only the 8x8 blocks 
+//   that are set in coded_pattern are transformed, as all others are known to be 
+//   zero. The luma is transformed as a single 16x16 block if coded_pattern holds
+//   EVX_CODED_PATTERN_LUMA_16x16.
 
-inline void inverse_transform_macroblock(const macroblock &src, macroblock *dest)
+inline void inverse_transform_macroblock(EVX_TRANSFORM_MODE mode, const macroblock &src, uint8 coded_pattern, macroblock *dest)
 {                                                                                   
-    inverse_transform_16x16(src.data_y, src.stride, dest->data_y, dest->stride);
-    inverse_transform_8x8(src.data_u, src.stride >> 1, dest->data_u, dest->stride >> 1);
-    inverse_transform_8x8(src.data_v, src.stride >> 1, dest->data_v, dest->stride >> 1);
+    const evx_transform_kernels &kernels = query_transform_kernels(mode);
+
+    if (coded_pattern & EVX_CODED_PATTERN_LUMA_16x16)
+    {
+        kernels.inverse_transform_16x16(src.data_y, src.stride, dest->data_y, dest->stride);
+    }
+    else
+    {
+        for (uint32 k = 0; k < 4; ++k)
+        {
+            int16 *dest_data = dest->data_y + EVX_LUMA_BLOCK_OFFSET(k, dest->stride);
+
+            if (coded_pattern & (0x1 << k))
+            {
+                kernels.inverse_transform_8x8(src.data_y + EVX_LUMA_BLOCK_OFFSET(k, src.stride), src.stride, dest_data, dest->stride);
+            }
+            else
+            {
+                zero_block_8x8(dest_data, dest->stride);
+            }
+        }
+    }
+
+    if (coded_pattern & EVX_CODED_PATTERN_U)
+        kernels.inverse_transform_8x8(src.data_u, src.stride >> 1, dest->data_u, dest->stride >> 1);
+    else
+        zero_block_8x8(dest->data_u, dest->stride >> 1);
+
+    if (coded_pattern & EVX_CODED_PATTERN_V)
+        kernels.inverse_transform_8x8(src.data_v, src.stride >> 1, dest->data_v, dest->stride >> 1);
+    else
+        zero_block_8x8(dest->data_v, dest->stride >> 1);
 }
 
-inline void inverse_transform_add_macroblock(const macroblock &src, const macroblock &add, macroblock *dest)                     
+inline void inverse_transform_add_macroblock(EVX_TRANSFORM_MODE mode, const macroblock &src, const macroblock &add, uint8 coded_pattern, macroblock *dest)                     
 {       
-    inverse_transform_add_16x16(src.data_y, src.stride, add.data_y, add.stride, dest->data_y, dest->stride);
-    inverse_transform_add_8x8(src.data_u, src.stride >> 1, add.data_u, add.stride >> 1, dest->data_u, dest->stride >> 1);
-    inverse_transform_add_8x8(src.data_v, src.stride >> 1, add.data_v, add.stride >> 1, dest->data_v, dest->stride >> 1);                                      
+    const evx_transform_kernels &kernels = query_transform_kernels(mode);
+
+    if (coded_pattern & EVX_CODED_PATTERN_LUMA_16x16)
+    {
+        kernels.inverse_transform_add_16x16(src.data_y, src.stride, add.data_y, add.stride, dest->data_y, dest->stride);
+    }
+    else
+    {
+        for (uint32 k = 0; k < 4; ++k)
+        {
+            int16 *add_data = add.data_y + EVX_LUMA_BLOCK_OFFSET(k, add.stride);
+            int16 *dest_data = dest->data_y + EVX_LUMA_BLOCK_OFFSET(k, dest->stride);
+
+            if (coded_pattern & (0x1 << k))
+            {
+                kernels.inverse_transform_add_8x8(src.data_y + EVX_LUMA_BLOCK_OFFSET(k, src.stride), src.stride, add_data, add.stride, dest_data, dest->stride);
+            }
+            else
+            {
+                copy_block_8x8(add_data, add.stride, dest_data, dest->stride);
+            }
+        }
+    }
+
+    if (coded_pattern & EVX_CODED_PATTERN_U)
+        kernels.inverse_transform_add_8x8(src.data_u, src.stride >> 1, add.data_u, add.stride >> 1, dest->data_u, dest->stride >> 1);
+    else
+        copy_block_8x8(add.data_u, add.stride >> 1, dest->data_u, dest->stride >> 1);
+
+    if (coded_pattern & EVX_CODED_PATTERN_V)
+        kernels.inverse_transform_add_8x8(src.data_v, src.stride >> 1, add.data_v, add.stride >> 1, dest->data_v, dest->stride >> 1);
+    else
+        copy_block_8x8(add.data_v, add.stride >> 1, dest->data_v, dest->stride >> 1);
 }
 
 } // namespace evx
@@ -137,6 +137,50 @@ inline uint8 log2(uint32 value)
 #endif
 }
 
+inline uint8 count_trailing_zeros(uint32 value)
+{
+    if (0 == value)
+    {
+        return 32;
+    }
+
+#if defined (__GNUC__)
+
+    return __builtin_ctz(value);
+
+#elif defined (_MSC_VER)
+
+    unsigned long index = 0;
+    _BitScanForward(&index, value);
+    return (uint8) index;
+
+#else
+
+    uint8 result = 0;
+
+    while (!(value & 0x1))
+    {
+        value >>= 1;
+        result++;
+    }
+
+    return result;
+
+#endif
+}
+
+inline uint32 reverse_bits(uint32 value, uint8 count)
+{
+    // Reverses the order of the low count bits of value, for count in [1:32].
+    value = ((value >> 1) & 0x55555555) | ((value & 0x55555555) << 1);
+    value = ((value >> 2) & 0x33333333) | ((value & 0x33333333) << 2);
+    value = ((value >> 4) & 0x0F0F0F0F) | ((value & 0x0F0F0F0F) << 4);
+    value = ((value >> 8) & 0x00FF00FF) | ((value & 0x00FF00FF) << 8);
+    value = (value >> 16) | (value << 16);
+
+    return value >> (32 - count);
+}
+
 inline int8 sign(int8 value)
 {
     int8 is_non_zero = !!value;
@@ -302,10 +346,11 @@ inline float inv_sqrt(float32 f)
     // Newton-Raphson approximation with a curiously awesome initial guess
     float32 half = 0.5f * f;
     
-    int32 i = *reinterpret_cast<int32 *>(&f);
+    union { float32 f; int32 i; } bits;
+    bits.f = f;
     
-    i = 0x5f3759df - (i >> 1);
-    f = *reinterpret_cast<float32 *>(&i);
+    bits.i = 0x5f3759df - (bits.i >> 1);
+    f = bits.f;
     f = f * (1.5f - half * f * f);
     // f = f * (1.5f - half * f * f);   // if we want extra precision we do an extra degree
     return f;
@@ -2,6 +2,7 @@
 #include "analysis.h"
 #include "common.h"
 #include "macroblock.h"
+#include "motion.h"
 
 // Increasing these above zero will allow the encoder to skip blocks that 
 // exhibit some degree of variation. Note, this constant has been replaced by
@@ -16,13 +17,29 @@
 // Also, if a motion predicted block is visually identical to our current block, then
 // we flag it as a skip block with motion prediction.
 
-#define EVX_MOTION_SAD_THRESHOLD                 (8*EVX_KB)
+#define EVX_MOTION_SAD_THRESHOLD                 ((int32) (8*EVX_KB))
 
 // Defines our maximum search area around each block. Larger values will require
 // significantly more processing but may detect larger movement more effectively.
 
 #define EVX_MOTION_SEARCH_RADIUS                 (16)
 
+// Predictive motion search seeds the inter search with the motion vectors of 
+// neighboring and co-located blocks, and refines the best predictor with a small 
+// diamond pattern. If no predictor comes within EVX_MOTION_PREDICTOR_SAD_THRESHOLD 
+// the full logarithmic search is performed from the best predictor instead.
+
+#define EVX_MOTION_PREDICTIVE_SEARCH             (1)
+#define EVX_MOTION_PREDICTOR_SAD_THRESHOLD       (4 * EVX_MACROBLOCK_LUMINANCE_SIZE)
+#define EVX_MOTION_REFINE_ITERATIONS             (8)
+
+// Hierarchical motion search covers EVX_MOTION_PYRAMID_RADIUS pixels (at full resolution)
+// with an exhaustive search at the coarsest pyramid level, which is then refined at each
+// finer level. Each additional pyramid level quarters the cost of the coarse search for
+// a given radius.
+
+#define EVX_MOTION_PYRAMID_RADIUS                (64)
+
 namespace evx {
 
 // Sum of Absolute Differences vs Maximum Absolute Difference
@@ -38,9 +55,13 @@ namespace evx {
 typedef struct evx_prediction_params
 {
     image_set *prediction;
+    const evx_cache_bank *cache_bank;
+    uint32 prediction_index;
     int16 mad_skip_threshold;
     int16 pixel_x;
     int16 pixel_y;
+    int16 min_y;                      // topmost block row that intra prediction may reference.
+    int16 max_y;                      // bottommost block row that intra prediction may reference.
 
 } evx_prediction_params;
 
@@ -108,15 +129,235 @@ void compute_motion_direction_from_frac_index(int16 frac_index, int16 *dir_x, in
     evx_post_error(EVX_ERROR_INVALIDARG);
 }
 
+// Sub-pixel planes
+//
+// A sub-pixel plane holds the interpolation of every pixel of a prediction frame with 
+// its neighbor in one of the eight sub-pixel directions, using the same rounding as
+// lerp_macroblock_half / lerp_macroblock_quarter. Chroma planes are interpolated with 
+// the same direction in chroma space. 
+//
+// Half pel interpolation is symmetric, so only the four planes for frac indices 4-7
+// are stored, and frac index k < 4 reads plane 7 - k offset by one pixel in direction
+// k. Quarter pel planes (mode 2) are stored for all eight directions and follow the
+// half pel planes.
+
+#if EVX_SUBPEL_PLANE_MODE
+
+static void build_subpel_channel(const image &source, bool amount, int16 dir_x, int16 dir_y, image *dest)
+{
+    int32 width = source.query_width();
+    int32 height = source.query_height();
+    int32 stride = source.query_row_pitch() >> 1;
+    const int16 *src_data = reinterpret_cast<const int16 *>(source.query_data());
+    int16 *dest_data = reinterpret_cast<int16 *>(dest->query_data());
+
+    // Pixels whose neighbor lies outside of the frame are never referenced by a valid
+    // motion vector, so we clamp their neighbor to keep the reads in bounds.
+    int32 first_x = (dir_x < 0 ? 1 : 0);
+    int32 last_x = (dir_x > 0 ? width - 1 : width);
+
+    for (int32 y = 0; y < height; ++y)
+    {
+        int32 neighbor_y = clip_range(y + dir_y, 0, height - 1);
+        const int16 *src_row = src_data + y * stride;
+        const int16 *neighbor_row = src_data + neighbor_y * stride + dir_x;
+        int16 *dest_row = dest_data + y * stride;
+
+        for (int32 x = 0; x < first_x; ++x) 
+        {
+            dest_row[x] = src_row[x];
+        }
+
+        if (amount)
+        {
+            for (int32 x = first_x; x < last_x; ++x)
+            {
+                int32 temp = 3 * src_row[x] + neighbor_row[x];
+                dest_row[x] = evx_round_out(temp, 2) / 4;
+            }
+        }
+        else
+        {
+            for (int32 x = first_x; x < last_x; ++x)
+            {
+                int32 temp = src_row[x] + neighbor_row[x];
+                dest_row[x] = evx_round_out(temp, 1) / 2;
+            }
+        }
+
+        for (int32 x = last_x; x < width; ++x) 
+        {
+            dest_row[x] = src_row[x];
+        }
+    }
+}
+
+// Returns the channel data for the sub-pixel block at (pixel_x, pixel_y) in direction 
+// (dir_x, dir_y), in the coordinate space of the channel.
+static inline int16 *query_subpel_channel(const image_set *planes, image *(image_set::*channel)() const, bool amount, 
+                                          int32 pixel_x, int32 pixel_y, int16 dir_x, int16 dir_y)
+{
+    int16 frac_index = compute_motion_frac_index_from_direction(dir_x, dir_y);
+    const image_set *plane = NULL;
+
+    if (amount)
+    {
+        plane = &planes[4 + frac_index];
+    }
+    else if (frac_index >= 4)
+    {
+        plane = &planes[frac_index - 4];
+    }
+    else
+    {
+        plane = &planes[3 - frac_index];
+        pixel_x += dir_x;
+        pixel_y += dir_y;
+    }
+
+    image *target = (plane->*channel)();
+
+    return reinterpret_cast<int16 *>(target->query_data() + target->query_block_offset(pixel_x, pixel_y));
+}
+
+static inline bool query_subpel_macroblock(const evx_cache_bank &cache_bank, uint32 prediction_index, bool amount, 
+                                           int32 pixel_x, int32 pixel_y, int16 frac_index, macroblock *output)
+{
+    if (!cache_bank.subpel_valid[prediction_index] || (amount && EVX_SUBPEL_PLANE_MODE < 2))
+    {
+        return false;
+    }
+
+    int16 dir_x = 0, dir_y = 0;
+    compute_motion_direction_from_frac_index(frac_index, &dir_x, &dir_y);
+
+    const image_set *planes = cache_bank.subpel_cache[prediction_index];
+    output->data_y = query_subpel_channel(planes, &image_set::query_y_image, amount, pixel_x, pixel_y, dir_x, dir_y);
+    output->stride = planes[0].query_y_image()->query_row_pitch() >> 1;
+
+    // The chroma neighbor of a sub-pixel block may be the chroma sample itself, in 
+    // which case the interpolation is an identity and we read the prediction directly.
+    int32 chroma_x = pixel_x >> 1;
+    int32 chroma_y = pixel_y >> 1;
+    int16 chroma_dir_x = ((pixel_x + dir_x) >> 1) - chroma_x;
+    int16 chroma_dir_y = ((pixel_y + dir_y) >> 1) - chroma_y;
+
+    if (0 == chroma_dir_x && 0 == chroma_dir_y)
+    {
+        const image_set &prediction = cache_bank.prediction_cache[prediction_index];
+        output->data_u = reinterpret_cast<int16 *>(prediction.query_u_image()->query_data() + prediction.query_u_image()->query_block_offset(chroma_x, chroma_y));
+        output->data_v = reinterpret_cast<int16 *>(prediction.query_v_image()->query_data() + prediction.query_v_image()->query_block_offset(chroma_x, chroma_y));
+    }
+    else
+    {
+        output->data_u = query_subpel_channel(planes, &image_set::query_u_image, amount, chroma_x, chroma_y, chroma_dir_x, chroma_dir_y);
+        output->data_v = query_subpel_channel(planes, &image_set::query_v_image, amount, chroma_x, chroma_y, chroma_dir_x, chroma_dir_y);
+    }
+
+    return true;
+}
+
+evx_status build_subpel_planes(uint32 prediction_index, evx_cache_bank *cache_bank)
+{
+    const image_set &source = cache_bank->prediction_cache[prediction_index];
+    image_set *planes = cache_bank->subpel_cache[prediction_index];
+
+    for (uint32 k = 0; k < EVX_SUBPEL_PLANE_COUNT; ++k)
+    {
+        bool amount = (k >= 4);
+        int16 frac_index = (amount ? k - 4 : k + 4);
+        int16 dir_x, dir_y;
+
+        if (EVX_IMAGE_FORMAT_NONE == planes[k].query_image_format() || 
+            planes[k].query_width() != source.query_width() || 
+            planes[k].query_height() != source.query_height())
+        {
+            if (evx_failed(planes[k].initialize(EVX_IMAGE_FORMAT_R16S, source.query_width(), source.query_height())))
+            {
+                return evx_post_error(EVX_ERROR_OUTOFMEMORY);
+            }
+        }
+
+        compute_motion_direction_from_frac_index(frac_index, &dir_x, &dir_y);
+        build_subpel_channel(*source.query_y_image(), amount, dir_x, dir_y, planes[k].query_y_image());
+        build_subpel_channel(*source.query_u_image(), amount, dir_x, dir_y, planes[k].query_u_image());
+        build_subpel_channel(*source.query_v_image(), amount, dir_x, dir_y, planes[k].query_v_image());
+    }
+
+    cache_bank->subpel_valid[prediction_index] = true;
+
+    return EVX_SUCCESS;
+}
+
+void invalidate_subpel_planes(uint32 prediction_index, evx_cache_bank *cache_bank)
+{
+    cache_bank->subpel_valid[prediction_index] = false;
+}
+
+#else
+
+static inline bool query_subpel_macroblock(const evx_cache_bank &cache_bank, uint32 prediction_index, bool amount, 
+                                           int32 pixel_x, int32 pixel_y, int16 frac_index, macroblock *output)
+{
+    return false;
+}
+
+evx_status build_subpel_planes(uint32 prediction_index, evx_cache_bank *cache_bank)
+{
+    return EVX_SUCCESS;
+}
+
+void invalidate_subpel_planes(uint32 prediction_index, evx_cache_bank *cache_bank) {}
+
+#endif
+
+void create_subpixel_prediction(evx_cache_bank *cache_bank, uint32 prediction_index, const evx_block_desc &block_desc, 
+                                int32 pixel_x, int32 pixel_y, macroblock *cache_block, macroblock *output)
+{
+    int32 base_x = pixel_x + block_desc.motion_x;
+    int32 base_y = pixel_y + block_desc.motion_y;
+
+    if (query_subpel_macroblock(*cache_bank, prediction_index, block_desc.sp_amount, base_x, base_y, block_desc.sp_index, output))
+    {
+        return;
+    }
+
+    int16 sp_i = 0, sp_j = 0;
+    macroblock beta_block;
+    image_set *prediction = &cache_bank->prediction_cache[prediction_index];
+
+    compute_motion_direction_from_frac_index(block_desc.sp_index, &sp_i, &sp_j);
+    create_macroblock(*prediction, base_x, base_y, &beta_block);
+    create_subpixel_macroblock(prediction, block_desc.sp_amount, beta_block, base_x + sp_i, base_y + sp_j, cache_block);
+
+    *output = *cache_block;
+}
+
 static inline void evaluate_motion_candidate(int32 current_x, int32 current_y, const evx_prediction_params &params, 
                                              const macroblock &src_block, evx_motion_selection *selection)
 {
     macroblock test_block;
 
     create_macroblock(*params.prediction, current_x, current_y, &test_block);  
-    int32 current_sad = compute_block_sad(src_block, test_block); 
+    int32 current_mad = 0;
     int32 current_ssd = EVX_PIXEL_DISTANCE_SQ(current_x, current_y, params.pixel_x, params.pixel_y);
-    int32 current_mad = compute_block_mad(src_block, test_block);
+    int32 sad_limit = 0;
+    int32 mad_limit = 0;
+
+    // Derive the distortion at which this candidate can no longer be selected by the 
+    // rules below, and allow the metric kernel to stop early once it is reached.
+    if (selection->best_mad < params.mad_skip_threshold)
+    {
+        mad_limit = selection->best_mad + (current_ssd < selection->best_ssd ? 1 : 0);
+    }
+    else
+    {
+        bool tie_wins = (current_ssd < selection->best_ssd && selection->best_sad < EVX_MOTION_SAD_THRESHOLD);
+        sad_limit = selection->best_sad + (tie_wins ? 1 : 0);
+        mad_limit = params.mad_skip_threshold;
+    }
+
+    int32 current_sad = compute_block_sad_mad_bounded(src_block, test_block, sad_limit, mad_limit, &current_mad); 
 
     // If we've already found a suitable copy block, then we only accept new 
     // candidates that are a closer matched copy block.
@@ -136,29 +377,53 @@ static inline void evaluate_motion_candidate(int32 current_x, int32 current_y, c
     else
     {
         if ((current_sad < selection->best_sad ||
-            (current_sad == selection->best_sad && current_ssd < selection->best_ssd) && 
-            current_sad < EVX_MOTION_SAD_THRESHOLD) || current_mad < params.mad_skip_threshold)                                                             
+            ((current_sad == selection->best_sad && current_ssd < selection->best_ssd) && 
+            current_sad < EVX_MOTION_SAD_THRESHOLD)) || current_mad < params.mad_skip_threshold)                                                             
         {                                                                                               
             selection->best_x = current_x;                                                                         
             selection->best_y = current_y;                                                                         
             selection->best_sad = current_sad;                         
             selection->best_ssd = current_ssd;
-            selection->best_mad = compute_block_mad(src_block, test_block);                                                                     
+            selection->best_mad = current_mad;
         }  
     } 
 }
 
+static inline int32 compute_subpel_candidate_distortion(const macroblock &src_block, const macroblock &test_block, const evx_prediction_params &params, 
+                                                        const evx_motion_selection &selection, int32 *mad)
+{
+    // Sub-pixel candidates never win ties, so the limits are simply the current best
+    // values that evaluate_subpel_motion_candidate compares against.
+    if (selection.best_mad < params.mad_skip_threshold)
+    {
+        return compute_block_sad_mad_bounded(src_block, test_block, 0, selection.best_mad, mad);
+    }
+
+    int32 sad_limit = evx_min2(selection.best_sad, EVX_MOTION_SAD_THRESHOLD);
+
+    return compute_block_sad_mad_bounded(src_block, test_block, sad_limit, params.mad_skip_threshold, mad);
+}
+
 static inline void evaluate_subpel_motion_candidate(int32 target_x, int32 target_y, int16 i, int16 j, const evx_prediction_params &params, 
                                                     const macroblock &src_block, macroblock *cache_block, const macroblock &best_block,
                                                     evx_motion_selection *selection)
 {
     macroblock test_block;
+    macroblock candidate_block;
+    int16 frac_index = compute_motion_frac_index_from_direction(i, j);
 
-    // create an interpolated block between best_block and test_block using a half-pel lerp.
+    // create an interpolated block between best_block and test_block using a half-pel lerp,
+    // unless a pre-interpolated half-pel plane is available.
     create_macroblock(*params.prediction, target_x, target_y, &test_block);   
-    lerp_macroblock_half(best_block, test_block, cache_block);                                                                       
-    int32 current_sad = compute_block_sad(src_block, *cache_block); 
-    int32 current_mad = compute_block_mad(src_block, *cache_block);
+
+    if (!query_subpel_macroblock(*params.cache_bank, params.prediction_index, false, selection->best_x, selection->best_y, frac_index, &candidate_block))
+    {
+        lerp_macroblock_half(best_block, test_block, cache_block);                                                                       
+        candidate_block = *cache_block;
+    }
+
+    int32 current_mad = 0;
+    int32 current_sad = compute_subpel_candidate_distortion(src_block, candidate_block, params, *selection, &current_mad); 
      
     // If we've already found a suitable copy block, then we only accept new 
     // candidates that are a closer matched copy block.
@@ -168,7 +433,7 @@ static inline void evaluate_subpel_motion_candidate(int32 target_x, int32 target
         {
             selection->sp_enabled = true;
             selection->sp_amount = false;   // identifies a half pixel interpolation.
-            selection->sp_index = compute_motion_frac_index_from_direction(i, j);
+            selection->sp_index = frac_index;
  
             selection->best_sad = current_sad;                                                                     
             selection->best_mad = current_mad; 
@@ -181,7 +446,7 @@ static inline void evaluate_subpel_motion_candidate(int32 target_x, int32 target
         {                                                                                               
             selection->sp_enabled = true;
             selection->sp_amount = false;   // identifies a half pixel interpolation.
-            selection->sp_index = compute_motion_frac_index_from_direction(i, j);
+            selection->sp_index = frac_index;
  
             selection->best_sad = current_sad;                                                                     
             selection->best_mad = current_mad;                                                                    
@@ -189,9 +454,13 @@ static inline void evaluate_subpel_motion_candidate(int32 target_x, int32 target
     }                                                                                  
                                                                                                         
     // perform a quarter-pel lerp and compare the results.                                                                                     
-    lerp_macroblock_quarter(best_block, test_block, cache_block);                                                                   
-    current_sad = compute_block_sad(src_block, *cache_block);     
-    current_mad = compute_block_mad(src_block, *cache_block);
+    if (!query_subpel_macroblock(*params.cache_bank, params.prediction_index, true, selection->best_x, selection->best_y, frac_index, &candidate_block))
+    {
+        lerp_macroblock_quarter(best_block, test_block, cache_block);                                                                   
+        candidate_block = *cache_block;
+    }
+
+    current_sad = compute_subpel_candidate_distortion(src_block, candidate_block, params, *selection, &current_mad);     
                              
     // If we've already found a suitable copy block, then we only accept new 
     // candidates that are a closer matched copy block.
@@ -201,7 +470,7 @@ static inline void evaluate_subpel_motion_candidate(int32 target_x, int32 target
         {
             selection->sp_enabled = true;
             selection->sp_amount = true;   // identifies a quarter pixel interpolation.
-            selection->sp_index = compute_motion_frac_index_from_direction(i, j);
+            selection->sp_index = frac_index;
  
             selection->best_sad = current_sad;                                                                     
             selection->best_mad = current_mad;    
@@ -214,7 +483,7 @@ static inline void evaluate_subpel_motion_candidate(int32 target_x, int32 target
         {                                                                                               
             selection->sp_enabled = true;
             selection->sp_amount = true;   // identifies a quarter pixel interpolation.
-            selection->sp_index = compute_motion_frac_index_from_direction(i, j);
+            selection->sp_index = frac_index;
  
             selection->best_sad = current_sad;                                                                     
             selection->best_mad = current_mad;                                                                      
@@ -242,7 +511,7 @@ void perform_intra_motion_search(int16 left, int16 top, int16 right, int16 botto
         }                                                                                               
                                                                                                         
         if (current_x < 0 || current_x > params.prediction->query_width() - EVX_MACROBLOCK_SIZE ||              
-            current_y < 0 || current_y > params.prediction->query_height() - EVX_MACROBLOCK_SIZE)               
+            current_y < params.min_y || current_y > params.max_y)               
         {                                                                                               
              continue;                                                                                  
         }                                                                                               
@@ -307,7 +576,7 @@ void perform_intra_subpixel_motion_search(const evx_prediction_params &params,
         }                                                                                               
                                                                                                         
         if (target_x < 0 || target_x > params.prediction->query_width() - EVX_MACROBLOCK_SIZE ||                
-            target_y < 0 || target_y > params.prediction->query_height() - EVX_MACROBLOCK_SIZE)                 
+            target_y < params.min_y || target_y > params.max_y)                 
         {                                                                                               
             continue;                                                                                   
         }                                                                                               
@@ -351,7 +620,8 @@ void perform_inter_subpixel_motion_search(const evx_prediction_params &params,
     } 
 }
 
-int32 calculate_intra_prediction(const evx_frame &frame, const macroblock &src_block, int32 pixel_x, int32 pixel_y, evx_cache_bank *cache_bank, evx_block_desc *output_desc)
+int32 calculate_intra_prediction(const evx_frame &frame, const macroblock &src_block, int32 pixel_x, int32 pixel_y, evx_cache_bank *cache_bank, 
+                                 evx_slice *slice, evx_block_desc *output_desc)
 {
     evx_motion_selection selection;
     selection.best_x = pixel_x;
@@ -368,9 +638,17 @@ int32 calculate_intra_prediction(const evx_frame &frame, const macroblock &src_b
     params.pixel_y = pixel_y;
     params.mad_skip_threshold = ((frame.quality >> 2) + 1);
 
+    // Intra prediction may only reference pixels of the current slice that have already 
+    // been reconstructed. Blocks to the left would otherwise extend into the rows below, 
+    // which prevents the decoder from reconstructing rows as a wavefront.
+    params.min_y = slice->first_row << EVX_MACROBLOCK_SHIFT;
+    params.max_y = pixel_y;
+
     // Search for the closest match to our current source block within the prediction image.
     uint32 intra_pred_index = query_prediction_index_by_offset(frame, 0);
     params.prediction = const_cast<image_set *>(&cache_bank->prediction_cache[intra_pred_index]);
+    params.prediction_index = intra_pred_index;
+    params.cache_bank = cache_bank;
 
     // Scan the following values in a triangle around our pixel:
     //                                                           
@@ -391,7 +669,7 @@ int32 calculate_intra_prediction(const evx_frame &frame, const macroblock &src_b
     }
 
     // perform sub-pixel motion estimation
-    perform_intra_subpixel_motion_search(params, src_block, &cache_bank->motion_block, &selection);    
+    perform_intra_subpixel_motion_search(params, src_block, &slice->motion_block, &selection);    
 
     // Fill out our block descriptor using our closest match.
     clear_block_desc(output_desc);
@@ -418,7 +696,409 @@ int32 calculate_intra_prediction(const evx_frame &frame, const macroblock &src_b
     return selection.best_sad;
 }
 
-int32 calculate_inter_prediction(const evx_frame &frame, const macroblock &src_block, int32 pixel_x, int32 pixel_y, evx_cache_bank *cache_bank, uint16 pred_offset, evx_block_desc *output_desc)
+static inline bool is_inter_candidate_in_bounds(int32 current_x, int32 current_y, const evx_prediction_params &params)
+{
+    return (current_x >= 0 && current_x <= params.prediction->query_width() - EVX_MACROBLOCK_SIZE &&
+            current_y >= 0 && current_y <= params.prediction->query_height() - EVX_MACROBLOCK_SIZE);
+}
+
+// Motion pyramids
+//
+// Level k of a pyramid holds the luma channel of its frame downsampled by 2^(k+1), where
+// each pixel is the rounded average of the 2x2 pixels beneath it. A block at level k 
+// therefore covers (EVX_MACROBLOCK_SIZE >> (k+1)) pixels per side.
+
+#if EVX_MOTION_PYRAMID_SEARCH
+
+static void downsample_channel(const image &source, image *dest)
+{
+    int32 width = dest->query_width();
+    int32 height = dest->query_height();
+    int32 src_stride = source.query_row_pitch() >> 1;
+    int32 dest_stride = dest->query_row_pitch() >> 1;
+    const int16 *src_data = reinterpret_cast<const int16 *>(source.query_data());
+    int16 *dest_data = reinterpret_cast<int16 *>(dest->query_data());
+
+    for (int32 y = 0; y < height; ++y)
+    {
+        const int16 *src_row = src_data + 2 * y * src_stride;
+        int16 *dest_row = dest_data + y * dest_stride;
+
+        for (int32 x = 0; x < width; ++x)
+        {
+            int32 sum = src_row[2 * x] + src_row[2 * x + 1] + 
+                        src_row[2 * x + src_stride] + src_row[2 * x + src_stride + 1];
+
+            dest_row[x] = (sum + 2) >> 2;
+        }
+    }
+}
+
+static evx_status build_motion_pyramid(const image &source, image *levels)
+{
+    const image *parent = &source;
+
+    for (uint32 k = 0; k < EVX_MOTION_PYRAMID_LEVELS; ++k)
+    {
+        uint32 level_width = parent->query_width() >> 1;
+        uint32 level_height = parent->query_height() >> 1;
+
+        if (EVX_IMAGE_FORMAT_NONE == levels[k].query_image_format() || 
+            levels[k].query_width() != level_width || 
+            levels[k].query_height() != level_height)
+        {
+            destroy_image(&levels[k]);
+
+            if (evx_failed(create_image(EVX_IMAGE_FORMAT_R16S, level_width, level_height, &levels[k])))
+            {
+                return evx_post_error(EVX_ERROR_OUTOFMEMORY);
+            }
+        }
+
+        downsample_channel(*parent, &levels[k]);
+        parent = &levels[k];
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status build_input_pyramid(evx_cache_bank *cache_bank)
+{
+    return build_motion_pyramid(*cache_bank->input_cache.query_y_image(), cache_bank->input_pyramid);
+}
+
+evx_status build_prediction_pyramid(uint32 prediction_index, evx_cache_bank *cache_bank)
+{
+    const image &source = *cache_bank->prediction_cache[prediction_index].query_y_image();
+
+    if (evx_failed(build_motion_pyramid(source, cache_bank->prediction_pyramid[prediction_index])))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    cache_bank->pyramid_valid[prediction_index] = true;
+
+    return EVX_SUCCESS;
+}
+
+void invalidate_prediction_pyramid(uint32 prediction_index, evx_cache_bank *cache_bank)
+{
+    cache_bank->pyramid_valid[prediction_index] = false;
+}
+
+// Returns early, with a partial sum, once the sum reaches sad_limit.
+static inline int32 compute_pyramid_block_sad(const int16 *src_data, int32 src_stride, const int16 *ref_data, int32 ref_stride, 
+                                              int32 block_size, int32 sad_limit)
+{
+    int32 sad = 0;
+
+    for (int32 y = 0; y < block_size; ++y)
+    {
+        for (int32 x = 0; x < block_size; ++x)
+        {
+            sad += abs(src_data[x] - ref_data[x]);
+        }
+
+        if (sad >= sad_limit)
+        {
+            break;
+        }
+
+        src_data += src_stride;
+        ref_data += ref_stride;
+    }
+
+    return sad;
+}
+
+// Searches the (2 * radius + 1)^2 window around (center_x, center_y) at a pyramid level,
+// where all coordinates are in the space of the level. The best position is written back
+// to (center_x, center_y).
+static void search_pyramid_level(const image &source, const image &reference, int32 block_x, int32 block_y, int32 block_size, 
+                                 int32 radius, int32 *center_x, int32 *center_y)
+{
+    int32 best_sad = EVX_MAX_INT32;
+    int32 best_x = *center_x;
+    int32 best_y = *center_y;
+    int32 max_x = reference.query_width() - block_size;
+    int32 max_y = reference.query_height() - block_size;
+    int32 src_stride = source.query_row_pitch() >> 1;
+    int32 ref_stride = reference.query_row_pitch() >> 1;
+    const int16 *src_data = reinterpret_cast<const int16 *>(source.query_data()) + block_y * src_stride + block_x;
+    const int16 *ref_data = reinterpret_cast<const int16 *>(reference.query_data());
+
+    for (int32 j = *center_y - radius; j <= *center_y + radius; ++j)
+    for (int32 i = *center_x - radius; i <= *center_x + radius; ++i)
+    {
+        if (i < 0 || i > max_x || j < 0 || j > max_y)
+        {
+            continue;
+        }
+
+        // Candidates are abandoned once they exceed best_sad, so a partial sum never wins.
+        int32 sad = compute_pyramid_block_sad(src_data, src_stride, ref_data + j * ref_stride + i, ref_stride, block_size, 
+                                              (best_sad == EVX_MAX_INT32 ? best_sad : best_sad + 1));
+
+        // Ties prefer the vector closest to the block's own position, as it is the 
+        // cheapest to encode.
+        if (sad < best_sad || (sad == best_sad && 
+            EVX_PIXEL_DISTANCE_SQ(i, j, block_x, block_y) < EVX_PIXEL_DISTANCE_SQ(best_x, best_y, block_x, block_y)))
+        {
+            best_sad = sad;
+            best_x = i;
+            best_y = j;
+        }
+    }
+
+    *center_x = best_x;
+    *center_y = best_y;
+}
+
+static bool perform_pyramid_motion_search(const evx_prediction_params &params, const macroblock &src_block, 
+                                          evx_motion_selection *selection)
+{
+    const evx_cache_bank &cache_bank = *params.cache_bank;
+
+    if (!cache_bank.pyramid_valid[params.prediction_index])
+    {
+        return false;
+    }
+
+    // Exhaustively search the coarsest level, then refine the result at each finer level.
+    int32 level = EVX_MOTION_PYRAMID_LEVELS - 1;
+    int32 target_x = params.pixel_x >> (level + 1);
+    int32 target_y = params.pixel_y >> (level + 1);
+    int32 radius = EVX_MOTION_PYRAMID_RADIUS >> (level + 1);
+
+    for (; level >= 0; --level)
+    {
+        int32 block_size = EVX_MACROBLOCK_SIZE >> (level + 1);
+
+        search_pyramid_level(cache_bank.input_pyramid[level], cache_bank.prediction_pyramid[params.prediction_index][level],
+                             params.pixel_x >> (level + 1), params.pixel_y >> (level + 1), block_size, radius, &target_x, &target_y);
+
+        target_x <<= 1;
+        target_y <<= 1;
+        radius = 1;
+    }
+
+    // The upsampled vector is refined at full resolution by the caller.
+    if (is_inter_candidate_in_bounds(target_x, target_y, params))
+    {
+        evaluate_motion_candidate(target_x, target_y, params, src_block, selection);
+    }
+
+    return true;
+}
+
+#else
+
+evx_status build_input_pyramid(evx_cache_bank *cache_bank)
+{
+    return EVX_SUCCESS;
+}
+
+evx_status build_prediction_pyramid(uint32 prediction_index, evx_cache_bank *cache_bank)
+{
+    return EVX_SUCCESS;
+}
+
+void invalidate_prediction_pyramid(uint32 prediction_index, evx_cache_bank *cache_bank) {}
+
+static inline bool perform_pyramid_motion_search(const evx_prediction_params &params, const macroblock &src_block, 
+                                                 evx_motion_selection *selection)
+{
+    return false;
+}
+
+#endif
+
+void gather_motion_predictors(const evx_block_desc *block_table, uint32 width_in_blocks, const evx_slice &slice, uint32 block_x, uint32 block_y, 
+                              evx_motion_predictors *output)
+{
+    // Note that the co-located entry must be read before the current block is classified, 
+    // as the block table is updated in place.
+    const evx_block_desc *current = &block_table[block_y * width_in_blocks + block_x];
+    const evx_block_desc *candidates[EVX_MOTION_PREDICTOR_COUNT] = {NULL, NULL, NULL, current};
+
+    if (block_x > 0)
+    {
+        candidates[EVX_MOTION_PREDICTOR_LEFT] = current - 1;
+    }
+
+    // Neighbors in other slices may not have been coded yet.
+    if (block_y > slice.first_row)
+    {
+        candidates[EVX_MOTION_PREDICTOR_TOP] = current - width_in_blocks;
+
+        if (block_x + 1 < width_in_blocks)
+        {
+            candidates[EVX_MOTION_PREDICTOR_TOP_RIGHT] = current - width_in_blocks + 1;
+        }
+    }
+
+    for (uint32 i = 0; i < EVX_MOTION_PREDICTOR_COUNT; ++i)
+    {
+        // Intra motion vectors reference the current frame and cannot be reused.
+        output->valid[i] = (candidates[i] && !EVX_IS_INTRA_BLOCK_TYPE(candidates[i]->block_type));
+        output->motion_x[i] = (output->valid[i] ? candidates[i]->motion_x : 0);
+        output->motion_y[i] = (output->valid[i] ? candidates[i]->motion_y : 0);
+        output->prediction_target[i] = (output->valid[i] ? candidates[i]->prediction_target : 0);
+    }
+}
+
+static inline int16 median3(int16 a, int16 b, int16 c)
+{
+    return evx_max2(evx_min2(a, b), evx_min2(evx_max2(a, b), c));
+}
+
+void query_motion_vector_prediction(const evx_block_desc *block_table, uint32 width_in_blocks, uint32 index, 
+                                    int16 *pred_x, int16 *pred_y)
+{
+    const evx_block_desc *neighbors[3] = {NULL, NULL, NULL};
+    uint32 block_x = index % width_in_blocks;
+
+    if (block_x > 0)
+    {
+        neighbors[0] = &block_table[index - 1];
+    }
+
+    if (index >= width_in_blocks)
+    {
+        neighbors[1] = &block_table[index - width_in_blocks];
+
+        if (block_x + 1 < width_in_blocks)
+        {
+            neighbors[2] = &block_table[index - width_in_blocks + 1];
+        }
+        else if (block_x > 0)
+        {
+            neighbors[2] = &block_table[index - width_in_blocks - 1];
+        }
+    }
+
+    int16 motion_x[3] = {0, 0, 0};
+    int16 motion_y[3] = {0, 0, 0};
+
+    for (uint32 i = 0; i < 3; ++i)
+    {
+        if (neighbors[i] && EVX_IS_MOTION_BLOCK_TYPE(neighbors[i]->block_type))
+        {
+            motion_x[i] = neighbors[i]->motion_x;
+            motion_y[i] = neighbors[i]->motion_y;
+        }
+    }
+
+    // Along the first row of a slice the left neighbor is the only candidate.
+    if (!neighbors[1])
+    {
+        *pred_x = motion_x[0];
+        *pred_y = motion_y[0];
+        return;
+    }
+
+    *pred_x = median3(motion_x[0], motion_x[1], motion_x[2]);
+    *pred_y = median3(motion_y[0], motion_y[1], motion_y[2]);
+}
+
+void perform_predictive_motion_search(const evx_motion_predictors &predictors, uint16 pred_offset, const evx_prediction_params &params, 
+                                      const macroblock &src_block, evx_motion_selection *selection)
+{
+    int16 candidate_x[EVX_MOTION_PREDICTOR_COUNT + 1];
+    int16 candidate_y[EVX_MOTION_PREDICTOR_COUNT + 1];
+    uint32 candidate_count = 0;
+
+    // Scale each predictor to our reference distance, assuming constant motion.
+    for (uint32 i = 0; i < EVX_MOTION_PREDICTOR_COUNT; ++i)
+    {
+        if (!predictors.valid[i] || 0 == predictors.prediction_target[i])
+        {
+            continue;
+        }
+
+        candidate_x[candidate_count] = rounded_div(predictors.motion_x[i] * pred_offset, predictors.prediction_target[i]);
+        candidate_y[candidate_count] = rounded_div(predictors.motion_y[i] * pred_offset, predictors.prediction_target[i]);
+        candidate_count++;
+    }
+
+    // The component-wise median of the spatial neighbors is the classic predictor. We only use
+    // it when all three are available, in which case they occupy the first three candidates.
+    if (predictors.valid[EVX_MOTION_PREDICTOR_LEFT] && predictors.valid[EVX_MOTION_PREDICTOR_TOP] && 
+        predictors.valid[EVX_MOTION_PREDICTOR_TOP_RIGHT] && candidate_count >= 3)
+    {
+        candidate_x[candidate_count] = median3(candidate_x[0], candidate_x[1], candidate_x[2]);
+        candidate_y[candidate_count] = median3(candidate_y[0], candidate_y[1], candidate_y[2]);
+        candidate_count++;
+    }
+
+    for (uint32 i = 0; i < candidate_count; ++i)
+    {
+        int32 current_x = params.pixel_x + candidate_x[i];
+        int32 current_y = params.pixel_y + candidate_y[i];
+        bool duplicate = (0 == candidate_x[i] && 0 == candidate_y[i]);
+
+        for (uint32 k = 0; k < i && !duplicate; ++k)
+        {
+            duplicate = (candidate_x[k] == candidate_x[i] && candidate_y[k] == candidate_y[i]);
+        }
+
+        if (!duplicate && is_inter_candidate_in_bounds(current_x, current_y, params))
+        {
+            evaluate_motion_candidate(current_x, current_y, params, src_block, selection);
+        }
+    }
+
+    if (selection->best_mad < params.mad_skip_threshold)
+    {
+        // A predictor yielded a copy block, which is as good as it gets.
+        return;
+    }
+
+    if (selection->best_sad > EVX_MOTION_PREDICTOR_SAD_THRESHOLD)
+    {
+        // Our predictors are unreliable (e.g. new or erratic motion), so we search the
+        // motion pyramid for large motion and refine the result below. If there is no
+        // pyramid we fall back to the full logarithmic search around the best predictor.
+        if (!perform_pyramid_motion_search(params, src_block, selection))
+        {
+            for (int16 i = EVX_MOTION_SEARCH_RADIUS; i > 0; i >>= 1)
+            {
+                perform_inter_motion_search(-i, -i, i, i, i, params, src_block, selection);
+            }
+
+            return;
+        }
+    }
+
+    // Refine our best predictor with a small diamond until it converges.
+    for (uint32 iteration = 0; iteration < EVX_MOTION_REFINE_ITERATIONS; ++iteration)
+    {
+        int16 center_x = selection->best_x;
+        int16 center_y = selection->best_y;
+        
+        static const int16 diamond_x[4] = {0, -1, 1, 0};
+        static const int16 diamond_y[4] = {-1, 0, 0, 1};
+
+        for (uint32 i = 0; i < 4; ++i)
+        {
+            int32 current_x = center_x + diamond_x[i];
+            int32 current_y = center_y + diamond_y[i];
+
+            if (is_inter_candidate_in_bounds(current_x, current_y, params))
+            {
+                evaluate_motion_candidate(current_x, current_y, params, src_block, selection);
+            }
+        }
+
+        if (center_x == selection->best_x && center_y == selection->best_y)
+        {
+            break;
+        }
+    }
+}
+
+int32 calculate_inter_prediction(const evx_frame &frame, const macroblock &src_block, int32 pixel_x, int32 pixel_y, evx_cache_bank *cache_bank, 
+                                 evx_slice *slice, uint16 pred_offset, const evx_motion_predictors &predictors, evx_block_desc *output_desc)
 {
     evx_motion_selection selection;
     selection.best_x = pixel_x;
@@ -433,24 +1113,30 @@ int32 calculate_inter_prediction(const evx_frame &frame, const macroblock &src_b
     evx_prediction_params params;
     params.pixel_x = pixel_x;
     params.pixel_y = pixel_y;
+    params.min_y = 0;
     params.mad_skip_threshold = ((frame.quality >> 2) + 1);
 
     // Search for the closest match to our current source block within the prediction image.
     uint32 inter_pred_index = query_prediction_index_by_offset(frame, pred_offset);
     params.prediction = const_cast<image_set *>(&cache_bank->prediction_cache[inter_pred_index]);
+    params.prediction_index = inter_pred_index;
+    params.cache_bank = cache_bank;
+    params.max_y = params.prediction->query_height() - EVX_MACROBLOCK_SIZE;
 
     // Each block type incurs a different cost to encode. If we encounter a sad tie then
     // we select the block that has the lowest cost. We accomplish this by configuring our
     // initial best_sad to indicate the cheapest block type.
     macroblock test_block;
     create_macroblock(*params.prediction, pixel_x, pixel_y, &test_block);  
-    selection.best_sad = compute_block_sad(src_block, test_block);  
-    selection.best_mad = compute_block_mad(src_block, test_block);
+    selection.best_sad = compute_block_sad_mad(src_block, test_block, &selection.best_mad);  
      
     // If we've already found a suitable copy block then we avoid an exhaustive
     // motion search and simply encode as inter_copy.
     if (selection.best_mad >= params.mad_skip_threshold)
     {
+#if EVX_MOTION_PREDICTIVE_SEARCH
+        perform_predictive_motion_search(predictors, pred_offset, params, src_block, &selection);
+#else
         // Scan the following values around our pixel:
         //                                                           
         //      X          X          X                                                  
@@ -463,9 +1149,10 @@ int32 calculate_inter_prediction(const evx_frame &frame, const macroblock &src_b
         {
             perform_inter_motion_search(-i, -i, i, i, i, params, src_block, &selection);
         }
+#endif
 
         // perform subpixel motion estimation
-        perform_inter_subpixel_motion_search(params, src_block, &cache_bank->motion_block, &selection);    
+        perform_inter_subpixel_motion_search(params, src_block, &slice->motion_block, &selection);    
     }
 
     // Fill out our block descriptor using our closest match.
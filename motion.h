@@ -41,11 +41,76 @@ namespace evx {
 
 void compute_motion_direction_from_frac_index(int16 frac_index, int16 *dir_x, int16 *dir_y);
 
+// Sub-pixel planes
+//
+//   build_subpel_planes pre-interpolates a committed prediction frame so that sub-pixel
+//   blocks can alias the planes instead of being interpolated per candidate (see 
+//   EVX_SUBPEL_PLANE_MODE). invalidate_subpel_planes must be called before a prediction
+//   frame is overwritten. Both are no-ops when sub-pixel planes are disabled.
+
+evx_status build_subpel_planes(uint32 prediction_index, evx_cache_bank *cache_bank);
+void invalidate_subpel_planes(uint32 prediction_index, evx_cache_bank *cache_bank);
+
+// Motion pyramids
+//
+//   build_input_pyramid and build_prediction_pyramid downsample the luma channel of the
+//   input frame or of a committed prediction frame into a pyramid that halves the 
+//   resolution at each level (see EVX_MOTION_PYRAMID_SEARCH). invalidate_prediction_pyramid
+//   must be called before a prediction frame is overwritten. All are no-ops when the 
+//   pyramid search is disabled.
+
+evx_status build_input_pyramid(evx_cache_bank *cache_bank);
+evx_status build_prediction_pyramid(uint32 prediction_index, evx_cache_bank *cache_bank);
+void invalidate_prediction_pyramid(uint32 prediction_index, evx_cache_bank *cache_bank);
+
+// create_subpixel_prediction creates the sub-pixel block described by block_desc for the 
+// block at (pixel_x, pixel_y). The output either aliases a sub-pixel plane or refers to
+// cache_block, and is bit-exact with create_subpixel_macroblock.
+void create_subpixel_prediction(evx_cache_bank *cache_bank, uint32 prediction_index, const evx_block_desc &block_desc, 
+                                int32 pixel_x, int32 pixel_y, macroblock *cache_block, macroblock *output);
+
+// Intra prediction only references pixels within the slice of the block (see evx_slice).
 int32 calculate_intra_prediction(const evx_frame &frame, const macroblock &src_block, int32 pixel_x, int32 pixel_y, 
-                                 evx_cache_bank *cache_bank, evx_block_desc *output_desc);
+                                 evx_cache_bank *cache_bank, evx_slice *slice, evx_block_desc *output_desc);
+
+// Motion predictors are the motion vectors of the neighboring blocks in the current frame
+// and of the co-located block in the previous frame. They seed the inter motion search.
+
+enum EVX_MOTION_PREDICTOR
+{
+    EVX_MOTION_PREDICTOR_LEFT = 0,
+    EVX_MOTION_PREDICTOR_TOP,
+    EVX_MOTION_PREDICTOR_TOP_RIGHT,
+    EVX_MOTION_PREDICTOR_COLOCATED,
+    EVX_MOTION_PREDICTOR_COUNT
+};
+
+typedef struct evx_motion_predictors
+{
+    bool valid[EVX_MOTION_PREDICTOR_COUNT];
+    int16 motion_x[EVX_MOTION_PREDICTOR_COUNT];
+    int16 motion_y[EVX_MOTION_PREDICTOR_COUNT];
+    uint8 prediction_target[EVX_MOTION_PREDICTOR_COUNT];
+
+} evx_motion_predictors;
+
+// gather_motion_predictors must be called before the block at (block_x, block_y) is 
+// classified, while its block table entry still describes the previous frame. Neighbors
+// outside of the slice are never used.
+void gather_motion_predictors(const evx_block_desc *block_table, uint32 width_in_blocks, const evx_slice &slice, 
+                              uint32 block_x, uint32 block_y, evx_motion_predictors *output);
+
+// query_motion_vector_prediction returns the prediction used to code the motion vector of
+// the block at index (see serialize_motion_vectors). This is the median of the left, top 
+// and top-right (or top-left) neighbors, or the left neighbor if it is the only one 
+// available. block_table must begin at the first row of the slice, so that neighbors in 
+// other slices are never used. Neighbors without motion contribute a zero vector.
+void query_motion_vector_prediction(const evx_block_desc *block_table, uint32 width_in_blocks, uint32 index, 
+                                    int16 *pred_x, int16 *pred_y);
 
 int32 calculate_inter_prediction(const evx_frame &frame, const macroblock &src_block, int32 pixel_x, int32 pixel_y, 
-                                 evx_cache_bank *cache_bank, uint16 pred_offset, evx_block_desc *output_desc);
+                                 evx_cache_bank *cache_bank, evx_slice *slice, uint16 pred_offset, 
+                                 const evx_motion_predictors &predictors, evx_block_desc *output_desc);
 
 } // namespace evx
 
@@ -2,11 +2,17 @@
 #include "quantize.h"
 #include "analysis.h"
 
+#if defined (EVX_SIMD_X86_SUPPORTED)
+#include "emmintrin.h"
+#include "immintrin.h"
+#endif
+
 // The quantizer scale factor enables us to adjust the scale of the 
 // quantization matrix. The default value is 16, which offers a reasonable
 // tradeoff between quality and efficiency for most content.
 
 #define EVX_QUANTIZER_SCALE_FACTOR                      (16)
+#define EVX_QUANTIZER_SCALE_SHIFT                       (4)         // log2 of the scale factor
 
 namespace evx {
 
@@ -56,12 +62,13 @@ int16 compute_chroma_dc_scale(int16 qp)
 
 // Adaptive quantization allows us to dynamically scale the quantization 
 // parameter based on the statistical characteristics of the incoming block.
+// The qp is selected from the variance of the transform coefficients, and is
+// non-decreasing with the variance.
 
-uint8 query_block_quantization_parameter(uint8 quality, const macroblock &src, EVX_BLOCK_TYPE block_type)
+static uint8 query_variance_quantization_parameter(uint8 quality, uint32 variance)
 {   
 #if EVX_QUANTIZATION_ENABLED
   #if EVX_ADAPTIVE_QUANTIZATION
-    uint32 variance = compute_block_variance2(src);
     uint8 index = clip_range(log2(variance) >> 1, 1, EVX_MAX_MPEG_QUANT_LEVELS - 1);
 
     if (index > quality) return clip_range(quality + ((index - quality) >> 1), 1, EVX_MAX_MPEG_QUANT_LEVELS - 1);
@@ -76,56 +83,745 @@ uint8 query_block_quantization_parameter(uint8 quality, const macroblock &src, E
 #endif
 }
 
-void quantize_luma_intra_block_8x8(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+uint8 query_block_quantization_parameter(uint8 quality, const macroblock &src, EVX_BLOCK_TYPE block_type)
+{   
+#if EVX_QUANTIZATION_ENABLED && EVX_ADAPTIVE_QUANTIZATION
+    return query_variance_quantization_parameter(quality, compute_block_variance2(src));
+#else
+    return query_variance_quantization_parameter(quality, 0);
+#endif
+}
+
+// Quantization tables are built for every qp that the encoder may select. Adaptive
+// quantization selects the qp per block, so the tables of a stream cannot be limited
+// to its quality setting.
+
+typedef struct evx_quantization_tables
 {
-    // Quantize our luminance values.
-    for (uint32 j = 0; j < 8; ++j)
-    for (uint32 k = 0; k < 8; ++k)
-    {   
-        int16 qm_value = default_intra_8x8_qm[k + j * 8];
-        int16 source_luma = source[k + j * source_stride];
+    evx_quantization_matrix intra;
+    evx_quantization_matrix inter;
+    uint32 luma_dc_multiplier;
+    uint32 chroma_dc_multiplier;
+    int32 luma_dc_bias;
+    int32 chroma_dc_bias;
+    int16 luma_dc_scale;
+    int16 chroma_dc_scale;
+    int16 zero_block_limits[16];
+
+} evx_quantization_tables;
+
+static evx_quantization_tables quantization_tables[EVX_MAX_MPEG_QUANT_LEVELS];
+
+// Returns ceil(2^32 / divisor). Numerators stay below 2^20 and divisors below 2^12, 
+// so the rounding error of the reciprocal never reaches the next integer quotient.
+
+static uint32 compute_reciprocal(uint32 divisor)
+{
+    if (!divisor)
+    {
+        return 0;
+    }
+
+    return (uint32) ((((uint64) 1 << 32) + divisor - 1) / divisor);
+}
+
+static void build_quantization_matrix(uint8 qp, const int16 *qm, bool intra, evx_quantization_matrix *matrix)
+{
+    for (uint32 i = 0; i < 64; ++i)
+    {
+        int32 divisor = (qp << 1) * qm[i];
 
+        // The rounding of both divisions folds into the bias. Inter blocks subtract
+        // qp from the intermediate value, which cancels the rounding of the second.
 #if EVX_ROUNDED_QUANTIZATION
-        dest[k + j * dest_stride] = rounded_div(rounded_div(source_luma * EVX_QUANTIZER_SCALE_FACTOR, qm_value), qp << 1);
+        matrix->bias[i] = (qm[i] >> 1) + (intra ? qp * qm[i] : 0);
 #else
-        dest[k + j * dest_stride] = ((source_luma * EVX_QUANTIZER_SCALE_FACTOR) / qm_value) / (qp << 1);
+        matrix->bias[i] = (intra ? 0 : -qp * qm[i]);
 #endif
+        matrix->multiplier[i] = compute_reciprocal(divisor);
+        matrix->scale[i] = divisor;
     }
+}
 
-    // For intra matrices we weight the dc coefficient separately.
-    int16 luma_dc_scale = compute_luma_dc_scale(qp);
-
+static void build_quantization_dc(int16 dc_scale, uint32 *multiplier, int32 *bias)
+{
+    // The dc is not weighted by the scale factor, so its divisor is scaled up instead.
 #if EVX_ROUNDED_QUANTIZATION
-    dest[0] = rounded_div(source[0], luma_dc_scale);
+    *bias = (dc_scale >> 1) * EVX_QUANTIZER_SCALE_FACTOR;
 #else
-    dest[0] = (source[0] / luma_dc_scale);
+    *bias = 0;
 #endif
+    *multiplier = compute_reciprocal(dc_scale * EVX_QUANTIZER_SCALE_FACTOR);
 }
 
-void quantize_chroma_intra_block_8x8(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+// Zero block detection
+//
+//   The 8 point dct is an orthogonal rotation of the walsh-hadamard transform (in its
+//   natural order) within each of four frequency bands: {0}, {4}, {2, 6} and {1, 3, 5, 7}.
+//   Every coefficient of an 8x8 dct is therefore bounded by the energy of the hadamard 
+//   coefficients of its pair of bands, which are computed with additions alone. 
+//
+//   The integer transforms differ from the exact dct D = C x C'. Each pass of either is 
+//   an exact integer matrix product A, followed by one rounding of at most r per output
+//   (0.5, plus 1/128 for the truncating divisions of transform_8x8_line_fast). The two
+//   passes thus compute A x A' + A e, with |e| <= r, and so every coefficient is within
+//
+//       max |A[v][j] A[u][k] - C[v][j] C[u][k]| * sad  +  r * (1 + max sum |A[v][j]|)
+//
+//   of the exact dct. For the 128 scaled table of transform_8x8 this is 0.00177 * sad 
+//   + 1.952, and for the fixed point factorization of transform_8x8_butterfly (with its
+//   scale of 2^11 and 2^18 per pass) it is 0.000027 * sad + 0.625. Blocks are checked
+//   with a margin of 2 + sad / 512 levels, which covers both.
+
+static const uint8 zero_block_dct_bands[8] = { 0, 3, 2, 3, 1, 3, 2, 3 };
+static const uint8 zero_block_hadamard_bands[8] = { 0, 3, 3, 1, 3, 2, 2, 3 };
+
+#define EVX_ZERO_BLOCK_ROUNDING_MARGIN                  (2)
+
+static void build_zero_block_limits(const evx_quantization_matrix &matrix, int16 *limits)
 {
-    // Quantize our luminance values.
+    for (uint32 i = 0; i < 16; ++i)
+    {
+        limits[i] = EVX_MAX_INT16;
+    }
+
     for (uint32 j = 0; j < 8; ++j)
     for (uint32 k = 0; k < 8; ++k)
-    {   
-        int16 qm_value = default_intra_8x8_qm[k + j * 8];
-        int16 source_chroma = source[k + j * source_stride];
+    {
+        uint32 index = k + j * 8;
+        uint32 band = zero_block_dct_bands[k] + zero_block_dct_bands[j] * 4;
 
-#if EVX_ROUNDED_QUANTIZATION
-        dest[k + j * dest_stride] = rounded_div(rounded_div(source_chroma * EVX_QUANTIZER_SCALE_FACTOR, qm_value), qp << 1);
-#else
-        dest[k + j * dest_stride] = ((source_chroma * EVX_QUANTIZER_SCALE_FACTOR) / qm_value) / (qp << 1);
+        // The largest coefficient that satisfies 16 * c + bias < divisor.
+        int32 level_limit = (matrix.scale[index] - matrix.bias[index] - 1) >> EVX_QUANTIZER_SCALE_SHIFT;
+        limits[band] = evx_min2(limits[band], level_limit);
+    }
+}
+
+static const evx_quantization_tables *build_quantization_tables()
+{
+    // A qp of zero is never selected by the encoder, and its tables quantize to zero.
+    for (uint32 qp = 0; qp < EVX_MAX_MPEG_QUANT_LEVELS; ++qp)
+    {
+        evx_quantization_tables *tables = &quantization_tables[qp];
+
+        build_quantization_matrix(qp, default_intra_8x8_qm, true, &tables->intra);
+        build_quantization_matrix(qp, default_inter_8x8_qm, false, &tables->inter);
+
+        tables->luma_dc_scale = compute_luma_dc_scale(qp);
+        tables->chroma_dc_scale = compute_chroma_dc_scale(qp);
+
+        build_quantization_dc(tables->luma_dc_scale, &tables->luma_dc_multiplier, &tables->luma_dc_bias);
+        build_quantization_dc(tables->chroma_dc_scale, &tables->chroma_dc_multiplier, &tables->chroma_dc_bias);
+
+        build_zero_block_limits(tables->inter, tables->zero_block_limits);
+    }
+
+    return quantization_tables;
+}
+
+static const evx_quantization_tables *query_all_quantization_tables()
+{
+    // Built once, on first use. Contexts may be created on any thread, and the 
+    // initialization of a local static is thread safe.
+    static const evx_quantization_tables *tables = build_quantization_tables();
+
+    return tables;
+}
+
+void initialize_quantization_tables()
+{
+    query_all_quantization_tables();
+}
+
+static const evx_quantization_tables &query_quantization_tables(uint8 qp)
+{
+    // Corrupt streams may carry any qp, which is clamped to the valid range.
+    return query_all_quantization_tables()[evx_min2(qp, EVX_MAX_MPEG_QUANT_LEVELS - 1)];
+}
+
+static inline int16 quantize_coefficient(int16 value, uint32 multiplier, int32 bias)
+{
+    int32 magnitude = (value < 0) ? -((int32) value) : value;
+    int32 numer = magnitude * EVX_QUANTIZER_SCALE_FACTOR + bias;
+
+#if !EVX_ROUNDED_QUANTIZATION
+    numer = evx_max2(numer, 0);
 #endif
+
+    int32 level = (int32) (((uint64) numer * multiplier) >> 32);
+
+    return (value < 0) ? -level : level;
+}
+
+static void quantize_block_8x8_scalar(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    for (uint32 j = 0; j < 8; ++j)
+    for (uint32 k = 0; k < 8; ++k)
+    {
+        uint32 index = k + j * 8;
+        dest[k + j * dest_stride] = quantize_coefficient(source[k + j * source_stride], matrix.multiplier[index], matrix.bias[index]);
     }
+}
 
-    // For intra matrices we weight the dc coefficient separately.
-    int16 chroma_dc_scale = compute_chroma_dc_scale(qp);
+// 16x16 luma blocks reuse the 8x8 matrices, upsampled such that each matrix entry 
+// covers the four coefficients of the corresponding frequency band.
 
-#if EVX_ROUNDED_QUANTIZATION
-    dest[0] = rounded_div(source[0], chroma_dc_scale);
-#else
-    dest[0] = (source[0] / chroma_dc_scale);
+static void quantize_block_16x16_scalar(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    for (uint32 j = 0; j < 16; ++j)
+    for (uint32 k = 0; k < 16; ++k)
+    {
+        uint32 index = (k >> 1) + (j >> 1) * 8;
+        dest[k + j * dest_stride] = quantize_coefficient(source[k + j * source_stride], matrix.multiplier[index], matrix.bias[index]);
+    }
+}
+
+static void inverse_quantize_block_8x8_scalar(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    for (uint32 j = 0; j < 8; ++j)
+    for (uint32 k = 0; k < 8; ++k)
+    {
+        dest[k + j * dest_stride] = (source[k + j * source_stride] * matrix.scale[k + j * 8]) / EVX_QUANTIZER_SCALE_FACTOR;
+    }
+}
+
+static void inverse_quantize_block_16x16_scalar(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    for (uint32 j = 0; j < 16; ++j)
+    for (uint32 k = 0; k < 16; ++k)
+    {
+        dest[k + j * dest_stride] = (source[k + j * source_stride] * matrix.scale[(k >> 1) + (j >> 1) * 8]) / EVX_QUANTIZER_SCALE_FACTOR;
+    }
+}
+
+// The zero block energies are the band energies of the hadamard transform of the 
+// difference between two 8x8 blocks (see build_zero_block_limits). The transform is not
+// normalized, so the energies are 64 times those of the dct. Returns the sad of the 
+// difference.
+
+static inline void compute_hadamard_8_scalar(int32 *data, uint32 stride)
+{
+    for (uint32 span = 1; span < 8; span <<= 1)
+    for (uint32 i = 0; i < 8; i += (span << 1))
+    for (uint32 k = i; k < i + span; ++k)
+    {
+        int32 a = data[k * stride];
+        int32 b = data[(k + span) * stride];
+
+        data[k * stride] = a + b;
+        data[(k + span) * stride] = a - b;
+    }
+}
+
+static int32 compute_zero_block_energies_scalar(const int16 *source, uint32 source_stride, const int16 *prediction, uint32 prediction_stride, int32 *energies)
+{
+    int32 block[64];
+    int32 sad = 0;
+
+    for (uint32 j = 0; j < 8; ++j)
+    {
+        for (uint32 i = 0; i < 8; ++i)
+        {
+            int32 delta = source[i + j * source_stride] - prediction[i + j * prediction_stride];
+
+            block[i + j * 8] = delta;
+            sad += (delta < 0 ? -delta : delta);
+        }
+
+        compute_hadamard_8_scalar(block + j * 8, 1);
+    }
+
+    for (uint32 i = 0; i < 8; ++i)
+    {
+        compute_hadamard_8_scalar(block + i, 8);
+    }
+
+    for (uint32 i = 0; i < 16; ++i)
+    {
+        energies[i] = 0;
+    }
+
+    for (uint32 j = 0; j < 8; ++j)
+    for (uint32 k = 0; k < 8; ++k)
+    {
+        int32 value = block[k + j * 8];
+        energies[zero_block_hadamard_bands[k] + zero_block_hadamard_bands[j] * 4] += value * value;
+    }
+
+    return sad;
+}
+
+#if defined (EVX_SIMD_X86_SUPPORTED)
+
+// The vector quantizers widen the coefficient magnitudes to 32 bits and keep the high 
+// half of the 64 bit products with the reciprocals. Quantized levels never exceed 32768
+// and dequantized values are truncated to 16 bits, so both are packed by wrapping.
+
+static EVX_TARGET_SSE2 inline __m128i wrap_pack_epi32_sse2(__m128i lo, __m128i hi)
+{
+    lo = _mm_srai_epi32(_mm_slli_epi32(lo, 16), 16);
+    hi = _mm_srai_epi32(_mm_slli_epi32(hi, 16), 16);
+    return _mm_packs_epi32(lo, hi);
+}
+
+static EVX_TARGET_SSE2 inline __m128i quantize_magnitude_sse2(__m128i magnitude, __m128i multiplier, __m128i bias)
+{
+    __m128i numer = _mm_add_epi32(_mm_slli_epi32(magnitude, EVX_QUANTIZER_SCALE_SHIFT), bias);
+
+#if !EVX_ROUNDED_QUANTIZATION
+    numer = _mm_andnot_si128(_mm_srai_epi32(numer, 31), numer);
 #endif
+
+    __m128i even = _mm_mul_epu32(numer, multiplier);
+    __m128i odd = _mm_mul_epu32(_mm_srli_epi64(numer, 32), _mm_srli_epi64(multiplier, 32));
+
+    return _mm_unpacklo_epi32(_mm_shuffle_epi32(even, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_epi32(odd, _MM_SHUFFLE(3, 1, 3, 1)));
+}
+
+static EVX_TARGET_SSE2 inline __m128i quantize_row_sse2(__m128i values, __m128i multiplier_lo, __m128i bias_lo, __m128i multiplier_hi, __m128i bias_hi)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i sign = _mm_srai_epi16(values, 15);
+    __m128i magnitude = _mm_sub_epi16(_mm_xor_si128(values, sign), sign);
+
+    __m128i lo = quantize_magnitude_sse2(_mm_unpacklo_epi16(magnitude, zero), multiplier_lo, bias_lo);
+    __m128i hi = quantize_magnitude_sse2(_mm_unpackhi_epi16(magnitude, zero), multiplier_hi, bias_hi);
+    __m128i levels = wrap_pack_epi32_sse2(lo, hi);
+
+    return _mm_sub_epi16(_mm_xor_si128(levels, sign), sign);
+}
+
+static EVX_TARGET_SSE2 inline __m128i inverse_quantize_row_sse2(__m128i values, __m128i scale)
+{
+    __m128i product_lo = _mm_mullo_epi16(values, scale);
+    __m128i product_hi = _mm_mulhi_epi16(values, scale);
+    __m128i lo = _mm_unpacklo_epi16(product_lo, product_hi);
+    __m128i hi = _mm_unpackhi_epi16(product_lo, product_hi);
+
+    // Truncating division by the scale factor.
+    lo = _mm_add_epi32(lo, _mm_srli_epi32(_mm_srai_epi32(lo, 31), 32 - EVX_QUANTIZER_SCALE_SHIFT));
+    hi = _mm_add_epi32(hi, _mm_srli_epi32(_mm_srai_epi32(hi, 31), 32 - EVX_QUANTIZER_SCALE_SHIFT));
+
+    return wrap_pack_epi32_sse2(_mm_srai_epi32(lo, EVX_QUANTIZER_SCALE_SHIFT), _mm_srai_epi32(hi, EVX_QUANTIZER_SCALE_SHIFT));
+}
+
+static EVX_TARGET_SSE2 void quantize_block_8x8_sse2(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    for (uint32 j = 0; j < 8; ++j)
+    {
+        const __m128i *multiplier = (const __m128i *) (matrix.multiplier + j * 8);
+        const __m128i *bias = (const __m128i *) (matrix.bias + j * 8);
+        __m128i values = _mm_loadu_si128((const __m128i *) (source + j * source_stride));
+
+        values = quantize_row_sse2(values, _mm_loadu_si128(multiplier), _mm_loadu_si128(bias), 
+                                           _mm_loadu_si128(multiplier + 1), _mm_loadu_si128(bias + 1));
+
+        _mm_storeu_si128((__m128i *) (dest + j * dest_stride), values);
+    }
+}
+
+static EVX_TARGET_SSE2 void quantize_block_16x16_sse2(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    for (uint32 j = 0; j < 16; ++j)
+    {
+        const __m128i *multiplier = (const __m128i *) (matrix.multiplier + (j >> 1) * 8);
+        const __m128i *bias = (const __m128i *) (matrix.bias + (j >> 1) * 8);
+        __m128i *dest_row = (__m128i *) (dest + j * dest_stride);
+        const __m128i *source_row = (const __m128i *) (source + j * source_stride);
+
+        // Each matrix entry is duplicated across its frequency band.
+        for (uint32 k = 0; k < 2; ++k)
+        {
+            __m128i row_multiplier = _mm_loadu_si128(multiplier + k);
+            __m128i row_bias = _mm_loadu_si128(bias + k);
+            __m128i values = quantize_row_sse2(_mm_loadu_si128(source_row + k), 
+                                               _mm_unpacklo_epi32(row_multiplier, row_multiplier), _mm_unpacklo_epi32(row_bias, row_bias),
+                                               _mm_unpackhi_epi32(row_multiplier, row_multiplier), _mm_unpackhi_epi32(row_bias, row_bias));
+
+            _mm_storeu_si128(dest_row + k, values);
+        }
+    }
+}
+
+static EVX_TARGET_SSE2 void inverse_quantize_block_8x8_sse2(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    for (uint32 j = 0; j < 8; ++j)
+    {
+        __m128i scale = _mm_loadu_si128((const __m128i *) (matrix.scale + j * 8));
+        __m128i values = _mm_loadu_si128((const __m128i *) (source + j * source_stride));
+        _mm_storeu_si128((__m128i *) (dest + j * dest_stride), inverse_quantize_row_sse2(values, scale));
+    }
+}
+
+static EVX_TARGET_SSE2 void inverse_quantize_block_16x16_sse2(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    for (uint32 j = 0; j < 16; ++j)
+    {
+        __m128i scale = _mm_loadu_si128((const __m128i *) (matrix.scale + (j >> 1) * 8));
+        const __m128i *source_row = (const __m128i *) (source + j * source_stride);
+        __m128i *dest_row = (__m128i *) (dest + j * dest_stride);
+
+        _mm_storeu_si128(dest_row, inverse_quantize_row_sse2(_mm_loadu_si128(source_row), _mm_unpacklo_epi16(scale, scale)));
+        _mm_storeu_si128(dest_row + 1, inverse_quantize_row_sse2(_mm_loadu_si128(source_row + 1), _mm_unpackhi_epi16(scale, scale)));
+    }
+}
+
+// The hadamard transform of a difference of 8 bit samples stays within 16 bits, so the
+// vector version transforms eight rows at a time, transposing the block between passes.
+
+static EVX_TARGET_SSE2 inline void hadamard_butterfly_sse2(__m128i *a, __m128i *b)
+{
+    __m128i sum = _mm_add_epi16(*a, *b);
+    *b = _mm_sub_epi16(*a, *b);
+    *a = sum;
+}
+
+static EVX_TARGET_SSE2 inline void compute_hadamard_8_sse2(__m128i *rows)
+{
+    hadamard_butterfly_sse2(&rows[0], &rows[1]);
+    hadamard_butterfly_sse2(&rows[2], &rows[3]);
+    hadamard_butterfly_sse2(&rows[4], &rows[5]);
+    hadamard_butterfly_sse2(&rows[6], &rows[7]);
+
+    hadamard_butterfly_sse2(&rows[0], &rows[2]);
+    hadamard_butterfly_sse2(&rows[1], &rows[3]);
+    hadamard_butterfly_sse2(&rows[4], &rows[6]);
+    hadamard_butterfly_sse2(&rows[5], &rows[7]);
+
+    hadamard_butterfly_sse2(&rows[0], &rows[4]);
+    hadamard_butterfly_sse2(&rows[1], &rows[5]);
+    hadamard_butterfly_sse2(&rows[2], &rows[6]);
+    hadamard_butterfly_sse2(&rows[3], &rows[7]);
+}
+
+static EVX_TARGET_SSE2 inline void transpose_4x4_epi32_sse2(__m128i *rows)
+{
+    __m128i t0 = _mm_unpacklo_epi32(rows[0], rows[1]);
+    __m128i t1 = _mm_unpackhi_epi32(rows[0], rows[1]);
+    __m128i t2 = _mm_unpacklo_epi32(rows[2], rows[3]);
+    __m128i t3 = _mm_unpackhi_epi32(rows[2], rows[3]);
+
+    rows[0] = _mm_unpacklo_epi64(t0, t2);
+    rows[1] = _mm_unpackhi_epi64(t0, t2);
+    rows[2] = _mm_unpacklo_epi64(t1, t3);
+    rows[3] = _mm_unpackhi_epi64(t1, t3);
+}
+
+static EVX_TARGET_SSE2 inline void transpose_8x8_epi16_sse2(__m128i *rows)
+{
+    __m128i a0 = _mm_unpacklo_epi16(rows[0], rows[1]);
+    __m128i a1 = _mm_unpackhi_epi16(rows[0], rows[1]);
+    __m128i a2 = _mm_unpacklo_epi16(rows[2], rows[3]);
+    __m128i a3 = _mm_unpackhi_epi16(rows[2], rows[3]);
+    __m128i a4 = _mm_unpacklo_epi16(rows[4], rows[5]);
+    __m128i a5 = _mm_unpackhi_epi16(rows[4], rows[5]);
+    __m128i a6 = _mm_unpacklo_epi16(rows[6], rows[7]);
+    __m128i a7 = _mm_unpackhi_epi16(rows[6], rows[7]);
+
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    rows[0] = _mm_unpacklo_epi64(b0, b4);
+    rows[1] = _mm_unpackhi_epi64(b0, b4);
+    rows[2] = _mm_unpacklo_epi64(b1, b5);
+    rows[3] = _mm_unpackhi_epi64(b1, b5);
+    rows[4] = _mm_unpacklo_epi64(b2, b6);
+    rows[5] = _mm_unpackhi_epi64(b2, b6);
+    rows[6] = _mm_unpacklo_epi64(b3, b7);
+    rows[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+static EVX_TARGET_SSE2 inline void accumulate_squares_sse2(__m128i value, __m128i *lo, __m128i *hi)
+{
+    __m128i square_lo = _mm_mullo_epi16(value, value);
+    __m128i square_hi = _mm_mulhi_epi16(value, value);
+
+    *lo = _mm_add_epi32(*lo, _mm_unpacklo_epi16(square_lo, square_hi));
+    *hi = _mm_add_epi32(*hi, _mm_unpackhi_epi16(square_lo, square_hi));
+}
+
+static EVX_TARGET_SSE2 int32 compute_zero_block_energies_sse2(const int16 *source, uint32 source_stride, const int16 *prediction, uint32 prediction_stride, int32 *energies)
+{
+    __m128i rows[8];
+    __m128i ones = _mm_set1_epi16(1);
+    __m128i sad = _mm_setzero_si128();
+
+    for (uint32 j = 0; j < 8; ++j)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i *) (source + j * source_stride));
+        __m128i b = _mm_loadu_si128((const __m128i *) (prediction + j * prediction_stride));
+        __m128i d = _mm_sub_epi16(_mm_max_epi16(a, b), _mm_min_epi16(a, b));
+
+        rows[j] = _mm_sub_epi16(a, b);
+        sad = _mm_add_epi32(sad, _mm_madd_epi16(d, ones));
+    }
+
+    // The rows are reordered by band as they are transposed, after which each row holds
+    // one horizontal frequency, over the vertical ones of the bands {0}, {3}, {5, 6} and
+    // {1, 2, 4, 7}, in that order.
+    compute_hadamard_8_sse2(rows);
+
+    __m128i bands[8] = { rows[0], rows[3], rows[5], rows[6], rows[1], rows[2], rows[4], rows[7] };
+
+    transpose_8x8_epi16_sse2(bands);
+    compute_hadamard_8_sse2(bands);
+
+    __m128i lo[4];
+    __m128i hi[4];
+
+    for (uint32 k = 0; k < 4; ++k)
+    {
+        lo[k] = _mm_setzero_si128();
+        hi[k] = _mm_setzero_si128();
+    }
+
+    // The horizontal frequencies are accumulated by band, as in zero_block_hadamard_bands.
+    accumulate_squares_sse2(bands[0], &lo[0], &hi[0]);
+    accumulate_squares_sse2(bands[1], &lo[3], &hi[3]);
+    accumulate_squares_sse2(bands[2], &lo[3], &hi[3]);
+    accumulate_squares_sse2(bands[3], &lo[1], &hi[1]);
+    accumulate_squares_sse2(bands[4], &lo[3], &hi[3]);
+    accumulate_squares_sse2(bands[5], &lo[2], &hi[2]);
+    accumulate_squares_sse2(bands[6], &lo[2], &hi[2]);
+    accumulate_squares_sse2(bands[7], &lo[3], &hi[3]);
+
+    // Each transposed row then holds one vertical band, over the horizontal ones.
+    transpose_4x4_epi32_sse2(lo);
+    transpose_4x4_epi32_sse2(hi);
+
+    _mm_storeu_si128((__m128i *) (energies + 0), lo[0]);
+    _mm_storeu_si128((__m128i *) (energies + 4), lo[1]);
+    _mm_storeu_si128((__m128i *) (energies + 8), _mm_add_epi32(lo[2], lo[3]));
+    _mm_storeu_si128((__m128i *) (energies + 12), _mm_add_epi32(_mm_add_epi32(hi[0], hi[1]), _mm_add_epi32(hi[2], hi[3])));
+
+    sad = _mm_add_epi32(sad, _mm_shuffle_epi32(sad, _MM_SHUFFLE(1, 0, 3, 2)));
+    sad = _mm_add_epi32(sad, _mm_shuffle_epi32(sad, _MM_SHUFFLE(2, 3, 0, 1)));
+
+    return _mm_cvtsi128_si32(sad);
+}
+
+static EVX_TARGET_AVX2 inline __m256i quantize_magnitude_avx2(__m256i magnitude, __m256i multiplier, __m256i bias)
+{
+    __m256i numer = _mm256_add_epi32(_mm256_slli_epi32(magnitude, EVX_QUANTIZER_SCALE_SHIFT), bias);
+
+#if !EVX_ROUNDED_QUANTIZATION
+    numer = _mm256_andnot_si256(_mm256_srai_epi32(numer, 31), numer);
+#endif
+
+    __m256i even = _mm256_mul_epu32(numer, multiplier);
+    __m256i odd = _mm256_mul_epu32(_mm256_srli_epi64(numer, 32), _mm256_srli_epi64(multiplier, 32));
+
+    return _mm256_blend_epi32(_mm256_srli_epi64(even, 32), odd, 0xAA);
+}
+
+// Quantizes 16 coefficients against the multipliers and biases of the low and high 8.
+
+static EVX_TARGET_AVX2 inline __m256i quantize_row_avx2(__m256i values, __m256i multiplier_lo, __m256i bias_lo, __m256i multiplier_hi, __m256i bias_hi)
+{
+    __m256i sign = _mm256_srai_epi16(values, 15);
+    __m256i magnitude = _mm256_sub_epi16(_mm256_xor_si256(values, sign), sign);
+
+    __m256i lo = quantize_magnitude_avx2(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(magnitude)), multiplier_lo, bias_lo);
+    __m256i hi = quantize_magnitude_avx2(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(magnitude, 1)), multiplier_hi, bias_hi);
+    __m256i levels = _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+
+    return _mm256_sub_epi16(_mm256_xor_si256(levels, sign), sign);
+}
+
+static EVX_TARGET_AVX2 inline __m256i inverse_quantize_row_avx2(__m256i values, __m256i scale)
+{
+    __m256i product_lo = _mm256_mullo_epi16(values, scale);
+    __m256i product_hi = _mm256_mulhi_epi16(values, scale);
+    __m256i lo = _mm256_unpacklo_epi16(product_lo, product_hi);
+    __m256i hi = _mm256_unpackhi_epi16(product_lo, product_hi);
+
+    lo = _mm256_add_epi32(lo, _mm256_srli_epi32(_mm256_srai_epi32(lo, 31), 32 - EVX_QUANTIZER_SCALE_SHIFT));
+    hi = _mm256_add_epi32(hi, _mm256_srli_epi32(_mm256_srai_epi32(hi, 31), 32 - EVX_QUANTIZER_SCALE_SHIFT));
+    lo = _mm256_srai_epi32(_mm256_slli_epi32(_mm256_srai_epi32(lo, EVX_QUANTIZER_SCALE_SHIFT), 16), 16);
+    hi = _mm256_srai_epi32(_mm256_slli_epi32(_mm256_srai_epi32(hi, EVX_QUANTIZER_SCALE_SHIFT), 16), 16);
+
+    // The unpacks and the pack are both lane local, so the coefficient order is preserved.
+    return _mm256_packs_epi32(lo, hi);
+}
+
+static EVX_TARGET_AVX2 inline __m256i load_row_pair_avx2(int16 *source, int32 source_stride)
+{
+    __m128i first = _mm_loadu_si128((const __m128i *) source);
+    __m128i second = _mm_loadu_si128((const __m128i *) (source + source_stride));
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(first), second, 1);
+}
+
+static EVX_TARGET_AVX2 inline void store_row_pair_avx2(__m256i values, int16 *dest, int32 dest_stride)
+{
+    _mm_storeu_si128((__m128i *) dest, _mm256_castsi256_si128(values));
+    _mm_storeu_si128((__m128i *) (dest + dest_stride), _mm256_extracti128_si256(values, 1));
+}
+
+static EVX_TARGET_AVX2 void quantize_block_8x8_avx2(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    for (uint32 j = 0; j < 8; j += 2)
+    {
+        const __m256i *multiplier = (const __m256i *) (matrix.multiplier + j * 8);
+        const __m256i *bias = (const __m256i *) (matrix.bias + j * 8);
+        __m256i values = load_row_pair_avx2(source + j * source_stride, source_stride);
+
+        values = quantize_row_avx2(values, _mm256_loadu_si256(multiplier), _mm256_loadu_si256(bias), 
+                                           _mm256_loadu_si256(multiplier + 1), _mm256_loadu_si256(bias + 1));
+
+        store_row_pair_avx2(values, dest + j * dest_stride, dest_stride);
+    }
+}
+
+static EVX_TARGET_AVX2 void quantize_block_16x16_avx2(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    __m256i band_lo = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+    __m256i band_hi = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+
+    for (uint32 j = 0; j < 16; j += 2)
+    {
+        __m256i row_multiplier = _mm256_loadu_si256((const __m256i *) (matrix.multiplier + (j >> 1) * 8));
+        __m256i row_bias = _mm256_loadu_si256((const __m256i *) (matrix.bias + (j >> 1) * 8));
+        __m256i multiplier_lo = _mm256_permutevar8x32_epi32(row_multiplier, band_lo);
+        __m256i multiplier_hi = _mm256_permutevar8x32_epi32(row_multiplier, band_hi);
+        __m256i bias_lo = _mm256_permutevar8x32_epi32(row_bias, band_lo);
+        __m256i bias_hi = _mm256_permutevar8x32_epi32(row_bias, band_hi);
+
+        // Both rows of a frequency band share the same matrix row.
+        for (uint32 i = j; i < j + 2; ++i)
+        {
+            __m256i values = _mm256_loadu_si256((const __m256i *) (source + i * source_stride));
+            values = quantize_row_avx2(values, multiplier_lo, bias_lo, multiplier_hi, bias_hi);
+            _mm256_storeu_si256((__m256i *) (dest + i * dest_stride), values);
+        }
+    }
+}
+
+static EVX_TARGET_AVX2 void inverse_quantize_block_8x8_avx2(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    for (uint32 j = 0; j < 8; j += 2)
+    {
+        __m256i scale = _mm256_loadu_si256((const __m256i *) (matrix.scale + j * 8));
+        __m256i values = load_row_pair_avx2(source + j * source_stride, source_stride);
+        store_row_pair_avx2(inverse_quantize_row_avx2(values, scale), dest + j * dest_stride, dest_stride);
+    }
+}
+
+static EVX_TARGET_AVX2 void inverse_quantize_block_16x16_avx2(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    for (uint32 j = 0; j < 16; j += 2)
+    {
+        __m128i row_scale = _mm_loadu_si128((const __m128i *) (matrix.scale + (j >> 1) * 8));
+        __m256i scale = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi16(row_scale, row_scale)), 
+                                                _mm_unpackhi_epi16(row_scale, row_scale), 1);
+
+        for (uint32 i = j; i < j + 2; ++i)
+        {
+            __m256i values = _mm256_loadu_si256((const __m256i *) (source + i * source_stride));
+            _mm256_storeu_si256((__m256i *) (dest + i * dest_stride), inverse_quantize_row_avx2(values, scale));
+        }
+    }
+}
+
+#endif // EVX_SIMD_X86_SUPPORTED
+
+static const evx_quantize_kernels scalar_quantize_kernels = 
+{
+    quantize_block_8x8_scalar,
+    quantize_block_16x16_scalar,
+    inverse_quantize_block_8x8_scalar,
+    inverse_quantize_block_16x16_scalar,
+    compute_zero_block_energies_scalar,
+    EVX_SIMD_SCALAR,
+};
+
+#if defined (EVX_SIMD_X86_SUPPORTED)
+
+static const evx_quantize_kernels sse2_quantize_kernels = 
+{
+    quantize_block_8x8_sse2,
+    quantize_block_16x16_sse2,
+    inverse_quantize_block_8x8_sse2,
+    inverse_quantize_block_16x16_sse2,
+    compute_zero_block_energies_sse2,
+    EVX_SIMD_SSE2,
+};
+
+static const evx_quantize_kernels avx2_quantize_kernels = 
+{
+    quantize_block_8x8_avx2,
+    quantize_block_16x16_avx2,
+    inverse_quantize_block_8x8_avx2,
+    inverse_quantize_block_16x16_avx2,
+    compute_zero_block_energies_sse2,
+    EVX_SIMD_AVX2,
+};
+
+#endif
+
+static const evx_quantize_kernels *active_quantize_kernels = NULL;
+
+static const evx_quantize_kernels *query_quantize_kernels_by_level(EVX_SIMD_LEVEL level)
+{
+    switch (level)
+    {
+#if defined (EVX_SIMD_X86_SUPPORTED)
+        case EVX_SIMD_AVX2: return &avx2_quantize_kernels;
+        case EVX_SIMD_SSE41:
+        case EVX_SIMD_SSE2: return &sse2_quantize_kernels;
+#endif
+        default: break;
+    };
+
+    return &scalar_quantize_kernels;
+}
+
+const evx_quantize_kernels &query_quantize_kernels()
+{
+    // The default kernels are selected once, on first use, by a thread safe local static.
+    // active_quantize_kernels only holds an override from select_quantize_kernels.
+    static const evx_quantize_kernels *default_kernels = query_quantize_kernels_by_level(query_simd_level());
+
+    return active_quantize_kernels ? *active_quantize_kernels : *default_kernels;
+}
+
+evx_status select_quantize_kernels(EVX_SIMD_LEVEL level)
+{
+    if (level > query_simd_level())
+    {
+        return evx_post_error(EVX_ERROR_NOTIMPL);
+    }
+
+    active_quantize_kernels = query_quantize_kernels_by_level(level);
+
+    return EVX_SUCCESS;
+}
+
+void quantize_luma_intra_block_8x8(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    const evx_quantization_tables &tables = query_quantization_tables(qp);
+
+    // Quantize our luminance values.
+    query_quantize_kernels().quantize_8x8(tables.intra, source, source_stride, dest, dest_stride);
+
+    // For intra matrices we weight the dc coefficient separately.
+    dest[0] = quantize_coefficient(source[0], tables.luma_dc_multiplier, tables.luma_dc_bias);
+}
+
+void quantize_chroma_intra_block_8x8(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    const evx_quantization_tables &tables = query_quantization_tables(qp);
+
+    // Quantize our chrominance values.
+    query_quantize_kernels().quantize_8x8(tables.intra, source, source_stride, dest, dest_stride);
+
+    // For intra matrices we weight the dc coefficient separately.
+    dest[0] = quantize_coefficient(source[0], tables.chroma_dc_multiplier, tables.chroma_dc_bias);
 }
 
 void quantize_intra_block_linear_8x8(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
@@ -146,20 +842,7 @@ void quantize_intra_block_linear_8x8(uint8 qp, int16 *source, int32 source_strid
 void quantize_inter_block_8x8(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
 {
     // Quantize our inter values.
-    for (uint32 j = 0; j < 8; ++j)
-    for (uint32 k = 0; k < 8; ++k)
-    {   
-        int16 qm_value = default_inter_8x8_qm[k + j * 8];
-        int16 source_value = source[k + j * source_stride];
-
-#if EVX_ROUNDED_QUANTIZATION
-        int16 qfactor = rounded_div(source_value * EVX_QUANTIZER_SCALE_FACTOR, qm_value);
-        dest[k + j * dest_stride] = rounded_div(qfactor - sign(qfactor) * qp, qp << 1);
-#else
-        int16 qfactor = (source_value * EVX_QUANTIZER_SCALE_FACTOR) / qm_value;
-        dest[k + j * dest_stride] = (qfactor - sign(qfactor) * qp) / (qp << 1);
-#endif
-    }
+    query_quantize_kernels().quantize_8x8(query_quantization_tables(qp).inter, source, source_stride, dest, dest_stride);
 }
 
 void quantize_inter_block_linear_8x8(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
@@ -179,36 +862,39 @@ void quantize_inter_block_linear_8x8(uint8 qp, int16 *source, int32 source_strid
     }
 }
 
+void quantize_luma_intra_block_16x16(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    const evx_quantization_tables &tables = query_quantization_tables(qp);
+
+    query_quantize_kernels().quantize_16x16(tables.intra, source, source_stride, dest, dest_stride);
+    dest[0] = quantize_coefficient(source[0], tables.luma_dc_multiplier, tables.luma_dc_bias);
+}
+
+void quantize_inter_block_16x16(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    query_quantize_kernels().quantize_16x16(query_quantization_tables(qp).inter, source, source_stride, dest, dest_stride);
+}
+
 void inverse_quantize_luma_intra_block_8x8(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
 {
+    const evx_quantization_tables &tables = query_quantization_tables(qp);
+
     // Inverse quantize our luminance values.
-    for (uint32 j = 0; j < 8; ++j)
-    for (uint32 k = 0; k < 8; ++k)
-    {   
-        int16 qm_value = default_intra_8x8_qm[k + j * 8];
-        int16 source_luma = source[k + j * source_stride];
-        dest[k + j * dest_stride] = (2 * source_luma * qm_value * qp) / EVX_QUANTIZER_SCALE_FACTOR;
-    }
+    query_quantize_kernels().inverse_quantize_8x8(tables.intra, source, source_stride, dest, dest_stride);
 
     // For intra matrices we weight the dc coefficient separately.
-    int16 luma_dc_scale = compute_luma_dc_scale(qp);
-    dest[0] = source[0] * luma_dc_scale;
+    dest[0] = source[0] * tables.luma_dc_scale;
 }
 
 void inverse_quantize_chroma_intra_block_8x8(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
 {
+    const evx_quantization_tables &tables = query_quantization_tables(qp);
+
     // Inverse quantize our chrominance values.
-    for (uint32 j = 0; j < 8; ++j)
-    for (uint32 k = 0; k < 8; ++k)
-    {   
-        int16 qm_value = default_intra_8x8_qm[k + j * 8];
-        int16 source_chroma = source[k + j * source_stride];
-        dest[k + j * dest_stride] = (2 * source_chroma * qm_value * qp) / EVX_QUANTIZER_SCALE_FACTOR;
-    }
+    query_quantize_kernels().inverse_quantize_8x8(tables.intra, source, source_stride, dest, dest_stride);
 
     // For intra matrices we weight the dc coefficient separately.
-    int16 chroma_dc_scale = compute_chroma_dc_scale(qp);
-    dest[0] = source[0] * chroma_dc_scale;
+    dest[0] = source[0] * tables.chroma_dc_scale;
 }
 
 void inverse_quantize_block_linear_8x8(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
@@ -233,13 +919,7 @@ void inverse_quantize_block_linear_8x8(uint8 qp, int16 *source, int32 source_str
 void inverse_quantize_inter_block_8x8(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
 {
     // Inverse quantize our inter values.
-    for (uint32 j = 0; j < 8; ++j)
-    for (uint32 k = 0; k < 8; ++k)
-    {   
-        int16 qm_value = default_inter_8x8_qm[k + j * 8];
-        int16 source_value = source[k + j * source_stride];
-        dest[k + j * dest_stride] = ((2 * source_value) * qm_value * qp) / EVX_QUANTIZER_SCALE_FACTOR; 
-    }
+    query_quantize_kernels().inverse_quantize_8x8(query_quantization_tables(qp).inter, source, source_stride, dest, dest_stride);
 }
 
 void inverse_quantize_block_flat_8x8(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
@@ -253,6 +933,19 @@ void inverse_quantize_block_flat_8x8(uint8 qp, int16 *source, int32 source_strid
     }
 }
 
+void inverse_quantize_luma_intra_block_16x16(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    const evx_quantization_tables &tables = query_quantization_tables(qp);
+
+    query_quantize_kernels().inverse_quantize_16x16(tables.intra, source, source_stride, dest, dest_stride);
+    dest[0] = source[0] * tables.luma_dc_scale;
+}
+
+void inverse_quantize_inter_block_16x16(uint8 qp, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride)
+{
+    query_quantize_kernels().inverse_quantize_16x16(query_quantization_tables(qp).inter, source, source_stride, dest, dest_stride);
+}
+
 void quantize_intra_macroblock(uint8 qp, const macroblock &source, macroblock *dest)
 {
 #if EVX_ENABLE_LINEAR_QUANTIZATION
@@ -303,53 +996,69 @@ void quantize_inter_macroblock(uint8 qp, const macroblock &source, macroblock *d
 #endif
 }   
 
-void inverse_quantize_intra_macroblock(uint8 qp, const macroblock &source, macroblock *dest)
+void inverse_quantize_intra_macroblock(uint8 qp, uint8 coded_pattern, const macroblock &source, macroblock *dest)
 {
 #if EVX_ENABLE_LINEAR_QUANTIZATION
-    // Luminance blocks.
-    inverse_quantize_block_linear_8x8(qp, source.data_y, source.stride, dest->data_y, dest->stride);
-    inverse_quantize_block_linear_8x8(qp, source.data_y + 8, source.stride, dest->data_y + 8, dest->stride);
-    inverse_quantize_block_linear_8x8(qp, source.data_y + 8 * source.stride, source.stride, dest->data_y + 8 * dest->stride, dest->stride);
-    inverse_quantize_block_linear_8x8(qp, source.data_y + 8 * source.stride + 8, source.stride, dest->data_y + 8 * dest->stride + 8, dest->stride);
+    // Luminance blocks. The linear quantizer is position invariant, so 16x16 blocks are
+    // processed as their quadrants.
+    if (coded_pattern & 0x01) inverse_quantize_block_linear_8x8(qp, source.data_y, source.stride, dest->data_y, dest->stride);
+    if (coded_pattern & 0x02) inverse_quantize_block_linear_8x8(qp, source.data_y + 8, source.stride, dest->data_y + 8, dest->stride);
+    if (coded_pattern & 0x04) inverse_quantize_block_linear_8x8(qp, source.data_y + 8 * source.stride, source.stride, dest->data_y + 8 * dest->stride, dest->stride);
+    if (coded_pattern & 0x08) inverse_quantize_block_linear_8x8(qp, source.data_y + 8 * source.stride + 8, source.stride, dest->data_y + 8 * dest->stride + 8, dest->stride);
 
     // Chroma blocks.
-    inverse_quantize_block_linear_8x8(qp, source.data_u, source.stride >> 1, dest->data_u, dest->stride >> 1);
-    inverse_quantize_block_linear_8x8(qp, source.data_v, source.stride >> 1, dest->data_v, dest->stride >> 1);
+    if (coded_pattern & EVX_CODED_PATTERN_U) inverse_quantize_block_linear_8x8(qp, source.data_u, source.stride >> 1, dest->data_u, dest->stride >> 1);
+    if (coded_pattern & EVX_CODED_PATTERN_V) inverse_quantize_block_linear_8x8(qp, source.data_v, source.stride >> 1, dest->data_v, dest->stride >> 1);
 #else
     // Luminance blocks.
-    inverse_quantize_luma_intra_block_8x8(qp, source.data_y, source.stride, dest->data_y, dest->stride);
-    inverse_quantize_luma_intra_block_8x8(qp, source.data_y + 8, source.stride, dest->data_y + 8, dest->stride);
-    inverse_quantize_luma_intra_block_8x8(qp, source.data_y + 8 * source.stride, source.stride, dest->data_y + 8 * dest->stride, dest->stride);
-    inverse_quantize_luma_intra_block_8x8(qp, source.data_y + 8 * source.stride + 8, source.stride, dest->data_y + 8 * dest->stride + 8, dest->stride);
+    if (coded_pattern & EVX_CODED_PATTERN_LUMA_16x16)
+    {
+        inverse_quantize_luma_intra_block_16x16(qp, source.data_y, source.stride, dest->data_y, dest->stride);
+    }
+    else
+    {
+        if (coded_pattern & 0x01) inverse_quantize_luma_intra_block_8x8(qp, source.data_y, source.stride, dest->data_y, dest->stride);
+        if (coded_pattern & 0x02) inverse_quantize_luma_intra_block_8x8(qp, source.data_y + 8, source.stride, dest->data_y + 8, dest->stride);
+        if (coded_pattern & 0x04) inverse_quantize_luma_intra_block_8x8(qp, source.data_y + 8 * source.stride, source.stride, dest->data_y + 8 * dest->stride, dest->stride);
+        if (coded_pattern & 0x08) inverse_quantize_luma_intra_block_8x8(qp, source.data_y + 8 * source.stride + 8, source.stride, dest->data_y + 8 * dest->stride + 8, dest->stride);
+    }
 
     // Chroma blocks.
-    inverse_quantize_chroma_intra_block_8x8(qp, source.data_u, source.stride >> 1, dest->data_u, dest->stride >> 1);
-    inverse_quantize_chroma_intra_block_8x8(qp, source.data_v, source.stride >> 1, dest->data_v, dest->stride >> 1);
+    if (coded_pattern & EVX_CODED_PATTERN_U) inverse_quantize_chroma_intra_block_8x8(qp, source.data_u, source.stride >> 1, dest->data_u, dest->stride >> 1);
+    if (coded_pattern & EVX_CODED_PATTERN_V) inverse_quantize_chroma_intra_block_8x8(qp, source.data_v, source.stride >> 1, dest->data_v, dest->stride >> 1);
 #endif
 }
 
-void inverse_quantize_inter_macroblock(uint8 qp, const macroblock &source, macroblock *dest)
+void inverse_quantize_inter_macroblock(uint8 qp, uint8 coded_pattern, const macroblock &source, macroblock *dest)
 {
 #if EVX_ENABLE_LINEAR_QUANTIZATION
-    // Luminance blocks.
-    inverse_quantize_block_linear_8x8(qp, source.data_y, source.stride, dest->data_y, dest->stride);
-    inverse_quantize_block_linear_8x8(qp, source.data_y + 8, source.stride, dest->data_y + 8, dest->stride);
-    inverse_quantize_block_linear_8x8(qp, source.data_y + 8 * source.stride, source.stride, dest->data_y + 8 * dest->stride, dest->stride);
-    inverse_quantize_block_linear_8x8(qp, source.data_y + 8 * source.stride + 8, source.stride, dest->data_y + 8 * dest->stride + 8, dest->stride);
+    // Luminance blocks. The linear quantizer is position invariant, so 16x16 blocks are
+    // processed as their quadrants.
+    if (coded_pattern & 0x01) inverse_quantize_block_linear_8x8(qp, source.data_y, source.stride, dest->data_y, dest->stride);
+    if (coded_pattern & 0x02) inverse_quantize_block_linear_8x8(qp, source.data_y + 8, source.stride, dest->data_y + 8, dest->stride);
+    if (coded_pattern & 0x04) inverse_quantize_block_linear_8x8(qp, source.data_y + 8 * source.stride, source.stride, dest->data_y + 8 * dest->stride, dest->stride);
+    if (coded_pattern & 0x08) inverse_quantize_block_linear_8x8(qp, source.data_y + 8 * source.stride + 8, source.stride, dest->data_y + 8 * dest->stride + 8, dest->stride);
 
     // Chroma blocks.
-    inverse_quantize_block_linear_8x8(qp, source.data_u, source.stride >> 1, dest->data_u, dest->stride >> 1);
-    inverse_quantize_block_linear_8x8(qp, source.data_v, source.stride >> 1, dest->data_v, dest->stride >> 1);
+    if (coded_pattern & EVX_CODED_PATTERN_U) inverse_quantize_block_linear_8x8(qp, source.data_u, source.stride >> 1, dest->data_u, dest->stride >> 1);
+    if (coded_pattern & EVX_CODED_PATTERN_V) inverse_quantize_block_linear_8x8(qp, source.data_v, source.stride >> 1, dest->data_v, dest->stride >> 1);
 #else
     // Luminance blocks.
-    inverse_quantize_inter_block_8x8(qp, source.data_y, source.stride, dest->data_y, dest->stride);
-    inverse_quantize_inter_block_8x8(qp, source.data_y + 8, source.stride, dest->data_y + 8, dest->stride);
-    inverse_quantize_inter_block_8x8(qp, source.data_y + 8 * source.stride, source.stride, dest->data_y + 8 * dest->stride, dest->stride);
-    inverse_quantize_inter_block_8x8(qp, source.data_y + 8 * source.stride + 8, source.stride, dest->data_y + 8 * dest->stride + 8, dest->stride);
+    if (coded_pattern & EVX_CODED_PATTERN_LUMA_16x16)
+    {
+        inverse_quantize_inter_block_16x16(qp, source.data_y, source.stride, dest->data_y, dest->stride);
+    }
+    else
+    {
+        if (coded_pattern & 0x01) inverse_quantize_inter_block_8x8(qp, source.data_y, source.stride, dest->data_y, dest->stride);
+        if (coded_pattern & 0x02) inverse_quantize_inter_block_8x8(qp, source.data_y + 8, source.stride, dest->data_y + 8, dest->stride);
+        if (coded_pattern & 0x04) inverse_quantize_inter_block_8x8(qp, source.data_y + 8 * source.stride, source.stride, dest->data_y + 8 * dest->stride, dest->stride);
+        if (coded_pattern & 0x08) inverse_quantize_inter_block_8x8(qp, source.data_y + 8 * source.stride + 8, source.stride, dest->data_y + 8 * dest->stride + 8, dest->stride);
+    }
 
     // Chroma blocks.
-    inverse_quantize_inter_block_8x8(qp, source.data_u, source.stride >> 1, dest->data_u, dest->stride >> 1);
-    inverse_quantize_inter_block_8x8(qp, source.data_v, source.stride >> 1, dest->data_v, dest->stride >> 1);
+    if (coded_pattern & EVX_CODED_PATTERN_U) inverse_quantize_inter_block_8x8(qp, source.data_u, source.stride >> 1, dest->data_u, dest->stride >> 1);
+    if (coded_pattern & EVX_CODED_PATTERN_V) inverse_quantize_inter_block_8x8(qp, source.data_v, source.stride >> 1, dest->data_v, dest->stride >> 1);
 #endif
 }
 
@@ -366,16 +1075,136 @@ void quantize_macroblock(uint8 qp, EVX_BLOCK_TYPE block_type, const macroblock &
 #endif
 }
 
-void inverse_quantize_macroblock(uint8 qp, EVX_BLOCK_TYPE block_type, const macroblock &source, macroblock *__restrict dest)
+void quantize_luma_16x16(uint8 qp, EVX_BLOCK_TYPE block_type, int16 *source, uint32 source_stride, int16 *__restrict dest, uint32 dest_stride)
 {
 #if EVX_QUANTIZATION_ENABLED
+  #if EVX_ENABLE_LINEAR_QUANTIZATION
+    bool intra = EVX_IS_INTRA_BLOCK_TYPE(block_type) && !EVX_IS_MOTION_BLOCK_TYPE(block_type);
+
+    for (uint32 k = 0; k < 4; ++k)
+    {
+        if (intra)
+            quantize_intra_block_linear_8x8(qp, source + EVX_LUMA_BLOCK_OFFSET(k, source_stride), source_stride, dest + EVX_LUMA_BLOCK_OFFSET(k, dest_stride), dest_stride);
+        else
+            quantize_inter_block_linear_8x8(qp, source + EVX_LUMA_BLOCK_OFFSET(k, source_stride), source_stride, dest + EVX_LUMA_BLOCK_OFFSET(k, dest_stride), dest_stride);
+    }
+  #else
     if (EVX_IS_INTRA_BLOCK_TYPE(block_type) && !EVX_IS_MOTION_BLOCK_TYPE(block_type))
-        return inverse_quantize_intra_macroblock(qp, source, dest);
+        return quantize_luma_intra_block_16x16(qp, source, source_stride, dest, dest_stride);
     else
-        return inverse_quantize_inter_macroblock(qp, source, dest);
+        return quantize_inter_block_16x16(qp, source, source_stride, dest, dest_stride);
+  #endif
+#else
+    for (uint32 j = 0; j < 16; ++j)
+    {
+        aligned_byte_copy(source + j * source_stride, sizeof(int16) * 16, dest + j * dest_stride);
+    }
+#endif
+}
+
+void inverse_quantize_macroblock(uint8 qp, EVX_BLOCK_TYPE block_type, uint8 coded_pattern, const macroblock &source, macroblock *__restrict dest)
+{
+#if EVX_QUANTIZATION_ENABLED
+    if (EVX_IS_INTRA_BLOCK_TYPE(block_type) && !EVX_IS_MOTION_BLOCK_TYPE(block_type))
+        return inverse_quantize_intra_macroblock(qp, coded_pattern, source, dest);
+    else
+        return inverse_quantize_inter_macroblock(qp, coded_pattern, source, dest);
 #else
     copy_macroblock(source, dest);
 #endif
 }
 
+#if EVX_ZERO_BLOCK_DETECTION && EVX_QUANTIZATION_ENABLED && !EVX_ENABLE_LINEAR_QUANTIZATION
+
+static bool is_zero_block(const int16 *limits, int32 sad, const int32 *energies)
+{
+    // The energies are scaled by 64, and so the limits and the margin by 8.
+    int32 margin = 8 * EVX_ZERO_BLOCK_ROUNDING_MARGIN + ((sad + 63) >> 6);
+
+    for (uint32 i = 0; i < 16; ++i)
+    {
+        int32 limit = 8 * limits[i] - margin;
+
+        if (limit < 0 || energies[i] > limit * limit)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+#endif
+
+bool predict_zero_macroblock(uint8 quality, EVX_BLOCK_TYPE block_type, const macroblock &source, const macroblock &prediction, uint8 *qp)
+{
+#if EVX_ZERO_BLOCK_DETECTION && EVX_QUANTIZATION_ENABLED && !EVX_ENABLE_LINEAR_QUANTIZATION
+    // Only delta blocks are predicted, and these always use the inter matrix.
+    if (EVX_IS_INTRA_BLOCK_TYPE(block_type) && !EVX_IS_MOTION_BLOCK_TYPE(block_type))
+    {
+        return false;
+    }
+
+    int32 energies[16];
+    int32 energy = 0;
+    int32 first_dc_energy = 0;
+
+    // The adaptive qp depends on the variance of the transformed luma, which is not known
+    // without the transform, and which may be near zero for any residual (e.g. a uniform
+    // offset, or a single coefficient). Blocks are therefore checked against the limits 
+    // of the smallest qp that query_block_quantization_parameter may select. The limits 
+    // only grow with the qp, so the block quantizes to zero at whichever qp it selects.
+    const evx_quantize_kernels &kernels = query_quantize_kernels();
+    const int16 *limits = query_quantization_tables(query_variance_quantization_parameter(quality, 0)).zero_block_limits;
+
+    for (uint32 k = 0; k < 4; ++k)
+    {
+        int32 sad = kernels.zero_block_energies(source.data_y + EVX_LUMA_BLOCK_OFFSET(k, source.stride), source.stride, 
+                                                prediction.data_y + EVX_LUMA_BLOCK_OFFSET(k, prediction.stride), prediction.stride, 
+                                                energies);
+
+        if (!is_zero_block(limits, sad, energies))
+        {
+            return false;
+        }
+
+        for (uint32 i = 0; i < 16; ++i)
+        {
+            energy += energies[i];
+        }
+
+        first_dc_energy = (0 == k) ? energies[0] : first_dc_energy;
+    }
+
+  #if EVX_ENABLE_CHROMA_SUPPORT
+    int32 chroma_sad = 0;
+    int32 chroma_energies[16];
+
+    chroma_sad = kernels.zero_block_energies(source.data_u, source.stride >> 1, prediction.data_u, prediction.stride >> 1, chroma_energies);
+
+    if (!is_zero_block(limits, chroma_sad, chroma_energies))
+    {
+        return false;
+    }
+
+    chroma_sad = kernels.zero_block_energies(source.data_v, source.stride >> 1, prediction.data_v, prediction.stride >> 1, chroma_energies);
+
+    if (!is_zero_block(limits, chroma_sad, chroma_energies))
+    {
+        return false;
+    }
+  #endif
+
+    // The qp that is signalled for the block is estimated from the energy of the luma,
+    // less that of the dc of the first block, which compute_block_variance2 skips. It 
+    // differs from the qp that the transform would select for some blocks (see above), 
+    // which affects only the deblocking of the block, as it holds no coefficients.
+    *qp = query_variance_quantization_parameter(quality, (energy - first_dc_energy) >> 6);
+
+    return true;
+#else
+    return false;
+#endif
+}
+
 } // namespace evx
\ No newline at end of file
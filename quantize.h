@@ -35,6 +35,7 @@
 
 #include "base.h"
 #include "config.h"
+#include "cpu.h"
 #include "math.h"
 #include "types.h"
 #include "macroblock.h"
@@ -50,8 +51,63 @@ uint8 query_block_quantization_parameter(uint8 quality, const macroblock &block,
 // Performs quantization of source according to the quantization parameter (qp) and the block type.
 void quantize_macroblock(uint8 qp, EVX_BLOCK_TYPE block_type, const macroblock &source, macroblock *__restrict dest);
 
+// Performs quantization of a 16x16 luma transform block, see EVX_CODED_PATTERN_LUMA_16x16.
+void quantize_luma_16x16(uint8 qp, EVX_BLOCK_TYPE block_type, int16 *source, uint32 source_stride, int16 *__restrict dest, uint32 dest_stride);
+
 // Performs an inverse quantization of source according to the quantization parameter and block type.
-void inverse_quantize_macroblock(uint8 qp, EVX_BLOCK_TYPE block_type, const macroblock &source, macroblock *__restrict dest);
+// Only the 8x8 blocks that are set in coded_pattern are processed, and all others are left untouched.
+// The luma is processed as a single 16x16 block if coded_pattern holds EVX_CODED_PATTERN_LUMA_16x16.
+void inverse_quantize_macroblock(uint8 qp, EVX_BLOCK_TYPE block_type, uint8 coded_pattern, const macroblock &source, macroblock *__restrict dest);
+
+// Returns true if every 8x8 block of the difference between source and prediction is known
+// to quantize to zero, at any qp that query_block_quantization_parameter may select for the
+// quality, without transforming it. The bound is derived from the error of both transform
+// modes (see EVX_ZERO_BLOCK_DETECTION), so the transform and quantization of such blocks 
+// may be skipped. The qp to signal for the block is estimated, and returned in qp.
+bool predict_zero_macroblock(uint8 quality, EVX_BLOCK_TYPE block_type, const macroblock &source, const macroblock &prediction, uint8 *qp);
+
+// Quantization tables
+//
+//   Rather than dividing each coefficient by its matrix entry and then by the qp, the 
+//   quantizers use a table that is built once per qp and matrix. Both roundings fold 
+//   into a single division by 2 * qp * qm, which is performed as a multiply by the
+//   reciprocal of the divisor:
+//
+//     level = sign(c) * (((|c| * 16 + bias) * multiplier) >> 32)
+//
+//   The result is identical to the nested divisions for every int16 coefficient. Inverse
+//   quantization uses the matching scale, (c * scale) / 16, where scale = 2 * qp * qm.
+
+typedef struct evx_quantization_matrix
+{
+    uint32 multiplier[64];
+    int32 bias[64];
+    int16 scale[64];
+
+} evx_quantization_matrix;
+
+// Builds the quantization tables of every qp, once. This is called by initialize_context, 
+// and is otherwise performed on the first use of the quantizers, on any thread.
+void initialize_quantization_tables();
+
+typedef struct evx_quantize_kernels
+{
+    void (*quantize_8x8)(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride);
+    void (*quantize_16x16)(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride);
+    void (*inverse_quantize_8x8)(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride);
+    void (*inverse_quantize_16x16)(const evx_quantization_matrix &matrix, int16 *source, int32 source_stride, int16 *dest, int32 dest_stride);
+    int32 (*zero_block_energies)(const int16 *source, uint32 source_stride, const int16 *prediction, uint32 prediction_stride, int32 *energies);
+    EVX_SIMD_LEVEL level;
+
+} evx_quantize_kernels;
+
+// Returns the active quantizers. By default these are the fastest kernels that are
+// supported by the host processor, all of which are bit-exact with the scalar versions.
+const evx_quantize_kernels &query_quantize_kernels();
+
+// Overrides the active quantizers, e.g. to compare against the scalar reference. Fails 
+// if the requested level is not supported by the host processor.
+evx_status select_quantize_kernels(EVX_SIMD_LEVEL level);
 
 } // namespace evx
 
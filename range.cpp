@@ -0,0 +1,304 @@
+
+#include "range.h"
+#include "math.h"
+
+#define EVX_RANGE_TOP_VALUE                     (uint32(0x1) << 24)
+#define EVX_RANGE_MODEL_INCREMENT               (24)
+#define EVX_RANGE_MODEL_LIMIT                   (uint32(0x1) << 16)
+
+namespace evx {
+
+symbol_model::symbol_model()
+{
+    initialize(2);
+}
+
+evx_status symbol_model::initialize(uint32 count)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (count < 2 || count > EVX_SYMBOL_MODEL_MAX_SYMBOLS)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        frequency[i] = 1;
+    }
+
+    symbol_count = count;
+    total = count;
+
+    return EVX_SUCCESS;
+}
+
+uint32 symbol_model::query_symbol_count() const
+{
+    return symbol_count;
+}
+
+void symbol_model::update(uint32 symbol)
+{
+    frequency[symbol] += EVX_RANGE_MODEL_INCREMENT;
+    total += EVX_RANGE_MODEL_INCREMENT;
+
+    if (total > EVX_RANGE_MODEL_LIMIT)
+    {
+        // Rescale our model to favor recent statistics. Frequencies never reach zero.
+        total = 0;
+
+        for (uint32 i = 0; i < symbol_count; ++i)
+        {
+            frequency[i] = (frequency[i] + 1) >> 1;
+            total += frequency[i];
+        }
+    }
+}
+
+range_coder::range_coder()
+{
+    stream = NULL;
+    clear();
+}
+
+void range_coder::clear()
+{
+    low = 0;
+    range = 0xFFFFFFFF;
+    code = 0;
+    cache = 0;
+    cache_size = 1;
+}
+
+evx_status range_coder::shift_low()
+{
+    // Bytes are held back until we know whether a carry will propagate into them.
+    if ((uint32) low < 0xFF000000 || (low >> 32))
+    {
+        uint8 carry = (uint8) (low >> 32);
+        uint8 temp = cache;
+
+        do
+        {
+            if (evx_failed(stream->write_byte(temp + carry)))
+            {
+                return evx_post_error(EVX_ERROR_CAPACITY_LIMIT);
+            }
+
+            temp = 0xFF;
+        }
+        while (--cache_size);
+
+        cache = (uint8) (low >> 24);
+    }
+
+    cache_size++;
+    low = (low & 0x00FFFFFF) << 8;
+
+    return EVX_SUCCESS;
+}
+
+uint8 range_coder::read_next_byte()
+{
+    uint8 value = 0;
+
+    // Reads beyond the end of the stream are zero filled.
+    if (!stream->is_empty())
+    {
+        stream->read_byte(&value);
+    }
+
+    return value;
+}
+
+void range_coder::normalize_decode()
+{
+    while (range < EVX_RANGE_TOP_VALUE)
+    {
+        code = (code << 8) | read_next_byte();
+        range <<= 8;
+    }
+}
+
+evx_status range_coder::start_encode(bit_stream *dest)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!dest)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    clear();
+    stream = dest;
+
+    return EVX_SUCCESS;
+}
+
+evx_status range_coder::finish_encode()
+{
+    for (uint32 i = 0; i < 5; ++i)
+    {
+        if (evx_failed(shift_low()))
+        {
+            return evx_post_error(EVX_ERROR_CAPACITY_LIMIT);
+        }
+    }
+
+    clear();
+
+    return EVX_SUCCESS;
+}
+
+evx_status range_coder::start_decode(bit_stream *source)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!source)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    clear();
+    stream = source;
+
+    // The first byte is always the (empty) initial cache of the encoder.
+    for (uint32 i = 0; i < 5; ++i)
+    {
+        code = (code << 8) | read_next_byte();
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status range_coder::encode_symbol(uint32 symbol, symbol_model *model)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!model || symbol >= model->symbol_count)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    uint32 start = 0;
+
+    for (uint32 i = 0; i < symbol; ++i)
+    {
+        start += model->frequency[i];
+    }
+
+    uint32 r = range / model->total;
+    low += (uint64) r * start;
+    range = r * model->frequency[symbol];
+
+    model->update(symbol);
+
+    while (range < EVX_RANGE_TOP_VALUE)
+    {
+        range <<= 8;
+
+        if (evx_failed(shift_low()))
+        {
+            return evx_post_error(EVX_ERROR_CAPACITY_LIMIT);
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status range_coder::decode_symbol(symbol_model *model, uint32 *symbol)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!model || !symbol)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    uint32 r = range / model->total;
+    uint32 target = evx_min2(code / r, model->total - 1);
+    uint32 start = 0;
+    uint32 index = 0;
+
+    while (start + model->frequency[index] <= target)
+    {
+        start += model->frequency[index++];
+    }
+
+    code -= r * start;
+    range = r * model->frequency[index];
+
+    model->update(index);
+    normalize_decode();
+
+    *symbol = index;
+
+    return EVX_SUCCESS;
+}
+
+evx_status range_coder::encode_bits(uint32 value, uint8 count)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (count > 16)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    if (!count)
+    {
+        return EVX_SUCCESS;
+    }
+
+    range >>= count;
+    low += (uint64) range * (value & ((0x1 << count) - 1));
+
+    while (range < EVX_RANGE_TOP_VALUE)
+    {
+        range <<= 8;
+
+        if (evx_failed(shift_low()))
+        {
+            return evx_post_error(EVX_ERROR_CAPACITY_LIMIT);
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status range_coder::decode_bits(uint8 count, uint32 *value)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (count > 16 || !value)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    if (!count)
+    {
+        *value = 0;
+        return EVX_SUCCESS;
+    }
+
+    range >>= count;
+
+    uint32 result = evx_min2(code / range, (uint32(0x1) << count) - 1);
+    code -= result * range;
+
+    normalize_decode();
+
+    *value = result;
+
+    return EVX_SUCCESS;
+}
+
+} // namespace evx
\ No newline at end of file
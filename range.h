@@ -0,0 +1,109 @@
+
+/*
+// Copyright (c) 2009-2014 Joe Bertolami. All Right Reserved.
+//
+// range.h
+//
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Additional Information:
+//
+*/
+
+#ifndef __EVX_RANGE_H__
+#define __EVX_RANGE_H__
+
+#include "bitstream.h"
+
+// The range coder is a byte oriented multi-symbol arithmetic coder. Unlike the binary
+// entropy_coder, it codes whole symbols against adaptive frequency models, and reads 
+// or writes its stream one byte at a time. Carries are propagated through a cached 
+// output byte, so the coder never needs to revisit bytes that it has already written.
+
+#define EVX_SYMBOL_MODEL_MAX_SYMBOLS                (32)
+
+namespace evx {
+
+class symbol_model
+{
+    friend class range_coder;
+
+    uint16 frequency[EVX_SYMBOL_MODEL_MAX_SYMBOLS];
+    uint32 total;
+    uint32 symbol_count;
+
+private:
+
+    void update(uint32 symbol);
+
+public:
+
+    symbol_model();
+
+    // Resets the model to a uniform distribution over symbol_count symbols.
+    evx_status initialize(uint32 count);
+
+    uint32 query_symbol_count() const;
+};
+
+class range_coder
+{
+    uint64 low;
+    uint32 range;
+    uint32 code;
+    uint32 cache_size;
+    uint8 cache;
+
+    bit_stream *stream;
+
+private:
+
+    evx_status shift_low();
+    void normalize_decode();
+    uint8 read_next_byte();
+
+public:
+
+    range_coder();
+    void clear();
+
+    evx_status start_encode(bit_stream *dest);
+    evx_status finish_encode();
+    evx_status start_decode(bit_stream *source);
+
+    // Codes a symbol against an adaptive model and updates the model.
+    evx_status encode_symbol(uint32 symbol, symbol_model *model);
+    evx_status decode_symbol(symbol_model *model, uint32 *symbol);
+
+    // Codes the low count bits of value with a uniform distribution. count must not 
+    // exceed 16.
+    evx_status encode_bits(uint32 value, uint8 count);
+    evx_status decode_bits(uint8 count, uint32 *value);
+
+private:
+
+    EVX_DISABLE_COPY_AND_ASSIGN(range_coder);
+};
+
+} // namespace evx
+
+#endif // __EVX_RANGE_H__
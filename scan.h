@@ -121,6 +121,30 @@ const uint8 EVX_MACROBLOCK_16x16_ZIGZAG_SOURCE[] =
   163,  164,  176,  177,  185,  186,  190,  191,  227,  228,  240,  241,  249,  250,  254,  255,
 };
 
+// The 16x16 scan above visits each 8x8 quadrant in turn, and suits blocks that hold 
+// four independent 8x8 transforms. Luma that is coded as a single 16x16 transform 
+// (see EVX_CODED_PATTERN_LUMA_16x16) is instead visited in full zigzag order.
+
+const uint8 EVX_MACROBLOCK_16x16_TRANSFORM_ZIGZAG[] = 
+{
+    0,    1,   16,   32,   17,    2,    3,   18,   33,   48,   64,   49,   34,   19,    4,    5,
+   20,   35,   50,   65,   80,   96,   81,   66,   51,   36,   21,    6,    7,   22,   37,   52,
+   67,   82,   97,  112,  128,  113,   98,   83,   68,   53,   38,   23,    8,    9,   24,   39,
+   54,   69,   84,   99,  114,  129,  144,  160,  145,  130,  115,  100,   85,   70,   55,   40,
+   25,   10,   11,   26,   41,   56,   71,   86,  101,  116,  131,  146,  161,  176,  192,  177,
+  162,  147,  132,  117,  102,   87,   72,   57,   42,   27,   12,   13,   28,   43,   58,   73,
+   88,  103,  118,  133,  148,  163,  178,  193,  208,  224,  209,  194,  179,  164,  149,  134,
+  119,  104,   89,   74,   59,   44,   29,   14,   15,   30,   45,   60,   75,   90,  105,  120,
+  135,  150,  165,  180,  195,  210,  225,  240,  241,  226,  211,  196,  181,  166,  151,  136,
+  121,  106,   91,   76,   61,   46,   31,   47,   62,   77,   92,  107,  122,  137,  152,  167,
+  182,  197,  212,  227,  242,  243,  228,  213,  198,  183,  168,  153,  138,  123,  108,   93,
+   78,   63,   79,   94,  109,  124,  139,  154,  169,  184,  199,  214,  229,  244,  245,  230,
+  215,  200,  185,  170,  155,  140,  125,  110,   95,  111,  126,  141,  156,  171,  186,  201,
+  216,  231,  246,  247,  232,  217,  202,  187,  172,  157,  142,  127,  143,  158,  173,  188,
+  203,  218,  233,  248,  249,  234,  219,  204,  189,  174,  159,  175,  190,  205,  220,  235,
+  250,  251,  236,  221,  206,  191,  207,  222,  237,  252,  253,  238,  223,  239,  254,  255
+};
+
 } // namespace evx
 
 #endif // __EVX_SCAN_H__
\ No newline at end of file
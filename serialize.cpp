@@ -4,10 +4,70 @@
 #include "common.h"
 #include "stream.h"
 #include "macroblock.h"
+#include "motion.h"
 
 namespace evx {
 
-evx_status serialize_block_8x8(int16 *source, uint32 source_width, int16 last_dc, int16 *cache, bit_stream *feed_stream, entropy_coder *coder, bit_stream *output)
+static int16 query_last_dc(image *source_image, int32 i, int32 j, int32 first_y, int32 block_size)
+{
+    // Support delta dc coding. The dc is predicted from the block to the left, or for the
+    // first block of a row, from the block above (within the slice).
+    int16 *last_block_data = NULL;
+
+    if (i >= block_size)
+    {
+        last_block_data = reinterpret_cast<int16 *>(source_image->query_data() + source_image->query_block_offset(i - (EVX_MACROBLOCK_SIZE >> 1), j));
+        return last_block_data[0];
+    }
+
+    if (j >= first_y + block_size)
+    {
+        last_block_data = reinterpret_cast<int16 *>(source_image->query_data() + source_image->query_block_offset(i, j - (EVX_MACROBLOCK_SIZE >> 1)));
+        return last_block_data[0];
+    }
+
+    return 0;
+}
+
+// Returns the dc predictor of the luma of the macroblock at (i, j), which is selected as in 
+// query_last_dc. A 16x16 neighbour holds a single dc at its origin, and the dc of a 16x16 
+// block is twice that of an 8x8 block of the same mean, so the prediction is rescaled when
+// the transform sizes of the two blocks differ. This is shared with unserialize.cpp.
+int16 query_last_luma_dc(image *source_image, const evx_block_desc *block_table, uint32 block_index, uint32 width_in_blocks, 
+                         int32 i, int32 j, int32 first_y, uint8 coded_pattern)
+{
+    const evx_block_desc *last_desc = NULL;
+    int32 last_i = i;
+    int32 last_j = j;
+
+    if (i >= EVX_MACROBLOCK_SIZE)
+    {
+        last_desc = &block_table[block_index - 1];
+        last_i = i - ((last_desc->coded_pattern & EVX_CODED_PATTERN_LUMA_16x16) ? EVX_MACROBLOCK_SIZE : (EVX_MACROBLOCK_SIZE >> 1));
+    }
+    else if (j >= first_y + EVX_MACROBLOCK_SIZE)
+    {
+        last_desc = &block_table[block_index - width_in_blocks];
+        last_j = j - ((last_desc->coded_pattern & EVX_CODED_PATTERN_LUMA_16x16) ? EVX_MACROBLOCK_SIZE : (EVX_MACROBLOCK_SIZE >> 1));
+    }
+    else
+    {
+        return 0;
+    }
+
+    int16 *last_block_data = reinterpret_cast<int16 *>(source_image->query_data() + source_image->query_block_offset(last_i, last_j));
+    int16 last_dc = last_block_data[0];
+
+    bool last_16x16 = !!(last_desc->coded_pattern & EVX_CODED_PATTERN_LUMA_16x16);
+    bool current_16x16 = !!(coded_pattern & EVX_CODED_PATTERN_LUMA_16x16);
+
+    if (current_16x16 && !last_16x16) return last_dc * 2;
+    if (!current_16x16 && last_16x16) return last_dc / 2;
+
+    return last_dc;
+}
+
+static void stage_block_8x8(int16 *source, uint32 source_width, int16 last_dc, int16 *cache)
 {
     // Our entropy stream encode uses a zigzag pattern to efficiently encode our residuals. 
     // This requires a contiguous input buffer, so we copy from a non-contiguous source 
@@ -18,35 +78,87 @@ evx_status serialize_block_8x8(int16 *source, uint32 source_width, int16 last_dc
     }
 
     cache[0] = cache[0] - last_dc;  // Compute and encode a delta value for the dc.
+}
 
-    return entropy_rle_stream_encode_8x8(cache, feed_stream, coder, output); 
+static void stage_block_16x16(int16 *source, uint32 source_width, int16 last_dc, int16 *cache)
+{
+    for (uint32 j = 0; j < 16; j++)
+    {
+        aligned_byte_copy(source + j * source_width, sizeof(int16) * 16, cache + j * 16);
+    }
+
+    cache[0] = cache[0] - last_dc;
 }
 
-evx_status serialize_block_16x16(int16 *source, uint32 source_width, int16 last_dc, int16 *cache, bit_stream *feed_stream, entropy_coder *coder, bit_stream *output)
+static evx_status serialize_staged_block(int16 *cache, const uint8 *scan, int32 coefficient_count, symbol_coder *coder)
 {
-    serialize_block_8x8(source, source_width, last_dc, cache, feed_stream, coder, output);
-    serialize_block_8x8(source + 8, source_width, source[0], cache, feed_stream, coder, output);
-    serialize_block_8x8(source + 8 * source_width, source_width, source[0], cache, feed_stream, coder, output);
-    serialize_block_8x8(source + 8 * source_width + 8, source_width, source[8 * source_width], cache, feed_stream, coder, output);
+    int32 run_length = coefficient_count - 1;
+
+    // Determine our run-length, which prefixes the zigzag ordered coefficients.
+    for (run_length = coefficient_count - 1; run_length >= 0; --run_length)
+    {
+        if (cache[scan[run_length]])
+        {
+            break;
+        }
+    }
+
+    run_length = (run_length + 1);
+
+    if (evx_failed(coder->encode_value(EVX_SYNTAX_RUN_LENGTH, (uint16) run_length)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    if (evx_failed(coder->encode_coefficients(cache, run_length, scan)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
 
     return EVX_SUCCESS;
 }
 
-evx_status serialize_image_blocks_16x16(image *source_image, int16 *cache_data, evx_block_desc *block_table, bit_stream *feed_stream, entropy_coder *coder, bit_stream *output)
+evx_status serialize_block_8x8(int16 *source, uint32 source_width, int16 last_dc, int16 *cache, symbol_coder *coder)
 {
-    uint16 block_index = 0;
-    uint32 width = source_image->query_width();
-    uint32 height = source_image->query_height();
+    stage_block_8x8(source, source_width, last_dc, cache);
+
+    return serialize_staged_block(cache, EVX_MACROBLOCK_8x8_ZIGZAG, 64, coder);
+}
 
-    feed_stream->empty();
+evx_status serialize_block_16x16(int16 *source, uint32 source_width, int16 last_dc, uint8 coded_pattern, int16 *cache, symbol_coder *coder)
+{
+    // Luma that was transformed as a single block is coded as a single block.
+    if (coded_pattern & EVX_CODED_PATTERN_LUMA_16x16)
+    {
+        stage_block_16x16(source, source_width, last_dc, cache);
+
+        return serialize_staged_block(cache, EVX_MACROBLOCK_16x16_TRANSFORM_ZIGZAG, 256, coder);
+    }
 
-    for (int32 j = 0; j < height; j += EVX_MACROBLOCK_SIZE)
-    for (int32 i = 0; i < width; i += EVX_MACROBLOCK_SIZE)
+    // Blocks that are missing from the coded pattern hold no coefficients, and are skipped.
+    if (((coded_pattern & 0x1) && evx_failed(serialize_block_8x8(source, source_width, last_dc, cache, coder))) ||
+        ((coded_pattern & 0x2) && evx_failed(serialize_block_8x8(source + 8, source_width, source[0], cache, coder))) ||
+        ((coded_pattern & 0x4) && evx_failed(serialize_block_8x8(source + 8 * source_width, source_width, source[0], cache, coder))) ||
+        ((coded_pattern & 0x8) && evx_failed(serialize_block_8x8(source + 8 * source_width + 8, source_width, source[8 * source_width], cache, coder))))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status serialize_image_blocks_16x16(image *source_image, const evx_slice &slice, int16 *cache_data, evx_block_desc *block_table, symbol_coder *coder)
+{
+    uint32 width = source_image->query_width();
+    uint16 block_index = slice.first_row * (width / EVX_MACROBLOCK_SIZE);
+    uint32 first_y = slice.first_row * EVX_MACROBLOCK_SIZE;
+    uint32 last_y = (slice.first_row + slice.row_count) * EVX_MACROBLOCK_SIZE;
+
+    for (uint32 j = first_y; j < last_y; j += EVX_MACROBLOCK_SIZE)
+    for (uint32 i = 0; i < width; i += EVX_MACROBLOCK_SIZE)
     {
         evx_block_desc *block_desc = &block_table[block_index++];
         
-        int16 last_dc = 0;
-        int16 *last_block_data = NULL;
         int16 *block_data = reinterpret_cast<int16 *>(source_image->query_data() + source_image->query_block_offset(i, j));
 
         // Copy blocks contain no residuals.
@@ -55,97 +167,200 @@ evx_status serialize_image_blocks_16x16(image *source_image, int16 *cache_data,
             continue;
         }
 
-        // Support delta dc coding
-        if (i >= EVX_MACROBLOCK_SIZE)
+        int16 last_dc = query_last_luma_dc(source_image, block_table, block_index - 1, width / EVX_MACROBLOCK_SIZE, 
+                                           i, j, first_y, block_desc->coded_pattern);
+
+        if (evx_failed(serialize_block_16x16(block_data, width, last_dc, block_desc->coded_pattern, cache_data, coder)))
         {
-            last_block_data = reinterpret_cast<int16 *>(source_image->query_data() + source_image->query_block_offset(i - (EVX_MACROBLOCK_SIZE >> 1), j));
-            last_dc = last_block_data[0];
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
         }
-        else
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status serialize_image_blocks_8x8(image *source_image, const evx_slice &slice, uint8 pattern_mask, int16 *cache_data, evx_block_desc *block_table, symbol_coder *coder)
+{
+    uint32 width = source_image->query_width();
+    uint16 block_index = slice.first_row * (width / (EVX_MACROBLOCK_SIZE >> 1));
+    uint32 first_y = slice.first_row * (EVX_MACROBLOCK_SIZE >> 1);
+    uint32 last_y = (slice.first_row + slice.row_count) * (EVX_MACROBLOCK_SIZE >> 1);
+
+    for (uint32 j = first_y; j < last_y; j += (EVX_MACROBLOCK_SIZE >> 1))
+    for (uint32 i = 0; i < width; i += (EVX_MACROBLOCK_SIZE >> 1))
+    {
+        evx_block_desc *block_desc = &block_table[block_index++];
+        
+        int16 *block_data = reinterpret_cast<int16 *>(source_image->query_data() + source_image->query_block_offset(i, j));
+
+        // Copy blocks and uncoded blocks contain no residuals.
+        if (EVX_IS_COPY_BLOCK_TYPE(block_desc->block_type) || !(block_desc->coded_pattern & pattern_mask))
         {
-            if (j >= EVX_MACROBLOCK_SIZE)
-            {
-                // i is zero, so we sample from the block above.
-                last_block_data = reinterpret_cast<int16 *>(source_image->query_data() + source_image->query_block_offset(i, j - (EVX_MACROBLOCK_SIZE >> 1)));
-                last_dc = last_block_data[0];
-            }
+            continue;
         }
 
-        serialize_block_16x16(block_data, width, last_dc, cache_data, feed_stream, coder, output);
+        int16 last_dc = query_last_dc(source_image, i, j, first_y, EVX_MACROBLOCK_SIZE >> 1);
+
+        if (evx_failed(serialize_block_8x8(block_data, width, last_dc, cache_data, coder)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
     }
 
     return EVX_SUCCESS;
 }
 
-evx_status serialize_image_blocks_8x8(image *source_image, int16 *cache_data, evx_block_desc *block_table, bit_stream *feed_stream, entropy_coder *coder, bit_stream *output)
+evx_status serialize_macroblocks(evx_context *context, evx_slice *slice)
 {
-    uint16 block_index = 0;
-    uint32 width = source_image->query_width();
-    uint32 height = source_image->query_height();
+    image *y_image = context->cache_bank.output_cache.query_y_image();
+    image *u_image = context->cache_bank.output_cache.query_u_image();
+    image *v_image = context->cache_bank.output_cache.query_v_image();
+
+    if (evx_failed(serialize_image_blocks_16x16(y_image, *slice, slice->staging_block.data_y, 
+                   context->block_table, &slice->coder)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+#if EVX_ENABLE_CHROMA_SUPPORT
+
+    if (evx_failed(serialize_image_blocks_8x8(u_image, *slice, EVX_CODED_PATTERN_U, slice->staging_block.data_u, 
+                   context->block_table, &slice->coder)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    if (evx_failed(serialize_image_blocks_8x8(v_image, *slice, EVX_CODED_PATTERN_V, slice->staging_block.data_v, 
+                   context->block_table, &slice->coder))) 
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
 
-    feed_stream->empty();
+#endif
 
-    for (int32 j = 0; j < height; j += (EVX_MACROBLOCK_SIZE >> 1))
-    for (int32 i = 0; i < width; i += (EVX_MACROBLOCK_SIZE >> 1))
+    return EVX_SUCCESS;
+}
+
+evx_status capture_image_blocks_16x16(image *source_image, const evx_slice &slice, evx_block_desc *block_table, int16 *output, uint32 capacity, uint32 *block_count)
+{
+    uint32 width = source_image->query_width();
+    uint16 block_index = slice.first_row * (width / EVX_MACROBLOCK_SIZE);
+    uint32 first_y = slice.first_row * EVX_MACROBLOCK_SIZE;
+    uint32 last_y = (slice.first_row + slice.row_count) * EVX_MACROBLOCK_SIZE;
+
+    for (uint32 j = first_y; j < last_y; j += EVX_MACROBLOCK_SIZE)
+    for (uint32 i = 0; i < width; i += EVX_MACROBLOCK_SIZE)
     {
         evx_block_desc *block_desc = &block_table[block_index++];
-        
-        int16 last_dc = 0;
-        int16 *last_block_data = NULL;
         int16 *block_data = reinterpret_cast<int16 *>(source_image->query_data() + source_image->query_block_offset(i, j));
 
-        // Copy blocks contain no residuals.
         if (EVX_IS_COPY_BLOCK_TYPE(block_desc->block_type))
         {
             continue;
         }
 
-        // Support delta dc coding
-        if (i >= (EVX_MACROBLOCK_SIZE >> 1))
+        int16 luma_dc = query_last_luma_dc(source_image, block_table, block_index - 1, width / EVX_MACROBLOCK_SIZE, 
+                                           i, j, first_y, block_desc->coded_pattern);
+
+        // Single 16x16 blocks are captured as the four 8x8 quadrants of their coefficients.
+        if (block_desc->coded_pattern & EVX_CODED_PATTERN_LUMA_16x16)
         {
-            last_block_data = reinterpret_cast<int16 *>(source_image->query_data() + source_image->query_block_offset(i - (EVX_MACROBLOCK_SIZE >> 1), j));
-            last_dc = last_block_data[0];
+            int16 staged_block[16*16];
+            stage_block_16x16(block_data, width, luma_dc, staged_block);
+
+            for (uint32 k = 0; k < 4; ++k)
+            {
+                if (*block_count >= capacity)
+                {
+                    return EVX_ERROR_CAPACITY_LIMIT;
+                }
+
+                int16 *unit = output + 64 * (*block_count)++;
+
+                for (uint32 row = 0; row < 8; ++row)
+                {
+                    aligned_byte_copy(staged_block + EVX_LUMA_BLOCK_OFFSET(k, 16) + row * 16, sizeof(int16) * 8, unit + row * 8);
+                }
+            }
+
+            continue;
         }
-        else
+
+        // The quadrants are visited, and their dc predicted, as in serialize_block_16x16.
+        int16 last_dc[4] = { luma_dc, block_data[0], block_data[0], block_data[8 * width] };
+
+        for (uint32 k = 0; k < 4; ++k)
         {
-            if (j >= (EVX_MACROBLOCK_SIZE >> 1))
+            if (!(block_desc->coded_pattern & (0x1 << k)))
             {
-                // i is zero, so we sample from the block above.
-                last_block_data = reinterpret_cast<int16 *>(source_image->query_data() + source_image->query_block_offset(i, j - (EVX_MACROBLOCK_SIZE >> 1)));
-                last_dc = last_block_data[0];
+                continue;
             }
+
+            if (*block_count >= capacity)
+            {
+                return EVX_ERROR_CAPACITY_LIMIT;
+            }
+
+            stage_block_8x8(block_data + EVX_LUMA_BLOCK_OFFSET(k, width), width, last_dc[k], output + 64 * (*block_count)++);
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status capture_image_blocks_8x8(image *source_image, const evx_slice &slice, uint8 pattern_mask, evx_block_desc *block_table, int16 *output, uint32 capacity, uint32 *block_count)
+{
+    uint32 width = source_image->query_width();
+    uint16 block_index = slice.first_row * (width / (EVX_MACROBLOCK_SIZE >> 1));
+    uint32 first_y = slice.first_row * (EVX_MACROBLOCK_SIZE >> 1);
+    uint32 last_y = (slice.first_row + slice.row_count) * (EVX_MACROBLOCK_SIZE >> 1);
+
+    for (uint32 j = first_y; j < last_y; j += (EVX_MACROBLOCK_SIZE >> 1))
+    for (uint32 i = 0; i < width; i += (EVX_MACROBLOCK_SIZE >> 1))
+    {
+        evx_block_desc *block_desc = &block_table[block_index++];
+        int16 *block_data = reinterpret_cast<int16 *>(source_image->query_data() + source_image->query_block_offset(i, j));
+
+        if (EVX_IS_COPY_BLOCK_TYPE(block_desc->block_type) || !(block_desc->coded_pattern & pattern_mask))
+        {
+            continue;
         }
 
-        serialize_block_8x8(block_data, width, last_dc, cache_data, feed_stream, coder, output);
+        if (*block_count >= capacity)
+        {
+            return EVX_ERROR_CAPACITY_LIMIT;
+        }
+
+        int16 last_dc = query_last_dc(source_image, i, j, first_y, EVX_MACROBLOCK_SIZE >> 1);
+
+        stage_block_8x8(block_data, width, last_dc, output + 64 * (*block_count)++);
     }
 
     return EVX_SUCCESS;
 }
 
-evx_status serialize_macroblocks(evx_context *context, bit_stream *output)
+evx_status capture_macroblocks(evx_context *context, evx_slice *slice, int16 *output, uint32 capacity, uint32 *block_count)
 {
+    // Gathers the coefficient blocks of the slice exactly as serialize_macroblocks passes
+    // them to the symbol coder: in coding order, with the dc stored as a delta against 
+    // its predictor. Each block holds 64 coefficients in raster order. Luma that is coded
+    // as a single 16x16 block is split into its four 8x8 coefficient quadrants, so these
+    // are not coded units of the stream (see EVX_CODED_PATTERN_LUMA_16x16).
     image *y_image = context->cache_bank.output_cache.query_y_image();
     image *u_image = context->cache_bank.output_cache.query_u_image();
     image *v_image = context->cache_bank.output_cache.query_v_image();
 
-    if (evx_failed(serialize_image_blocks_16x16(y_image, context->cache_bank.staging_block.data_y, 
-                   context->block_table, &context->feed_stream, &context->arith_coder, output)))
+    if (EVX_SUCCESS != capture_image_blocks_16x16(y_image, *slice, context->block_table, output, capacity, block_count))
     {
-        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        return EVX_ERROR_CAPACITY_LIMIT;
     }
 
 #if EVX_ENABLE_CHROMA_SUPPORT
 
-    if (evx_failed(serialize_image_blocks_8x8(u_image, context->cache_bank.staging_block.data_u, 
-                   context->block_table, &context->feed_stream, &context->arith_coder, output)))
+    if (EVX_SUCCESS != capture_image_blocks_8x8(u_image, *slice, EVX_CODED_PATTERN_U, context->block_table, output, capacity, block_count) ||
+        EVX_SUCCESS != capture_image_blocks_8x8(v_image, *slice, EVX_CODED_PATTERN_V, context->block_table, output, capacity, block_count))
     {
-        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
-    }
-
-    if (evx_failed(serialize_image_blocks_8x8(v_image, context->cache_bank.staging_block.data_v, 
-                   context->block_table, &context->feed_stream, &context->arith_coder, output))) 
-    {
-        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        return EVX_ERROR_CAPACITY_LIMIT;
     }
 
 #endif
@@ -153,22 +368,44 @@ evx_status serialize_macroblocks(evx_context *context, bit_stream *output)
     return EVX_SUCCESS;
 }
 
-evx_status serialize_block_types(uint16 block_count, evx_block_desc *block_table, bit_stream *feed_stream, entropy_coder *coder, bit_stream *output)
+evx_status serialize_block_types(uint16 block_count, evx_block_desc *block_table, symbol_coder *coder)
 {
-    feed_stream->empty();
+    // Inter copy blocks dominate most inter frames, so they are coded as skip runs. Each
+    // run is followed by the type of the block that ends it, and a run that reaches the 
+    // end of the table is not followed by a type.
+    uint16 skip_run = 0;
 
     for (uint32 i = 0; i < block_count; i++)
     {
-        feed_stream->write_bits(&block_table[i].block_type, 3);
+        if (EVX_BLOCK_INTER_COPY == block_table[i].block_type)
+        {
+            skip_run++;
+            continue;
+        }
+
+        if (evx_failed(coder->encode_value(EVX_SYNTAX_SKIP_RUN, skip_run)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        if (evx_failed(coder->encode_bits(EVX_SYNTAX_BLOCK_TYPE, (uint8) block_table[i].block_type, 3)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        skip_run = 0;
+    }
+
+    if (skip_run && evx_failed(coder->encode_value(EVX_SYNTAX_SKIP_RUN, skip_run)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    return coder->encode(feed_stream, output, false);
+    return EVX_SUCCESS;
 }
 
-evx_status serialize_prediction_targets(uint16 block_count, evx_block_desc *block_table, bit_stream *feed_stream, entropy_coder *coder, bit_stream *output)
+evx_status serialize_prediction_targets(uint16 block_count, evx_block_desc *block_table, symbol_coder *coder)
 {
-    feed_stream->empty();
-
     for (uint32 i = 0; i < block_count; i++)
     {
         if (EVX_IS_INTRA_BLOCK_TYPE(block_table[i].block_type))
@@ -177,19 +414,26 @@ evx_status serialize_prediction_targets(uint16 block_count, evx_block_desc *bloc
         }
 
         uint8 bit_count = log2((uint8) EVX_REFERENCE_FRAME_COUNT);
-        feed_stream->write_bits(&block_table[i].prediction_target, bit_count);
+
+        if (evx_failed(coder->encode_bits(EVX_SYNTAX_PREDICTION_TARGET, block_table[i].prediction_target, bit_count)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
     }
 
-    return coder->encode(feed_stream, output, false);
+    return EVX_SUCCESS;
 }
 
-evx_status serialize_motion_vectors(uint16 block_count, evx_block_desc *block_table, bit_stream *feed_stream, entropy_coder *coder, bit_stream *output)
+evx_status serialize_motion_vectors(uint16 block_count, uint32 width_in_blocks, evx_block_desc *block_table, symbol_coder *coder,
+                                    evx_stream_stats *stats)
 {
-    // We encode our motion vectors as motion vector differences, one component at a time.
-    int16 last_x = 0, last_y = 0;
-    feed_stream->empty();
+    // We encode our motion vectors as differences from the median of their neighbors 
+    // (see query_motion_vector_prediction). Runs of motion blocks that match their 
+    // prediction are coded as a single count, which is followed by the difference 
+    // that ends the run (if any).
+    uint32 start_bits = coder->query_occupancy();
+    uint16 motion_run = 0;
 
-    // Encode our x component differences.
     for (uint32 i = 0; i < block_count; i++)
     {
         if (!EVX_IS_MOTION_BLOCK_TYPE(block_table[i].block_type))
@@ -197,31 +441,42 @@ evx_status serialize_motion_vectors(uint16 block_count, evx_block_desc *block_ta
             continue;
         }
 
-        int16 current_x = block_table[i].motion_x - last_x;
-        entropy_stream_encode_value(current_x, feed_stream, coder, output);
-        last_x = block_table[i].motion_x;
-    }
+        int16 pred_x = 0, pred_y = 0;
+        query_motion_vector_prediction(block_table, width_in_blocks, i, &pred_x, &pred_y);
 
-    // Encode our y component differences.
-    for (uint32 i = 0; i < block_count; i++)
-    {
-        if (!EVX_IS_MOTION_BLOCK_TYPE(block_table[i].block_type))
+        int16 current_x = block_table[i].motion_x - pred_x;
+        int16 current_y = block_table[i].motion_y - pred_y;
+
+        stats->motion_vector_count++;
+
+        if (!current_x && !current_y)
         {
+            motion_run++;
             continue;
         }
 
-        int16 current_y = block_table[i].motion_y - last_y;
-        entropy_stream_encode_value(current_y, feed_stream, coder, output);
-        last_y = block_table[i].motion_y;
+        if (evx_failed(coder->encode_value(EVX_SYNTAX_MOTION_RUN, motion_run)) ||
+            evx_failed(coder->encode_value(EVX_SYNTAX_MOTION_X, current_x)) ||
+            evx_failed(coder->encode_value(EVX_SYNTAX_MOTION_Y, current_y)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        motion_run = 0;
     }
 
+    if (motion_run && evx_failed(coder->encode_value(EVX_SYNTAX_MOTION_RUN, motion_run)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    stats->motion_vector_bits += coder->query_occupancy() - start_bits;
+
     return EVX_SUCCESS;
 }
 
-evx_status serialize_subpixel_motion_params(uint16 block_count, evx_block_desc *block_table, bit_stream *feed_stream, entropy_coder *coder, bit_stream *output)
+evx_status serialize_subpixel_motion_params(uint16 block_count, evx_block_desc *block_table, symbol_coder *coder)
 {
-    feed_stream->empty();
-
     // Subpixel prediction enabled bit
     for (uint32 i = 0; i < block_count; i++)
     {
@@ -230,8 +485,7 @@ evx_status serialize_subpixel_motion_params(uint16 block_count, evx_block_desc *
             continue;
         }
 
-        feed_stream->write_bit(block_table[i].sp_pred);
-        coder->encode(feed_stream, output, false);
+        coder->encode_bits(EVX_SYNTAX_SUBPEL_ENABLED, block_table[i].sp_pred, 1);
     }
 
     // Subpixel level bit.
@@ -245,8 +499,7 @@ evx_status serialize_subpixel_motion_params(uint16 block_count, evx_block_desc *
             continue;
         }
 
-        feed_stream->write_bit(block_table[i].sp_amount);
-        coder->encode(feed_stream, output, false);
+        coder->encode_bits(EVX_SYNTAX_SUBPEL_AMOUNT, block_table[i].sp_amount, 1);
     }
 
     // Subpixel direction (degree) bits.
@@ -258,17 +511,15 @@ evx_status serialize_subpixel_motion_params(uint16 block_count, evx_block_desc *
             continue;
         }
         
-        feed_stream->write_bits(&block_table[i].sp_index, 3);
-        coder->encode(feed_stream, output, false);
+        coder->encode_bits(EVX_SYNTAX_SUBPEL_INDEX, block_table[i].sp_index, 3);
     }
 
     return EVX_SUCCESS;
 }
 
-evx_status serialize_block_quality(uint16 block_count, evx_block_desc *block_table, bit_stream *feed_stream, entropy_coder *coder, bit_stream *output)
+evx_status serialize_block_quality(uint16 block_count, evx_block_desc *block_table, symbol_coder *coder)
 {
     int16 last_q = 0; 
-    feed_stream->empty();
 
     for (uint32 i = 0; i < block_count; i++)
     {
@@ -278,37 +529,82 @@ evx_status serialize_block_quality(uint16 block_count, evx_block_desc *block_tab
         }
 
         int16 current_q = block_table[i].q_index - last_q;
-        stream_encode_value(current_q, feed_stream);
+
+        if (evx_failed(coder->encode_value(EVX_SYNTAX_BLOCK_QUALITY, current_q)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
         last_q = block_table[i].q_index;
     }
 
-    return coder->encode(feed_stream, output, false);
+    return EVX_SUCCESS;
+}
+
+evx_status serialize_coded_patterns(uint16 block_count, EVX_TRANSFORM_MODE transform_mode, evx_block_desc *block_table, symbol_coder *coder)
+{
+    for (uint32 i = 0; i < block_count; i++)
+    {
+        if (EVX_IS_COPY_BLOCK_TYPE(block_table[i].block_type))
+        {
+            continue;
+        }
+
+        uint8 coded_pattern = block_table[i].coded_pattern;
+
+        if (evx_failed(coder->encode_bits(EVX_SYNTAX_LUMA_PATTERN, coded_pattern & EVX_CODED_PATTERN_LUMA, 4)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        // Adaptive transform modes follow a fully coded luma pattern with its transform size.
+        if (EVX_IS_ADAPTIVE_TRANSFORM_MODE(transform_mode) && EVX_CODED_PATTERN_LUMA == (coded_pattern & EVX_CODED_PATTERN_LUMA) &&
+            evx_failed(coder->encode_bits(EVX_SYNTAX_TRANSFORM_SIZE, !!(coded_pattern & EVX_CODED_PATTERN_LUMA_16x16), 1)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+#if EVX_ENABLE_CHROMA_SUPPORT
+        if (evx_failed(coder->encode_bits(EVX_SYNTAX_CHROMA_PATTERN, (coded_pattern & (EVX_CODED_PATTERN_U | EVX_CODED_PATTERN_V)) >> 4, 2)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+#endif
+    }
+
+    return EVX_SUCCESS;
 }
 
-evx_status serialize_block_table(uint16 block_count, evx_block_desc *block_table, bit_stream *feed_stream, entropy_coder *coder, bit_stream *output)
+evx_status serialize_block_table(uint16 block_count, uint32 width_in_blocks, EVX_TRANSFORM_MODE transform_mode, evx_block_desc *block_table, 
+                                 symbol_coder *coder, evx_stream_stats *stats)
 {
     // Descriptors are serialized contiguously to improve efficiency.
-    if (evx_failed(serialize_block_types(block_count, block_table, feed_stream, coder, output)))
+    if (evx_failed(serialize_block_types(block_count, block_table, coder)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    if (evx_failed(serialize_prediction_targets(block_count, block_table, coder)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    if (evx_failed(serialize_prediction_targets(block_count, block_table, feed_stream, coder, output)))
+    if (evx_failed(serialize_motion_vectors(block_count, width_in_blocks, block_table, coder, stats)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    if (evx_failed(serialize_motion_vectors(block_count, block_table, feed_stream, coder, output)))
+    if (evx_failed(serialize_subpixel_motion_params(block_count, block_table, coder)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    if (evx_failed(serialize_subpixel_motion_params(block_count, block_table, feed_stream, coder, output)))
+    if (evx_failed(serialize_block_quality(block_count, block_table, coder)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    if (evx_failed(serialize_block_quality(block_count, block_table, feed_stream, coder, output)))
+    if (evx_failed(serialize_coded_patterns(block_count, transform_mode, block_table, coder)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
@@ -316,25 +612,72 @@ evx_status serialize_block_table(uint16 block_count, evx_block_desc *block_table
     return EVX_SUCCESS;
 }
 
-evx_status serialize_slice(const evx_frame &frame, evx_context *context, bit_stream *output)
+evx_status serialize_slice(const evx_frame &frame, evx_context *context, evx_slice *slice)
 {
-    uint16 block_count = context->width_in_blocks * context->height_in_blocks;
+    uint16 block_count = context->width_in_blocks * slice->row_count;
+    evx_block_desc *block_table = &context->block_table[slice->first_row * context->width_in_blocks];
+    bit_stream *output = &slice->slice_stream;
+
+    output->empty();
 
-    context->arith_coder.clear();
+    if (evx_failed(slice->coder.start_encode(output)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
 
-    // Serialize the encoded contents of our context, starting with the block table.
-    if (evx_failed(serialize_block_table(block_count, context->block_table, &context->feed_stream, &context->arith_coder, output)))
+    // Serialize the encoded contents of our slice, starting with the block table.
+    if (evx_failed(serialize_block_table(block_count, context->width_in_blocks, context->transform_mode, block_table, &slice->coder, &slice->stats)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
     
     // Serialize all transformed and quantized residuals.
-    if (evx_failed(serialize_macroblocks(context, output)))
+    if (evx_failed(serialize_macroblocks(context, slice)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
     
-    context->arith_coder.finish_encode(output);
+    if (evx_failed(slice->coder.finish_encode()))
+    {
+        return evx_post_error(EVX_ERROR_CAPACITY_LIMIT);
+    }
+
+    // Slices are stored at byte granularity, so we zero fill the final byte.
+    while (output->query_occupancy() % 8)
+    {
+        if (evx_failed(output->write_bit(0)))
+        {
+            return evx_post_error(EVX_ERROR_CAPACITY_LIMIT);
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status serialize_slices(evx_context *context, bit_stream *output)
+{
+    // The slice table holds the coded size of each slice, in bytes, and allows the 
+    // decoder to locate all slices of the frame before decoding any of them.
+    for (uint32 i = 0; i < context->slice_count; ++i)
+    {
+        uint32 slice_size = context->slices[i].slice_stream.query_byte_occupancy();
+
+        if (evx_failed(output->write_bytes(&slice_size, sizeof(uint32))))
+        {
+            return evx_post_error(EVX_ERROR_CAPACITY_LIMIT);
+        }
+    }
+
+    for (uint32 i = 0; i < context->slice_count; ++i)
+    {
+        bit_stream *slice_stream = &context->slices[i].slice_stream;
+        uint32 slice_size = slice_stream->query_byte_occupancy();
+
+        if (slice_size && evx_failed(slice_stream->transfer_bytes(output, slice_size)))
+        {
+            return evx_post_error(EVX_ERROR_CAPACITY_LIMIT);
+        }
+    }
 
     return EVX_SUCCESS;
 }
@@ -1,6 +1,7 @@
 
 #include "stream.h"
 #include "golomb.h"
+#include "egtables.h"
 #include "scan.h"
 
 namespace evx {
@@ -100,7 +101,7 @@ evx_status stream_encode_value(uint16 value, bit_stream *out_buffer)
     uint8 count = 0;
     uint32 golomb_value = encode_unsigned_golomb_value(value, &count);
 
-    return out_buffer->write_bits(&golomb_value, count);
+    return out_buffer->put_bits(golomb_value, count);
 }
 
 evx_status stream_encode_value(int16 value, bit_stream *out_buffer)
@@ -116,7 +117,7 @@ evx_status stream_encode_value(int16 value, bit_stream *out_buffer)
     uint8 count = 0;
     uint32 golomb_value = encode_signed_golomb_value(value, &count);
 
-    return out_buffer->write_bits(&golomb_value, count);
+    return out_buffer->put_bits(golomb_value, count);
 }
 
 evx_status stream_encode_values(uint16 *data, uint32 count, bit_stream *out_buffer)
@@ -172,9 +173,9 @@ evx_status stream_decode_value(bit_stream *data, uint16 *output)
     }
 
     uint32 value = 0;
-    uint8 count = evx_min2(32, data->query_byte_occupancy());
+    uint8 count = 0;
 
-    evx_status result = data->peek_bits(&value, count);
+    evx_status result = data->show_bits(32, &value);
     *output = decode_unsigned_golomb_value(value, &count);
     data->seek(count);
 
@@ -192,9 +193,9 @@ evx_status stream_decode_value(bit_stream *data, int16 *output)
     }
 
     uint32 value = 0;
-    uint8 count = evx_min2(32, data->query_byte_occupancy());
+    uint8 count = 0;
     
-    evx_status result = data->peek_bits(&value, count);
+    evx_status result = data->show_bits(32, &value);
     *output = decode_signed_golomb_value(value, &count);
     data->seek(count);
 
@@ -243,6 +244,71 @@ evx_status stream_decode_values(bit_stream *data, uint32 count, int16 *output)
     return EVX_SUCCESS;
 }
 
+evx_status stream_encode_block(int16 *data, const uint8 *scan, uint32 count, bit_stream *out_buffer)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!data || !scan || 0 == count || !out_buffer || 0 == out_buffer->query_capacity())
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    uint64 pending = 0;
+    uint8 pending_count = 0;
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        int16 value = data[scan[i]];
+        uint32 code = 0;
+        uint8 code_count = 0;
+
+        if (value >= -128 && value < 128)
+        {
+            uint8 index = (uint8) value;
+            code = EVX_SEXP_GOLOMB_CODES[index];
+            code_count = EVX_SEXP_GOLOMB_SIZE_LUT[index];
+        }
+        else
+        {
+            code = encode_signed_golomb_value(value, &code_count);
+        }
+
+        // Signed codes never exceed 32 bits, so a full word is always available to flush
+        // while fewer than 32 bits remain pending.
+        pending |= uint64(code) << pending_count;
+        pending_count += code_count;
+
+        if (pending_count >= 32)
+        {
+            if (evx_failed(out_buffer->put_bits((uint32) pending, 32)))
+            {
+                return evx_post_error(EVX_ERROR_CAPACITY_LIMIT);
+            }
+
+            pending >>= 32;
+            pending_count -= 32;
+        }
+    }
+
+    if (pending_count && evx_failed(out_buffer->put_bits((uint32) pending, pending_count)))
+    {
+        return evx_post_error(EVX_ERROR_CAPACITY_LIMIT);
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status stream_encode_8x8(int16 *data, bit_stream *out_buffer)
+{
+    return stream_encode_block(data, EVX_MACROBLOCK_8x8_ZIGZAG, 64, out_buffer);
+}
+
+evx_status stream_encode_16x16(int16 *data, bit_stream *out_buffer)
+{
+    return stream_encode_block(data, EVX_MACROBLOCK_16x16_ZIGZAG, 256, out_buffer);
+}
+
 evx_status entropy_stream_encode_value(uint16 value, bit_stream *feed_stream, entropy_coder *coder, bit_stream *output)
 {
     if (EVX_PARAM_CHECK)
@@ -301,7 +367,6 @@ evx_status entropy_stream_decode_value(bit_stream *input, entropy_coder *coder,
 
     uint16 result = 0; 
     uint8 zero_count = 0;
-    uint8 bit_count = 0;
     uint8 bit_value = 0;
 
     if (EVX_SUCCESS != coder->decode(1, input, feed_stream, false))
@@ -316,7 +381,11 @@ evx_status entropy_stream_decode_value(bit_stream *input, entropy_coder *coder,
 
     while (!bit_value) 
     {
-        zero_count++;
+        // Valid 16-bit codes never carry more than 16 prefix zeroes.
+        if (++zero_count > 16)
+        {
+            return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+        }
 
         if (EVX_SUCCESS != coder->decode(1, input, feed_stream, false))
         {
@@ -329,25 +398,21 @@ evx_status entropy_stream_decode_value(bit_stream *input, entropy_coder *coder,
         }
     }
 
-    bit_count = zero_count + 1;
+    result = 1;
 
-    for (uint8 i = 0; i < bit_count; i++) 
+    if (zero_count)
     {
-        result <<= 1;
-        result |= bit_value & 0x1;
+        // The suffix follows the terminating one bit of the prefix, msb first. We decode 
+        // it in a single pass and then restore its bit order with a word reversal.
+        uint32 suffix = 0;
 
-        if (i < bit_count - 1)
+        if (EVX_SUCCESS != coder->decode(zero_count, input, feed_stream, false) ||
+            EVX_SUCCESS != feed_stream->get_bits(zero_count, &suffix))
         {
-            if (EVX_SUCCESS != coder->decode(1, input, feed_stream, false))
-            {
-                return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
-            }
-
-            if (EVX_SUCCESS != feed_stream->read_bit(&bit_value))
-            {
-                return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
-            }
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
         }
+
+        result = (1 << zero_count) | reverse_bits(suffix, zero_count);
     }
 
     result -= 1;
@@ -384,7 +449,11 @@ evx_status entropy_stream_decode_value(bit_stream *input, entropy_coder *coder,
 
     while (!bit_value) 
     {
-        zero_count++;
+        // Valid 16-bit codes never carry more than 16 prefix zeroes.
+        if (++zero_count > 16)
+        {
+            return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+        }
         
         if (EVX_SUCCESS != coder->decode(1, input, feed_stream, false))
         {
@@ -398,24 +467,21 @@ evx_status entropy_stream_decode_value(bit_stream *input, entropy_coder *coder,
     }
 
     bit_count = zero_count + 1;
+    result = 1;
 
-    for (uint8 i = 0; i < bit_count; i++) 
+    if (zero_count)
     {
-        result <<= 1;
-        result |= bit_value & 0x1;
+        // The suffix follows the terminating one bit of the prefix, msb first. We decode 
+        // it in a single pass and then restore its bit order with a word reversal.
+        uint32 suffix = 0;
 
-        if (i < bit_count - 1)
+        if (EVX_SUCCESS != coder->decode(zero_count, input, feed_stream, false) ||
+            EVX_SUCCESS != feed_stream->get_bits(zero_count, &suffix))
         {
-            if (EVX_SUCCESS != coder->decode(1, input, feed_stream, false))
-            {
-                return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
-            }
-
-            if (EVX_SUCCESS != feed_stream->read_bit(&bit_value))
-            {
-                return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
-            }
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
         }
+
+        result = (1 << zero_count) | reverse_bits(suffix, zero_count);
     }
 
     // Remove the lowest bit as our sign bit.
@@ -572,7 +638,7 @@ evx_status entropy_rle_stream_encode_8x8(int16 *input, bit_stream *feed_stream,
 
     entropy_stream_encode_value((uint16) run_length, feed_stream, coder, output);
 
-    for (uint32 read_index = 0; read_index < run_length; ++read_index)
+    for (int32 read_index = 0; read_index < run_length; ++read_index)
     {
         entropy_stream_encode_value(input[EVX_MACROBLOCK_8x8_ZIGZAG[read_index]], feed_stream, coder, output);
     }
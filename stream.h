@@ -60,6 +60,13 @@ evx_status stream_decode_value(bit_stream *data, int16 *output);
 evx_status stream_decode_values(bit_stream *data, uint32 count, uint16 *output);
 evx_status stream_decode_values(bit_stream *data, uint32 count, int16 *output);
 
+// Block based golomb precoding. These methods precode count signed values of a contiguous
+// block, visited in scan order, in a single call. Codes are gathered in a 64-bit register 
+// and appended to the stream a word at a time.
+evx_status stream_encode_block(int16 *data, const uint8 *scan, uint32 count, bit_stream *out_buffer);
+evx_status stream_encode_8x8(int16 *data, bit_stream *out_buffer);
+evx_status stream_encode_16x16(int16 *data, bit_stream *out_buffer);
+
 // These methods combine a golomb precoder with the entropy coder.
 evx_status entropy_stream_encode_value(uint16 value, bit_stream *feed_stream, entropy_coder *coder, bit_stream *output);
 evx_status entropy_stream_encode_value(int16 value, bit_stream *feed_stream, entropy_coder *coder, bit_stream *output);
@@ -0,0 +1,957 @@
+
+#include "symbol.h"
+#include "config.h"
+#include "math.h"
+#include "golomb.h"
+#include "egtables.h"
+#include "hufftables.h"
+
+// Values are coded as a magnitude class (0 for zero, otherwise one plus the index
+// of the most significant bit), so every value model spans 17 classes.
+#define EVX_SYMBOL_MAGNITUDE_CLASSES            (17)
+#define EVX_SYMBOL_AC_LOW_COUNT                 (6)
+
+// Huffman mode codes each ac coefficient as a (zero run, magnitude class) pair symbol. 
+// Runs of 16 or more zeroes are split with the zero run symbol.
+#define EVX_SYMBOL_PAIR_SYMBOLS                 (257)
+#define EVX_SYMBOL_ZERO_RUN_SYMBOL              (256)
+
+// Layout of the contexts of each element and neighbour state (context mode).
+#define EVX_SYMBOL_PREFIX_OFFSET                (0)
+#define EVX_SYMBOL_SUFFIX_OFFSET                (EVX_SYMBOL_PREFIX_OFFSET + EVX_SYMBOL_PREFIX_CONTEXTS)
+#define EVX_SYMBOL_TREE_OFFSET                  (EVX_SYMBOL_SUFFIX_OFFSET + EVX_SYMBOL_SUFFIX_CONTEXTS)
+#define EVX_SYMBOL_SIGN_OFFSET                  (EVX_SYMBOL_TREE_OFFSET + EVX_SYMBOL_TREE_CONTEXTS)
+
+namespace evx {
+
+EVX_SYNTAX_ELEMENT query_coefficient_element(uint32 index)
+{
+    if (0 == index)
+    {
+        return EVX_SYNTAX_DC_COEFFICIENT;
+    }
+
+    return (index < EVX_SYMBOL_AC_LOW_COUNT) ? EVX_SYNTAX_AC_LOW_COEFFICIENT : EVX_SYNTAX_AC_HIGH_COEFFICIENT;
+}
+
+static uint32 query_element_symbol_count(uint32 element)
+{
+    // Fixed width fields code their value as a symbol, and values their magnitude class.
+    uint32 target_count = 0x1 << log2((uint8) EVX_REFERENCE_FRAME_COUNT);
+
+    switch (element)
+    {
+        case EVX_SYNTAX_BLOCK_TYPE: return 8;
+        case EVX_SYNTAX_PREDICTION_TARGET: return evx_max2(target_count, 2);
+        case EVX_SYNTAX_SUBPEL_ENABLED: return 2;
+        case EVX_SYNTAX_SUBPEL_AMOUNT: return 2;
+        case EVX_SYNTAX_SUBPEL_INDEX: return 8;
+        case EVX_SYNTAX_LUMA_PATTERN: return 16;
+        case EVX_SYNTAX_CHROMA_PATTERN: return 4;
+        case EVX_SYNTAX_TRANSFORM_SIZE: return 2;
+        default: break;
+    }
+
+    return EVX_SYMBOL_MAGNITUDE_CLASSES;
+}
+
+symbol_coder::symbol_coder()
+{
+    mode = EVX_ENTROPY_MODE_ABAC;
+    stream = NULL;
+}
+
+evx_status symbol_coder::initialize(EVX_ENTROPY_MODE entropy_mode)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (entropy_mode >= EVX_ENTROPY_MODE_COUNT)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    mode = entropy_mode;
+    stream = NULL;
+
+    if (EVX_ENTROPY_MODE_HUFFMAN == mode)
+    {
+        for (uint32 i = 0; i < EVX_SYNTAX_ELEMENT_COUNT; ++i)
+        {
+            if (evx_failed(huffman_tables[i].initialize(EVX_HUFFMAN_ELEMENT_LENGTHS[i], query_element_symbol_count(i))))
+            {
+                return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            }
+        }
+
+        if (evx_failed(coefficient_table.initialize(EVX_HUFFMAN_PAIR_LENGTHS, EVX_SYMBOL_PAIR_SYMBOLS)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
+EVX_ENTROPY_MODE symbol_coder::query_mode() const
+{
+    return mode;
+}
+
+uint32 symbol_coder::query_occupancy() const
+{
+    return stream ? stream->query_occupancy() : 0;
+}
+
+evx_status symbol_coder::reset_models()
+{
+    for (uint32 i = 0; i < EVX_SYNTAX_ELEMENT_COUNT; ++i)
+    {
+        uint32 symbol_count = query_element_symbol_count(i);
+
+        for (uint32 k = 0; k < EVX_SYMBOL_NEIGHBOUR_STATES; ++k)
+        {
+            if (evx_failed(models[i][k].initialize(symbol_count)))
+            {
+                return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            }
+
+            for (uint32 c = 0; c < EVX_SYMBOL_CONTEXT_COUNT; ++c)
+            {
+                contexts[i][k][c].clear();
+            }
+        }
+
+        last_values[i] = 0;
+    }
+
+    return EVX_SUCCESS;
+}
+
+uint8 symbol_coder::query_neighbour_state(EVX_SYNTAX_ELEMENT element) const
+{
+    uint16 last_value = last_values[element];
+
+    switch (element)
+    {
+        // Fixed width fields are conditioned on the previous field itself.
+        case EVX_SYNTAX_BLOCK_TYPE:
+        case EVX_SYNTAX_PREDICTION_TARGET:
+        case EVX_SYNTAX_SUBPEL_ENABLED:
+        case EVX_SYNTAX_SUBPEL_AMOUNT:
+        case EVX_SYNTAX_SUBPEL_INDEX:
+        case EVX_SYNTAX_CHROMA_PATTERN:
+            return last_value & (EVX_SYMBOL_NEIGHBOUR_STATES - 1);
+
+        // Luma patterns are conditioned on the number of coded blocks in the previous pattern.
+        case EVX_SYNTAX_LUMA_PATTERN:
+            return (last_value & 0x1) + ((last_value >> 1) & 0x1) + ((last_value >> 2) & 0x1) + ((last_value >> 3) & 0x1);
+
+        default: break;
+    }
+
+    // Values are conditioned on the magnitude class of the previous value.
+    if (!last_value)
+    {
+        return 0;
+    }
+
+    return evx_min2(log2(last_value) + 1, EVX_SYMBOL_NEIGHBOUR_STATES - 1);
+}
+
+evx_status symbol_coder::start_encode(bit_stream *output)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!output)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    stream = output;
+    binary_coder.clear();
+
+    if (evx_failed(reset_models()))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    if (EVX_ENTROPY_MODE_RANGE == mode)
+    {
+        return multi_coder.start_encode(output);
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status symbol_coder::finish_encode()
+{
+    if (EVX_ENTROPY_MODE_RANGE == mode)
+    {
+        return multi_coder.finish_encode();
+    }
+
+    // Huffman codes are written directly to the stream, and require no flush.
+    if (EVX_ENTROPY_MODE_HUFFMAN == mode)
+    {
+        return EVX_SUCCESS;
+    }
+
+    return binary_coder.finish_encode(stream);
+}
+
+evx_status symbol_coder::start_decode(bit_stream *input)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!input)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    stream = input;
+
+    if (evx_failed(reset_models()))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    if (EVX_ENTROPY_MODE_RANGE == mode)
+    {
+        return multi_coder.start_decode(input);
+    }
+
+    if (EVX_ENTROPY_MODE_HUFFMAN == mode)
+    {
+        return EVX_SUCCESS;
+    }
+
+    return binary_coder.start_decode(input);
+}
+
+evx_status symbol_coder::encode_context_bit(EVX_SYNTAX_ELEMENT element, uint32 index, uint8 bit)
+{
+    entropy_context *context = &contexts[element][query_neighbour_state(element)][index];
+
+    return binary_coder.encode_bit(bit, context, stream);
+}
+
+evx_status symbol_coder::decode_context_bit(EVX_SYNTAX_ELEMENT element, uint32 index, uint8 *bit)
+{
+    entropy_context *context = &contexts[element][query_neighbour_state(element)][index];
+
+    return binary_coder.decode_bit(stream, context, bit);
+}
+
+evx_status symbol_coder::encode_magnitude(EVX_SYNTAX_ELEMENT element, uint16 magnitude)
+{
+    uint8 magnitude_class = magnitude ? log2(magnitude) + 1 : 0;
+
+    if (EVX_ENTROPY_MODE_HUFFMAN == mode)
+    {
+        if (evx_failed(huffman_tables[element].encode_symbol(magnitude_class, stream)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+    else
+    {
+        symbol_model *model = &models[element][query_neighbour_state(element)];
+
+        if (evx_failed(multi_coder.encode_symbol(magnitude_class, model)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    // The most significant bit is implied by the class, so only the bits below it are sent.
+    if (magnitude_class > 1)
+    {
+        return encode_raw_bits(magnitude & ((0x1 << (magnitude_class - 1)) - 1), magnitude_class - 1);
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status symbol_coder::decode_magnitude(EVX_SYNTAX_ELEMENT element, uint16 *magnitude)
+{
+    uint32 magnitude_class = 0;
+    uint32 mantissa = 0;
+
+    if (EVX_ENTROPY_MODE_HUFFMAN == mode)
+    {
+        if (evx_failed(huffman_tables[element].decode_symbol(stream, &magnitude_class)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+    else
+    {
+        symbol_model *model = &models[element][query_neighbour_state(element)];
+
+        if (evx_failed(multi_coder.decode_symbol(model, &magnitude_class)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    if (0 == magnitude_class)
+    {
+        *magnitude = 0;
+        return EVX_SUCCESS;
+    }
+
+    if (evx_failed(decode_raw_bits(magnitude_class - 1, &mantissa)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    *magnitude = (uint16) ((0x1 << (magnitude_class - 1)) | mantissa);
+
+    return EVX_SUCCESS;
+}
+
+evx_status symbol_coder::encode_raw_bits(uint32 value, uint8 count)
+{
+    // Raw bits bypass the models of the range coder, and are written as is in huffman mode.
+    if (EVX_ENTROPY_MODE_HUFFMAN == mode)
+    {
+        return stream->put_bits(value, count);
+    }
+
+    return multi_coder.encode_bits(value, count);
+}
+
+evx_status symbol_coder::decode_raw_bits(uint8 count, uint32 *value)
+{
+    if (EVX_ENTROPY_MODE_HUFFMAN == mode)
+    {
+        return stream->get_bits(count, value);
+    }
+
+    return multi_coder.decode_bits(count, value);
+}
+
+evx_status symbol_coder::decode_golomb(uint32 *code, uint8 *zero_count)
+{
+    // Golomb codes (abac mode) carry a prefix of zeroes that is terminated by the leading
+    // one bit of the code value. The remaining bits of the value follow, msb first.
+    uint32 bit = 0;
+    uint32 suffix = 0;
+    uint8 prefix_count = 0;
+
+    while (true)
+    {
+        if (evx_failed(binary_coder.decode_bits(1, stream, &bit)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        if (bit)
+        {
+            break;
+        }
+
+        // Valid 16-bit codes never carry more than 16 prefix zeroes.
+        if (++prefix_count > 16)
+        {
+            return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+        }
+    }
+
+    if (prefix_count)
+    {
+        if (evx_failed(binary_coder.decode_bits(prefix_count, stream, &suffix)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        suffix = reverse_bits(suffix, prefix_count);
+    }
+
+    *code = (0x1 << prefix_count) | suffix;
+    *zero_count = prefix_count;
+
+    return EVX_SUCCESS;
+}
+
+evx_status symbol_coder::encode_binarized(EVX_SYNTAX_ELEMENT element, uint16 magnitude)
+{
+    // We code magnitude + 1 as an exp-golomb code: a unary prefix that holds the index
+    // of the most significant bit, followed by the bits below it. The prefix bins and the
+    // leading suffix bin carry most of the information, so each receives a context.
+    uint32 value = magnitude + 1;
+    uint8 bit_count = log2(value);
+
+    for (uint8 i = 0; i <= bit_count; ++i)
+    {
+        uint32 index = EVX_SYMBOL_PREFIX_OFFSET + evx_min2(i, EVX_SYMBOL_PREFIX_CONTEXTS - 1);
+
+        if (evx_failed(encode_context_bit(element, index, i == bit_count)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    for (int8 i = bit_count - 1; i >= 0; --i)
+    {
+        uint32 index = EVX_SYMBOL_SUFFIX_OFFSET + (i == bit_count - 1 ? bit_count - 1 : EVX_SYMBOL_SUFFIX_CONTEXTS - 1);
+
+        if (evx_failed(encode_context_bit(element, index, (value >> i) & 0x1)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status symbol_coder::decode_binarized(EVX_SYNTAX_ELEMENT element, uint16 *magnitude)
+{
+    uint8 bit_count = 0;
+    uint8 bit = 0;
+
+    while (true)
+    {
+        uint32 index = EVX_SYMBOL_PREFIX_OFFSET + evx_min2(bit_count, EVX_SYMBOL_PREFIX_CONTEXTS - 1);
+
+        if (evx_failed(decode_context_bit(element, index, &bit)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        if (bit)
+        {
+            break;
+        }
+
+        // A 16 bit magnitude never requires more than 16 prefix zeroes.
+        if (++bit_count > 16)
+        {
+            return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+        }
+    }
+
+    uint32 value = 0x1;
+
+    for (int8 i = bit_count - 1; i >= 0; --i)
+    {
+        uint32 index = EVX_SYMBOL_SUFFIX_OFFSET + (i == bit_count - 1 ? bit_count - 1 : EVX_SYMBOL_SUFFIX_CONTEXTS - 1);
+
+        if (evx_failed(decode_context_bit(element, index, &bit)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        value = (value << 1) | bit;
+    }
+
+    *magnitude = (uint16) (value - 1);
+
+    return EVX_SUCCESS;
+}
+
+evx_status symbol_coder::encode_value(EVX_SYNTAX_ELEMENT element, uint16 value)
+{
+    evx_status result = EVX_SUCCESS;
+
+    switch (mode)
+    {
+        case EVX_ENTROPY_MODE_ABAC:
+        {
+            uint8 count = 0;
+            uint32 code = encode_unsigned_golomb_value(value, &count);
+
+            return binary_coder.encode_bits(code, count, stream);
+        }
+
+        case EVX_ENTROPY_MODE_RANGE:
+        case EVX_ENTROPY_MODE_HUFFMAN: result = encode_magnitude(element, value); break;
+        default: result = encode_binarized(element, value); break;
+    }
+
+    last_values[element] = value;
+
+    return result;
+}
+
+evx_status symbol_coder::encode_value(EVX_SYNTAX_ELEMENT element, int16 value)
+{
+    if (EVX_ENTROPY_MODE_ABAC == mode)
+    {
+        uint8 count = 0;
+        uint32 code = encode_signed_golomb_value(value, &count);
+
+        return binary_coder.encode_bits(code, count, stream);
+    }
+
+    uint16 magnitude = (uint16) abs(value);
+
+    if (EVX_ENTROPY_MODE_RANGE == mode || EVX_ENTROPY_MODE_HUFFMAN == mode)
+    {
+        if (evx_failed(encode_magnitude(element, magnitude)) ||
+            (value && evx_failed(encode_raw_bits(value < 0, 1))))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+    else
+    {
+        if (evx_failed(encode_binarized(element, magnitude)) ||
+            (value && evx_failed(encode_context_bit(element, EVX_SYMBOL_SIGN_OFFSET, value < 0))))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    last_values[element] = magnitude;
+
+    return EVX_SUCCESS;
+}
+
+evx_status symbol_coder::decode_value(EVX_SYNTAX_ELEMENT element, uint16 *value)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!value)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    evx_status result = EVX_SUCCESS;
+
+    switch (mode)
+    {
+        case EVX_ENTROPY_MODE_ABAC:
+        {
+            uint32 code = 0;
+            uint8 zero_count = 0;
+
+            if (evx_failed(decode_golomb(&code, &zero_count)))
+            {
+                return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            }
+
+            *value = (uint16) (code - 1);
+
+            return EVX_SUCCESS;
+        }
+
+        case EVX_ENTROPY_MODE_RANGE:
+        case EVX_ENTROPY_MODE_HUFFMAN: result = decode_magnitude(element, value); break;
+        default: result = decode_binarized(element, value); break;
+    }
+
+    last_values[element] = *value;
+
+    return result;
+}
+
+evx_status symbol_coder::decode_value(EVX_SYNTAX_ELEMENT element, int16 *value)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!value)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    if (EVX_ENTROPY_MODE_ABAC == mode)
+    {
+        uint32 code = 0;
+        uint8 zero_count = 0;
+
+        if (evx_failed(decode_golomb(&code, &zero_count)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        // The lowest bit of a signed code holds the sign, and codes of more than 32 bits 
+        // only occur for the minimum int16.
+        int16 result = (int16) code;
+        result = (1 - 2 * (result & 0x1)) * ((result >> 1) & 0x7FFF);
+
+        if (2 * zero_count + 1 > 32)
+        {
+            result |= 0x8000;
+        }
+
+        *value = result;
+
+        return EVX_SUCCESS;
+    }
+
+    uint16 magnitude = 0;
+    uint8 sign = 0;
+
+    if (EVX_ENTROPY_MODE_RANGE == mode || EVX_ENTROPY_MODE_HUFFMAN == mode)
+    {
+        uint32 sign_bit = 0;
+
+        if (evx_failed(decode_magnitude(element, &magnitude)) ||
+            (magnitude && evx_failed(decode_raw_bits(1, &sign_bit))))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        sign = (uint8) sign_bit;
+    }
+    else
+    {
+        if (evx_failed(decode_binarized(element, &magnitude)) ||
+            (magnitude && evx_failed(decode_context_bit(element, EVX_SYMBOL_SIGN_OFFSET, &sign))))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    *value = sign ? -(int16) magnitude : (int16) magnitude;
+    last_values[element] = magnitude;
+
+    return EVX_SUCCESS;
+}
+
+evx_status symbol_coder::encode_coefficients(int16 *block, uint32 count, const uint8 *scan)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!block || !scan || count > 256)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    if (!count)
+    {
+        return EVX_SUCCESS;
+    }
+
+    if (EVX_ENTROPY_MODE_ABAC == mode)
+    {
+        // All coefficients share a single model, so the golomb codes of the block are 
+        // gathered in a register and passed to the entropy coder a word at a time.
+        uint64 pending = 0;
+        uint8 pending_count = 0;
+
+        for (uint32 i = 0; i < count; ++i)
+        {
+            int16 value = block[scan[i]];
+            uint32 code = 0;
+            uint8 code_count = 0;
+
+            if (value >= -128 && value < 128)
+            {
+                uint8 index = (uint8) value;
+                code = EVX_SEXP_GOLOMB_CODES[index];
+                code_count = EVX_SEXP_GOLOMB_SIZE_LUT[index];
+            }
+            else
+            {
+                code = encode_signed_golomb_value(value, &code_count);
+            }
+
+            pending |= uint64(code) << pending_count;
+            pending_count += code_count;
+
+            if (pending_count >= 32)
+            {
+                if (evx_failed(binary_coder.encode_bits((uint32) pending, 32, stream)))
+                {
+                    return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+                }
+
+                pending >>= 32;
+                pending_count -= 32;
+            }
+        }
+
+        return binary_coder.encode_bits((uint32) pending, pending_count, stream);
+    }
+
+    if (EVX_ENTROPY_MODE_HUFFMAN == mode)
+    {
+        return encode_huffman_coefficients(block, count, scan);
+    }
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        if (evx_failed(encode_value(query_coefficient_element(i), block[scan[i]])))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status symbol_coder::decode_coefficients(uint32 count, int16 *block, const uint8 *scan)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!block || !scan || count > 256)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    if (EVX_ENTROPY_MODE_HUFFMAN == mode)
+    {
+        return decode_huffman_coefficients(count, block, scan);
+    }
+
+    for (uint32 i = 0; i < count; ++i)
+    {
+        if (evx_failed(decode_value(query_coefficient_element(i), &block[scan[i]])))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status symbol_coder::encode_huffman_coefficients(int16 *block, uint32 count, const uint8 *scan)
+{
+    // The dc is coded as a value, and each nonzero ac coefficient as a single symbol that
+    // joins the number of zeroes that precede it with its magnitude class. The mantissa
+    // and sign follow in one raw field. The block ends with its last nonzero coefficient,
+    // so no end of block symbol is required.
+    if (0 == count)
+    {
+        return EVX_SUCCESS;
+    }
+
+    if (evx_failed(encode_value(EVX_SYNTAX_DC_COEFFICIENT, block[0])))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    uint32 zero_run = 0;
+
+    for (uint32 i = 1; i < count; ++i)
+    {
+        int16 value = block[scan[i]];
+
+        if (!value)
+        {
+            zero_run++;
+            continue;
+        }
+
+        for (; zero_run >= 16; zero_run -= 16)
+        {
+            if (evx_failed(coefficient_table.encode_symbol(EVX_SYMBOL_ZERO_RUN_SYMBOL, stream)))
+            {
+                return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            }
+        }
+
+        uint16 magnitude = (uint16) abs(value);
+        uint8 magnitude_class = log2(magnitude) + 1;
+        uint32 field = (magnitude & ((0x1 << (magnitude_class - 1)) - 1)) | ((value < 0) << (magnitude_class - 1));
+
+        if (evx_failed(coefficient_table.encode_symbol((zero_run << 4) | (magnitude_class - 1), stream)) ||
+            evx_failed(stream->put_bits(field, magnitude_class)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        zero_run = 0;
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status symbol_coder::decode_huffman_coefficients(uint32 count, int16 *block, const uint8 *scan)
+{
+    if (0 == count)
+    {
+        return EVX_SUCCESS;
+    }
+
+    if (evx_failed(decode_value(EVX_SYNTAX_DC_COEFFICIENT, &block[0])))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    uint32 i = 1;
+
+    while (i < count)
+    {
+        uint32 symbol = 0;
+        uint32 field = 0;
+
+        if (evx_failed(coefficient_table.decode_symbol(stream, &symbol)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        if (EVX_SYMBOL_ZERO_RUN_SYMBOL == symbol)
+        {
+            i += 16;
+            continue;
+        }
+
+        uint8 magnitude_class = (symbol & 0xF) + 1;
+        i += (symbol >> 4);
+
+        if (i >= count || evx_failed(stream->get_bits(magnitude_class, &field)))
+        {
+            return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+        }
+
+        uint16 magnitude = (uint16) ((0x1 << (magnitude_class - 1)) | (field & ((0x1 << (magnitude_class - 1)) - 1)));
+        block[scan[i++]] = (field >> (magnitude_class - 1)) ? -(int16) magnitude : (int16) magnitude;
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status symbol_coder::encode_bits(EVX_SYNTAX_ELEMENT element, uint8 value, uint8 count)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (count > 8)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    if (!count)
+    {
+        return EVX_SUCCESS;
+    }
+
+    value &= (0x1 << count) - 1;
+
+    switch (mode)
+    {
+        case EVX_ENTROPY_MODE_ABAC:
+        {
+            return binary_coder.encode_bits(value, count, stream);
+        }
+
+        case EVX_ENTROPY_MODE_HUFFMAN:
+        {
+            return huffman_tables[element].encode_symbol(value, stream);
+        }
+
+        case EVX_ENTROPY_MODE_RANGE:
+        {
+            symbol_model *model = &models[element][query_neighbour_state(element)];
+
+            if (evx_failed(multi_coder.encode_symbol(value, model)))
+            {
+                return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            }
+
+        } break;
+
+        default:
+        {
+            // Fields are coded msb first as a binary tree, with one context per node.
+            uint32 node = 1;
+
+            for (int8 i = count - 1; i >= 0; --i)
+            {
+                uint8 bit = (value >> i) & 0x1;
+                uint32 index = EVX_SYMBOL_TREE_OFFSET + evx_min2(node, EVX_SYMBOL_TREE_CONTEXTS - 1);
+
+                if (evx_failed(encode_context_bit(element, index, bit)))
+                {
+                    return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+                }
+
+                node = (node << 1) | bit;
+            }
+
+        } break;
+    }
+
+    last_values[element] = value;
+
+    return EVX_SUCCESS;
+}
+
+evx_status symbol_coder::decode_bits(EVX_SYNTAX_ELEMENT element, uint8 count, uint8 *value)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (count > 8 || !value)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    *value = 0;
+
+    if (!count)
+    {
+        return EVX_SUCCESS;
+    }
+
+    switch (mode)
+    {
+        case EVX_ENTROPY_MODE_ABAC:
+        {
+            uint32 bits = 0;
+            evx_status result = binary_coder.decode_bits(count, stream, &bits);
+            *value = (uint8) bits;
+
+            return result;
+        }
+
+        case EVX_ENTROPY_MODE_HUFFMAN:
+        {
+            uint32 symbol = 0;
+            evx_status result = huffman_tables[element].decode_symbol(stream, &symbol);
+            *value = (uint8) symbol;
+
+            return result;
+        }
+
+        case EVX_ENTROPY_MODE_RANGE:
+        {
+            uint32 symbol = 0;
+            symbol_model *model = &models[element][query_neighbour_state(element)];
+
+            if (evx_failed(multi_coder.decode_symbol(model, &symbol)))
+            {
+                return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            }
+
+            *value = (uint8) symbol;
+
+        } break;
+
+        default:
+        {
+            uint32 node = 1;
+
+            for (uint8 i = 0; i < count; ++i)
+            {
+                uint8 bit = 0;
+                uint32 index = EVX_SYMBOL_TREE_OFFSET + evx_min2(node, EVX_SYMBOL_TREE_CONTEXTS - 1);
+
+                if (evx_failed(decode_context_bit(element, index, &bit)))
+                {
+                    return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+                }
+
+                node = (node << 1) | bit;
+                *value = (*value << 1) | bit;
+            }
+
+        } break;
+    }
+
+    last_values[element] = *value;
+
+    return EVX_SUCCESS;
+}
+
+} // namespace evx
\ No newline at end of file
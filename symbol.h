@@ -0,0 +1,175 @@
+
+/*
+// Copyright (c) 2009-2014 Joe Bertolami. All Right Reserved.
+//
+// symbol.h
+//
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Additional Information:
+//
+*/
+
+#ifndef __EVX_SYMBOL_H__
+#define __EVX_SYMBOL_H__
+
+#include "base.h"
+#include "types.h"
+#include "bitstream.h"
+#include "abac.h"
+#include "range.h"
+#include "huffman.h"
+
+// The symbol coder is the single entry point used by the serializer to code the
+// syntax elements of a slice. It forwards each element to the entropy backend that 
+// was selected for the stream (see EVX_ENTROPY_MODE):
+//
+//  o: abac mode precodes values with golomb codes and codes the resulting bits with
+//     the adaptive binary entropy_coder. This is the original EVX-1 bitstream.
+//
+//  o: range mode codes the magnitude class of each value as a single symbol against
+//     an adaptive model that is private to its syntax element, followed by the raw
+//     mantissa and sign bits. Fixed width fields are coded as one symbol each.
+//
+//  o: context mode binarizes values with exp-golomb codes and codes each bin with the
+//     entropy_coder against a context selected by the syntax element, the position of
+//     the bin within the code, and the neighbour state of the element.
+//
+//  o: huffman mode codes the same symbols as range mode against static huffman tables
+//     that were trained offline (see hufftables.h), and writes the mantissa and sign 
+//     bits raw. Ac coefficients are coded as joint (zero run, magnitude class) symbols.
+//     There is no adaptive state, so decoding is a table lookup per symbol.
+//
+// The neighbour state of an element is derived from the previous value that was coded
+// for the same element within the slice (e.g. the type of the preceding block).
+
+namespace evx {
+
+enum EVX_SYNTAX_ELEMENT
+{
+    EVX_SYNTAX_BLOCK_TYPE           = 0,
+    EVX_SYNTAX_SKIP_RUN             = 1,        // number of copy blocks that precede a block type.
+    EVX_SYNTAX_PREDICTION_TARGET    = 2,
+    EVX_SYNTAX_MOTION_RUN           = 3,        // number of unchanged motion vectors that precede a difference.
+    EVX_SYNTAX_MOTION_X             = 4,
+    EVX_SYNTAX_MOTION_Y             = 5,
+    EVX_SYNTAX_SUBPEL_ENABLED       = 6,
+    EVX_SYNTAX_SUBPEL_AMOUNT        = 7,
+    EVX_SYNTAX_SUBPEL_INDEX         = 8,
+    EVX_SYNTAX_BLOCK_QUALITY        = 9,
+    EVX_SYNTAX_LUMA_PATTERN         = 10,       // coded block pattern of the luma blocks.
+    EVX_SYNTAX_CHROMA_PATTERN       = 11,       // coded block pattern of the chroma blocks.
+    EVX_SYNTAX_RUN_LENGTH           = 12,
+    EVX_SYNTAX_DC_COEFFICIENT       = 13,
+    EVX_SYNTAX_AC_LOW_COEFFICIENT   = 14,       // the first few ac coefficients in zigzag order.
+    EVX_SYNTAX_AC_HIGH_COEFFICIENT  = 15,
+    EVX_SYNTAX_TRANSFORM_SIZE       = 16,       // set if the luma is coded as a single 16x16 block.
+    EVX_SYNTAX_ELEMENT_COUNT        = 17,
+};
+
+#define EVX_SYMBOL_NEIGHBOUR_STATES             (8)
+#define EVX_SYMBOL_PREFIX_CONTEXTS              (16)
+#define EVX_SYMBOL_SUFFIX_CONTEXTS              (17)
+#define EVX_SYMBOL_TREE_CONTEXTS                (16)
+#define EVX_SYMBOL_CONTEXT_COUNT                (EVX_SYMBOL_PREFIX_CONTEXTS + EVX_SYMBOL_SUFFIX_CONTEXTS + \
+                                                 EVX_SYMBOL_TREE_CONTEXTS + 1)
+
+// Returns the syntax element used to code the coefficient at index (in zigzag order).
+EVX_SYNTAX_ELEMENT query_coefficient_element(uint32 index);
+
+class symbol_coder
+{
+    EVX_ENTROPY_MODE mode;
+    bit_stream *stream;
+
+    entropy_coder binary_coder;
+    range_coder multi_coder;
+
+    uint16 last_values[EVX_SYNTAX_ELEMENT_COUNT];
+    symbol_model models[EVX_SYNTAX_ELEMENT_COUNT][EVX_SYMBOL_NEIGHBOUR_STATES];
+    entropy_context contexts[EVX_SYNTAX_ELEMENT_COUNT][EVX_SYMBOL_NEIGHBOUR_STATES][EVX_SYMBOL_CONTEXT_COUNT];
+
+    huffman_table huffman_tables[EVX_SYNTAX_ELEMENT_COUNT];
+    huffman_table coefficient_table;  // ac (zero run, magnitude class) pairs, huffman mode only.
+
+private:
+
+    evx_status reset_models();
+    uint8 query_neighbour_state(EVX_SYNTAX_ELEMENT element) const;
+
+    evx_status encode_magnitude(EVX_SYNTAX_ELEMENT element, uint16 magnitude);
+    evx_status decode_magnitude(EVX_SYNTAX_ELEMENT element, uint16 *magnitude);
+    evx_status encode_raw_bits(uint32 value, uint8 count);
+    evx_status decode_raw_bits(uint8 count, uint32 *value);
+
+    evx_status encode_huffman_coefficients(int16 *block, uint32 count, const uint8 *scan);
+    evx_status decode_huffman_coefficients(uint32 count, int16 *block, const uint8 *scan);
+
+    evx_status decode_golomb(uint32 *code, uint8 *zero_count);
+
+    evx_status encode_binarized(EVX_SYNTAX_ELEMENT element, uint16 magnitude);
+    evx_status decode_binarized(EVX_SYNTAX_ELEMENT element, uint16 *magnitude);
+    evx_status encode_context_bit(EVX_SYNTAX_ELEMENT element, uint32 index, uint8 bit);
+    evx_status decode_context_bit(EVX_SYNTAX_ELEMENT element, uint32 index, uint8 *bit);
+
+public:
+
+    symbol_coder();
+
+    // Selects the entropy backend. This must precede start_encode and start_decode.
+    evx_status initialize(EVX_ENTROPY_MODE entropy_mode);
+    EVX_ENTROPY_MODE query_mode() const;
+
+    // Each slice is coded as a separate session that begins with start_* and
+    // resets all adaptive state.
+    evx_status start_encode(bit_stream *output);
+    evx_status finish_encode();
+    evx_status start_decode(bit_stream *input);
+
+    evx_status encode_value(EVX_SYNTAX_ELEMENT element, uint16 value);
+    evx_status encode_value(EVX_SYNTAX_ELEMENT element, int16 value);
+    evx_status decode_value(EVX_SYNTAX_ELEMENT element, uint16 *value);
+    evx_status decode_value(EVX_SYNTAX_ELEMENT element, int16 *value);
+
+    // Codes the first count coefficients of a contiguous 8x8 or 16x16 block in the order
+    // of scan (see scan.h). In abac mode the golomb codes of the block are passed to the
+    // entropy coder directly from a register, without an intermediate stream. In huffman
+    // mode the coefficient at count - 1 must be nonzero (i.e. count is the run length).
+    evx_status encode_coefficients(int16 *block, uint32 count, const uint8 *scan);
+    evx_status decode_coefficients(uint32 count, int16 *block, const uint8 *scan);
+
+    // Codes a fixed width field of (at most 8) bits.
+    evx_status encode_bits(EVX_SYNTAX_ELEMENT element, uint8 value, uint8 count);
+    evx_status decode_bits(EVX_SYNTAX_ELEMENT element, uint8 count, uint8 *value);
+
+    // Returns the number of bits written to the output of the current session. This is
+    // intended for statistics, see evx_stream_stats.
+    uint32 query_occupancy() const;
+
+private:
+
+    EVX_DISABLE_COPY_AND_ASSIGN(symbol_coder);
+};
+
+} // namespace evx
+
+#endif // __EVX_SYMBOL_H__
\ No newline at end of file
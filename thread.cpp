@@ -0,0 +1,362 @@
+
+#include "thread.h"
+#include "math.h"
+
+namespace evx {
+
+#if defined (EVX_PLATFORM_WINDOWS)
+    #define EVX_LOCK(pool)                  EnterCriticalSection(&(pool)->lock)
+    #define EVX_UNLOCK(pool)                LeaveCriticalSection(&(pool)->lock)
+    #define EVX_WAIT(pool, cond)            SleepConditionVariableCS(&(pool)->cond, &(pool)->lock, INFINITE)
+    #define EVX_SIGNAL(pool, cond)          WakeConditionVariable(&(pool)->cond)
+    #define EVX_BROADCAST(pool, cond)       WakeAllConditionVariable(&(pool)->cond)
+#else
+    #define EVX_LOCK(pool)                  pthread_mutex_lock(&(pool)->lock)
+    #define EVX_UNLOCK(pool)                pthread_mutex_unlock(&(pool)->lock)
+    #define EVX_WAIT(pool, cond)            pthread_cond_wait(&(pool)->cond, &(pool)->lock)
+    #define EVX_SIGNAL(pool, cond)          pthread_cond_signal(&(pool)->cond)
+    #define EVX_BROADCAST(pool, cond)       pthread_cond_broadcast(&(pool)->cond)
+#endif
+
+thread_pool::thread_pool()
+{
+    threads = NULL;
+    thread_count = 1;
+    generation = 0;
+    shutdown = false;
+
+    callback = NULL;
+    user_data = NULL;
+    task_count = 0;
+    next_task = 0;
+    completed_count = 0;
+    batch_status = EVX_SUCCESS;
+
+#if defined (EVX_PLATFORM_WINDOWS)
+    InitializeCriticalSection(&lock);
+    InitializeConditionVariable(&work_ready);
+    InitializeConditionVariable(&work_done);
+#else
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&work_ready, NULL);
+    pthread_cond_init(&work_done, NULL);
+#endif
+}
+
+thread_pool::~thread_pool()
+{
+    deinitialize();
+
+#if defined (EVX_PLATFORM_WINDOWS)
+    DeleteCriticalSection(&lock);
+#else
+    pthread_cond_destroy(&work_done);
+    pthread_cond_destroy(&work_ready);
+    pthread_mutex_destroy(&lock);
+#endif
+}
+
+evx_status thread_pool::initialize(uint32 count)
+{
+    if (evx_failed(deinitialize()))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    count = evx_max2(count, 1);
+
+    if (1 == count)
+    {
+        return EVX_SUCCESS;
+    }
+
+#if defined (EVX_PLATFORM_WINDOWS)
+    threads = new HANDLE[count - 1];
+#else
+    threads = new pthread_t[count - 1];
+#endif
+
+    if (!threads)
+    {
+        return evx_post_error(EVX_ERROR_OUTOFMEMORY);
+    }
+
+    for (uint32 i = 0; i < count - 1; ++i)
+    {
+#if defined (EVX_PLATFORM_WINDOWS)
+        threads[i] = CreateThread(NULL, 0, worker_entry, this, 0, NULL);
+        bool created = (NULL != threads[i]);
+#else
+        bool created = (0 == pthread_create(&threads[i], NULL, worker_entry, this));
+#endif
+
+        if (!created)
+        {
+            // Retain the workers that we were able to create.
+            thread_count = i + 1;
+            deinitialize();
+
+            return evx_post_error(EVX_ERROR_SYSTEM_FAILURE);
+        }
+
+        thread_count = i + 2;
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status thread_pool::deinitialize()
+{
+    if (!threads)
+    {
+        thread_count = 1;
+        return EVX_SUCCESS;
+    }
+
+    EVX_LOCK(this);
+    shutdown = true;
+    EVX_BROADCAST(this, work_ready);
+    EVX_UNLOCK(this);
+
+    for (uint32 i = 0; i < thread_count - 1; ++i)
+    {
+#if defined (EVX_PLATFORM_WINDOWS)
+        WaitForSingleObject(threads[i], INFINITE);
+        CloseHandle(threads[i]);
+#else
+        pthread_join(threads[i], NULL);
+#endif
+    }
+
+    delete [] threads;
+
+    threads = NULL;
+    thread_count = 1;
+    shutdown = false;
+
+    return EVX_SUCCESS;
+}
+
+uint32 thread_pool::query_thread_count() const
+{
+    return thread_count;
+}
+
+void thread_pool::execute_tasks()
+{
+    while (next_task < task_count)
+    {
+        uint32 task_index = next_task++;
+        evx_task_callback task_callback = callback;
+        void *task_data = user_data;
+
+        EVX_UNLOCK(this);
+        evx_status result = task_callback(task_data, task_index);
+        EVX_LOCK(this);
+
+        if (evx_failed(result))
+        {
+            batch_status = EVX_ERROR_EXECUTION_FAILURE;
+        }
+
+        if (++completed_count == task_count)
+        {
+            EVX_SIGNAL(this, work_done);
+        }
+    }
+}
+
+void thread_pool::worker_main(thread_pool *pool)
+{
+    uint32 last_generation = 0;
+
+    EVX_LOCK(pool);
+
+    while (true)
+    {
+        while (!pool->shutdown && last_generation == pool->generation)
+        {
+            EVX_WAIT(pool, work_ready);
+        }
+
+        if (pool->shutdown)
+        {
+            break;
+        }
+
+        last_generation = pool->generation;
+        pool->execute_tasks();
+    }
+
+    EVX_UNLOCK(pool);
+}
+
+#if defined (EVX_PLATFORM_WINDOWS)
+
+DWORD WINAPI thread_pool::worker_entry(LPVOID param)
+{
+    worker_main(reinterpret_cast<thread_pool *>(param));
+    return 0;
+}
+
+#else
+
+void *thread_pool::worker_entry(void *param)
+{
+    worker_main(reinterpret_cast<thread_pool *>(param));
+    return NULL;
+}
+
+#endif
+
+evx_status thread_pool::execute(uint32 count, evx_task_callback task_callback, void *task_data)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!task_callback)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    if (!threads || count <= 1)
+    {
+        // Nothing to distribute, so we run the batch inline.
+        for (uint32 i = 0; i < count; ++i)
+        {
+            if (evx_failed(task_callback(task_data, i)))
+            {
+                return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            }
+        }
+
+        return EVX_SUCCESS;
+    }
+
+    EVX_LOCK(this);
+
+    callback = task_callback;
+    user_data = task_data;
+    task_count = count;
+    next_task = 0;
+    completed_count = 0;
+    batch_status = EVX_SUCCESS;
+    generation++;
+
+    EVX_BROADCAST(this, work_ready);
+
+    // The calling thread takes part in the batch, then waits for the stragglers.
+    execute_tasks();
+
+    while (completed_count < task_count)
+    {
+        EVX_WAIT(this, work_done);
+    }
+
+    evx_status result = batch_status;
+
+    EVX_UNLOCK(this);
+
+    if (evx_failed(result))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    return EVX_SUCCESS;
+}
+
+progress_table::progress_table()
+{
+    values = NULL;
+    value_count = 0;
+
+#if defined (EVX_PLATFORM_WINDOWS)
+    InitializeCriticalSection(&lock);
+    InitializeConditionVariable(&progress_made);
+#else
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&progress_made, NULL);
+#endif
+}
+
+progress_table::~progress_table()
+{
+    deinitialize();
+
+#if defined (EVX_PLATFORM_WINDOWS)
+    DeleteCriticalSection(&lock);
+#else
+    pthread_cond_destroy(&progress_made);
+    pthread_mutex_destroy(&lock);
+#endif
+}
+
+evx_status progress_table::initialize(uint32 count)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (0 == count)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    deinitialize();
+
+    values = new uint32[count];
+
+    if (!values)
+    {
+        return evx_post_error(EVX_ERROR_OUTOFMEMORY);
+    }
+
+    value_count = count;
+    reset();
+
+    return EVX_SUCCESS;
+}
+
+evx_status progress_table::deinitialize()
+{
+    delete [] values;
+
+    values = NULL;
+    value_count = 0;
+
+    return EVX_SUCCESS;
+}
+
+void progress_table::reset()
+{
+    for (uint32 i = 0; i < value_count; ++i)
+    {
+        values[i] = 0;
+    }
+}
+
+void progress_table::publish(uint32 index, uint32 value)
+{
+    EVX_LOCK(this);
+
+    if (value > values[index])
+    {
+        values[index] = value;
+        EVX_BROADCAST(this, progress_made);
+    }
+
+    EVX_UNLOCK(this);
+}
+
+void progress_table::wait(uint32 index, uint32 value)
+{
+    EVX_LOCK(this);
+
+    while (values[index] < value)
+    {
+        EVX_WAIT(this, progress_made);
+    }
+
+    EVX_UNLOCK(this);
+}
+
+} // namespace evx
\ No newline at end of file
@@ -0,0 +1,150 @@
+
+/*
+// Copyright (c) 2009-2014 Joe Bertolami. All Right Reserved.
+//
+// thread.h
+//
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Additional Information:
+//
+//   For more information, visit http://www.bertolami.com.
+*/
+
+#ifndef __EVX_THREAD_H__
+#define __EVX_THREAD_H__
+
+#include "base.h"
+
+#if !defined (EVX_PLATFORM_WINDOWS)
+#include "pthread.h"
+#endif
+
+// The thread pool runs batches of independent tasks on a set of persistent worker 
+// threads. The calling thread participates in each batch, so a pool of N threads
+// creates N - 1 workers, and a pool of one thread executes all tasks inline.
+
+namespace evx {
+
+typedef evx_status (*evx_task_callback)(void *user_data, uint32 task_index);
+
+class thread_pool
+{
+#if defined (EVX_PLATFORM_WINDOWS)
+    HANDLE *threads;
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE work_ready;
+    CONDITION_VARIABLE work_done;
+#else
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t work_ready;
+    pthread_cond_t work_done;
+#endif
+
+    uint32 thread_count;
+    uint32 generation;              // incremented for each batch.
+    bool shutdown;
+
+    evx_task_callback callback;
+    void *user_data;
+    uint32 task_count;
+    uint32 next_task;
+    uint32 completed_count;
+    evx_status batch_status;
+
+private:
+
+    // execute_tasks must be called with the lock held, and returns with the lock held.
+    void execute_tasks();
+
+    static void worker_main(thread_pool *pool);
+
+#if defined (EVX_PLATFORM_WINDOWS)
+    static DWORD WINAPI worker_entry(LPVOID param);
+#else
+    static void *worker_entry(void *param);
+#endif
+
+public:
+
+    thread_pool();
+    virtual ~thread_pool();
+
+    // initialize may be called at any time outside of execute, and replaces any 
+    // existing workers. A thread count of zero is treated as one.
+    evx_status initialize(uint32 count);
+    evx_status deinitialize();
+
+    uint32 query_thread_count() const;
+
+    // Invokes callback once for each task index in [0, count) and blocks until all 
+    // tasks have completed. Tasks may run in any order and on any thread. Returns 
+    // EVX_ERROR_EXECUTION_FAILURE if any task failed.
+    evx_status execute(uint32 count, evx_task_callback task_callback, void *task_data);
+
+private:
+
+    EVX_DISABLE_COPY_AND_ASSIGN(thread_pool);
+};
+
+// The progress table holds a set of monotonically increasing counters that tasks 
+// publish as they advance, and that other tasks may block on. This is used to
+// express dependencies between the rows of a wavefront.
+
+class progress_table
+{
+#if defined (EVX_PLATFORM_WINDOWS)
+    CRITICAL_SECTION lock;
+    CONDITION_VARIABLE progress_made;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t progress_made;
+#endif
+
+    uint32 *values;
+    uint32 value_count;
+
+public:
+
+    progress_table();
+    virtual ~progress_table();
+
+    evx_status initialize(uint32 count);
+    evx_status deinitialize();
+
+    // Resets all counters to zero. Must not be called while tasks are waiting.
+    void reset();
+
+    // publish raises the counter at index to value, and wait blocks until the 
+    // counter at index is at least value.
+    void publish(uint32 index, uint32 value);
+    void wait(uint32 index, uint32 value);
+
+private:
+
+    EVX_DISABLE_COPY_AND_ASSIGN(progress_table);
+};
+
+} // namespace evx
+
+#endif // __EVX_THREAD_H__
@@ -0,0 +1,107 @@
+
+#include "timing.h"
+
+#if defined (EVX_PLATFORM_IOS) || defined (EVX_PLATFORM_MACOSX)
+#include "mach/mach_time.h"
+#elif defined (EVX_PLATFORM_LINUX)
+#include "time.h"
+#endif
+
+namespace evx {
+
+uint64 query_timestamp()
+{
+#if defined (EVX_PLATFORM_WINDOWS)
+    static LARGE_INTEGER frequency = {0};
+    LARGE_INTEGER counter;
+
+    if (0 == frequency.QuadPart)
+    {
+        QueryPerformanceFrequency(&frequency);
+    }
+
+    QueryPerformanceCounter(&counter);
+
+    // Split the conversion to avoid overflowing the intermediate product.
+    uint64 seconds = counter.QuadPart / frequency.QuadPart;
+    uint64 remainder = counter.QuadPart % frequency.QuadPart;
+
+    return seconds * 1000000000 + (remainder * 1000000000) / frequency.QuadPart;
+#elif defined (EVX_PLATFORM_IOS) || defined (EVX_PLATFORM_MACOSX)
+    static mach_timebase_info_data_t timebase = {0, 0};
+
+    if (0 == timebase.denom)
+    {
+        mach_timebase_info(&timebase);
+    }
+
+    return mach_absolute_time() * timebase.numer / timebase.denom;
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    return (uint64) now.tv_sec * 1000000000 + now.tv_nsec;
+#endif
+}
+
+evx_status clear_timing_stats(evx_timing_stats *stats)
+{
+    if (EVX_PARAM_CHECK)
+    {
+        if (!stats)
+        {
+            return evx_post_error(EVX_ERROR_INVALIDARG);
+        }
+    }
+
+    memset(stats, 0, sizeof(evx_timing_stats));
+
+    return EVX_SUCCESS;
+}
+
+void begin_timing_frame(evx_timing_stats *stats)
+{
+    memset(stats->frame_time, 0, sizeof(stats->frame_time));
+}
+
+void end_timing_frame(evx_timing_stats *stats)
+{
+    for (uint32 i = 0; i < EVX_TIMING_STAGE_COUNT; ++i)
+    {
+        stats->total_time[i] += stats->frame_time[i];
+    }
+
+    stats->frame_count++;
+}
+
+void merge_timing_frame(const evx_timing_stats &source, evx_timing_stats *dest)
+{
+    for (uint32 i = 0; i < EVX_TIMING_STAGE_COUNT; ++i)
+    {
+        dest->frame_time[i] += source.frame_time[i];
+    }
+}
+
+const char *query_timing_stage_name(EVX_TIMING_STAGE stage)
+{
+    switch (stage)
+    {
+        case EVX_TIMING_FRAME: return "frame";
+        case EVX_TIMING_CONVERT: return "convert_image";
+        case EVX_TIMING_ENCODE_SLICE: return "encode_slice";
+        case EVX_TIMING_CLASSIFY_BLOCK: return "classify_block";
+        case EVX_TIMING_ENCODE_BLOCK: return "encode_block";
+        case EVX_TIMING_DECODE_BLOCK: return "decode_block";
+        case EVX_TIMING_SERIALIZE: return "serialize_slice";
+        case EVX_TIMING_UNSERIALIZE: return "unserialize_slice";
+        case EVX_TIMING_DECODE_SLICE: return "decode_slice";
+        case EVX_TIMING_DEBLOCK: return "deblock_image_filter";
+        case EVX_TIMING_SUBPEL_PLANES: return "build_subpel_planes";
+        case EVX_TIMING_MOTION_PYRAMID: return "build_motion_pyramid";
+        default: break;
+    };
+
+    return "unknown";
+}
+
+} // namespace evx
@@ -0,0 +1,103 @@
+
+/*
+// Copyright (c) 2009-2014 Joe Bertolami. All Right Reserved.
+//
+// timing.h
+//
+//   Redistribution and use in source and binary forms, with or without
+//   modification, are permitted provided that the following conditions are met:
+//
+//   * Redistributions of source code must retain the above copyright notice, this
+//     list of conditions and the following disclaimer.
+//
+//   * Redistributions in binary form must reproduce the above copyright notice,
+//     this list of conditions and the following disclaimer in the documentation
+//     and/or other materials provided with the distribution.
+//
+//   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+//   AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//   IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+//   DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+//   FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+//   DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+//   SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+//   CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+//   OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+//   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+// Additional Information:
+//
+//   For more information, visit http://www.bertolami.com.
+*/
+
+#ifndef __EVX_TIMING_H__
+#define __EVX_TIMING_H__
+
+#include "base.h"
+#include "config.h"
+
+// Stage timing records the time spent in each stage of the encode and decode
+// pipelines, for the most recent frame and in total since the last clear. The
+// instrumentation is compiled out entirely when EVX_ENABLE_STAGE_TIMING is 0.
+
+namespace evx {
+
+enum EVX_TIMING_STAGE
+{
+    EVX_TIMING_FRAME = 0,           // full engine_encode_frame / engine_decode_frame
+    EVX_TIMING_CONVERT,             // rgb to yuv (encoder) or yuv to rgb (decoder)
+    EVX_TIMING_ENCODE_SLICE,        // wall time of all encode_slice tasks; the three stages below are summed across slices
+    EVX_TIMING_CLASSIFY_BLOCK,      // motion search and block classification
+    EVX_TIMING_ENCODE_BLOCK,        // forward transform and quantization
+    EVX_TIMING_DECODE_BLOCK,        // reconstruction (encoder) or block decode (decoder)
+    EVX_TIMING_SERIALIZE,           // serialize_slice
+    EVX_TIMING_UNSERIALIZE,         // unserialize_slice
+    EVX_TIMING_DECODE_SLICE,        // wall time of the decode_slice wavefront over all rows
+    EVX_TIMING_DEBLOCK,             // in-loop deblocking filter
+    EVX_TIMING_SUBPEL_PLANES,       // sub-pixel plane interpolation (encoder)
+    EVX_TIMING_MOTION_PYRAMID,      // motion pyramid downsampling (encoder)
+    EVX_TIMING_STAGE_COUNT
+};
+
+typedef struct evx_timing_stats
+{
+    uint64 frame_time[EVX_TIMING_STAGE_COUNT];  // nanoseconds spent per stage in the last frame
+    uint64 total_time[EVX_TIMING_STAGE_COUNT];  // nanoseconds spent per stage since the last clear
+    uint32 frame_count;                         // number of frames accumulated into total_time
+
+} evx_timing_stats;
+
+// Returns a monotonic timestamp in nanoseconds.
+uint64 query_timestamp();
+
+evx_status clear_timing_stats(evx_timing_stats *stats);
+
+// begin_timing_frame resets the per-frame counters and end_timing_frame folds
+// them into the running totals.
+void begin_timing_frame(evx_timing_stats *stats);
+void end_timing_frame(evx_timing_stats *stats);
+
+// merge_timing_frame adds the per-frame counters of source (e.g. a slice) into dest.
+// Stages that run concurrently are therefore reported as their summed thread time.
+void merge_timing_frame(const evx_timing_stats &source, evx_timing_stats *dest);
+
+// Returns a readable name for a stage, useful for reporting.
+const char *query_timing_stage_name(EVX_TIMING_STAGE stage);
+
+} // namespace evx
+
+#if EVX_ENABLE_STAGE_TIMING
+    #define EVX_TIMING_BEGIN(name)                      evx::uint64 name = evx::query_timestamp()
+    #define EVX_TIMING_END(stats, stage, name)          ((stats)->frame_time[(stage)] += evx::query_timestamp() - (name))
+    #define EVX_TIMING_BEGIN_FRAME(stats)               evx::begin_timing_frame((stats))
+    #define EVX_TIMING_END_FRAME(stats)                 evx::end_timing_frame((stats))
+    #define EVX_TIMING_MERGE_FRAME(source, dest)        evx::merge_timing_frame((source), (dest))
+#else
+    #define EVX_TIMING_BEGIN(name)
+    #define EVX_TIMING_END(stats, stage, name)
+    #define EVX_TIMING_BEGIN_FRAME(stats)
+    #define EVX_TIMING_END_FRAME(stats)
+    #define EVX_TIMING_MERGE_FRAME(source, dest)
+#endif
+
+#endif // __EVX_TIMING_H__
@@ -3,11 +3,17 @@
 #include "math.h"
 #include "xftables.h"
 
+#if defined (EVX_SIMD_X86_SUPPORTED)
+#include "emmintrin.h"
+#include "immintrin.h"
+#endif
+
 namespace evx {
 
-// There are several far more efficient implementations of this transform. We've chosen
-// not to implement them here for the sake of clarity, but interested readers should 
-// consult Chen'77 and Loeffer'89.
+// The reference transforms below are direct products against the trig tables, which
+// we've kept for the sake of clarity. Far more efficient factorizations exist (see
+// Chen'77 and Loeffler'89), and the butterfly transforms at the end of this file
+// implement the latter. Streams record which of the two they use, see EVX_TRANSFORM_MODE.
 
 #define EVX_TRANSFORM_SUB_LINE(n)         \
     for (uint8 i = 0; i < n; ++i)         \
@@ -479,18 +485,49 @@ void transform_16x16_line(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest
 
 void transform_16x16_line_fast(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
 {
-    evx_post_error(EVX_ERROR_NOTIMPL);
+    for (uint8 i = 0; i < 16; ++i)
+    {
+        int32 total = 0;             
+        int16 *output = dest + i * dest_pitch;
+
+        total  = src[ 0 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 +  0];
+        total += src[ 1 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 +  1];
+        total += src[ 2 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 +  2];
+        total += src[ 3 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 +  3];
+        total += src[ 4 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 +  4];
+        total += src[ 5 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 +  5];
+        total += src[ 6 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 +  6];
+        total += src[ 7 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 +  7];
+        total += src[ 8 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 +  8];
+        total += src[ 9 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 +  9];
+        total += src[10 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 + 10];
+        total += src[11 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 + 11];
+        total += src[12 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 + 12];
+        total += src[13 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 + 13];
+        total += src[14 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 + 14];
+        total += src[15 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[i * 16 + 15];
+
+        total = (!i) * ((total * 32) / 128) + (!!i) * ((total * 45) / 128);
+        total = rounded_div(total, 128);
+        *output = total;
+    }
 }
 
 void transform_16x16(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
 {
-    int16 *src_row_8 = src + 8 * src_pitch;
-    int16 *dest_row_8 = dest + 8 * dest_pitch;
+    int16 scratch_block[16*16];
 
-    transform_8x8(src, src_pitch, dest, dest_pitch);
-    transform_8x8(src + 8, src_pitch, dest + 8, dest_pitch);
-    transform_8x8(src_row_8, src_pitch, dest_row_8, dest_pitch);
-    transform_8x8(src_row_8 + 8, src_pitch, dest_row_8 + 8, dest_pitch);
+    // Horizontal DCT-II
+    for (uint8 j = 0; j < 16; ++j)
+    {
+        transform_16x16_line_fast(src + j * src_pitch, 1, scratch_block + j * 16, 1);
+    }
+    
+    // Vertical DCT-II
+    for (uint8 j = 0; j < 16; ++j)
+    {
+        transform_16x16_line_fast(scratch_block + j, 16, dest + j, dest_pitch);
+    }
 }
 
 void inverse_transform_16x16_line(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
@@ -522,18 +559,48 @@ void inverse_transform_16x16_line(int16 *src, uint32 src_pitch, int16 *dest, uin
 
 void inverse_transform_16x16_line_fast(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
 {
-    evx_post_error(EVX_ERROR_NOTIMPL);
+    for (uint8 i = 0; i < 16; ++i)
+    {
+        int32 total = 0;        
+        int16 *output = dest + i * dest_pitch;
+
+        total = ((src[ 0 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 0 * 16 + i]) * 32) / 128;
+        total += ((src[ 1 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 1 * 16 + i]) * 45) / 128;
+        total += ((src[ 2 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 2 * 16 + i]) * 45) / 128;
+        total += ((src[ 3 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 3 * 16 + i]) * 45) / 128;
+        total += ((src[ 4 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 4 * 16 + i]) * 45) / 128;
+        total += ((src[ 5 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 5 * 16 + i]) * 45) / 128;
+        total += ((src[ 6 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 6 * 16 + i]) * 45) / 128;
+        total += ((src[ 7 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 7 * 16 + i]) * 45) / 128;
+        total += ((src[ 8 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 8 * 16 + i]) * 45) / 128;
+        total += ((src[ 9 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 9 * 16 + i]) * 45) / 128;
+        total += ((src[10 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[10 * 16 + i]) * 45) / 128;
+        total += ((src[11 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[11 * 16 + i]) * 45) / 128;
+        total += ((src[12 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[12 * 16 + i]) * 45) / 128;
+        total += ((src[13 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[13 * 16 + i]) * 45) / 128;
+        total += ((src[14 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[14 * 16 + i]) * 45) / 128;
+        total += ((src[15 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[15 * 16 + i]) * 45) / 128;
+
+        total = rounded_div(total, 128);
+        *output = total;
+    }
 }
 
 void inverse_transform_16x16(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
 {
-    int16 *src_row_8 = src  + 8 * src_pitch;
-    int16 *dest_row_8 = dest + 8 * dest_pitch;
+    int16 scratch_block[16*16];
+
+    // Vertical IDCT-II
+    for (uint8 j = 0; j < 16; ++j)
+    {
+        inverse_transform_16x16_line_fast(src + j, src_pitch, scratch_block + j, 16);
+    }
 
-    inverse_transform_8x8(src, src_pitch, dest, dest_pitch);
-    inverse_transform_8x8(src + 8, src_pitch, dest + 8, dest_pitch);
-    inverse_transform_8x8(src_row_8, src_pitch, dest_row_8, dest_pitch);
-    inverse_transform_8x8(src_row_8 + 8, src_pitch, dest_row_8 + 8, dest_pitch);
+    // Horizontal IDCT-II
+    for (uint8 j = 0; j < 16; ++j)
+    {
+        inverse_transform_16x16_line_fast(scratch_block + j * 16, 1, dest + j * dest_pitch, 1);
+    }
 }
 
 void inverse_transform_add_16x16_line(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch)
@@ -566,38 +633,1907 @@ void inverse_transform_add_16x16_line(int16 *src, uint32 src_pitch, int16 *add,
 
 void inverse_transform_add_16x16_line_fast(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch)
 {
-    evx_post_error(EVX_ERROR_NOTIMPL);
+    for (uint8 i = 0; i < 16; ++i)
+    {
+        int32 total = 0;        
+        int16 *output = dest + i * dest_pitch;
+        int16 *add_input = add + i * add_pitch;
+
+        total = ((src[ 0 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 0 * 16 + i]) * 32) / 128;
+        total += ((src[ 1 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 1 * 16 + i]) * 45) / 128;
+        total += ((src[ 2 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 2 * 16 + i]) * 45) / 128;
+        total += ((src[ 3 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 3 * 16 + i]) * 45) / 128;
+        total += ((src[ 4 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 4 * 16 + i]) * 45) / 128;
+        total += ((src[ 5 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 5 * 16 + i]) * 45) / 128;
+        total += ((src[ 6 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 6 * 16 + i]) * 45) / 128;
+        total += ((src[ 7 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 7 * 16 + i]) * 45) / 128;
+        total += ((src[ 8 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 8 * 16 + i]) * 45) / 128;
+        total += ((src[ 9 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[ 9 * 16 + i]) * 45) / 128;
+        total += ((src[10 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[10 * 16 + i]) * 45) / 128;
+        total += ((src[11 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[11 * 16 + i]) * 45) / 128;
+        total += ((src[12 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[12 * 16 + i]) * 45) / 128;
+        total += ((src[13 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[13 * 16 + i]) * 45) / 128;
+        total += ((src[14 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[14 * 16 + i]) * 45) / 128;
+        total += ((src[15 * src_pitch] * EVX_TRANSFORM_16x16_TRIG_128_LUT[15 * 16 + i]) * 45) / 128;
+
+        total = rounded_div(total, 128);
+        *output = total + *add_input;
+    }
 }
 
 void inverse_transform_add_16x16(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch)
 {
-    int16 *src_row_8 = src + 8 * src_pitch;
-    int16 *add_row_8 = add + 8 * add_pitch;
-    int16 *dest_row_8 = dest + 8 * dest_pitch;
+    int16 scratch_block[16*16];
+
+    // Vertical IDCT-II
+    for (uint8 j = 0; j < 16; ++j)
+    {
+        inverse_transform_16x16_line_fast(src + j, src_pitch, scratch_block + j, 16);
+    }
 
-    inverse_transform_add_8x8(src, src_pitch, add, add_pitch, dest, dest_pitch);
-    inverse_transform_add_8x8(src + 8, src_pitch, add + 8, add_pitch, dest + 8, dest_pitch);
-    inverse_transform_add_8x8(src_row_8, src_pitch, add_row_8, add_pitch, dest_row_8, dest_pitch);
-    inverse_transform_add_8x8(src_row_8 + 8, src_pitch, add_row_8 + 8, add_pitch, dest_row_8 + 8, dest_pitch);
+    // Horizontal IDCT-II
+    for (uint8 j = 0; j < 16; ++j)
+    {
+        inverse_transform_add_16x16_line_fast(scratch_block + j * 16, 1, add + j * add_pitch, 1, dest + j * dest_pitch, 1);
+    }
 }
 
 void sub_transform_16x16(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch)
 {
-    int16 *src_row_8 = src + 8 * src_pitch;
-    int16 *sub_row_8 = sub + 8 * sub_pitch;
-    int16 *dest_row_8 = dest + 8 * dest_pitch;
+    int16 scratch_block[16*16];
+    int16 sub_scratch_block[16*16];
+
+    // Horizontal DCT-II
+    for (uint8 j = 0; j < 16; ++j) 
+    {
+        sub_16x16_line(src + j * src_pitch, sub + j * sub_pitch, sub_scratch_block + j * 16);
+        transform_16x16_line_fast(sub_scratch_block + j * 16, 1, scratch_block + j * 16, 1);
+    }
+    
+    // Vertical DCT-II
+    for (uint8 j = 0; j < 16; ++j)
+    {
+        transform_16x16_line_fast(scratch_block + j, 16, dest + j, dest_pitch);
+    }
+}
 
-    sub_transform_8x8(src, src_pitch, sub, sub_pitch, dest, dest_pitch);
-    sub_transform_8x8(src + 8, src_pitch, sub + 8, sub_pitch, dest + 8, dest_pitch);
-    sub_transform_8x8(src_row_8, src_pitch, sub_row_8, sub_pitch, dest_row_8, dest_pitch);
-    sub_transform_8x8(src_row_8 + 8, src_pitch, sub_row_8 + 8, sub_pitch, dest_row_8 + 8, dest_pitch);
+// Butterfly transforms
+//
+//   These factor the DCT-II after Loeffler'89, with twelve multiplies per 8 point line
+//   rather than sixty four. Constants are fixed point with EVX_BUTTERFLY_CONST_BITS of
+//   fraction. The factorization scales its outputs uniformly by sqrt(8) per pass, so the
+//   normalization of both passes reduces to a single power of two that is folded into 
+//   the final rounding shift. The first pass retains EVX_BUTTERFLY_PASS_BITS of extra
+//   precision, which the second pass removes. Coefficients therefore share the scale
+//   of the reference transforms, and the quantizer is unaware of the transform mode.
+
+#define EVX_BUTTERFLY_CONST_BITS          (13)
+#define EVX_BUTTERFLY_PASS_BITS           (2)
+#define EVX_BUTTERFLY_FIRST_SHIFT         (EVX_BUTTERFLY_CONST_BITS - EVX_BUTTERFLY_PASS_BITS)
+#define EVX_BUTTERFLY_SECOND_SHIFT        (EVX_BUTTERFLY_CONST_BITS + EVX_BUTTERFLY_PASS_BITS + 3)
+
+#define EVX_BUTTERFLY_16x16_PASS_BITS     (1)
+#define EVX_BUTTERFLY_16x16_FIRST_SHIFT   (EVX_BUTTERFLY_CONST_BITS - EVX_BUTTERFLY_16x16_PASS_BITS)
+#define EVX_BUTTERFLY_16x16_SECOND_SHIFT  (EVX_BUTTERFLY_CONST_BITS + EVX_BUTTERFLY_16x16_PASS_BITS + 4)
+
+#define EVX_FIX_0_298631336               (2446)
+#define EVX_FIX_0_390180644               (3196)
+#define EVX_FIX_0_541196100               (4433)
+#define EVX_FIX_0_765366865               (6270)
+#define EVX_FIX_0_899976223               (7373)
+#define EVX_FIX_1_175875602               (9633)
+#define EVX_FIX_1_501321110               (12299)
+#define EVX_FIX_1_847759065               (15137)
+#define EVX_FIX_1_961570560               (16069)
+#define EVX_FIX_2_053119869               (16819)
+#define EVX_FIX_2_562915447               (20995)
+#define EVX_FIX_3_072711026               (25172)
+
+// Rounding right shift. Negative values rely upon an arithmetic shift, which all of 
+// our supported compilers provide. Left shifts are expressed as multiplies.
+#define EVX_BUTTERFLY_DESCALE(x, n)       (((x) + (1 << ((n) - 1))) >> (n))
+
+inline void forward_butterfly_8(const int32 *x, int32 *y, uint8 shift)
+{
+    int32 tmp0 = x[0] + x[7];
+    int32 tmp7 = x[0] - x[7];
+    int32 tmp1 = x[1] + x[6];
+    int32 tmp6 = x[1] - x[6];
+    int32 tmp2 = x[2] + x[5];
+    int32 tmp5 = x[2] - x[5];
+    int32 tmp3 = x[3] + x[4];
+    int32 tmp4 = x[3] - x[4];
+
+    // Even part.
+    int32 tmp10 = tmp0 + tmp3;
+    int32 tmp13 = tmp0 - tmp3;
+    int32 tmp11 = tmp1 + tmp2;
+    int32 tmp12 = tmp1 - tmp2;
+
+    int32 z1 = (tmp12 + tmp13) * EVX_FIX_0_541196100;
+
+    y[0] = EVX_BUTTERFLY_DESCALE((tmp10 + tmp11) * (1 << EVX_BUTTERFLY_CONST_BITS), shift);
+    y[4] = EVX_BUTTERFLY_DESCALE((tmp10 - tmp11) * (1 << EVX_BUTTERFLY_CONST_BITS), shift);
+    y[2] = EVX_BUTTERFLY_DESCALE(z1 + tmp13 * EVX_FIX_0_765366865, shift);
+    y[6] = EVX_BUTTERFLY_DESCALE(z1 - tmp12 * EVX_FIX_1_847759065, shift);
+
+    // Odd part.
+    z1 = tmp4 + tmp7;
+    int32 z2 = tmp5 + tmp6;
+    int32 z3 = tmp4 + tmp6;
+    int32 z4 = tmp5 + tmp7;
+    int32 z5 = (z3 + z4) * EVX_FIX_1_175875602;
+
+    tmp4 *= EVX_FIX_0_298631336;
+    tmp5 *= EVX_FIX_2_053119869;
+    tmp6 *= EVX_FIX_3_072711026;
+    tmp7 *= EVX_FIX_1_501321110;
+    z1 *= -EVX_FIX_0_899976223;
+    z2 *= -EVX_FIX_2_562915447;
+    z3 = z5 - z3 * EVX_FIX_1_961570560;
+    z4 = z5 - z4 * EVX_FIX_0_390180644;
+
+    y[7] = EVX_BUTTERFLY_DESCALE(tmp4 + z1 + z3, shift);
+    y[5] = EVX_BUTTERFLY_DESCALE(tmp5 + z2 + z4, shift);
+    y[3] = EVX_BUTTERFLY_DESCALE(tmp6 + z2 + z3, shift);
+    y[1] = EVX_BUTTERFLY_DESCALE(tmp7 + z1 + z4, shift);
 }
 
-} // namespace evx
+// Returns the inverse of an 8 point line prior to its final rounding shift, i.e. with 
+// EVX_BUTTERFLY_CONST_BITS of fraction. This is shared by the 16 point inverse, which 
+// combines the result with its odd half before rounding.
+inline void inverse_butterfly_8_core(const int32 *x, int32 *y)
+{
+    // Most quantized lines only carry a dc value, which reduces to a single product.
+    if (!(x[1] | x[2] | x[3] | x[4] | x[5] | x[6] | x[7]))
+    {
+        int32 dc = x[0] * (1 << EVX_BUTTERFLY_CONST_BITS);
+
+        for (uint8 i = 0; i < 8; ++i)
+        {
+            y[i] = dc;
+        }
+
+        return;
+    }
+
+    // Even part.
+    int32 z1 = (x[2] + x[6]) * EVX_FIX_0_541196100;
+    int32 tmp2 = z1 - x[6] * EVX_FIX_1_847759065;
+    int32 tmp3 = z1 + x[2] * EVX_FIX_0_765366865;
+    int32 tmp0 = (x[0] + x[4]) * (1 << EVX_BUTTERFLY_CONST_BITS);
+    int32 tmp1 = (x[0] - x[4]) * (1 << EVX_BUTTERFLY_CONST_BITS);
+
+    int32 tmp10 = tmp0 + tmp3;
+    int32 tmp13 = tmp0 - tmp3;
+    int32 tmp11 = tmp1 + tmp2;
+    int32 tmp12 = tmp1 - tmp2;
+
+    // Odd part.
+    tmp0 = x[7];
+    tmp1 = x[5];
+    tmp2 = x[3];
+    tmp3 = x[1];
+
+    z1 = tmp0 + tmp3;
+    int32 z2 = tmp1 + tmp2;
+    int32 z3 = tmp0 + tmp2;
+    int32 z4 = tmp1 + tmp3;
+    int32 z5 = (z3 + z4) * EVX_FIX_1_175875602;
+
+    tmp0 *= EVX_FIX_0_298631336;
+    tmp1 *= EVX_FIX_2_053119869;
+    tmp2 *= EVX_FIX_3_072711026;
+    tmp3 *= EVX_FIX_1_501321110;
+    z1 *= -EVX_FIX_0_899976223;
+    z2 *= -EVX_FIX_2_562915447;
+    z3 = z5 - z3 * EVX_FIX_1_961570560;
+    z4 = z5 - z4 * EVX_FIX_0_390180644;
+
+    tmp0 += z1 + z3;
+    tmp1 += z2 + z4;
+    tmp2 += z2 + z3;
+    tmp3 += z1 + z4;
+
+    y[0] = tmp10 + tmp3;
+    y[7] = tmp10 - tmp3;
+    y[1] = tmp11 + tmp2;
+    y[6] = tmp11 - tmp2;
+    y[2] = tmp12 + tmp1;
+    y[5] = tmp12 - tmp1;
+    y[3] = tmp13 + tmp0;
+    y[4] = tmp13 - tmp0;
+}
+
+inline void inverse_butterfly_8(const int32 *x, int32 *y, uint8 shift)
+{
+    inverse_butterfly_8_core(x, y);
+
+    for (uint8 i = 0; i < 8; ++i)
+    {
+        y[i] = EVX_BUTTERFLY_DESCALE(y[i], shift);
+    }
+}
+
+// The 16 point transforms split their input into symmetric and antisymmetric halves. 
+// The even coefficients are an 8 point transform of the sums x[n] + x[15 - n], which 
+// reuses the factorization above, and the odd coefficients are direct products of the
+// differences against EVX_TRANSFORM_16x16_ODD_FIX_LUT. Both halves scale their outputs
+// by four, so a 16x16 block is scaled by sixteen overall. Sums of the first pass may 
+// reach twice the range of the 8x8 transforms, so the first pass retains one less bit.
+
+inline void forward_butterfly_16(const int32 *x, int32 *y, uint8 shift)
+{
+    int32 sum[8];
+    int32 diff[8];
+    int32 even[8];
+
+    for (uint8 n = 0; n < 8; ++n)
+    {
+        sum[n] = x[n] + x[15 - n];
+        diff[n] = x[n] - x[15 - n];
+    }
+
+    forward_butterfly_8(sum, even, shift);
+
+    for (uint8 k = 0; k < 8; ++k)
+    {
+        const int16 *fix = EVX_TRANSFORM_16x16_ODD_FIX_LUT + k * 8;
+
+        int32 total = diff[0] * fix[0] + diff[1] * fix[1] + diff[2] * fix[2] + diff[3] * fix[3] + 
+                      diff[4] * fix[4] + diff[5] * fix[5] + diff[6] * fix[6] + diff[7] * fix[7];
+
+        y[2 * k] = even[k];
+        y[2 * k + 1] = EVX_BUTTERFLY_DESCALE(total, shift);
+    }
+}
+
+inline void inverse_butterfly_16(const int32 *x, int32 *y, uint8 shift)
+{
+    int32 even_input[8];
+    int32 even[8];
+    int32 odd[8] = {0};
+    int32 odd_mask = 0;
+
+    for (uint8 k = 0; k < 8; ++k)
+    {
+        even_input[k] = x[2 * k];
+        odd_mask |= x[2 * k + 1];
+    }
+
+    inverse_butterfly_8_core(even_input, even);
+
+    // Quantization leaves the odd half of most lines empty, in which case the output is
+    // symmetric and only the even half is required.
+    if (odd_mask)
+    {
+        for (uint8 k = 0; k < 8; ++k)
+        {
+            int32 value = x[2 * k + 1];
+
+            if (!value)
+            {
+                continue;
+            }
+
+            const int16 *fix = EVX_TRANSFORM_16x16_ODD_FIX_LUT + k * 8;
+
+            for (uint8 n = 0; n < 8; ++n)
+            {
+                odd[n] += value * fix[n];
+            }
+        }
+    }
+
+    for (uint8 n = 0; n < 8; ++n)
+    {
+        y[n] = EVX_BUTTERFLY_DESCALE(even[n] + odd[n], shift);
+        y[15 - n] = EVX_BUTTERFLY_DESCALE(even[n] - odd[n], shift);
+    }
+}
+
+void transform_8x8_butterfly(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    int32 line[8];
+    int32 output[8];
+    int32 scratch_block[8*8];
+
+    // Horizontal DCT-II
+    for (uint8 j = 0; j < 8; ++j)
+    {
+        for (uint8 k = 0; k < 8; ++k)
+        {
+            line[k] = src[j * src_pitch + k];
+        }
+
+        forward_butterfly_8(line, scratch_block + j * 8, EVX_BUTTERFLY_FIRST_SHIFT);
+    }
+
+    // Vertical DCT-II
+    for (uint8 j = 0; j < 8; ++j)
+    {
+        for (uint8 k = 0; k < 8; ++k)
+        {
+            line[k] = scratch_block[k * 8 + j];
+        }
+
+        forward_butterfly_8(line, output, EVX_BUTTERFLY_SECOND_SHIFT);
+
+        for (uint8 k = 0; k < 8; ++k)
+        {
+            dest[k * dest_pitch + j] = output[k];
+        }
+    }
+}
+
+void inverse_transform_8x8_butterfly(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    int32 line[8];
+    int32 output[8];
+    int32 scratch_block[8*8];
+
+    // Vertical IDCT-II
+    for (uint8 j = 0; j < 8; ++j)
+    {
+        for (uint8 k = 0; k < 8; ++k)
+        {
+            line[k] = src[k * src_pitch + j];
+        }
+
+        inverse_butterfly_8(line, output, EVX_BUTTERFLY_FIRST_SHIFT);
+
+        for (uint8 k = 0; k < 8; ++k)
+        {
+            scratch_block[k * 8 + j] = output[k];
+        }
+    }
+
+    // Horizontal IDCT-II
+    for (uint8 j = 0; j < 8; ++j)
+    {
+        inverse_butterfly_8(scratch_block + j * 8, output, EVX_BUTTERFLY_SECOND_SHIFT);
+
+        for (uint8 k = 0; k < 8; ++k)
+        {
+            dest[j * dest_pitch + k] = output[k];
+        }
+    }
+}
+
+void inverse_transform_add_8x8_butterfly(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch)
+{
+    int32 line[8];
+    int32 output[8];
+    int32 scratch_block[8*8];
+
+    // Vertical IDCT-II
+    for (uint8 j = 0; j < 8; ++j)
+    {
+        for (uint8 k = 0; k < 8; ++k)
+        {
+            line[k] = src[k * src_pitch + j];
+        }
+
+        inverse_butterfly_8(line, output, EVX_BUTTERFLY_FIRST_SHIFT);
+
+        for (uint8 k = 0; k < 8; ++k)
+        {
+            scratch_block[k * 8 + j] = output[k];
+        }
+    }
+
+    // Horizontal IDCT-II
+    for (uint8 j = 0; j < 8; ++j)
+    {
+        inverse_butterfly_8(scratch_block + j * 8, output, EVX_BUTTERFLY_SECOND_SHIFT);
+
+        for (uint8 k = 0; k < 8; ++k)
+        {
+            dest[j * dest_pitch + k] = output[k] + add[j * add_pitch + k];
+        }
+    }
+}
+
+void sub_transform_8x8_butterfly(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch)
+{
+    int16 sub_scratch_block[8*8];
+
+    for (uint8 j = 0; j < 8; j++) 
+    {
+        sub_8x8_line(src + j * src_pitch, sub + j * sub_pitch, sub_scratch_block + j * 8);
+    }
+
+    transform_8x8_butterfly(sub_scratch_block, 8, dest, dest_pitch);
+}
+
+void transform_16x16_butterfly(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    int32 line[16];
+    int32 output[16];
+    int32 scratch_block[16*16];
+
+    // Horizontal DCT-II
+    for (uint8 j = 0; j < 16; ++j)
+    {
+        for (uint8 k = 0; k < 16; ++k)
+        {
+            line[k] = src[j * src_pitch + k];
+        }
+
+        forward_butterfly_16(line, scratch_block + j * 16, EVX_BUTTERFLY_16x16_FIRST_SHIFT);
+    }
+
+    // Vertical DCT-II
+    for (uint8 j = 0; j < 16; ++j)
+    {
+        for (uint8 k = 0; k < 16; ++k)
+        {
+            line[k] = scratch_block[k * 16 + j];
+        }
+
+        forward_butterfly_16(line, output, EVX_BUTTERFLY_16x16_SECOND_SHIFT);
+
+        for (uint8 k = 0; k < 16; ++k)
+        {
+            dest[k * dest_pitch + j] = output[k];
+        }
+    }
+}
+
+void inverse_transform_16x16_butterfly(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    int32 line[16];
+    int32 output[16];
+    int32 scratch_block[16*16];
+
+    // Vertical IDCT-II
+    for (uint8 j = 0; j < 16; ++j)
+    {
+        for (uint8 k = 0; k < 16; ++k)
+        {
+            line[k] = src[k * src_pitch + j];
+        }
 
+        inverse_butterfly_16(line, output, EVX_BUTTERFLY_16x16_FIRST_SHIFT);
 
+        for (uint8 k = 0; k < 16; ++k)
+        {
+            scratch_block[k * 16 + j] = output[k];
+        }
+    }
+
+    // Horizontal IDCT-II
+    for (uint8 j = 0; j < 16; ++j)
+    {
+        inverse_butterfly_16(scratch_block + j * 16, output, EVX_BUTTERFLY_16x16_SECOND_SHIFT);
+
+        for (uint8 k = 0; k < 16; ++k)
+        {
+            dest[j * dest_pitch + k] = output[k];
+        }
+    }
+}
+
+void inverse_transform_add_16x16_butterfly(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch)
+{
+    int32 line[16];
+    int32 output[16];
+    int32 scratch_block[16*16];
+
+    // Vertical IDCT-II
+    for (uint8 j = 0; j < 16; ++j)
+    {
+        for (uint8 k = 0; k < 16; ++k)
+        {
+            line[k] = src[k * src_pitch + j];
+        }
 
+        inverse_butterfly_16(line, output, EVX_BUTTERFLY_16x16_FIRST_SHIFT);
 
+        for (uint8 k = 0; k < 16; ++k)
+        {
+            scratch_block[k * 16 + j] = output[k];
+        }
+    }
 
+    // Horizontal IDCT-II
+    for (uint8 j = 0; j < 16; ++j)
+    {
+        inverse_butterfly_16(scratch_block + j * 16, output, EVX_BUTTERFLY_16x16_SECOND_SHIFT);
 
+        for (uint8 k = 0; k < 16; ++k)
+        {
+            dest[j * dest_pitch + k] = output[k] + add[j * add_pitch + k];
+        }
+    }
+}
 
+void sub_transform_16x16_butterfly(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch)
+{
+    int16 sub_scratch_block[16*16];
+
+    for (uint8 j = 0; j < 16; j++) 
+    {
+        sub_16x16_line(src + j * src_pitch, sub + j * sub_pitch, sub_scratch_block + j * 16);
+    }
+
+    transform_16x16_butterfly(sub_scratch_block, 16, dest, dest_pitch);
+}
+
+// Vectorized transforms
+//
+//   The vector kernels below are bit-exact with the scalar transforms for any input that 
+//   the scalar transforms compute without overflow. Each lane carries a separate line, so
+//   a pass over the columns of a block operates directly upon its rows, and a pass over 
+//   its rows transposes the block first. The reference transforms keep 16 bit values 
+//   between passes and map onto the 16 bit multiply-add instructions of sse2, with the 
+//   scale of each output folded into its trig constants. Rows of the reference transforms
+//   already fill the 128 bit registers, so higher levels share these kernels. The butterfly
+//   transforms require 32 bit intermediates and multiplies, which first appear in sse4.1,
+//   so sse2 processors use the scalar butterfly transforms.
+
+#if defined (EVX_SIMD_X86_SUPPORTED)
+
+static EVX_TARGET_SSE2 inline __m128i pair_epi16_sse2(int16 low, int16 high)
+{
+    return _mm_set1_epi32((int32) ((uint16) low | ((uint32) (uint16) high << 16)));
+}
+
+// Division by a power of two that rounds toward zero, as the division operator does.
+static EVX_TARGET_SSE2 inline __m128i div_pow2_sse2(__m128i value, uint8 shift)
+{
+    __m128i bias = _mm_srl_epi32(_mm_srai_epi32(value, 31), _mm_cvtsi32_si128(32 - shift));
+
+    return _mm_sra_epi32(_mm_add_epi32(value, bias), _mm_cvtsi32_si128(shift));
+}
+
+// Matches rounded_div(value, 128), which rounds halves away from zero.
+static EVX_TARGET_SSE2 inline __m128i rounded_div_128_sse2(__m128i value)
+{
+    __m128i bias = _mm_add_epi32(_mm_set1_epi32(64), _mm_srai_epi32(value, 31));
+
+    return _mm_srai_epi32(_mm_add_epi32(value, bias), 7);
+}
+
+// Truncates each lane to 16 bits, as an assignment to an int16 would, and packs them.
+static EVX_TARGET_SSE2 inline __m128i pack_epi32_sse2(__m128i low, __m128i high)
+{
+    low = _mm_srai_epi32(_mm_slli_epi32(low, 16), 16);
+    high = _mm_srai_epi32(_mm_slli_epi32(high, 16), 16);
+
+    return _mm_packs_epi32(low, high);
+}
+
+static EVX_TARGET_SSE2 inline void unpack_epi16_sse2(__m128i value, __m128i *low, __m128i *high)
+{
+    *low = _mm_srai_epi32(_mm_unpacklo_epi16(value, value), 16);
+    *high = _mm_srai_epi32(_mm_unpackhi_epi16(value, value), 16);
+}
+
+static EVX_TARGET_SSE2 inline void transpose_4x4_epi32_sse2(__m128i *rows, uint32 stride)
+{
+    __m128i t0 = _mm_unpacklo_epi32(rows[0 * stride], rows[1 * stride]);
+    __m128i t1 = _mm_unpacklo_epi32(rows[2 * stride], rows[3 * stride]);
+    __m128i t2 = _mm_unpackhi_epi32(rows[0 * stride], rows[1 * stride]);
+    __m128i t3 = _mm_unpackhi_epi32(rows[2 * stride], rows[3 * stride]);
+
+    rows[0 * stride] = _mm_unpacklo_epi64(t0, t1);
+    rows[1 * stride] = _mm_unpackhi_epi64(t0, t1);
+    rows[2 * stride] = _mm_unpacklo_epi64(t2, t3);
+    rows[3 * stride] = _mm_unpackhi_epi64(t2, t3);
+}
+
+static EVX_TARGET_SSE2 inline void transpose_8x8_epi16_sse2(__m128i *rows, uint32 stride)
+{
+    __m128i a0 = _mm_unpacklo_epi16(rows[0 * stride], rows[1 * stride]);
+    __m128i a1 = _mm_unpackhi_epi16(rows[0 * stride], rows[1 * stride]);
+    __m128i a2 = _mm_unpacklo_epi16(rows[2 * stride], rows[3 * stride]);
+    __m128i a3 = _mm_unpackhi_epi16(rows[2 * stride], rows[3 * stride]);
+    __m128i a4 = _mm_unpacklo_epi16(rows[4 * stride], rows[5 * stride]);
+    __m128i a5 = _mm_unpackhi_epi16(rows[4 * stride], rows[5 * stride]);
+    __m128i a6 = _mm_unpacklo_epi16(rows[6 * stride], rows[7 * stride]);
+    __m128i a7 = _mm_unpackhi_epi16(rows[6 * stride], rows[7 * stride]);
+
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+
+    rows[0 * stride] = _mm_unpacklo_epi64(b0, b4);
+    rows[1 * stride] = _mm_unpackhi_epi64(b0, b4);
+    rows[2 * stride] = _mm_unpacklo_epi64(b1, b5);
+    rows[3 * stride] = _mm_unpackhi_epi64(b1, b5);
+    rows[4 * stride] = _mm_unpacklo_epi64(b2, b6);
+    rows[5 * stride] = _mm_unpackhi_epi64(b2, b6);
+    rows[6 * stride] = _mm_unpacklo_epi64(b3, b7);
+    rows[7 * stride] = _mm_unpackhi_epi64(b3, b7);
+}
+
+// Transposes a square block that is stored as stride vectors per row, with tiles of 
+// tile_size elements on a side. Tiles off of the diagonal are transposed and swapped.
+static EVX_TARGET_SSE2 inline void transpose_block_sse2(__m128i *block, uint32 stride, uint32 tile_size)
+{
+    for (uint32 a = 0; a < stride; ++a)
+    for (uint32 b = a; b < stride; ++b)
+    {
+        __m128i *upper = block + a * tile_size * stride + b;
+        __m128i *lower = block + b * tile_size * stride + a;
+
+        if (4 == tile_size)
+        {
+            transpose_4x4_epi32_sse2(upper, stride);
+        }
+        else
+        {
+            transpose_8x8_epi16_sse2(upper, stride);
+        }
+
+        if (a == b)
+        {
+            continue;
+        }
+
+        if (4 == tile_size)
+        {
+            transpose_4x4_epi32_sse2(lower, stride);
+        }
+        else
+        {
+            transpose_8x8_epi16_sse2(lower, stride);
+        }
+
+        for (uint32 r = 0; r < tile_size; ++r)
+        {
+            __m128i temp = upper[r * stride];
+            upper[r * stride] = lower[r * stride];
+            lower[r * stride] = temp;
+        }
+    }
+}
+
+static EVX_TARGET_SSE2 inline void load_block_epi16_sse2(int16 *src, uint32 src_pitch, uint8 size, __m128i *rows)
+{
+    uint32 stride = size >> 3;
+
+    for (uint32 j = 0; j < size; ++j)
+    for (uint32 h = 0; h < stride; ++h)
+    {
+        rows[j * stride + h] = _mm_loadu_si128((const __m128i *) (src + j * src_pitch + h * 8));
+    }
+}
+
+static EVX_TARGET_SSE2 inline void load_sub_block_epi16_sse2(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, uint8 size, __m128i *rows)
+{
+    uint32 stride = size >> 3;
+
+    for (uint32 j = 0; j < size; ++j)
+    for (uint32 h = 0; h < stride; ++h)
+    {
+        __m128i left = _mm_loadu_si128((const __m128i *) (src + j * src_pitch + h * 8));
+        __m128i right = _mm_loadu_si128((const __m128i *) (sub + j * sub_pitch + h * 8));
+
+        rows[j * stride + h] = _mm_sub_epi16(left, right);
+    }
+}
+
+static EVX_TARGET_SSE2 inline void store_block_epi16_sse2(const __m128i *rows, uint8 size, int16 *dest, uint32 dest_pitch)
+{
+    uint32 stride = size >> 3;
+
+    for (uint32 j = 0; j < size; ++j)
+    for (uint32 h = 0; h < stride; ++h)
+    {
+        _mm_storeu_si128((__m128i *) (dest + j * dest_pitch + h * 8), rows[j * stride + h]);
+    }
+}
+
+static EVX_TARGET_SSE2 inline void store_add_block_epi16_sse2(const __m128i *rows, uint8 size, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch)
+{
+    uint32 stride = size >> 3;
+
+    for (uint32 j = 0; j < size; ++j)
+    for (uint32 h = 0; h < stride; ++h)
+    {
+        __m128i prediction = _mm_loadu_si128((const __m128i *) (add + j * add_pitch + h * 8));
+        _mm_storeu_si128((__m128i *) (dest + j * dest_pitch + h * 8), _mm_add_epi16(rows[j * stride + h], prediction));
+    }
+}
+
+// Widens a block of 16 bit rows to 32 bits, or narrows it back.
+static EVX_TARGET_SSE2 inline void unpack_block_sse2(const __m128i *rows, uint8 size, __m128i *block)
+{
+    for (uint32 i = 0; i < ((uint32) size * size) >> 3; ++i)
+    {
+        unpack_epi16_sse2(rows[i], block + 2 * i, block + 2 * i + 1);
+    }
+}
+
+static EVX_TARGET_SSE2 inline void pack_block_sse2(const __m128i *block, uint8 size, __m128i *rows)
+{
+    for (uint32 i = 0; i < ((uint32) size * size) >> 3; ++i)
+    {
+        rows[i] = pack_epi32_sse2(block[2 * i], block[2 * i + 1]);
+    }
+}
+
+// Reference transforms
+
+static EVX_TARGET_SSE2 inline void transform_columns_sse2(__m128i *rows, uint8 size)
+{
+    // Each pair of rows is interleaved, so that a single multiply-add accumulates two terms 
+    // of each output. The dc scale of the 8 point transform and all scales of the 16 point
+    // transform are products, which fold into the trig constants, and the division that 
+    // follows them always rounds toward zero, as it does in transform_*_line_fast.
+    const int16 *trig_table = (8 == size) ? EVX_TRANSFORM_8x8_TRIG_128_LUT : EVX_TRANSFORM_16x16_TRIG_128_LUT;
+    uint32 stride = size >> 3;
+    uint32 pair_count = size >> 1;
+    __m128i pairs[32];
+    __m128i output[32];
+
+    for (uint32 h = 0; h < stride; ++h)
+    for (uint32 p = 0; p < pair_count; ++p)
+    {
+        __m128i even_row = rows[(2 * p) * stride + h];
+        __m128i odd_row = rows[(2 * p + 1) * stride + h];
+
+        pairs[(h * pair_count + p) * 2 + 0] = _mm_unpacklo_epi16(even_row, odd_row);
+        pairs[(h * pair_count + p) * 2 + 1] = _mm_unpackhi_epi16(even_row, odd_row);
+    }
+
+    for (uint32 i = 0; i < size; ++i)
+    {
+        const int16 *trig = trig_table + i * size;
+        int16 scale = 45;
+        uint8 shift = 7;
+
+        if (8 == size && i)
+        {
+            scale = 1;
+            shift = 1;
+        }
+        else if (16 == size && !i)
+        {
+            scale = 32;
+        }
+
+        for (uint32 h = 0; h < stride; ++h)
+        {
+            __m128i low = _mm_setzero_si128();
+            __m128i high = _mm_setzero_si128();
+
+            for (uint32 p = 0; p < pair_count; ++p)
+            {
+                __m128i factor = pair_epi16_sse2(trig[2 * p] * scale, trig[2 * p + 1] * scale);
+
+                low = _mm_add_epi32(low, _mm_madd_epi16(pairs[(h * pair_count + p) * 2 + 0], factor));
+                high = _mm_add_epi32(high, _mm_madd_epi16(pairs[(h * pair_count + p) * 2 + 1], factor));
+            }
+
+            low = rounded_div_128_sse2(div_pow2_sse2(low, shift));
+            high = rounded_div_128_sse2(div_pow2_sse2(high, shift));
+
+            output[i * stride + h] = pack_epi32_sse2(low, high);
+        }
+    }
+
+    for (uint32 i = 0; i < size * stride; ++i)
+    {
+        rows[i] = output[i];
+    }
+}
+
+static EVX_TARGET_SSE2 inline void inverse_transform_columns_sse2(__m128i *rows, uint8 size)
+{
+    // The inverse scales, and rounds, each term individually, so every product is widened.
+    const int16 *trig_table = (8 == size) ? EVX_TRANSFORM_8x8_TRIG_128_LUT : EVX_TRANSFORM_16x16_TRIG_128_LUT;
+    uint32 stride = size >> 3;
+    __m128i output[32];
+
+    for (uint32 i = 0; i < size; ++i)
+    for (uint32 h = 0; h < stride; ++h)
+    {
+        __m128i low = _mm_setzero_si128();
+        __m128i high = _mm_setzero_si128();
+
+        for (uint32 k = 0; k < size; ++k)
+        {
+            int16 scale = 45;
+            uint8 shift = 7;
+
+            if (8 == size && k)
+            {
+                scale = 1;
+                shift = 1;
+            }
+            else if (16 == size && !k)
+            {
+                scale = 32;
+            }
+
+            __m128i factor = _mm_set1_epi16(trig_table[k * size + i] * scale);
+            __m128i product_low = _mm_mullo_epi16(rows[k * stride + h], factor);
+            __m128i product_high = _mm_mulhi_epi16(rows[k * stride + h], factor);
+
+            low = _mm_add_epi32(low, div_pow2_sse2(_mm_unpacklo_epi16(product_low, product_high), shift));
+            high = _mm_add_epi32(high, div_pow2_sse2(_mm_unpackhi_epi16(product_low, product_high), shift));
+        }
+
+        output[i * stride + h] = pack_epi32_sse2(rounded_div_128_sse2(low), rounded_div_128_sse2(high));
+    }
+
+    for (uint32 i = 0; i < size * stride; ++i)
+    {
+        rows[i] = output[i];
+    }
+}
+
+static EVX_TARGET_SSE2 inline void transform_rows_sse2(__m128i *rows, uint8 size)
+{
+    // Horizontal DCT-II
+    transpose_block_sse2(rows, size >> 3, 8);
+    transform_columns_sse2(rows, size);
+    
+    // Vertical DCT-II
+    transpose_block_sse2(rows, size >> 3, 8);
+    transform_columns_sse2(rows, size);
+}
+
+static EVX_TARGET_SSE2 inline void inverse_transform_rows_sse2(__m128i *rows, uint8 size)
+{
+    // Vertical IDCT-II
+    inverse_transform_columns_sse2(rows, size);
+
+    // Horizontal IDCT-II
+    transpose_block_sse2(rows, size >> 3, 8);
+    inverse_transform_columns_sse2(rows, size);
+    transpose_block_sse2(rows, size >> 3, 8);
+}
+
+static EVX_TARGET_SSE2 void transform_8x8_sse2(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[8];
+
+    load_block_epi16_sse2(src, src_pitch, 8, rows);
+    transform_rows_sse2(rows, 8);
+    store_block_epi16_sse2(rows, 8, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE2 void inverse_transform_8x8_sse2(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[8];
+
+    load_block_epi16_sse2(src, src_pitch, 8, rows);
+    inverse_transform_rows_sse2(rows, 8);
+    store_block_epi16_sse2(rows, 8, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE2 void sub_transform_8x8_sse2(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[8];
+
+    load_sub_block_epi16_sse2(src, src_pitch, sub, sub_pitch, 8, rows);
+    transform_rows_sse2(rows, 8);
+    store_block_epi16_sse2(rows, 8, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE2 void inverse_transform_add_8x8_sse2(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[8];
+
+    load_block_epi16_sse2(src, src_pitch, 8, rows);
+    inverse_transform_rows_sse2(rows, 8);
+    store_add_block_epi16_sse2(rows, 8, add, add_pitch, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE2 void transform_16x16_sse2(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[32];
+
+    load_block_epi16_sse2(src, src_pitch, 16, rows);
+    transform_rows_sse2(rows, 16);
+    store_block_epi16_sse2(rows, 16, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE2 void inverse_transform_16x16_sse2(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[32];
+
+    load_block_epi16_sse2(src, src_pitch, 16, rows);
+    inverse_transform_rows_sse2(rows, 16);
+    store_block_epi16_sse2(rows, 16, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE2 void sub_transform_16x16_sse2(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[32];
+
+    load_sub_block_epi16_sse2(src, src_pitch, sub, sub_pitch, 16, rows);
+    transform_rows_sse2(rows, 16);
+    store_block_epi16_sse2(rows, 16, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE2 void inverse_transform_add_16x16_sse2(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[32];
+
+    load_block_epi16_sse2(src, src_pitch, 16, rows);
+    inverse_transform_rows_sse2(rows, 16);
+    store_add_block_epi16_sse2(rows, 16, add, add_pitch, dest, dest_pitch);
+}
+
+// Butterfly transforms
+
+static EVX_TARGET_SSE41 inline __m128i descale_sse41(__m128i value, uint8 shift)
+{
+    return _mm_sra_epi32(_mm_add_epi32(value, _mm_set1_epi32(1 << (shift - 1))), _mm_cvtsi32_si128(shift));
+}
+
+static EVX_TARGET_SSE41 inline __m128i mul_const_sse41(__m128i value, int32 constant)
+{
+    return _mm_mullo_epi32(value, _mm_set1_epi32(constant));
+}
+
+static EVX_TARGET_SSE41 inline void forward_butterfly_8_sse41(const __m128i *x, __m128i *y, uint8 shift)
+{
+    __m128i tmp0 = _mm_add_epi32(x[0], x[7]);
+    __m128i tmp7 = _mm_sub_epi32(x[0], x[7]);
+    __m128i tmp1 = _mm_add_epi32(x[1], x[6]);
+    __m128i tmp6 = _mm_sub_epi32(x[1], x[6]);
+    __m128i tmp2 = _mm_add_epi32(x[2], x[5]);
+    __m128i tmp5 = _mm_sub_epi32(x[2], x[5]);
+    __m128i tmp3 = _mm_add_epi32(x[3], x[4]);
+    __m128i tmp4 = _mm_sub_epi32(x[3], x[4]);
+
+    // Even part.
+    __m128i tmp10 = _mm_add_epi32(tmp0, tmp3);
+    __m128i tmp13 = _mm_sub_epi32(tmp0, tmp3);
+    __m128i tmp11 = _mm_add_epi32(tmp1, tmp2);
+    __m128i tmp12 = _mm_sub_epi32(tmp1, tmp2);
+
+    __m128i z1 = mul_const_sse41(_mm_add_epi32(tmp12, tmp13), EVX_FIX_0_541196100);
+
+    y[0] = descale_sse41(_mm_slli_epi32(_mm_add_epi32(tmp10, tmp11), EVX_BUTTERFLY_CONST_BITS), shift);
+    y[4] = descale_sse41(_mm_slli_epi32(_mm_sub_epi32(tmp10, tmp11), EVX_BUTTERFLY_CONST_BITS), shift);
+    y[2] = descale_sse41(_mm_add_epi32(z1, mul_const_sse41(tmp13, EVX_FIX_0_765366865)), shift);
+    y[6] = descale_sse41(_mm_sub_epi32(z1, mul_const_sse41(tmp12, EVX_FIX_1_847759065)), shift);
+
+    // Odd part.
+    z1 = _mm_add_epi32(tmp4, tmp7);
+    __m128i z2 = _mm_add_epi32(tmp5, tmp6);
+    __m128i z3 = _mm_add_epi32(tmp4, tmp6);
+    __m128i z4 = _mm_add_epi32(tmp5, tmp7);
+    __m128i z5 = mul_const_sse41(_mm_add_epi32(z3, z4), EVX_FIX_1_175875602);
+
+    tmp4 = mul_const_sse41(tmp4, EVX_FIX_0_298631336);
+    tmp5 = mul_const_sse41(tmp5, EVX_FIX_2_053119869);
+    tmp6 = mul_const_sse41(tmp6, EVX_FIX_3_072711026);
+    tmp7 = mul_const_sse41(tmp7, EVX_FIX_1_501321110);
+    z1 = mul_const_sse41(z1, -EVX_FIX_0_899976223);
+    z2 = mul_const_sse41(z2, -EVX_FIX_2_562915447);
+    z3 = _mm_sub_epi32(z5, mul_const_sse41(z3, EVX_FIX_1_961570560));
+    z4 = _mm_sub_epi32(z5, mul_const_sse41(z4, EVX_FIX_0_390180644));
+
+    y[7] = descale_sse41(_mm_add_epi32(tmp4, _mm_add_epi32(z1, z3)), shift);
+    y[5] = descale_sse41(_mm_add_epi32(tmp5, _mm_add_epi32(z2, z4)), shift);
+    y[3] = descale_sse41(_mm_add_epi32(tmp6, _mm_add_epi32(z2, z3)), shift);
+    y[1] = descale_sse41(_mm_add_epi32(tmp7, _mm_add_epi32(z1, z4)), shift);
+}
+
+static EVX_TARGET_SSE41 inline void inverse_butterfly_8_core_sse41(const __m128i *x, __m128i *y)
+{
+    // Even part.
+    __m128i z1 = mul_const_sse41(_mm_add_epi32(x[2], x[6]), EVX_FIX_0_541196100);
+    __m128i tmp2 = _mm_sub_epi32(z1, mul_const_sse41(x[6], EVX_FIX_1_847759065));
+    __m128i tmp3 = _mm_add_epi32(z1, mul_const_sse41(x[2], EVX_FIX_0_765366865));
+    __m128i tmp0 = _mm_slli_epi32(_mm_add_epi32(x[0], x[4]), EVX_BUTTERFLY_CONST_BITS);
+    __m128i tmp1 = _mm_slli_epi32(_mm_sub_epi32(x[0], x[4]), EVX_BUTTERFLY_CONST_BITS);
+
+    __m128i tmp10 = _mm_add_epi32(tmp0, tmp3);
+    __m128i tmp13 = _mm_sub_epi32(tmp0, tmp3);
+    __m128i tmp11 = _mm_add_epi32(tmp1, tmp2);
+    __m128i tmp12 = _mm_sub_epi32(tmp1, tmp2);
+
+    // Odd part.
+    tmp0 = x[7];
+    tmp1 = x[5];
+    tmp2 = x[3];
+    tmp3 = x[1];
+
+    z1 = _mm_add_epi32(tmp0, tmp3);
+    __m128i z2 = _mm_add_epi32(tmp1, tmp2);
+    __m128i z3 = _mm_add_epi32(tmp0, tmp2);
+    __m128i z4 = _mm_add_epi32(tmp1, tmp3);
+    __m128i z5 = mul_const_sse41(_mm_add_epi32(z3, z4), EVX_FIX_1_175875602);
+
+    tmp0 = mul_const_sse41(tmp0, EVX_FIX_0_298631336);
+    tmp1 = mul_const_sse41(tmp1, EVX_FIX_2_053119869);
+    tmp2 = mul_const_sse41(tmp2, EVX_FIX_3_072711026);
+    tmp3 = mul_const_sse41(tmp3, EVX_FIX_1_501321110);
+    z1 = mul_const_sse41(z1, -EVX_FIX_0_899976223);
+    z2 = mul_const_sse41(z2, -EVX_FIX_2_562915447);
+    z3 = _mm_sub_epi32(z5, mul_const_sse41(z3, EVX_FIX_1_961570560));
+    z4 = _mm_sub_epi32(z5, mul_const_sse41(z4, EVX_FIX_0_390180644));
+
+    tmp0 = _mm_add_epi32(tmp0, _mm_add_epi32(z1, z3));
+    tmp1 = _mm_add_epi32(tmp1, _mm_add_epi32(z2, z4));
+    tmp2 = _mm_add_epi32(tmp2, _mm_add_epi32(z2, z3));
+    tmp3 = _mm_add_epi32(tmp3, _mm_add_epi32(z1, z4));
+
+    y[0] = _mm_add_epi32(tmp10, tmp3);
+    y[7] = _mm_sub_epi32(tmp10, tmp3);
+    y[1] = _mm_add_epi32(tmp11, tmp2);
+    y[6] = _mm_sub_epi32(tmp11, tmp2);
+    y[2] = _mm_add_epi32(tmp12, tmp1);
+    y[5] = _mm_sub_epi32(tmp12, tmp1);
+    y[3] = _mm_add_epi32(tmp13, tmp0);
+    y[4] = _mm_sub_epi32(tmp13, tmp0);
+}
+
+static EVX_TARGET_SSE41 inline void forward_butterfly_16_sse41(const __m128i *x, __m128i *y, uint8 shift)
+{
+    __m128i sum[8];
+    __m128i diff[8];
+    __m128i even[8];
+
+    for (uint8 n = 0; n < 8; ++n)
+    {
+        sum[n] = _mm_add_epi32(x[n], x[15 - n]);
+        diff[n] = _mm_sub_epi32(x[n], x[15 - n]);
+    }
+
+    forward_butterfly_8_sse41(sum, even, shift);
+
+    for (uint8 k = 0; k < 8; ++k)
+    {
+        const int16 *fix = EVX_TRANSFORM_16x16_ODD_FIX_LUT + k * 8;
+        __m128i total = mul_const_sse41(diff[0], fix[0]);
+
+        for (uint8 n = 1; n < 8; ++n)
+        {
+            total = _mm_add_epi32(total, mul_const_sse41(diff[n], fix[n]));
+        }
+
+        y[2 * k] = even[k];
+        y[2 * k + 1] = descale_sse41(total, shift);
+    }
+}
+
+static EVX_TARGET_SSE41 inline void inverse_butterfly_16_sse41(const __m128i *x, __m128i *y, uint8 shift)
+{
+    __m128i even_input[8];
+    __m128i even[8];
+    __m128i odd[8];
+    __m128i odd_mask = _mm_setzero_si128();
+
+    for (uint8 k = 0; k < 8; ++k)
+    {
+        even_input[k] = x[2 * k];
+        odd_mask = _mm_or_si128(odd_mask, x[2 * k + 1]);
+        odd[k] = _mm_setzero_si128();
+    }
+
+    inverse_butterfly_8_core_sse41(even_input, even);
+
+    if (!_mm_testz_si128(odd_mask, odd_mask))
+    {
+        for (uint8 k = 0; k < 8; ++k)
+        {
+            const int16 *fix = EVX_TRANSFORM_16x16_ODD_FIX_LUT + k * 8;
+
+            for (uint8 n = 0; n < 8; ++n)
+            {
+                odd[n] = _mm_add_epi32(odd[n], mul_const_sse41(x[2 * k + 1], fix[n]));
+            }
+        }
+    }
+
+    for (uint8 n = 0; n < 8; ++n)
+    {
+        y[n] = descale_sse41(_mm_add_epi32(even[n], odd[n]), shift);
+        y[15 - n] = descale_sse41(_mm_sub_epi32(even[n], odd[n]), shift);
+    }
+}
+
+// Applies a line transform to the columns of a block of 32 bit rows, four columns at a time.
+static EVX_TARGET_SSE41 inline void forward_butterfly_columns_sse41(__m128i *block, uint8 size, uint8 shift)
+{
+    uint32 stride = size >> 2;
+    __m128i line[16];
+    __m128i output[16];
+
+    for (uint32 h = 0; h < stride; ++h)
+    {
+        for (uint32 k = 0; k < size; ++k)
+        {
+            line[k] = block[k * stride + h];
+        }
+
+        if (8 == size)
+        {
+            forward_butterfly_8_sse41(line, output, shift);
+        }
+        else
+        {
+            forward_butterfly_16_sse41(line, output, shift);
+        }
+
+        for (uint32 k = 0; k < size; ++k)
+        {
+            block[k * stride + h] = output[k];
+        }
+    }
+}
+
+static EVX_TARGET_SSE41 inline void inverse_butterfly_columns_sse41(__m128i *block, uint8 size, uint8 shift)
+{
+    uint32 stride = size >> 2;
+    __m128i line[16];
+    __m128i output[16];
+
+    for (uint32 h = 0; h < stride; ++h)
+    {
+        for (uint32 k = 0; k < size; ++k)
+        {
+            line[k] = block[k * stride + h];
+        }
+
+        if (8 == size)
+        {
+            inverse_butterfly_8_core_sse41(line, output);
+
+            for (uint32 k = 0; k < 8; ++k)
+            {
+                output[k] = descale_sse41(output[k], shift);
+            }
+        }
+        else
+        {
+            inverse_butterfly_16_sse41(line, output, shift);
+        }
+
+        for (uint32 k = 0; k < size; ++k)
+        {
+            block[k * stride + h] = output[k];
+        }
+    }
+}
+
+static EVX_TARGET_SSE41 inline void transform_butterfly_rows_sse41(__m128i *rows, uint8 size)
+{
+    uint8 first_shift = (8 == size) ? EVX_BUTTERFLY_FIRST_SHIFT : EVX_BUTTERFLY_16x16_FIRST_SHIFT;
+    uint8 second_shift = (8 == size) ? EVX_BUTTERFLY_SECOND_SHIFT : EVX_BUTTERFLY_16x16_SECOND_SHIFT;
+    __m128i block[64];
+
+    unpack_block_sse2(rows, size, block);
+
+    // Horizontal DCT-II
+    transpose_block_sse2(block, size >> 2, 4);
+    forward_butterfly_columns_sse41(block, size, first_shift);
+
+    // Vertical DCT-II
+    transpose_block_sse2(block, size >> 2, 4);
+    forward_butterfly_columns_sse41(block, size, second_shift);
+
+    pack_block_sse2(block, size, rows);
+}
+
+static EVX_TARGET_SSE41 inline void inverse_transform_butterfly_rows_sse41(__m128i *rows, uint8 size)
+{
+    uint8 first_shift = (8 == size) ? EVX_BUTTERFLY_FIRST_SHIFT : EVX_BUTTERFLY_16x16_FIRST_SHIFT;
+    uint8 second_shift = (8 == size) ? EVX_BUTTERFLY_SECOND_SHIFT : EVX_BUTTERFLY_16x16_SECOND_SHIFT;
+    __m128i block[64];
+
+    unpack_block_sse2(rows, size, block);
+
+    // Vertical IDCT-II
+    inverse_butterfly_columns_sse41(block, size, first_shift);
+
+    // Horizontal IDCT-II
+    transpose_block_sse2(block, size >> 2, 4);
+    inverse_butterfly_columns_sse41(block, size, second_shift);
+    transpose_block_sse2(block, size >> 2, 4);
+
+    pack_block_sse2(block, size, rows);
+}
+
+static EVX_TARGET_SSE41 void transform_8x8_butterfly_sse41(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[8];
+
+    load_block_epi16_sse2(src, src_pitch, 8, rows);
+    transform_butterfly_rows_sse41(rows, 8);
+    store_block_epi16_sse2(rows, 8, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE41 void inverse_transform_8x8_butterfly_sse41(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[8];
+
+    load_block_epi16_sse2(src, src_pitch, 8, rows);
+    inverse_transform_butterfly_rows_sse41(rows, 8);
+    store_block_epi16_sse2(rows, 8, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE41 void sub_transform_8x8_butterfly_sse41(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[8];
+
+    load_sub_block_epi16_sse2(src, src_pitch, sub, sub_pitch, 8, rows);
+    transform_butterfly_rows_sse41(rows, 8);
+    store_block_epi16_sse2(rows, 8, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE41 void inverse_transform_add_8x8_butterfly_sse41(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[8];
+
+    load_block_epi16_sse2(src, src_pitch, 8, rows);
+    inverse_transform_butterfly_rows_sse41(rows, 8);
+    store_add_block_epi16_sse2(rows, 8, add, add_pitch, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE41 void transform_16x16_butterfly_sse41(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[32];
+
+    load_block_epi16_sse2(src, src_pitch, 16, rows);
+    transform_butterfly_rows_sse41(rows, 16);
+    store_block_epi16_sse2(rows, 16, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE41 void inverse_transform_16x16_butterfly_sse41(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[32];
+
+    load_block_epi16_sse2(src, src_pitch, 16, rows);
+    inverse_transform_butterfly_rows_sse41(rows, 16);
+    store_block_epi16_sse2(rows, 16, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE41 void sub_transform_16x16_butterfly_sse41(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[32];
+
+    load_sub_block_epi16_sse2(src, src_pitch, sub, sub_pitch, 16, rows);
+    transform_butterfly_rows_sse41(rows, 16);
+    store_block_epi16_sse2(rows, 16, dest, dest_pitch);
+}
+
+static EVX_TARGET_SSE41 void inverse_transform_add_16x16_butterfly_sse41(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m128i rows[32];
+
+    load_block_epi16_sse2(src, src_pitch, 16, rows);
+    inverse_transform_butterfly_rows_sse41(rows, 16);
+    store_add_block_epi16_sse2(rows, 16, add, add_pitch, dest, dest_pitch);
+}
+
+static EVX_TARGET_AVX2 inline __m256i descale_avx2(__m256i value, uint8 shift)
+{
+    return _mm256_sra_epi32(_mm256_add_epi32(value, _mm256_set1_epi32(1 << (shift - 1))), _mm_cvtsi32_si128(shift));
+}
+
+static EVX_TARGET_AVX2 inline __m256i mul_const_avx2(__m256i value, int32 constant)
+{
+    return _mm256_mullo_epi32(value, _mm256_set1_epi32(constant));
+}
+
+// Truncates each lane to 16 bits, as an assignment to an int16 would, and packs them.
+static EVX_TARGET_AVX2 inline __m128i pack_epi32_avx2(__m256i value)
+{
+    value = _mm256_srai_epi32(_mm256_slli_epi32(value, 16), 16);
+    value = _mm256_packs_epi32(value, value);
+
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(value, _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+static EVX_TARGET_AVX2 inline void transpose_8x8_epi32_avx2(__m256i *rows, uint32 stride)
+{
+    __m256i t0 = _mm256_unpacklo_epi32(rows[0 * stride], rows[1 * stride]);
+    __m256i t1 = _mm256_unpackhi_epi32(rows[0 * stride], rows[1 * stride]);
+    __m256i t2 = _mm256_unpacklo_epi32(rows[2 * stride], rows[3 * stride]);
+    __m256i t3 = _mm256_unpackhi_epi32(rows[2 * stride], rows[3 * stride]);
+    __m256i t4 = _mm256_unpacklo_epi32(rows[4 * stride], rows[5 * stride]);
+    __m256i t5 = _mm256_unpackhi_epi32(rows[4 * stride], rows[5 * stride]);
+    __m256i t6 = _mm256_unpacklo_epi32(rows[6 * stride], rows[7 * stride]);
+    __m256i t7 = _mm256_unpackhi_epi32(rows[6 * stride], rows[7 * stride]);
+
+    __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    rows[0 * stride] = _mm256_permute2x128_si256(u0, u4, 0x20);
+    rows[1 * stride] = _mm256_permute2x128_si256(u1, u5, 0x20);
+    rows[2 * stride] = _mm256_permute2x128_si256(u2, u6, 0x20);
+    rows[3 * stride] = _mm256_permute2x128_si256(u3, u7, 0x20);
+    rows[4 * stride] = _mm256_permute2x128_si256(u0, u4, 0x31);
+    rows[5 * stride] = _mm256_permute2x128_si256(u1, u5, 0x31);
+    rows[6 * stride] = _mm256_permute2x128_si256(u2, u6, 0x31);
+    rows[7 * stride] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+static EVX_TARGET_AVX2 inline void transpose_block_avx2(__m256i *block, uint32 stride)
+{
+    for (uint32 a = 0; a < stride; ++a)
+    for (uint32 b = a; b < stride; ++b)
+    {
+        __m256i *upper = block + a * 8 * stride + b;
+        __m256i *lower = block + b * 8 * stride + a;
+
+        transpose_8x8_epi32_avx2(upper, stride);
+
+        if (a == b)
+        {
+            continue;
+        }
+
+        transpose_8x8_epi32_avx2(lower, stride);
+
+        for (uint32 r = 0; r < 8; ++r)
+        {
+            __m256i temp = upper[r * stride];
+            upper[r * stride] = lower[r * stride];
+            lower[r * stride] = temp;
+        }
+    }
+}
+
+static EVX_TARGET_AVX2 inline void load_block_avx2(int16 *src, uint32 src_pitch, uint8 size, __m256i *block)
+{
+    uint32 stride = size >> 3;
+
+    for (uint32 j = 0; j < size; ++j)
+    for (uint32 h = 0; h < stride; ++h)
+    {
+        block[j * stride + h] = _mm256_cvtepi16_epi32(_mm_loadu_si128((const __m128i *) (src + j * src_pitch + h * 8)));
+    }
+}
+
+static EVX_TARGET_AVX2 inline void load_sub_block_avx2(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, uint8 size, __m256i *block)
+{
+    uint32 stride = size >> 3;
+
+    for (uint32 j = 0; j < size; ++j)
+    for (uint32 h = 0; h < stride; ++h)
+    {
+        __m128i left = _mm_loadu_si128((const __m128i *) (src + j * src_pitch + h * 8));
+        __m128i right = _mm_loadu_si128((const __m128i *) (sub + j * sub_pitch + h * 8));
+
+        block[j * stride + h] = _mm256_cvtepi16_epi32(_mm_sub_epi16(left, right));
+    }
+}
+
+static EVX_TARGET_AVX2 inline void store_block_avx2(const __m256i *block, uint8 size, int16 *dest, uint32 dest_pitch)
+{
+    uint32 stride = size >> 3;
+
+    for (uint32 j = 0; j < size; ++j)
+    for (uint32 h = 0; h < stride; ++h)
+    {
+        _mm_storeu_si128((__m128i *) (dest + j * dest_pitch + h * 8), pack_epi32_avx2(block[j * stride + h]));
+    }
+}
+
+static EVX_TARGET_AVX2 inline void store_add_block_avx2(const __m256i *block, uint8 size, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch)
+{
+    uint32 stride = size >> 3;
+
+    for (uint32 j = 0; j < size; ++j)
+    for (uint32 h = 0; h < stride; ++h)
+    {
+        __m128i prediction = _mm_loadu_si128((const __m128i *) (add + j * add_pitch + h * 8));
+        _mm_storeu_si128((__m128i *) (dest + j * dest_pitch + h * 8), _mm_add_epi16(pack_epi32_avx2(block[j * stride + h]), prediction));
+    }
+}
+
+static EVX_TARGET_AVX2 inline void forward_butterfly_8_avx2(const __m256i *x, __m256i *y, uint8 shift)
+{
+    __m256i tmp0 = _mm256_add_epi32(x[0], x[7]);
+    __m256i tmp7 = _mm256_sub_epi32(x[0], x[7]);
+    __m256i tmp1 = _mm256_add_epi32(x[1], x[6]);
+    __m256i tmp6 = _mm256_sub_epi32(x[1], x[6]);
+    __m256i tmp2 = _mm256_add_epi32(x[2], x[5]);
+    __m256i tmp5 = _mm256_sub_epi32(x[2], x[5]);
+    __m256i tmp3 = _mm256_add_epi32(x[3], x[4]);
+    __m256i tmp4 = _mm256_sub_epi32(x[3], x[4]);
+
+    // Even part.
+    __m256i tmp10 = _mm256_add_epi32(tmp0, tmp3);
+    __m256i tmp13 = _mm256_sub_epi32(tmp0, tmp3);
+    __m256i tmp11 = _mm256_add_epi32(tmp1, tmp2);
+    __m256i tmp12 = _mm256_sub_epi32(tmp1, tmp2);
+
+    __m256i z1 = mul_const_avx2(_mm256_add_epi32(tmp12, tmp13), EVX_FIX_0_541196100);
+
+    y[0] = descale_avx2(_mm256_slli_epi32(_mm256_add_epi32(tmp10, tmp11), EVX_BUTTERFLY_CONST_BITS), shift);
+    y[4] = descale_avx2(_mm256_slli_epi32(_mm256_sub_epi32(tmp10, tmp11), EVX_BUTTERFLY_CONST_BITS), shift);
+    y[2] = descale_avx2(_mm256_add_epi32(z1, mul_const_avx2(tmp13, EVX_FIX_0_765366865)), shift);
+    y[6] = descale_avx2(_mm256_sub_epi32(z1, mul_const_avx2(tmp12, EVX_FIX_1_847759065)), shift);
+
+    // Odd part.
+    z1 = _mm256_add_epi32(tmp4, tmp7);
+    __m256i z2 = _mm256_add_epi32(tmp5, tmp6);
+    __m256i z3 = _mm256_add_epi32(tmp4, tmp6);
+    __m256i z4 = _mm256_add_epi32(tmp5, tmp7);
+    __m256i z5 = mul_const_avx2(_mm256_add_epi32(z3, z4), EVX_FIX_1_175875602);
+
+    tmp4 = mul_const_avx2(tmp4, EVX_FIX_0_298631336);
+    tmp5 = mul_const_avx2(tmp5, EVX_FIX_2_053119869);
+    tmp6 = mul_const_avx2(tmp6, EVX_FIX_3_072711026);
+    tmp7 = mul_const_avx2(tmp7, EVX_FIX_1_501321110);
+    z1 = mul_const_avx2(z1, -EVX_FIX_0_899976223);
+    z2 = mul_const_avx2(z2, -EVX_FIX_2_562915447);
+    z3 = _mm256_sub_epi32(z5, mul_const_avx2(z3, EVX_FIX_1_961570560));
+    z4 = _mm256_sub_epi32(z5, mul_const_avx2(z4, EVX_FIX_0_390180644));
+
+    y[7] = descale_avx2(_mm256_add_epi32(tmp4, _mm256_add_epi32(z1, z3)), shift);
+    y[5] = descale_avx2(_mm256_add_epi32(tmp5, _mm256_add_epi32(z2, z4)), shift);
+    y[3] = descale_avx2(_mm256_add_epi32(tmp6, _mm256_add_epi32(z2, z3)), shift);
+    y[1] = descale_avx2(_mm256_add_epi32(tmp7, _mm256_add_epi32(z1, z4)), shift);
+}
+
+static EVX_TARGET_AVX2 inline void inverse_butterfly_8_core_avx2(const __m256i *x, __m256i *y)
+{
+    // Even part.
+    __m256i z1 = mul_const_avx2(_mm256_add_epi32(x[2], x[6]), EVX_FIX_0_541196100);
+    __m256i tmp2 = _mm256_sub_epi32(z1, mul_const_avx2(x[6], EVX_FIX_1_847759065));
+    __m256i tmp3 = _mm256_add_epi32(z1, mul_const_avx2(x[2], EVX_FIX_0_765366865));
+    __m256i tmp0 = _mm256_slli_epi32(_mm256_add_epi32(x[0], x[4]), EVX_BUTTERFLY_CONST_BITS);
+    __m256i tmp1 = _mm256_slli_epi32(_mm256_sub_epi32(x[0], x[4]), EVX_BUTTERFLY_CONST_BITS);
+
+    __m256i tmp10 = _mm256_add_epi32(tmp0, tmp3);
+    __m256i tmp13 = _mm256_sub_epi32(tmp0, tmp3);
+    __m256i tmp11 = _mm256_add_epi32(tmp1, tmp2);
+    __m256i tmp12 = _mm256_sub_epi32(tmp1, tmp2);
+
+    // Odd part.
+    tmp0 = x[7];
+    tmp1 = x[5];
+    tmp2 = x[3];
+    tmp3 = x[1];
+
+    z1 = _mm256_add_epi32(tmp0, tmp3);
+    __m256i z2 = _mm256_add_epi32(tmp1, tmp2);
+    __m256i z3 = _mm256_add_epi32(tmp0, tmp2);
+    __m256i z4 = _mm256_add_epi32(tmp1, tmp3);
+    __m256i z5 = mul_const_avx2(_mm256_add_epi32(z3, z4), EVX_FIX_1_175875602);
+
+    tmp0 = mul_const_avx2(tmp0, EVX_FIX_0_298631336);
+    tmp1 = mul_const_avx2(tmp1, EVX_FIX_2_053119869);
+    tmp2 = mul_const_avx2(tmp2, EVX_FIX_3_072711026);
+    tmp3 = mul_const_avx2(tmp3, EVX_FIX_1_501321110);
+    z1 = mul_const_avx2(z1, -EVX_FIX_0_899976223);
+    z2 = mul_const_avx2(z2, -EVX_FIX_2_562915447);
+    z3 = _mm256_sub_epi32(z5, mul_const_avx2(z3, EVX_FIX_1_961570560));
+    z4 = _mm256_sub_epi32(z5, mul_const_avx2(z4, EVX_FIX_0_390180644));
+
+    tmp0 = _mm256_add_epi32(tmp0, _mm256_add_epi32(z1, z3));
+    tmp1 = _mm256_add_epi32(tmp1, _mm256_add_epi32(z2, z4));
+    tmp2 = _mm256_add_epi32(tmp2, _mm256_add_epi32(z2, z3));
+    tmp3 = _mm256_add_epi32(tmp3, _mm256_add_epi32(z1, z4));
+
+    y[0] = _mm256_add_epi32(tmp10, tmp3);
+    y[7] = _mm256_sub_epi32(tmp10, tmp3);
+    y[1] = _mm256_add_epi32(tmp11, tmp2);
+    y[6] = _mm256_sub_epi32(tmp11, tmp2);
+    y[2] = _mm256_add_epi32(tmp12, tmp1);
+    y[5] = _mm256_sub_epi32(tmp12, tmp1);
+    y[3] = _mm256_add_epi32(tmp13, tmp0);
+    y[4] = _mm256_sub_epi32(tmp13, tmp0);
+}
+
+static EVX_TARGET_AVX2 inline void forward_butterfly_16_avx2(const __m256i *x, __m256i *y, uint8 shift)
+{
+    __m256i sum[8];
+    __m256i diff[8];
+    __m256i even[8];
+
+    for (uint8 n = 0; n < 8; ++n)
+    {
+        sum[n] = _mm256_add_epi32(x[n], x[15 - n]);
+        diff[n] = _mm256_sub_epi32(x[n], x[15 - n]);
+    }
+
+    forward_butterfly_8_avx2(sum, even, shift);
+
+    for (uint8 k = 0; k < 8; ++k)
+    {
+        const int16 *fix = EVX_TRANSFORM_16x16_ODD_FIX_LUT + k * 8;
+        __m256i total = mul_const_avx2(diff[0], fix[0]);
+
+        for (uint8 n = 1; n < 8; ++n)
+        {
+            total = _mm256_add_epi32(total, mul_const_avx2(diff[n], fix[n]));
+        }
+
+        y[2 * k] = even[k];
+        y[2 * k + 1] = descale_avx2(total, shift);
+    }
+}
+
+static EVX_TARGET_AVX2 inline void inverse_butterfly_16_avx2(const __m256i *x, __m256i *y, uint8 shift)
+{
+    __m256i even_input[8];
+    __m256i even[8];
+    __m256i odd[8];
+    __m256i odd_mask = _mm256_setzero_si256();
+
+    for (uint8 k = 0; k < 8; ++k)
+    {
+        even_input[k] = x[2 * k];
+        odd_mask = _mm256_or_si256(odd_mask, x[2 * k + 1]);
+        odd[k] = _mm256_setzero_si256();
+    }
+
+    inverse_butterfly_8_core_avx2(even_input, even);
+
+    if (!_mm256_testz_si256(odd_mask, odd_mask))
+    {
+        for (uint8 k = 0; k < 8; ++k)
+        {
+            const int16 *fix = EVX_TRANSFORM_16x16_ODD_FIX_LUT + k * 8;
+
+            for (uint8 n = 0; n < 8; ++n)
+            {
+                odd[n] = _mm256_add_epi32(odd[n], mul_const_avx2(x[2 * k + 1], fix[n]));
+            }
+        }
+    }
+
+    for (uint8 n = 0; n < 8; ++n)
+    {
+        y[n] = descale_avx2(_mm256_add_epi32(even[n], odd[n]), shift);
+        y[15 - n] = descale_avx2(_mm256_sub_epi32(even[n], odd[n]), shift);
+    }
+}
+
+// Applies a line transform to the columns of a block of 32 bit rows, eight columns at a time.
+static EVX_TARGET_AVX2 inline void forward_butterfly_columns_avx2(__m256i *block, uint8 size, uint8 shift)
+{
+    uint32 stride = size >> 3;
+    __m256i line[16];
+    __m256i output[16];
+
+    for (uint32 h = 0; h < stride; ++h)
+    {
+        for (uint32 k = 0; k < size; ++k)
+        {
+            line[k] = block[k * stride + h];
+        }
+
+        if (8 == size)
+        {
+            forward_butterfly_8_avx2(line, output, shift);
+        }
+        else
+        {
+            forward_butterfly_16_avx2(line, output, shift);
+        }
+
+        for (uint32 k = 0; k < size; ++k)
+        {
+            block[k * stride + h] = output[k];
+        }
+    }
+}
+
+static EVX_TARGET_AVX2 inline void inverse_butterfly_columns_avx2(__m256i *block, uint8 size, uint8 shift)
+{
+    uint32 stride = size >> 3;
+    __m256i line[16];
+    __m256i output[16];
+
+    for (uint32 h = 0; h < stride; ++h)
+    {
+        for (uint32 k = 0; k < size; ++k)
+        {
+            line[k] = block[k * stride + h];
+        }
+
+        if (8 == size)
+        {
+            inverse_butterfly_8_core_avx2(line, output);
+
+            for (uint32 k = 0; k < 8; ++k)
+            {
+                output[k] = descale_avx2(output[k], shift);
+            }
+        }
+        else
+        {
+            inverse_butterfly_16_avx2(line, output, shift);
+        }
+
+        for (uint32 k = 0; k < size; ++k)
+        {
+            block[k * stride + h] = output[k];
+        }
+    }
+}
+
+static EVX_TARGET_AVX2 inline void transform_butterfly_block_avx2(__m256i *block, uint8 size)
+{
+    uint8 first_shift = (8 == size) ? EVX_BUTTERFLY_FIRST_SHIFT : EVX_BUTTERFLY_16x16_FIRST_SHIFT;
+    uint8 second_shift = (8 == size) ? EVX_BUTTERFLY_SECOND_SHIFT : EVX_BUTTERFLY_16x16_SECOND_SHIFT;
+
+    if (8 == size)
+    {
+        // An 8x8 block is a single tile, with a line in every lane.
+        __m256i output[8];
+
+        transpose_8x8_epi32_avx2(block, 1);
+        forward_butterfly_8_avx2(block, output, first_shift);
+        transpose_8x8_epi32_avx2(output, 1);
+        forward_butterfly_8_avx2(output, block, second_shift);
+
+        return;
+    }
+
+    // Horizontal DCT-II
+    transpose_block_avx2(block, size >> 3);
+    forward_butterfly_columns_avx2(block, size, first_shift);
+
+    // Vertical DCT-II
+    transpose_block_avx2(block, size >> 3);
+    forward_butterfly_columns_avx2(block, size, second_shift);
+}
+
+static EVX_TARGET_AVX2 inline void inverse_transform_butterfly_block_avx2(__m256i *block, uint8 size)
+{
+    uint8 first_shift = (8 == size) ? EVX_BUTTERFLY_FIRST_SHIFT : EVX_BUTTERFLY_16x16_FIRST_SHIFT;
+    uint8 second_shift = (8 == size) ? EVX_BUTTERFLY_SECOND_SHIFT : EVX_BUTTERFLY_16x16_SECOND_SHIFT;
+
+    if (8 == size)
+    {
+        __m256i output[8];
+
+        inverse_butterfly_8_core_avx2(block, output);
+
+        for (uint32 k = 0; k < 8; ++k)
+        {
+            output[k] = descale_avx2(output[k], first_shift);
+        }
+
+        transpose_8x8_epi32_avx2(output, 1);
+        inverse_butterfly_8_core_avx2(output, block);
+
+        for (uint32 k = 0; k < 8; ++k)
+        {
+            block[k] = descale_avx2(block[k], second_shift);
+        }
+
+        transpose_8x8_epi32_avx2(block, 1);
+
+        return;
+    }
+
+    // Vertical IDCT-II
+    inverse_butterfly_columns_avx2(block, size, first_shift);
+
+    // Horizontal IDCT-II
+    transpose_block_avx2(block, size >> 3);
+    inverse_butterfly_columns_avx2(block, size, second_shift);
+    transpose_block_avx2(block, size >> 3);
+}
+
+static EVX_TARGET_AVX2 void transform_8x8_butterfly_avx2(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m256i block[8];
+
+    load_block_avx2(src, src_pitch, 8, block);
+    transform_butterfly_block_avx2(block, 8);
+    store_block_avx2(block, 8, dest, dest_pitch);
+}
+
+static EVX_TARGET_AVX2 void inverse_transform_8x8_butterfly_avx2(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m256i block[8];
+
+    load_block_avx2(src, src_pitch, 8, block);
+    inverse_transform_butterfly_block_avx2(block, 8);
+    store_block_avx2(block, 8, dest, dest_pitch);
+}
+
+static EVX_TARGET_AVX2 void sub_transform_8x8_butterfly_avx2(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m256i block[8];
+
+    load_sub_block_avx2(src, src_pitch, sub, sub_pitch, 8, block);
+    transform_butterfly_block_avx2(block, 8);
+    store_block_avx2(block, 8, dest, dest_pitch);
+}
+
+static EVX_TARGET_AVX2 void inverse_transform_add_8x8_butterfly_avx2(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m256i block[8];
+
+    load_block_avx2(src, src_pitch, 8, block);
+    inverse_transform_butterfly_block_avx2(block, 8);
+    store_add_block_avx2(block, 8, add, add_pitch, dest, dest_pitch);
+}
+
+static EVX_TARGET_AVX2 void transform_16x16_butterfly_avx2(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m256i block[32];
+
+    load_block_avx2(src, src_pitch, 16, block);
+    transform_butterfly_block_avx2(block, 16);
+    store_block_avx2(block, 16, dest, dest_pitch);
+}
+
+static EVX_TARGET_AVX2 void inverse_transform_16x16_butterfly_avx2(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m256i block[32];
+
+    load_block_avx2(src, src_pitch, 16, block);
+    inverse_transform_butterfly_block_avx2(block, 16);
+    store_block_avx2(block, 16, dest, dest_pitch);
+}
+
+static EVX_TARGET_AVX2 void sub_transform_16x16_butterfly_avx2(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m256i block[32];
+
+    load_sub_block_avx2(src, src_pitch, sub, sub_pitch, 16, block);
+    transform_butterfly_block_avx2(block, 16);
+    store_block_avx2(block, 16, dest, dest_pitch);
+}
+
+static EVX_TARGET_AVX2 void inverse_transform_add_16x16_butterfly_avx2(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch)
+{
+    __m256i block[32];
+
+    load_block_avx2(src, src_pitch, 16, block);
+    inverse_transform_butterfly_block_avx2(block, 16);
+    store_add_block_avx2(block, 16, add, add_pitch, dest, dest_pitch);
+}
+
+#endif // EVX_SIMD_X86_SUPPORTED
+
+static const evx_transform_kernels reference_transform_kernels = 
+{
+    transform_8x8,
+    inverse_transform_8x8,
+    sub_transform_8x8,
+    inverse_transform_add_8x8,
+    transform_16x16,
+    inverse_transform_16x16,
+    sub_transform_16x16,
+    inverse_transform_add_16x16,
+    EVX_TRANSFORM_MODE_REFERENCE,
+    EVX_SIMD_SCALAR,
+};
+
+static const evx_transform_kernels butterfly_transform_kernels = 
+{
+    transform_8x8_butterfly,
+    inverse_transform_8x8_butterfly,
+    sub_transform_8x8_butterfly,
+    inverse_transform_add_8x8_butterfly,
+    transform_16x16_butterfly,
+    inverse_transform_16x16_butterfly,
+    sub_transform_16x16_butterfly,
+    inverse_transform_add_16x16_butterfly,
+    EVX_TRANSFORM_MODE_BUTTERFLY,
+    EVX_SIMD_SCALAR,
+};
+
+#if defined (EVX_SIMD_X86_SUPPORTED)
+
+static const evx_transform_kernels sse2_reference_transform_kernels = 
+{
+    transform_8x8_sse2,
+    inverse_transform_8x8_sse2,
+    sub_transform_8x8_sse2,
+    inverse_transform_add_8x8_sse2,
+    transform_16x16_sse2,
+    inverse_transform_16x16_sse2,
+    sub_transform_16x16_sse2,
+    inverse_transform_add_16x16_sse2,
+    EVX_TRANSFORM_MODE_REFERENCE,
+    EVX_SIMD_SSE2,
+};
+
+static const evx_transform_kernels sse41_butterfly_transform_kernels = 
+{
+    transform_8x8_butterfly_sse41,
+    inverse_transform_8x8_butterfly_sse41,
+    sub_transform_8x8_butterfly_sse41,
+    inverse_transform_add_8x8_butterfly_sse41,
+    transform_16x16_butterfly_sse41,
+    inverse_transform_16x16_butterfly_sse41,
+    sub_transform_16x16_butterfly_sse41,
+    inverse_transform_add_16x16_butterfly_sse41,
+    EVX_TRANSFORM_MODE_BUTTERFLY,
+    EVX_SIMD_SSE41,
+};
+
+static const evx_transform_kernels avx2_butterfly_transform_kernels = 
+{
+    transform_8x8_butterfly_avx2,
+    inverse_transform_8x8_butterfly_avx2,
+    sub_transform_8x8_butterfly_avx2,
+    inverse_transform_add_8x8_butterfly_avx2,
+    transform_16x16_butterfly_avx2,
+    inverse_transform_16x16_butterfly_avx2,
+    sub_transform_16x16_butterfly_avx2,
+    inverse_transform_add_16x16_butterfly_avx2,
+    EVX_TRANSFORM_MODE_BUTTERFLY,
+    EVX_SIMD_AVX2,
+};
+
+#endif
+
+static const evx_transform_kernels *active_transform_kernels[EVX_TRANSFORM_MODE_COUNT] = { NULL };
+
+static const evx_transform_kernels *query_transform_kernels_by_level(EVX_TRANSFORM_MODE mode, EVX_SIMD_LEVEL level)
+{
+    if (EVX_TRANSFORM_MODE_BUTTERFLY == mode)
+    {
+        switch (level)
+        {
+#if defined (EVX_SIMD_X86_SUPPORTED)
+            case EVX_SIMD_AVX2: return &avx2_butterfly_transform_kernels;
+            case EVX_SIMD_SSE41: return &sse41_butterfly_transform_kernels;
+#endif
+            default: break;
+        };
+
+        return &butterfly_transform_kernels;
+    }
+
+    switch (level)
+    {
+#if defined (EVX_SIMD_X86_SUPPORTED)
+        case EVX_SIMD_AVX2:
+        case EVX_SIMD_SSE41:
+        case EVX_SIMD_SSE2: return &sse2_reference_transform_kernels;
+#endif
+        default: break;
+    };
+
+    return &reference_transform_kernels;
+}
+
+const evx_transform_kernels &query_transform_kernels(EVX_TRANSFORM_MODE mode)
+{
+    // Unknown modes use the reference transforms.
+    if (EVX_TRANSFORM_MODE_BUTTERFLY != mode)
+    {
+        mode = EVX_TRANSFORM_MODE_REFERENCE;
+    }
+
+    // The default kernels are selected once, on first use, by thread safe local statics.
+    // active_transform_kernels only holds an override from select_transform_kernels.
+    static const evx_transform_kernels *default_kernels[EVX_TRANSFORM_MODE_COUNT] = 
+    {
+        query_transform_kernels_by_level(EVX_TRANSFORM_MODE_REFERENCE, query_simd_level()),
+        query_transform_kernels_by_level(EVX_TRANSFORM_MODE_BUTTERFLY, query_simd_level()),
+    };
+
+    return active_transform_kernels[mode] ? *active_transform_kernels[mode] : *default_kernels[mode];
+}
+
+evx_status select_transform_kernels(EVX_SIMD_LEVEL level)
+{
+    if (level > query_simd_level())
+    {
+        return evx_post_error(EVX_ERROR_NOTIMPL);
+    }
+
+    active_transform_kernels[EVX_TRANSFORM_MODE_REFERENCE] = query_transform_kernels_by_level(EVX_TRANSFORM_MODE_REFERENCE, level);
+    active_transform_kernels[EVX_TRANSFORM_MODE_BUTTERFLY] = query_transform_kernels_by_level(EVX_TRANSFORM_MODE_BUTTERFLY, level);
+
+    return EVX_SUCCESS;
+}
+
+} // namespace evx
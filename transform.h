@@ -34,7 +34,9 @@
 #define __EVX_TRANSFORM_H__
 
 #include "base.h"
+#include "cpu.h"
 #include "math.h"
+#include "types.h"
 
 namespace evx {
 
@@ -63,6 +65,45 @@ void inverse_transform_16x16(int16 *src, uint32 src_pitch, int16 *dest, uint32 d
 void sub_transform_16x16(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch);
 void inverse_transform_add_16x16(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch);
 
+// Butterfly transforms. These compute the same transforms as the functions above, but 
+// factor them into fixed point butterflies, see EVX_TRANSFORM_MODE_BUTTERFLY. Results 
+// match the reference to within rounding, but are not bit-exact with it.
+void transform_8x8_butterfly(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch);
+void inverse_transform_8x8_butterfly(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch);
+
+void sub_transform_8x8_butterfly(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch);
+void inverse_transform_add_8x8_butterfly(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch);
+
+void transform_16x16_butterfly(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch);
+void inverse_transform_16x16_butterfly(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch);
+
+void sub_transform_16x16_butterfly(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch);
+void inverse_transform_add_16x16_butterfly(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch);
+
+typedef struct evx_transform_kernels
+{
+    void (*transform_8x8)(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch);
+    void (*inverse_transform_8x8)(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch);
+    void (*sub_transform_8x8)(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch);
+    void (*inverse_transform_add_8x8)(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch);
+    void (*transform_16x16)(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch);
+    void (*inverse_transform_16x16)(int16 *src, uint32 src_pitch, int16 *dest, uint32 dest_pitch);
+    void (*sub_transform_16x16)(int16 *src, uint32 src_pitch, int16 *sub, uint32 sub_pitch, int16 *dest, uint32 dest_pitch);
+    void (*inverse_transform_add_16x16)(int16 *src, uint32 src_pitch, int16 *add, uint32 add_pitch, int16 *dest, uint32 dest_pitch);
+    EVX_TRANSFORM_MODE mode;
+    EVX_SIMD_LEVEL level;
+
+} evx_transform_kernels;
+
+// Returns the macroblock transforms of the requested transform mode. By default these 
+// are the fastest kernels that are supported by the host processor, all of which are
+// bit-exact with the scalar transforms above.
+const evx_transform_kernels &query_transform_kernels(EVX_TRANSFORM_MODE mode);
+
+// Overrides the active kernels of every transform mode, e.g. to compare against the 
+// scalar reference. Fails if the requested level is not supported by the host processor.
+evx_status select_transform_kernels(EVX_SIMD_LEVEL level);
+
 } // namespace evx
 
 #endif // __EVX_TRANSFORM_H__
@@ -56,6 +56,43 @@ enum EVX_CHANNEL_TYPE
     EVX_CHANNEL_FORCE_UINT8     = 0x7F
 };
 
+// Entropy modes
+//  abac            golomb precoded values are coded by the adaptive binary entropy_coder.
+//  range           syntax elements are coded as whole symbols by the range_coder.
+//  context         golomb binarized values are coded by the entropy_coder against a bank
+//                  of contexts selected by syntax element, bit position and neighbour.
+//  huffman         syntax elements are coded with static canonical huffman tables, which
+//                  decode with a table lookup and no arithmetic coding.
+
+enum EVX_ENTROPY_MODE
+{
+    EVX_ENTROPY_MODE_ABAC       = 0,
+    EVX_ENTROPY_MODE_RANGE      = 1,
+    EVX_ENTROPY_MODE_CONTEXT    = 2,
+    EVX_ENTROPY_MODE_HUFFMAN    = 3,
+    EVX_ENTROPY_MODE_COUNT      = 4,
+    EVX_ENTROPY_FORCE_UINT8     = 0x7F
+};
+
+// Transform modes
+//  reference       direct products against the trig tables of xftables.h.
+//  butterfly       fixed point factorization after Loeffler'89. Streams that predate
+//                  the transform mode always use the reference transforms.
+//
+// Adaptive modes select the luma transform size per macroblock, between four 8x8 
+// blocks and a single 16x16 block. The reference mode always uses 8x8 blocks, which 
+// keeps its streams identical to those that predate the adaptive transforms.
+
+enum EVX_TRANSFORM_MODE
+{
+    EVX_TRANSFORM_MODE_REFERENCE    = 0,
+    EVX_TRANSFORM_MODE_BUTTERFLY    = 1,
+    EVX_TRANSFORM_MODE_COUNT        = 2,
+    EVX_TRANSFORM_FORCE_UINT8       = 0x7F
+};
+
+#define EVX_IS_ADAPTIVE_TRANSFORM_MODE(mode) (EVX_TRANSFORM_MODE_BUTTERFLY == (mode))
+
 // Block types
 //                             source          motion?          operation
 //  intra block default        i               n                copy
@@ -74,6 +111,19 @@ enum EVX_CHANNEL_TYPE
 #define EVX_SET_MOTION_BLOCK_TYPE_BIT(type, mode) ((type) = (EVX_BLOCK_TYPE) (((type) & ~0x2) | (!!(mode) << 1)))
 #define EVX_SET_COPY_BLOCK_TYPE_BIT(type, mode) ((type) = (EVX_BLOCK_TYPE) (((type) & ~0x4) | (!!(mode) << 2)))
 
+// Stream statistics describe how the bits of the most recent frame were spent. Counts
+// are taken at the output of the entropy coder, and are approximate in the range and
+// context modes, which emit their output with a delay of a few bytes.
+
+typedef struct evx_stream_stats
+{
+    uint32 frame_bits;              // size of the coded slices, excluding the frame header.
+    uint32 motion_vector_bits;      // motion vector runs and differences.
+    uint32 motion_vector_count;     // number of motion blocks in the frame.
+    uint32 zero_block_count;        // delta blocks coded without a transform, see EVX_ZERO_BLOCK_DETECTION.
+
+} evx_stream_stats;
+
 enum EVX_BLOCK_TYPE
 {
     EVX_BLOCK_INTRA_DEFAULT         = EVX_MAKE_BLOCK_TYPE_CODE(true, false, false),
@@ -4,15 +4,41 @@
 #include "common.h"
 #include "stream.h"
 #include "macroblock.h"
+#include "motion.h"
 
 namespace evx {
 
-evx_status unserialize_block_8x8(bit_stream *input, int16 last_dc, bit_stream *feed_stream, entropy_coder *coder, int16 *cache, int16 *dest, uint32 dest_width)
+int16 query_last_luma_dc(image *source_image, const evx_block_desc *block_table, uint32 block_index, uint32 width_in_blocks, 
+                         int32 i, int32 j, int32 first_y, uint8 coded_pattern);
+
+static evx_status unserialize_staged_block(symbol_coder *coder, const uint8 *scan, uint16 coefficient_count, int16 last_dc, int16 *cache)
 {
-    entropy_rle_stream_decode_8x8(input, coder, feed_stream, cache);
+    uint16 run_length = 0;
+
+    memset(cache, 0, sizeof(int16) * coefficient_count);
+
+    if (evx_failed(coder->decode_value(EVX_SYNTAX_RUN_LENGTH, &run_length)) || run_length > coefficient_count)
+    {
+        return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+    }
+
+    if (evx_failed(coder->decode_coefficients(run_length, cache, scan)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
 
     cache[0] = cache[0] + last_dc;  // Reconstruct our dc using the delta value.
 
+    return EVX_SUCCESS;
+}
+
+evx_status unserialize_block_8x8(symbol_coder *coder, int16 last_dc, int16 *cache, int16 *dest, uint32 dest_width)
+{
+    if (evx_failed(unserialize_staged_block(coder, EVX_MACROBLOCK_8x8_ZIGZAG, 64, last_dc, cache)))
+    {
+        return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+    }
+
     for (uint32 j = 0; j < 8; j++)
     {
         aligned_byte_copy(cache + j * 8, sizeof(int16) * 8, dest + j * dest_width);
@@ -21,31 +47,57 @@ evx_status unserialize_block_8x8(bit_stream *input, int16 last_dc, bit_stream *f
     return EVX_SUCCESS; 
 }
 
-evx_status unserialize_block_16x16(bit_stream *input, int16 last_dc, bit_stream *feed_stream, entropy_coder *coder, int16 *cache, int16 *dest, uint32 dest_width)
+evx_status unserialize_block_16x16(symbol_coder *coder, int16 last_dc, uint8 coded_pattern, int16 *cache, int16 *dest, uint32 dest_width)
 {
-    unserialize_block_8x8(input, last_dc, feed_stream, coder, cache, dest, dest_width);
-    unserialize_block_8x8(input, dest[0], feed_stream, coder, cache, dest + 8, dest_width);
-    unserialize_block_8x8(input, dest[0], feed_stream, coder, cache, dest + 8 * dest_width, dest_width);
-    unserialize_block_8x8(input, dest[8 * dest_width], feed_stream, coder, cache, dest + 8 * dest_width + 8, dest_width);
+    // Luma that was transformed as a single block holds a single run of 256 coefficients.
+    if (coded_pattern & EVX_CODED_PATTERN_LUMA_16x16)
+    {
+        if (evx_failed(unserialize_staged_block(coder, EVX_MACROBLOCK_16x16_TRANSFORM_ZIGZAG, 256, last_dc, cache)))
+        {
+            return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+        }
+
+        for (uint32 j = 0; j < 16; j++)
+        {
+            aligned_byte_copy(cache + j * 16, sizeof(int16) * 16, dest + j * dest_width);
+        }
+
+        return EVX_SUCCESS;
+    }
+
+    // Uncoded blocks are zero filled so that the dc predictions of their neighbours
+    // match those of the encoder.
+    for (uint32 i = 0; i < 4; i++)
+    {
+        if (!(coded_pattern & (0x1 << i)))
+        {
+            zero_block_8x8(dest + EVX_LUMA_BLOCK_OFFSET(i, dest_width), dest_width);
+        }
+    }
+
+    if (((coded_pattern & 0x1) && evx_failed(unserialize_block_8x8(coder, last_dc, cache, dest, dest_width))) ||
+        ((coded_pattern & 0x2) && evx_failed(unserialize_block_8x8(coder, dest[0], cache, dest + 8, dest_width))) ||
+        ((coded_pattern & 0x4) && evx_failed(unserialize_block_8x8(coder, dest[0], cache, dest + 8 * dest_width, dest_width))) ||
+        ((coded_pattern & 0x8) && evx_failed(unserialize_block_8x8(coder, dest[8 * dest_width], cache, dest + 8 * dest_width + 8, dest_width))))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
 
     return EVX_SUCCESS;
 }
 
-evx_status unserialize_image_blocks_16x16(bit_stream *input, evx_block_desc *block_table, bit_stream *feed_stream, entropy_coder *coder, int16 *cache_data, image *dest_image)
+evx_status unserialize_image_blocks_16x16(symbol_coder *coder, const evx_slice &slice, evx_block_desc *block_table, int16 *cache_data, image *dest_image)
 {
-    uint16 block_index = 0;
     uint32 width = dest_image->query_width();
-    uint32 height = dest_image->query_height();
+    uint16 block_index = slice.first_row * (width / EVX_MACROBLOCK_SIZE);
+    uint32 first_y = slice.first_row * EVX_MACROBLOCK_SIZE;
+    uint32 last_y = (slice.first_row + slice.row_count) * EVX_MACROBLOCK_SIZE;
 
-    feed_stream->empty();
-
-    for (int32 j = 0; j < height; j += EVX_MACROBLOCK_SIZE)
-    for (int32 i = 0; i < width; i += EVX_MACROBLOCK_SIZE)
+    for (uint32 j = first_y; j < last_y; j += EVX_MACROBLOCK_SIZE)
+    for (uint32 i = 0; i < width; i += EVX_MACROBLOCK_SIZE)
     {
         evx_block_desc *block_desc = &block_table[block_index++];
         
-        int16 last_dc = 0;
-        int16 *last_block_data = NULL;
         int16 *block_data = reinterpret_cast<int16 *>(dest_image->query_data() + dest_image->query_block_offset(i, j));
 
         // Copy blocks contain no residuals.
@@ -55,37 +107,27 @@ evx_status unserialize_image_blocks_16x16(bit_stream *input, evx_block_desc *blo
         }
 
         // Support delta dc coding
-        if (i >= EVX_MACROBLOCK_SIZE)
+        int16 last_dc = query_last_luma_dc(dest_image, block_table, block_index - 1, width / EVX_MACROBLOCK_SIZE, 
+                                           i, j, first_y, block_desc->coded_pattern);
+
+        if (evx_failed(unserialize_block_16x16(coder, last_dc, block_desc->coded_pattern, cache_data, block_data, width)))
         {
-            last_block_data = reinterpret_cast<int16 *>(dest_image->query_data() + dest_image->query_block_offset(i - (EVX_MACROBLOCK_SIZE >> 1), j));
-            last_dc = last_block_data[0];
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
         }
-        else
-        {
-            if (j >= EVX_MACROBLOCK_SIZE)
-            {
-                // i is zero, so we sample from the block above.
-                last_block_data = reinterpret_cast<int16 *>(dest_image->query_data() + dest_image->query_block_offset(i, j - (EVX_MACROBLOCK_SIZE >> 1)));
-                last_dc = last_block_data[0];
-            }
-        }
-
-        unserialize_block_16x16(input, last_dc, feed_stream, coder, cache_data, block_data, width);
     }
 
     return EVX_SUCCESS;
 }
 
-evx_status unserialize_image_blocks_8x8(bit_stream *input, evx_block_desc *block_table, bit_stream *feed_stream, entropy_coder *coder, int16 *cache_data, image *dest_image)
+evx_status unserialize_image_blocks_8x8(symbol_coder *coder, const evx_slice &slice, evx_block_desc *block_table, uint8 pattern_mask, int16 *cache_data, image *dest_image)
 {
-    uint16 block_index = 0;
     uint32 width = dest_image->query_width();
-    uint32 height = dest_image->query_height();
+    uint16 block_index = slice.first_row * (width / (EVX_MACROBLOCK_SIZE >> 1));
+    uint32 first_y = slice.first_row * (EVX_MACROBLOCK_SIZE >> 1);
+    uint32 last_y = (slice.first_row + slice.row_count) * (EVX_MACROBLOCK_SIZE >> 1);
 
-    feed_stream->empty();
-   
-    for (int32 j = 0; j < height; j += (EVX_MACROBLOCK_SIZE >> 1))
-    for (int32 i = 0; i < width; i += (EVX_MACROBLOCK_SIZE >> 1))
+    for (uint32 j = first_y; j < last_y; j += (EVX_MACROBLOCK_SIZE >> 1))
+    for (uint32 i = 0; i < width; i += (EVX_MACROBLOCK_SIZE >> 1))
     {
         evx_block_desc *block_desc = &block_table[block_index++];
 
@@ -99,6 +141,12 @@ evx_status unserialize_image_blocks_8x8(bit_stream *input, evx_block_desc *block
             continue;
         }
 
+        if (!(block_desc->coded_pattern & pattern_mask))
+        {
+            zero_block_8x8(block_data, width);
+            continue;
+        }
+
         // Support delta dc coding
         if (i >= (EVX_MACROBLOCK_SIZE >> 1))
         {
@@ -107,42 +155,45 @@ evx_status unserialize_image_blocks_8x8(bit_stream *input, evx_block_desc *block
         }
         else
         {
-            if (j >= (EVX_MACROBLOCK_SIZE >> 1))
+            if (j >= first_y + (EVX_MACROBLOCK_SIZE >> 1))
             {
-                // i is zero, so we sample from the block above.
+                // i is zero, so we sample from the block above (within the slice).
                 last_block_data = reinterpret_cast<int16 *>(dest_image->query_data() + dest_image->query_block_offset(i, j - (EVX_MACROBLOCK_SIZE >> 1)));
                 last_dc = last_block_data[0];
             }
         }
 
-        unserialize_block_8x8(input, last_dc, feed_stream, coder, cache_data, block_data, width);
+        if (evx_failed(unserialize_block_8x8(coder, last_dc, cache_data, block_data, width)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
     }
 
     return EVX_SUCCESS;
 }
 
-evx_status unserialize_macroblocks(bit_stream *input, evx_context *context)
+evx_status unserialize_macroblocks(evx_context *context, evx_slice *slice)
 {
     image *y_image = context->cache_bank.input_cache.query_y_image();
     image *u_image = context->cache_bank.input_cache.query_u_image();
     image *v_image = context->cache_bank.input_cache.query_v_image();
 
-    if (evx_failed(unserialize_image_blocks_16x16(input, context->block_table, &context->feed_stream,
-                   &context->arith_coder, context->cache_bank.staging_block.data_y, y_image)))
+    if (evx_failed(unserialize_image_blocks_16x16(&slice->coder, *slice, context->block_table,
+                   slice->staging_block.data_y, y_image)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
 #if EVX_ENABLE_CHROMA_SUPPORT
 
-    if (evx_failed(unserialize_image_blocks_8x8(input, context->block_table, &context->feed_stream,
-                   &context->arith_coder, context->cache_bank.staging_block.data_u, u_image)))
+    if (evx_failed(unserialize_image_blocks_8x8(&slice->coder, *slice, context->block_table,
+                   EVX_CODED_PATTERN_U, slice->staging_block.data_u, u_image)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    if (evx_failed(unserialize_image_blocks_8x8(input, context->block_table, &context->feed_stream,
-                   &context->arith_coder, context->cache_bank.staging_block.data_v, v_image)))
+    if (evx_failed(unserialize_image_blocks_8x8(&slice->coder, *slice, context->block_table,
+                   EVX_CODED_PATTERN_V, slice->staging_block.data_v, v_image)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
@@ -152,23 +203,43 @@ evx_status unserialize_macroblocks(bit_stream *input, evx_context *context)
     return EVX_SUCCESS;
 }
 
-evx_status unserialize_block_types(uint16 block_count, bit_stream *input, bit_stream *feed_stream, entropy_coder *coder, evx_block_desc *block_table)
+evx_status unserialize_block_types(uint16 block_count, symbol_coder *coder, evx_block_desc *block_table)
 {
-    feed_stream->empty();
+    uint32 i = 0;
 
-    for (uint32 i = 0; i < block_count; i++)
+    while (i < block_count)
     {
-        coder->decode(3, input, feed_stream, false);
-        feed_stream->read_bits(&block_table[i].block_type, 3);
+        uint8 block_type = 0;
+        uint16 skip_run = 0;
+
+        if (evx_failed(coder->decode_value(EVX_SYNTAX_SKIP_RUN, &skip_run)) || skip_run > block_count - i)
+        {
+            return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+        }
+
+        for (uint32 end = i + skip_run; i < end; i++)
+        {
+            block_table[i].block_type = EVX_BLOCK_INTER_COPY;
+        }
+
+        if (i == block_count)
+        {
+            break;
+        }
+
+        if (evx_failed(coder->decode_bits(EVX_SYNTAX_BLOCK_TYPE, 3, &block_type)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        block_table[i++].block_type = (EVX_BLOCK_TYPE) block_type;
     }
 
     return EVX_SUCCESS;
 }
 
-evx_status unserialize_prediction_targets(uint16 block_count, bit_stream *input, bit_stream *feed_stream, entropy_coder *coder, evx_block_desc *block_table)
+evx_status unserialize_prediction_targets(uint16 block_count, symbol_coder *coder, evx_block_desc *block_table)
 {
-    feed_stream->empty();
-
     for (uint32 i = 0; i < block_count; i++)
     {
         if (EVX_IS_INTRA_BLOCK_TYPE(block_table[i].block_type))
@@ -177,19 +248,21 @@ evx_status unserialize_prediction_targets(uint16 block_count, bit_stream *input,
         }
 
         uint8 bit_count = log2((uint8) EVX_REFERENCE_FRAME_COUNT);
-        coder->decode(bit_count, input, feed_stream, false);
-        feed_stream->read_bits(&block_table[i].prediction_target, bit_count);
+
+        if (evx_failed(coder->decode_bits(EVX_SYNTAX_PREDICTION_TARGET, bit_count, &block_table[i].prediction_target)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
     }
 
     return EVX_SUCCESS;
 }
 
-evx_status unserialize_motion_vectors(uint16 block_count, bit_stream *input, bit_stream *feed_stream, entropy_coder *coder, evx_block_desc *block_table)
+evx_status unserialize_motion_vectors(uint16 block_count, uint32 width_in_blocks, symbol_coder *coder, evx_block_desc *block_table)
 {
-    feed_stream->empty();
-    int16 last_x = 0, last_y = 0;
+    uint16 motion_run = 0;
+    bool run_decoded = false;
 
-    // Decode our x component differences.
     for (uint32 i = 0; i < block_count; i++)
     {
         if (!EVX_IS_MOTION_BLOCK_TYPE(block_table[i].block_type))
@@ -197,32 +270,47 @@ evx_status unserialize_motion_vectors(uint16 block_count, bit_stream *input, bit
             continue;
         }
 
-        int16 current_x = 0;
-        entropy_stream_decode_value(input, coder, feed_stream, &current_x);
-        block_table[i].motion_x = last_x + current_x;
-        last_x = block_table[i].motion_x;
-    }
+        // Each run is followed by a difference, unless the run reaches the end of the table.
+        if (!run_decoded)
+        {
+            if (evx_failed(coder->decode_value(EVX_SYNTAX_MOTION_RUN, &motion_run)))
+            {
+                return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+            }
 
-    // Decode our y component differences.
-    for (uint32 i = 0; i < block_count; i++)
-    {
-        if (!EVX_IS_MOTION_BLOCK_TYPE(block_table[i].block_type))
+            run_decoded = true;
+        }
+
+        int16 pred_x = 0, pred_y = 0;
+        query_motion_vector_prediction(block_table, width_in_blocks, i, &pred_x, &pred_y);
+
+        if (motion_run)
         {
+            block_table[i].motion_x = pred_x;
+            block_table[i].motion_y = pred_y;
+            motion_run--;
             continue;
         }
 
-        int16 current_y = 0;
-        entropy_stream_decode_value(input, coder, feed_stream, &current_y);
-        block_table[i].motion_y = last_y + current_y;
-        last_y = block_table[i].motion_y;
+        int16 current_x = 0, current_y = 0;
+
+        if (evx_failed(coder->decode_value(EVX_SYNTAX_MOTION_X, &current_x)) ||
+            evx_failed(coder->decode_value(EVX_SYNTAX_MOTION_Y, &current_y)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        block_table[i].motion_x = pred_x + current_x;
+        block_table[i].motion_y = pred_y + current_y;
+        run_decoded = false;
     }
 
     return EVX_SUCCESS;
 }
 
-evx_status unserialize_subpixel_motion_params(uint16 block_count, bit_stream *input, bit_stream *feed_stream, entropy_coder *coder, evx_block_desc *block_table)
+evx_status unserialize_subpixel_motion_params(uint16 block_count, symbol_coder *coder, evx_block_desc *block_table)
 {
-    feed_stream->empty();
+    uint8 value = 0;
 
     // Subpixel prediction enabled bit
     for (uint32 i = 0; i < block_count; i++)
@@ -232,8 +320,8 @@ evx_status unserialize_subpixel_motion_params(uint16 block_count, bit_stream *in
             continue;
         }
 
-        coder->decode(1, input, feed_stream, false);
-        feed_stream->read_bit(&block_table[i].sp_pred);
+        coder->decode_bits(EVX_SYNTAX_SUBPEL_ENABLED, 1, &value);
+        block_table[i].sp_pred = !!value;
     }
 
     // Subpixel level bit.
@@ -247,8 +335,8 @@ evx_status unserialize_subpixel_motion_params(uint16 block_count, bit_stream *in
             continue;
         }
 
-        coder->decode(1, input, feed_stream, false);
-        feed_stream->read_bit(&block_table[i].sp_amount);
+        coder->decode_bits(EVX_SYNTAX_SUBPEL_AMOUNT, 1, &value);
+        block_table[i].sp_amount = !!value;
     }
 
     // Subpixel direction (degree) bits.
@@ -260,17 +348,15 @@ evx_status unserialize_subpixel_motion_params(uint16 block_count, bit_stream *in
             continue;
         }
 
-        coder->decode(3, input, feed_stream, false);
-        feed_stream->read_bits(&block_table[i].sp_index, 3);
+        coder->decode_bits(EVX_SYNTAX_SUBPEL_INDEX, 3, &block_table[i].sp_index);
     }
 
     return EVX_SUCCESS;
 }
 
-evx_status unserialize_block_quality(uint16 block_count, bit_stream *input, bit_stream *feed_stream, entropy_coder *coder, evx_block_desc *block_table)
+evx_status unserialize_block_quality(uint16 block_count, symbol_coder *coder, evx_block_desc *block_table)
 {
     int16 last_q = 0; 
-    feed_stream->empty();
 
     for (uint32 i = 0; i < block_count; i++)
     {
@@ -280,7 +366,12 @@ evx_status unserialize_block_quality(uint16 block_count, bit_stream *input, bit_
         }
 
         int16 current_q = 0;
-        entropy_stream_decode_value(input, coder, feed_stream, &current_q);
+
+        if (evx_failed(coder->decode_value(EVX_SYNTAX_BLOCK_QUALITY, &current_q)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
         block_table[i].q_index = current_q + last_q;
         last_q = block_table[i].q_index;
     }
@@ -288,29 +379,74 @@ evx_status unserialize_block_quality(uint16 block_count, bit_stream *input, bit_
     return EVX_SUCCESS;
 }
 
-evx_status unserialize_block_table(uint16 block_count, bit_stream *input, bit_stream *feed_stream, entropy_coder *coder, evx_block_desc *block_table)
+evx_status unserialize_coded_patterns(uint16 block_count, EVX_TRANSFORM_MODE transform_mode, symbol_coder *coder, evx_block_desc *block_table)
+{
+    for (uint32 i = 0; i < block_count; i++)
+    {
+        uint8 luma_pattern = 0;
+        uint8 transform_size = 0;
+        uint8 chroma_pattern = 0;
+
+        block_table[i].coded_pattern = 0;
+
+        if (EVX_IS_COPY_BLOCK_TYPE(block_table[i].block_type))
+        {
+            continue;
+        }
+
+        if (evx_failed(coder->decode_bits(EVX_SYNTAX_LUMA_PATTERN, 4, &luma_pattern)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+        if (EVX_IS_ADAPTIVE_TRANSFORM_MODE(transform_mode) && EVX_CODED_PATTERN_LUMA == (luma_pattern & EVX_CODED_PATTERN_LUMA) &&
+            evx_failed(coder->decode_bits(EVX_SYNTAX_TRANSFORM_SIZE, 1, &transform_size)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+
+#if EVX_ENABLE_CHROMA_SUPPORT
+        if (evx_failed(coder->decode_bits(EVX_SYNTAX_CHROMA_PATTERN, 2, &chroma_pattern)))
+        {
+            return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+        }
+#endif
+
+        block_table[i].coded_pattern = (luma_pattern & EVX_CODED_PATTERN_LUMA) | ((chroma_pattern & 0x3) << 4) | 
+                                       (transform_size ? EVX_CODED_PATTERN_LUMA_16x16 : 0);
+    }
+
+    return EVX_SUCCESS;
+}
+
+evx_status unserialize_block_table(uint16 block_count, uint32 width_in_blocks, EVX_TRANSFORM_MODE transform_mode, symbol_coder *coder, evx_block_desc *block_table)
 {
-    if (evx_failed(unserialize_block_types(block_count, input, feed_stream, coder, block_table)))
+    if (evx_failed(unserialize_block_types(block_count, coder, block_table)))
+    {
+        return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
+    }
+
+    if (evx_failed(unserialize_prediction_targets(block_count, coder, block_table)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    if (evx_failed(unserialize_prediction_targets(block_count, input, feed_stream, coder, block_table)))
+    if (evx_failed(unserialize_motion_vectors(block_count, width_in_blocks, coder, block_table)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    if (evx_failed(unserialize_motion_vectors(block_count, input, feed_stream, coder, block_table)))
+    if (evx_failed(unserialize_subpixel_motion_params(block_count, coder, block_table)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    if (evx_failed(unserialize_subpixel_motion_params(block_count, input, feed_stream, coder, block_table)))
+    if (evx_failed(unserialize_block_quality(block_count, coder, block_table)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
-    if (evx_failed(unserialize_block_quality(block_count, input, feed_stream, coder, block_table)))
+    if (evx_failed(unserialize_coded_patterns(block_count, transform_mode, coder, block_table)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
@@ -318,21 +454,25 @@ evx_status unserialize_block_table(uint16 block_count, bit_stream *input, bit_st
     return EVX_SUCCESS;
 }
 
-evx_status unserialize_slice(bit_stream *input, evx_context *context)
+evx_status unserialize_slice(evx_context *context, evx_slice *slice)
 {
-    uint16 block_count = context->width_in_blocks * context->height_in_blocks;
+    uint16 block_count = context->width_in_blocks * slice->row_count;
+    evx_block_desc *block_table = &context->block_table[slice->first_row * context->width_in_blocks];
+    bit_stream *input = &slice->slice_stream;
 
-    context->arith_coder.clear();
-    context->arith_coder.start_decode(input);
+    if (evx_failed(slice->coder.start_decode(input)))
+    {
+        return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+    }
 
-    // Unserialize the encoded contents of our context, starting with the block table.
-    if (evx_failed(unserialize_block_table(block_count, input, &context->feed_stream, &context->arith_coder, context->block_table)))
+    // Unserialize the encoded contents of our slice, starting with the block table.
+    if (evx_failed(unserialize_block_table(block_count, context->width_in_blocks, context->transform_mode, &slice->coder, block_table)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
 
     // Unserialize all transformed and quantized residuals.
-    if (evx_failed(unserialize_macroblocks(input, context)))
+    if (evx_failed(unserialize_macroblocks(context, slice)))
     {
         return evx_post_error(EVX_ERROR_EXECUTION_FAILURE);
     }
@@ -340,4 +480,31 @@ evx_status unserialize_slice(bit_stream *input, evx_context *context)
     return EVX_SUCCESS;
 }
 
+evx_status unserialize_slices(bit_stream *input, evx_context *context)
+{
+    uint32 slice_sizes[EVX_MAX_SLICE_COUNT];
+
+    // Read the slice table, then split the frame into the per slice streams.
+    for (uint32 i = 0; i < context->slice_count; ++i)
+    {
+        if (evx_failed(input->read_bytes(&slice_sizes[i], sizeof(uint32))))
+        {
+            return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+        }
+    }
+
+    for (uint32 i = 0; i < context->slice_count; ++i)
+    {
+        bit_stream *slice_stream = &context->slices[i].slice_stream;
+        slice_stream->empty();
+
+        if (slice_sizes[i] && evx_failed(input->transfer_bytes(slice_stream, slice_sizes[i])))
+        {
+            return evx_post_error(EVX_ERROR_INVALID_RESOURCE);
+        }
+    }
+
+    return EVX_SUCCESS;
+}
+
 } // namespace evx
\ No newline at end of file
@@ -37,6 +37,12 @@
 #define EVX_VERSION_MINOR                         47      // auto-gen, do not modify!
 #define EVX_VERSION_CHANGELIST					  193     // auto-gen, do not modify!
 
+// The revision of the bitstream syntax, which is written to evx_header::version. Unlike the
+// build version above, this only changes with the syntax, and streams of any other revision
+// are rejected. 2.47 is the original syntax, which carried the build version of its release.
+#define EVX_FORMAT_VERSION_MAJOR                  2
+#define EVX_FORMAT_VERSION_MINOR                  48
+
 #define EVX_VERSION_WORD(major, minor)            ((((major) & 0xFF) << 8) | ((minor) & 0xFF))
 #define EVX_MAJOR_VERSION(x)                      (((x) >> 8) & 0xFF)
 #define EVX_MINOR_VERSION(x)                      ((x) & 0xFF)
@@ -86,6 +86,25 @@ const int16 EVX_TRANSFORM_16x16_TRIG_128_LUT[] =
      13,  -37,   60,  -81,   99, -113,  122, -127,  127, -122,  113,  -99,   81,  -60,   37,  -13,
 };
 
+// This table stores the odd half of the 16 point DCT-II used by the butterfly transforms, 
+// which maps the eight differences x[n] - x[15 - n] to the odd coefficients. Entries are 
+// scaled by sqrt(2) so that both halves of the transform share a scale of four, and are
+// in fixed point with 13 bits of fraction:
+//
+//    EVX_TRANSFORM_16x16_ODD_FIX_LUT[k * 8 + n] = sqrt(2) * cos(((2 * n + 1) * (2 * k + 1) * EVX_PI) / 32)
+
+const int16 EVX_TRANSFORM_16x16_ODD_FIX_LUT[] = 
+{
+    11529,  11086,  10217,   8956,   7350,   5461,   3363,   1136,
+    11086,   7350,   1136,  -5461, -10217, -11529,  -8956,  -3363,
+    10217,   1136,  -8956, -11086,  -3363,   7350,  11529,   5461,
+     8956,  -5461, -11086,   1136,  11529,   3363, -10217,  -7350,
+     7350, -10217,  -3363,  11529,  -1136, -11086,   5461,   8956,
+     5461, -11529,   7350,   3363, -11086,   8956,   1136, -10217,
+     3363,  -8956,  11529, -10217,   5461,   1136,  -7350,  11086,
+     1136,  -3363,   5461,  -7350,   8956, -10217,  11086, -11529,
+};
+
 } // namespace evx
 
 #endif // __EVX_TRANSFORM_TABLES_H__
\ No newline at end of file